@@ -19,6 +19,11 @@ struct CbMaterial
     int NormalTexture;
     int OcclusionTexture;
     float4 BaseColorFactor;
+    // -1 when the texture has its own resource, otherwise the slice in the shared texture array.
+    int BaseColorSlice;
+    int MetallicRoughnessSlice;
+    int NormalSlice;
+    int OcclusionSlice;
 };
 struct Light
 {
@@ -37,10 +42,18 @@ ConstantBuffer<CbMaterial> cbMaterial : register(b2);
 ConstantBuffer<CbLight> cbLight : register(b3);
 
 Texture2D<float4> Textures[10000] : register(t0);
+Texture2DArray<float4> TextureArrays[10000] : register(t0, space1); // Aliases Textures.
 
 SamplerState LinearClampSampler : register(s0);
 SamplerState LinearWrapSampler : register(s1);
 
+float4 SampleMaterialTexture(int index, int slice, float2 uv)
+{
+    if (slice < 0)
+        return Textures[index].Sample(LinearWrapSampler, uv);
+    return TextureArrays[index].Sample(LinearWrapSampler, float3(uv, slice));
+}
+
 struct vIn
 {
     float3 pos : POSITION;
@@ -72,13 +85,13 @@ vOut vs(vIn i)
 
 float4 ps(vOut i) : SV_Target
 {
-    float4 t = Textures[cbMaterial.BaseColorTexture].Sample(LinearWrapSampler, i.uv);
+    float4 t = SampleMaterialTexture(cbMaterial.BaseColorTexture, cbMaterial.BaseColorSlice, i.uv);
     float3 normal = normalize(i.norm);
     float3 tangent = normalize(i.tangent.xyz);
     float3 bitangent = cross(normal, tangent) * i.tangent.w;
     float3x3 tbn = float3x3(tangent, bitangent, normal);
 
-    float3 bumpNorm = Textures[cbMaterial.NormalTexture].Sample(LinearWrapSampler, i.uv).xyz * 2.0f - 1.0f;
+    float3 bumpNorm = UnpackNormal(SampleMaterialTexture(cbMaterial.NormalTexture, cbMaterial.NormalSlice, i.uv).xy);
     bumpNorm = normalize(mul(bumpNorm, tbn));
 
     float3 bp = BlinnPhong(cbLight.Lights[0].Direction, cbLight.Lights[0].Color, cbCamera.Position, i.wpos, bumpNorm);
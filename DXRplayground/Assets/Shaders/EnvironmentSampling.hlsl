@@ -0,0 +1,60 @@
+#ifndef ENVIRONMENT_SAMPLING_HLSL
+#define ENVIRONMENT_SAMPLING_HLSL
+
+// Reads the tables built by EnvironmentSampling on the CPU: the marginal CDF, the conditional CDFs of the rows and the texel pdfs
+// one after another. size is the tables width and height.
+
+#define ENV_PI 3.14159265358979323846f
+
+// The first entry greater than xi, the last entry of a CDF is 1.
+uint FindInterval(StructuredBuffer<float> tables, uint first, uint count, float xi)
+{
+    uint begin = 0;
+    uint end = count - 1;
+    while (begin < end)
+    {
+        uint middle = (begin + end) / 2;
+        if (tables[first + middle] > xi)
+            end = middle;
+        else
+            begin = middle + 1;
+    }
+    return begin;
+}
+
+float GetIntervalOffset(StructuredBuffer<float> tables, uint first, uint index, float xi)
+{
+    float begin = index == 0 ? 0.0f : tables[first + index - 1];
+    float size = tables[first + index] - begin;
+    return size > 0.0f ? min((xi - begin) / size, 0.99999994f) : 0.5f;
+}
+
+// xi is uniform in [0, 1)^2. Returns the direction, pdf is over the solid angle.
+float3 SampleEnvironment(StructuredBuffer<float> tables, uint2 size, float2 xi, out float pdf)
+{
+    uint y = FindInterval(tables, 0, size.y, xi.x);
+    uint rowStart = size.y + y * size.x;
+    uint x = FindInterval(tables, rowStart, size.x, xi.y);
+    float u = (x + GetIntervalOffset(tables, rowStart, x, xi.y)) / size.x;
+    float v = (y + GetIntervalOffset(tables, 0, y, xi.x)) / size.y;
+
+    // The same parametrization as CubemapConverter::GetEquirectCoords.
+    float theta = u * 2.0f * ENV_PI - ENV_PI;
+    float phi = 0.5f * ENV_PI - v * ENV_PI;
+    float cosPhi = cos(phi);
+    pdf = tables[size.y + size.x * size.y + y * size.x + x] / max(2.0f * ENV_PI * ENV_PI * cosPhi, 1e-6f);
+    return float3(cosPhi * sin(theta), sin(phi), cosPhi * cos(theta));
+}
+
+// For directions sampled some other way, e.g. by the BRDF when the samples are combined with MIS.
+float GetEnvironmentPdf(StructuredBuffer<float> tables, uint2 size, float3 dir)
+{
+    float u = (atan2(dir.x, dir.z) + ENV_PI) / (2.0f * ENV_PI);
+    float v = acos(clamp(dir.y, -1.0f, 1.0f)) / ENV_PI;
+    uint x = min(uint(u * size.x), size.x - 1);
+    uint y = min(uint(v * size.y), size.y - 1);
+    float sinTheta = sqrt(saturate(1.0f - dir.y * dir.y));
+    return tables[size.y + size.x * size.y + y * size.x + x] / max(2.0f * ENV_PI * ENV_PI * sinTheta, 1e-6f);
+}
+
+#endif
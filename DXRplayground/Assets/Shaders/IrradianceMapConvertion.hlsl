@@ -1,20 +1,17 @@
-RWTexture2DArray<float4> irrMap : register(u0);
-TextureCube<float4> envMap : register(t0);
-
-SamplerState LinearClampSampler : register(s0);
+#include "SphericalHarmonics.hlsl"
 
-#define PI 3.14159265358979323846f
-#define PI_2 (PI / 2.0f)
+RWTexture2DArray<float4> irrMap : register(u0);
 
 struct Data
 {
-    float2 sizeDstSrc;
+    float4 IrradianceSH[9]; // Already convolved with the cosine lobe on the CPU.
+    float Size;
 };
 ConstantBuffer<Data> data : register(b0);
 
 float3 RemapToXYZ(uint3 tId, float size)
 {
-    float2 coord = tId.xy / size;
+    float2 coord = (tId.xy + 0.5f) / size;
     uint face = uint(tId.z);
     coord = coord * 2.0f - 1.0f;
 
@@ -38,28 +35,7 @@ float3 RemapToXYZ(uint3 tId, float size)
 [numthreads(32, 32, 1)]
 void cs(uint3 tId : SV_DispatchThreadID)
 {
-    float3 N = normalize(RemapToXYZ(tId, data.sizeDstSrc.x));
-    float3 irradiance = float3(0.0f, 0.0f, 0.0f);
-    float w = 0;
-    for (uint i = 0; i < data.sizeDstSrc.y; ++i)
-    {
-        for (uint j = 0; j < data.sizeDstSrc.y; ++j)
-        {
-            for (uint f = 0; f < 6; ++f)
-            {
-                float3 dir = normalize(RemapToXYZ(uint3(i, j, f), data.sizeDstSrc.y));
-                float cosAngle = dot(N, dir);
-                if (cosAngle <= 0.0)
-                    continue;
-                // todo: take solid angle into account (sin)
-                float sinAngle = 1;// sqrt(1 - cosAngle * cosAngle);
-                float currWeight = sinAngle * cosAngle;
-                irradiance += clamp(envMap.SampleLevel(LinearClampSampler, dir, 0).rgb, 0.0f, 2.0f) * cosAngle * sinAngle;
-                w += (cosAngle * sinAngle);
-            }
-        }
-    }
-    irradiance /= w;
-    irrMap[tId] = float4(irradiance, 1.0f);// envMap.SampleLevel(LinearClampSampler, N, 0).rgba;// float4(irradiance, 1.0f); //envMap.SampleLevel(LinearClampSampler, N, 0);
-    //irrMap[tId] = float4(N, 1);
-}
\ No newline at end of file
+    float3 N = normalize(RemapToXYZ(tId, data.Size));
+    // Nine coefficients per texel instead of a loop over the whole environment. SH ringing can go below zero.
+    irrMap[tId] = float4(max(EvaluateSH9(data.IrradianceSH, N), 0.0f), 1.0f);
+}
@@ -17,6 +17,11 @@ struct CbMaterial
     int NormalTexture;
     int OcclusionTexture;
     float4 BaseColorFactor;
+    // -1 when the texture has its own resource, otherwise the slice in the shared texture array.
+    int BaseColorSlice;
+    int MetallicRoughnessSlice;
+    int NormalSlice;
+    int OcclusionSlice;
 };
 
 struct Light
@@ -34,8 +39,10 @@ struct CbCubemaps
 {
     uint CubemapIndex;
     uint IrradianceMapIndex;
-    uint pad0;
-    uint pad1;
+    uint SpecularMapIndex;
+    uint SpecularMipsCount;
+    uint BrdfLutIndex;
+    uint3 Pad;
 };
 
 ConstantBuffer<CbCamera> cbCamera : register(b0);
@@ -44,11 +51,19 @@ ConstantBuffer<CbLight> cbLight : register(b3);
 ConstantBuffer<CbCubemaps> cbCubemaps : register(b5);
 
 Texture2D<float4> Textures[10000] : register(t0);
+Texture2DArray<float4> TextureArrays[10000] : register(t0, space1); // Aliases Textures.
 TextureCube<float4> Cubemaps[100] : register(t10000);
 
 SamplerState LinearClampSampler : register(s0);
 SamplerState LinearWrapSampler : register(s1);
 
+float4 SampleMaterialTexture(int index, int slice, float2 uv)
+{
+    if (slice < 0)
+        return Textures[index].Sample(LinearWrapSampler, uv);
+    return TextureArrays[index].Sample(LinearWrapSampler, float3(uv, slice));
+}
+
 struct vIn
 {
     float3 pos : POSITION;
@@ -81,18 +96,18 @@ vOut vs(vIn i, SV_INSTANCE)
 
 float4 ps(vOut pIn) : SV_Target
 {
-    float4 albedo = Textures[cbMaterial.BaseColorTexture].Sample(LinearWrapSampler, pIn.uv);
+    float4 albedo = SampleMaterialTexture(cbMaterial.BaseColorTexture, cbMaterial.BaseColorSlice, pIn.uv);
     albedo = sRGBtoRGB(albedo);
 
-    float2 metalnessRoughness = Textures[cbMaterial.MetallicRoughnessTexture].Sample(LinearWrapSampler, pIn.uv).xy;
-    float AO = Textures[cbMaterial.OcclusionTexture].Sample(LinearWrapSampler, pIn.uv).x;
+    float2 metalnessRoughness = SampleMaterialTexture(cbMaterial.MetallicRoughnessTexture, cbMaterial.MetallicRoughnessSlice, pIn.uv).xy;
+    float AO = SampleMaterialTexture(cbMaterial.OcclusionTexture, cbMaterial.OcclusionSlice, pIn.uv).x;
 
     float3 normal = normalize(pIn.norm);
     float3 tangent = normalize(pIn.tangent.xyz);
     float3 bitangent = cross(normal, tangent) * pIn.tangent.w;
     float3x3 tbn = float3x3(tangent, bitangent, normal);
 
-    float3 bumpNorm = Textures[cbMaterial.NormalTexture].Sample(LinearWrapSampler, pIn.uv).xyz * 2.0f - 1.0f;
+    float3 bumpNorm = UnpackNormal(SampleMaterialTexture(cbMaterial.NormalTexture, cbMaterial.NormalSlice, pIn.uv).xy);
     float3 N = normalize(mul(bumpNorm, tbn));
 
     float3 wpos = pIn.wpos;
@@ -128,10 +143,16 @@ float4 ps(vOut pIn) : SV_Target
         Lo += (kd * albedo.xyz / PI + spec) * radiance * NdotL;
 
     }
-    float3 ks = FresnelSchlickRoughness(max(dot(N, V), 0.0), f0, metalnessRoughness.y);
-    float3 kd = 1.0f - ks;
+    float NdotV = max(dot(N, V), 0.0f);
+    float3 ks = FresnelSchlickRoughness(NdotV, f0, metalnessRoughness.y);
+    float3 kd = (1.0f - ks) * (1.0f - metalnessRoughness.x);
     float3 irr = Cubemaps[cbCubemaps.IrradianceMapIndex].Sample(LinearClampSampler, N).xyz;
-    float3 ambient = irr * albedo.xyz * kd * AO;
+    // Split sum: the prefiltered radiance times the environment BRDF, one fetch each.
+    float3 R = reflect(-V, N);
+    float specularMip = metalnessRoughness.y * (cbCubemaps.SpecularMipsCount - 1);
+    float3 prefiltered = Cubemaps[cbCubemaps.SpecularMapIndex].SampleLevel(LinearClampSampler, R, specularMip).xyz;
+    float2 envBrdf = Textures[cbCubemaps.BrdfLutIndex].SampleLevel(LinearClampSampler, float2(NdotV, metalnessRoughness.y), 0).xy;
+    float3 ambient = (irr * albedo.xyz * kd + prefiltered * (f0 * envBrdf.x + envBrdf.y)) * AO;
     float3 color = ambient + Lo;
 
     return float4(color, 1.0f);
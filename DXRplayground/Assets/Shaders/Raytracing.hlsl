@@ -1,7 +1,11 @@
+#include "EnvironmentSampling.hlsl"
+
 struct SceneRtData
 {
     float4x4 invViewProj;
     float4 camPosition;
+    uint2 envSamplingSize;
+    uint2 pad;
 };
 struct ShadowCB
 {
@@ -12,6 +16,8 @@ RaytracingAccelerationStructure Scene : register(t0);
 RWTexture2D<float4> RenderTarget : register(u0);
 ConstantBuffer<SceneRtData> SceneCb : register(b0);
 ConstantBuffer<ShadowCB> ShadowCb : register(b0, space1);
+// See EnvironmentSampling.hlsl, the size is SceneCb.envSamplingSize.
+StructuredBuffer<float> EnvSampling : register(t1);
 
 typedef BuiltInTriangleIntersectionAttributes Attributes;
 
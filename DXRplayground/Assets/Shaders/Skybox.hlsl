@@ -14,8 +14,10 @@ struct CbCubemaps
 {
     uint CubemapIndex;
     uint IrradianceMapIndex;
-    uint pad0;
-    uint pad1;
+    uint SpecularMapIndex;
+    uint SpecularMipsCount;
+    uint BrdfLutIndex;
+    uint3 Pad;
 };
 ConstantBuffer<CbCubemaps> cbCubemaps : register(b5);
 TextureCube<float4> Cubemaps[100] : register(t10000);
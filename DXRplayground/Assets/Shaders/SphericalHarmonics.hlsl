@@ -0,0 +1,14 @@
+// The same basis as DXrenderer/Textures/SphericalHarmonics.h: third order real SH, RGB in xyz of every coefficient.
+float3 EvaluateSH9(float4 sh[9], float3 n)
+{
+    float3 res = sh[0].xyz * 0.282095f;
+    res += sh[1].xyz * (0.488603f * n.y);
+    res += sh[2].xyz * (0.488603f * n.z);
+    res += sh[3].xyz * (0.488603f * n.x);
+    res += sh[4].xyz * (1.092548f * n.x * n.y);
+    res += sh[5].xyz * (1.092548f * n.y * n.z);
+    res += sh[6].xyz * (0.315392f * (3.0f * n.z * n.z - 1.0f));
+    res += sh[7].xyz * (1.092548f * n.x * n.z);
+    res += sh[8].xyz * (0.546274f * (n.x * n.x - n.y * n.y));
+    return res;
+}
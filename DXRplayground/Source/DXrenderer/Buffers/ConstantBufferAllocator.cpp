@@ -0,0 +1,83 @@
+#include "DXrenderer/Buffers/ConstantBufferAllocator.h"
+
+#include "External/Dx12Helpers/d3dx12.h"
+#include "DXrenderer/DXhelpers.h"
+
+namespace DirectxPlayground
+{
+void PersistentConstants::UpdateBytes(UINT frameIndex, const byte* data, UINT size)
+{
+    assert(size == mData.size() && frameIndex < mFramesCount);
+    if (memcmp(mData.data(), data, size) != 0)
+    {
+        memcpy(mData.data(), data, size);
+        mDirtyFrames = (1u << mFramesCount) - 1;
+    }
+    if (mDirtyFrames & (1u << frameIndex))
+    {
+        memcpy(mCopies.CpuAddress + frameIndex * mStride, mData.data(), size);
+        mDirtyFrames &= ~(1u << frameIndex);
+    }
+}
+
+ConstantBufferAllocator::ConstantBufferAllocator(ID3D12Device* device, UINT framesCount, UINT64 frameSize, UINT64 persistentSize)
+    : mFramesCount(framesCount)
+    , mFrameSize(AlignUp(frameSize, Alignment))
+    , mPersistentSize(AlignUp(persistentSize, Alignment))
+{
+    assert(framesCount > 0 && framesCount < 32);
+    mFrameStart = mPersistentSize;
+
+    CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(mPersistentSize + mFrameSize * framesCount);
+    ThrowIfFailed(device->CreateCommittedResource(
+        &uploadHeapProps,
+        D3D12_HEAP_FLAG_NONE,
+        &bufferDesc,
+        mBuffer.GetCurrentState(),
+        nullptr,
+        IID_PPV_ARGS(mBuffer.GetAddressOf())));
+    mBuffer.SetName(L"constants");
+
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(mBuffer.Get()->Map(0, &readRange, reinterpret_cast<void**>(&mData)));
+}
+
+ConstantBufferAllocator::~ConstantBufferAllocator()
+{
+    mBuffer.Get()->Unmap(0, nullptr);
+}
+
+void ConstantBufferAllocator::BeginFrame(UINT frameIndex)
+{
+    assert(frameIndex < mFramesCount);
+    mFrameStart = mPersistentSize + frameIndex * mFrameSize;
+    mFrameUsed = 0;
+}
+
+ConstantAllocation ConstantBufferAllocator::Allocate(UINT64 size)
+{
+    UINT64 alignedSize = AlignUp(size, Alignment);
+    assert(mFrameUsed + alignedSize <= mFrameSize && "Out of frame constants, increase the frame size");
+    ConstantAllocation res;
+    res.CpuAddress = mData + mFrameStart + mFrameUsed;
+    res.GpuAddress = mBuffer.Get()->GetGPUVirtualAddress() + mFrameStart + mFrameUsed;
+    mFrameUsed += alignedSize;
+    return res;
+}
+
+PersistentConstants ConstantBufferAllocator::CreatePersistent(UINT size)
+{
+    PersistentConstants res;
+    res.mStride = AlignUp(size, Alignment);
+    assert(mPersistentUsed + res.mStride * mFramesCount <= mPersistentSize && "Out of persistent constants, increase the persistent size");
+    res.mData.resize(size);
+    res.mCopies.CpuAddress = mData + mPersistentUsed;
+    res.mCopies.GpuAddress = mBuffer.Get()->GetGPUVirtualAddress() + mPersistentUsed;
+    res.mFramesCount = mFramesCount;
+    // Every copy is written by the first Update of its frame.
+    res.mDirtyFrames = (1u << mFramesCount) - 1;
+    mPersistentUsed += res.mStride * mFramesCount;
+    return res;
+}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cassert>
+#include <d3d12.h>
+#include <vector>
+
+#include "DXrenderer/ResourceDX.h"
+
+namespace DirectxPlayground
+{
+struct ConstantAllocation
+{
+    byte* CpuAddress = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
+};
+
+// Constants which rarely change, e.g. materials. There is a copy per frame index, Update rewrites the copy of the frame only if the data
+// differs from the last written one, so it is cheap to call every frame. Created by ConstantBufferAllocator and never freed.
+class PersistentConstants
+{
+public:
+    template <typename T>
+    void Update(UINT frameIndex, const T& data);
+    void UpdateBytes(UINT frameIndex, const byte* data, UINT size);
+
+    D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress(UINT frameIndex) const;
+
+private:
+    friend class ConstantBufferAllocator;
+
+    std::vector<byte> mData; // The last written data.
+    ConstantAllocation mCopies; // FramesCount copies mStride bytes apart.
+    UINT64 mStride = 0;
+    UINT mFramesCount = 0;
+    UINT mDirtyFrames = 0; // A bit per frame index whose copy is outdated.
+};
+
+// Constant buffer memory in one persistently mapped upload buffer. Per frame constants are bump allocated from the region of the frame
+// which is reset as a whole in BeginFrame, the persistent ones live at the start of the buffer. All addresses are 256 byte aligned.
+class ConstantBufferAllocator
+{
+public:
+    static constexpr UINT64 Alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+    ConstantBufferAllocator(ID3D12Device* device, UINT framesCount, UINT64 frameSize, UINT64 persistentSize);
+    ConstantBufferAllocator(const ConstantBufferAllocator&) = delete;
+    ConstantBufferAllocator(ConstantBufferAllocator&&) = delete;
+    ConstantBufferAllocator& operator=(const ConstantBufferAllocator&) = delete;
+    ConstantBufferAllocator& operator=(ConstantBufferAllocator&&) = delete;
+    ~ConstantBufferAllocator();
+
+    // The commands which used the region of the frame the previous time must be finished.
+    void BeginFrame(UINT frameIndex);
+    // Valid until the next BeginFrame with the same frame index.
+    ConstantAllocation Allocate(UINT64 size);
+    template <typename T>
+    D3D12_GPU_VIRTUAL_ADDRESS Upload(const T& data);
+
+    PersistentConstants CreatePersistent(UINT size);
+
+    UINT64 GetFrameUsedSize() const;
+    UINT64 GetPersistentUsedSize() const;
+
+private:
+    ResourceDX mBuffer{ D3D12_RESOURCE_STATE_GENERIC_READ };
+    byte* mData = nullptr;
+    UINT mFramesCount = 0;
+    UINT64 mFrameSize = 0;
+    UINT64 mPersistentSize = 0;
+    UINT64 mPersistentUsed = 0;
+    UINT64 mFrameStart = 0; // Offset of the region of the current frame.
+    UINT64 mFrameUsed = 0;
+};
+
+template <typename T>
+void PersistentConstants::Update(UINT frameIndex, const T& data)
+{
+    UpdateBytes(frameIndex, reinterpret_cast<const byte*>(&data), sizeof(T));
+}
+
+inline D3D12_GPU_VIRTUAL_ADDRESS PersistentConstants::GetGpuAddress(UINT frameIndex) const
+{
+    assert(frameIndex < mFramesCount);
+    return mCopies.GpuAddress + frameIndex * mStride;
+}
+
+template <typename T>
+D3D12_GPU_VIRTUAL_ADDRESS ConstantBufferAllocator::Upload(const T& data)
+{
+    ConstantAllocation allocation = Allocate(sizeof(T));
+    memcpy(allocation.CpuAddress, &data, sizeof(T));
+    return allocation.GpuAddress;
+}
+
+inline UINT64 ConstantBufferAllocator::GetFrameUsedSize() const
+{
+    return mFrameUsed;
+}
+
+inline UINT64 ConstantBufferAllocator::GetPersistentUsedSize() const
+{
+    return mPersistentUsed;
+}
+}
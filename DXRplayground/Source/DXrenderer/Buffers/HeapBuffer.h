@@ -5,25 +5,35 @@
 
 #include "External/Dx12Helpers/d3dx12.h"
 #include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/RenderContext.h"
+#include "DXrenderer/RenderPipeline.h"
 #include "DXrenderer/ResourceDX.h"
+#include "DXrenderer/Buffers/UploadRing.h"
+#include "DXrenderer/Memory/DeferredReleaseQueue.h"
+#include "DXrenderer/Memory/GpuMemoryAllocator.h"
 
 namespace DirectxPlayground
 {
+// The data is staged in the upload ring of the context, nothing has to be released after the copy.
+// The buffer is placed by the GPU memory allocator of the context, the destructor returns it through the release queue once the
+// commands recorded so far are finished.
 class HeapBuffer
 {
 public:
-    HeapBuffer(const byte* data, UINT dataSize, ID3D12GraphicsCommandList* commandList, ID3D12Device* device, D3D12_RESOURCE_STATES destinationState);
+    HeapBuffer(RenderContext& ctx, const byte* data, UINT dataSize, D3D12_RESOURCE_STATES destinationState);
     HeapBuffer(const HeapBuffer&) = delete;
     HeapBuffer(HeapBuffer&&) = delete;
     HeapBuffer& operator=(const HeapBuffer&) = delete;
     HeapBuffer& operator=(HeapBuffer&&) = delete;
-    ~HeapBuffer() = default;
+    ~HeapBuffer();
 
     ID3D12Resource* GetBuffer() const;
 
 private:
     ResourceDX mBuffer{ D3D12_RESOURCE_STATE_COPY_DEST };
-    ResourceDX mUploadBuffer{ D3D12_RESOURCE_STATE_GENERIC_READ }; // [a_vorontcov] TODO:: Check if command list was executed and release ptr. But maybe its not nessesary.
+    GpuMemoryAllocator* mAllocator = nullptr;
+    DeferredReleaseQueue* mReleaseQueue = nullptr;
+    IRenderPipeline* mPipeline = nullptr;
 };
 
 inline ID3D12Resource* HeapBuffer::GetBuffer() const
@@ -31,35 +41,29 @@ inline ID3D12Resource* HeapBuffer::GetBuffer() const
     return mBuffer.Get();
 }
 
-inline HeapBuffer::HeapBuffer(const byte* data, UINT dataSize, ID3D12GraphicsCommandList* commandList, ID3D12Device* device, D3D12_RESOURCE_STATES destinationState)
+inline HeapBuffer::~HeapBuffer()
 {
-    CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
-    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(dataSize);
-    ThrowIfFailed(device->CreateCommittedResource(
-        &uploadHeapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
-        mUploadBuffer.GetCurrentState(),
-        nullptr,
-        IID_PPV_ARGS(mUploadBuffer.GetAddressOf())));
-
-    UINT8* mappedBuffer = nullptr;
-    CD3DX12_RANGE range(0, 0);
-    mUploadBuffer.Get()->Map(0, &range, reinterpret_cast<void**>(&mappedBuffer));
-    memcpy(mappedBuffer, data, dataSize);
-    mUploadBuffer.Get()->Unmap(0, nullptr);
-
-    CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_DEFAULT);
-    ThrowIfFailed(device->CreateCommittedResource(
-        &heapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
-        mBuffer.GetCurrentState(),
-        nullptr,
-        IID_PPV_ARGS(mBuffer.GetAddressOf())));
-
-    commandList->CopyResource(mBuffer.Get(), mUploadBuffer.Get());
-    mBuffer.Transition(commandList, destinationState);
+    GpuMemoryAllocator* allocator = mAllocator;
+    ResourceDX buffer = mBuffer;
+    mReleaseQueue->Enqueue(mPipeline->GetPendingFenceValue(), [allocator, buffer]()
+    {
+        allocator->Release(buffer.Get());
+    });
+}
+
+inline HeapBuffer::HeapBuffer(RenderContext& ctx, const byte* data, UINT dataSize, D3D12_RESOURCE_STATES destinationState)
+    : mAllocator(ctx.GpuAllocator)
+    , mReleaseQueue(ctx.ReleaseQueue)
+    , mPipeline(ctx.Pipeline)
+{
+    UploadAllocation staging = ctx.UploadRing->Allocate(dataSize, sizeof(UINT));
+    memcpy(staging.CpuAddress, data, dataSize);
+
+    mAllocator->CreateResource(CD3DX12_RESOURCE_DESC::Buffer(dataSize), nullptr, mBuffer);
+
+    ctx.StateTracker->Flush(ctx.CommandList);
+    ctx.CommandList->CopyBufferRegion(mBuffer.Get(), 0, staging.Resource, staging.Offset, dataSize);
+    ctx.StateTracker->Transition(mBuffer, destinationState);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -69,7 +73,7 @@ inline HeapBuffer::HeapBuffer(const byte* data, UINT dataSize, ID3D12GraphicsCom
 class IndexBuffer
 {
 public:
-    IndexBuffer(const byte* indexData, UINT indexDataSize, ID3D12GraphicsCommandList* commandList, ID3D12Device* device, DXGI_FORMAT indexBufferFormat);
+    IndexBuffer(RenderContext& ctx, const byte* indexData, UINT indexDataSize, DXGI_FORMAT indexBufferFormat);
     IndexBuffer(const IndexBuffer&) = delete;
     IndexBuffer(IndexBuffer&&) = delete;
     IndexBuffer& operator=(const IndexBuffer&) = delete;
@@ -94,9 +98,9 @@ inline ID3D12Resource* IndexBuffer::GetIndexBuffer() const
     return mBuffer->GetBuffer();
 }
 
-inline IndexBuffer::IndexBuffer(const byte* indexData, UINT indexDataSize, ID3D12GraphicsCommandList* commandList, ID3D12Device* device, DXGI_FORMAT indexBufferFormat)
+inline IndexBuffer::IndexBuffer(RenderContext& ctx, const byte* indexData, UINT indexDataSize, DXGI_FORMAT indexBufferFormat)
 {
-    mBuffer = new HeapBuffer(indexData, indexDataSize, commandList, device, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+    mBuffer = new HeapBuffer(ctx, indexData, indexDataSize, D3D12_RESOURCE_STATE_INDEX_BUFFER);
 
     mIndexBufferView.BufferLocation = mBuffer->GetBuffer()->GetGPUVirtualAddress();
     mIndexBufferView.Format = indexBufferFormat;
@@ -115,7 +119,7 @@ inline IndexBuffer::~IndexBuffer()
 class VertexBuffer
 {
 public:
-    VertexBuffer(const byte* vertexData, UINT vertexDataSize, UINT vertexStride, ID3D12GraphicsCommandList* commandList, ID3D12Device* device);
+    VertexBuffer(RenderContext& ctx, const byte* vertexData, UINT vertexDataSize, UINT vertexStride);
     VertexBuffer(const VertexBuffer&) = delete;
     VertexBuffer(VertexBuffer&&) = delete;
     VertexBuffer& operator=(const VertexBuffer&) = delete;
@@ -140,9 +144,9 @@ inline ID3D12Resource* VertexBuffer::GetVertexBuffer() const
     return m_buffer->GetBuffer();
 }
 
-inline VertexBuffer::VertexBuffer(const byte* vertexData, UINT vertexDataSize, UINT vertexStride, ID3D12GraphicsCommandList* commandList, ID3D12Device* device)
+inline VertexBuffer::VertexBuffer(RenderContext& ctx, const byte* vertexData, UINT vertexDataSize, UINT vertexStride)
 {
-    m_buffer = new HeapBuffer(vertexData, vertexDataSize, commandList, device, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    m_buffer = new HeapBuffer(ctx, vertexData, vertexDataSize, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
 
     m_vertexBufferView.BufferLocation = m_buffer->GetBuffer()->GetGPUVirtualAddress();
     m_vertexBufferView.StrideInBytes = vertexStride;
@@ -0,0 +1,69 @@
+#include "DXrenderer/Buffers/RingAllocator.h"
+
+#include <cassert>
+
+#include "DXrenderer/DXhelpers.h"
+
+namespace DirectxPlayground
+{
+RingAllocator::RingAllocator(UINT64 capacity)
+    : mCapacity(capacity)
+{
+    assert(capacity > 0);
+}
+
+UINT64 RingAllocator::Allocate(UINT64 size, UINT64 alignment, UINT64 fenceValue)
+{
+    assert(size > 0 && (alignment & (alignment - 1)) == 0);
+    assert((mBlocks.empty() || mBlocks.back().FenceValue <= fenceValue) && "Fence values must not decrease");
+    if (mUsedSize == mCapacity)
+        return InvalidOffset;
+
+    // The free space is [mHead, mCapacity) + [0, mTail) if the allocations in flight don't wrap and [mHead, mTail) if they do.
+    UINT64 offset = AlignUp(mHead, alignment);
+    if (mHead >= mTail)
+    {
+        if (offset + size > mCapacity)
+        {
+            if (size > mTail)
+                return InvalidOffset;
+            offset = 0;
+        }
+    }
+    else if (offset + size > mTail)
+    {
+        return InvalidOffset;
+    }
+
+    UINT64 end = offset + size;
+    UINT64 consumed = offset >= mHead ? end - mHead : mCapacity - mHead + end;
+    if (!mBlocks.empty() && mBlocks.back().FenceValue == fenceValue)
+    {
+        mBlocks.back().End = end;
+        mBlocks.back().Size += consumed;
+    }
+    else
+    {
+        mBlocks.push_back({ end, consumed, fenceValue });
+    }
+    mUsedSize += consumed;
+    mHead = end;
+    return offset;
+}
+
+void RingAllocator::Reclaim(UINT64 completedFenceValue)
+{
+    while (!mBlocks.empty() && mBlocks.front().FenceValue <= completedFenceValue)
+    {
+        mTail = mBlocks.front().End;
+        mUsedSize -= mBlocks.front().Size;
+        mBlocks.pop_front();
+    }
+    // Nothing is in flight, the next allocation can use the whole ring without skipping its end.
+    if (mBlocks.empty())
+    {
+        mHead = 0;
+        mTail = 0;
+    }
+}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <deque>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// Offsets in a ring of the given capacity. It doesn't touch the GPU: every allocation is tagged with the fence value which is signaled
+// after the commands reading it, Reclaim frees everything the GPU has passed. Allocations are freed in the order they were made,
+// so fence values must not decrease. A range never wraps, the space at the end of the ring is skipped if the allocation doesn't fit there.
+class RingAllocator
+{
+public:
+    static constexpr UINT64 InvalidOffset = ~0ull;
+
+    explicit RingAllocator(UINT64 capacity);
+
+    // Returns InvalidOffset if there is no space until more fences are passed. alignment is a power of two.
+    UINT64 Allocate(UINT64 size, UINT64 alignment, UINT64 fenceValue);
+    void Reclaim(UINT64 completedFenceValue);
+
+    UINT64 GetCapacity() const;
+    // Including the skipped and the alignment bytes.
+    UINT64 GetUsedSize() const;
+
+private:
+    // Consecutive allocations with the same fence value are merged.
+    struct Block
+    {
+        UINT64 End = 0;
+        UINT64 Size = 0;
+        UINT64 FenceValue = 0;
+    };
+
+    std::deque<Block> mBlocks;
+    UINT64 mCapacity = 0;
+    UINT64 mHead = 0; // The next allocation starts here.
+    UINT64 mTail = 0; // The oldest allocation in flight starts here.
+    UINT64 mUsedSize = 0;
+};
+
+inline UINT64 RingAllocator::GetCapacity() const
+{
+    return mCapacity;
+}
+
+inline UINT64 RingAllocator::GetUsedSize() const
+{
+    return mUsedSize;
+}
+}
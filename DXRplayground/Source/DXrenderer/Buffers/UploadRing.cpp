@@ -0,0 +1,68 @@
+#include "DXrenderer/Buffers/UploadRing.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "External/Dx12Helpers/d3dx12.h"
+#include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/Memory/DeferredReleaseQueue.h"
+#include "Utils/Logger.h"
+
+namespace DirectxPlayground
+{
+UploadRing::UploadRing(ID3D12Device* device, DeferredReleaseQueue* releaseQueue, UINT64 size)
+    : mDevice(device)
+    , mReleaseQueue(releaseQueue)
+    , mAllocator(size)
+{
+    CreateBuffer(size);
+}
+
+UploadAllocation UploadRing::Allocate(UINT64 size, UINT64 alignment)
+{
+    UINT64 offset = mAllocator.Allocate(size, alignment, mPendingFenceValue);
+    if (offset == RingAllocator::InvalidOffset)
+    {
+        // The commands recorded so far still read the current buffer.
+        if (mAllocator.GetUsedSize() > 0)
+            mReleaseQueue->Release(mPendingFenceValue, mBuffer);
+        UINT64 newSize = std::max(mAllocator.GetCapacity() * 2, AlignUp(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+        LOG("Upload ring grows from ", mAllocator.GetCapacity(), " to ", newSize, " bytes");
+        mAllocator = RingAllocator(newSize);
+        CreateBuffer(newSize);
+        offset = mAllocator.Allocate(size, alignment, mPendingFenceValue);
+        assert(offset == 0);
+    }
+
+    UploadAllocation res;
+    res.Resource = mBuffer.Get();
+    res.Offset = offset;
+    res.CpuAddress = mData + offset;
+    res.GpuAddress = mBuffer.Get()->GetGPUVirtualAddress() + offset;
+    return res;
+}
+
+void UploadRing::Reclaim(UINT64 completedFenceValue)
+{
+    mAllocator.Reclaim(completedFenceValue);
+}
+
+void UploadRing::CreateBuffer(UINT64 size)
+{
+    mBuffer = ResourceDX{ D3D12_RESOURCE_STATE_GENERIC_READ };
+    CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+    ThrowIfFailed(mDevice->CreateCommittedResource(
+        &uploadHeapProps,
+        D3D12_HEAP_FLAG_NONE,
+        &bufferDesc,
+        mBuffer.GetCurrentState(),
+        nullptr,
+        IID_PPV_ARGS(mBuffer.GetAddressOf())));
+    mBuffer.SetName(L"upload_ring");
+
+    // Upload heaps can stay mapped for their whole lifetime, the CPU never reads them.
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(mBuffer.Get()->Map(0, &readRange, reinterpret_cast<void**>(&mData)));
+}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <d3d12.h>
+
+#include "DXrenderer/Buffers/RingAllocator.h"
+#include "DXrenderer/ResourceDX.h"
+
+namespace DirectxPlayground
+{
+class DeferredReleaseQueue;
+
+struct UploadAllocation
+{
+    ID3D12Resource* Resource = nullptr;
+    UINT64 Offset = 0; // In Resource.
+    byte* CpuAddress = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
+};
+
+// Staging memory for the copies to the default heap, one persistently mapped upload buffer shared by all uploads. It is owned by
+// RenderPipeline, which tells it the fence values: an allocation is valid until the GPU passes the fence signaled after the commands
+// recorded at the time of the allocation. When an allocation doesn't fit the ring grows, the old buffer goes to the release queue.
+class UploadRing
+{
+public:
+    UploadRing(ID3D12Device* device, DeferredReleaseQueue* releaseQueue, UINT64 size);
+    UploadRing(const UploadRing&) = delete;
+    UploadRing(UploadRing&&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+    UploadRing& operator=(UploadRing&&) = delete;
+    ~UploadRing() = default;
+
+    UploadAllocation Allocate(UINT64 size, UINT64 alignment);
+
+    // The value the pipeline signals after the commands recorded from now on.
+    void SetPendingFenceValue(UINT64 fenceValue);
+    void Reclaim(UINT64 completedFenceValue);
+
+    UINT64 GetSize() const;
+    UINT64 GetUsedSize() const;
+
+private:
+    void CreateBuffer(UINT64 size);
+
+    ID3D12Device* mDevice = nullptr;
+    DeferredReleaseQueue* mReleaseQueue = nullptr;
+    ResourceDX mBuffer{ D3D12_RESOURCE_STATE_GENERIC_READ };
+    byte* mData = nullptr;
+    RingAllocator mAllocator;
+    UINT64 mPendingFenceValue = 1;
+};
+
+inline void UploadRing::SetPendingFenceValue(UINT64 fenceValue)
+{
+    mPendingFenceValue = fenceValue;
+}
+
+inline UINT64 UploadRing::GetSize() const
+{
+    return mAllocator.GetCapacity();
+}
+
+inline UINT64 UploadRing::GetUsedSize() const
+{
+    return mAllocator.GetUsedSize();
+}
+}
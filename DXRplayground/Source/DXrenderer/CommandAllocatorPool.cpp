@@ -0,0 +1,69 @@
+#include "DXrenderer/CommandAllocatorPool.h"
+
+#include <cassert>
+#include <string>
+
+#include "DXrenderer/DXhelpers.h"
+
+namespace DirectxPlayground
+{
+CommandAllocatorPool::CommandAllocatorPool(ID3D12Device* device, WaitFunc wait, UINT maxAllocatorsPerType)
+    : CommandAllocatorPool([device](D3D12_COMMAND_LIST_TYPE type, UINT index)
+    {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+        ThrowIfFailed(device->CreateCommandAllocator(type, IID_PPV_ARGS(&allocator)));
+        std::wstring name = L"command_allocator_" + std::to_wstring(type) + L"_" + std::to_wstring(index);
+        SetDXobjectName(allocator.Get(), name.c_str());
+        return allocator;
+    }, std::move(wait), maxAllocatorsPerType)
+{
+}
+
+CommandAllocatorPool::CommandAllocatorPool(CreateFunc create, WaitFunc wait, UINT maxAllocatorsPerType)
+    : mCreate(std::move(create))
+    , mWait(std::move(wait))
+    , mMaxAllocatorsPerType(maxAllocatorsPerType)
+{
+    assert(maxAllocatorsPerType > 0);
+}
+
+Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandAllocatorPool::Acquire(D3D12_COMMAND_LIST_TYPE type, UINT64 completedFenceValue)
+{
+    TypePool& pool = GetPool(type);
+    bool available = !pool.Released.empty() && pool.Released.front().FenceValue <= completedFenceValue;
+    if (!available && pool.Statistics.Created < mMaxAllocatorsPerType)
+        return mCreate(type, pool.Statistics.Created++);
+
+    assert(!pool.Released.empty() && "All the allocators are acquired, nothing to wait for");
+    if (!available)
+    {
+        mWait(pool.Released.front().FenceValue);
+        ++pool.Statistics.Waits;
+    }
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator = std::move(pool.Released.front().Allocator);
+    pool.Released.pop_front();
+    ThrowIfFailed(allocator->Reset());
+    ++pool.Statistics.Reused;
+    return allocator;
+}
+
+void CommandAllocatorPool::Release(D3D12_COMMAND_LIST_TYPE type, Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator, UINT64 fenceValue)
+{
+    TypePool& pool = GetPool(type);
+    assert(allocator != nullptr);
+    assert((pool.Released.empty() || pool.Released.back().FenceValue <= fenceValue) && "Fence values must not decrease");
+    pool.Released.push_back({ std::move(allocator), fenceValue });
+}
+
+CommandAllocatorPool::TypePool& CommandAllocatorPool::GetPool(D3D12_COMMAND_LIST_TYPE type)
+{
+    assert(static_cast<UINT>(type) < TypesCount && "Not a queue type");
+    return mPools[type];
+}
+
+const CommandAllocatorPool::TypePool& CommandAllocatorPool::GetPool(D3D12_COMMAND_LIST_TYPE type) const
+{
+    assert(static_cast<UINT>(type) < TypesCount && "Not a queue type");
+    return mPools[type];
+}
+}
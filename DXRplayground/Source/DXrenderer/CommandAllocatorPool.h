@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <functional>
+#include <d3d12.h>
+#include <wrl.h>
+
+namespace DirectxPlayground
+{
+// Command allocators per command list type, recycled by fence. An allocator can be reset only once the GPU has executed everything
+// recorded with it, so Release tags it with the fence value signaled after the submission and Acquire hands it out again once the GPU
+// has passed the value. The pool grows while all the allocators are in flight, at the limit it waits for the oldest one. Owned by
+// RenderPipeline, not thread safe. Only the creation touches the device, it's a callback, so the bookkeeping runs without a GPU.
+class CommandAllocatorPool
+{
+public:
+    // Blocks until the GPU passes the fence value.
+    using WaitFunc = std::function<void(UINT64 fenceValue)>;
+    // index - the number of the allocators of the type created before.
+    using CreateFunc = std::function<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>(D3D12_COMMAND_LIST_TYPE type, UINT index)>;
+
+    struct Stats
+    {
+        UINT Created = 0;
+        UINT64 Reused = 0;
+        UINT64 Waits = 0; // Acquires which had to wait for the GPU at the limit.
+    };
+
+    // The allocators are created on the device and named by the type and the index.
+    CommandAllocatorPool(ID3D12Device* device, WaitFunc wait, UINT maxAllocatorsPerType);
+    CommandAllocatorPool(CreateFunc create, WaitFunc wait, UINT maxAllocatorsPerType);
+    CommandAllocatorPool(const CommandAllocatorPool&) = delete;
+    CommandAllocatorPool(CommandAllocatorPool&&) = delete;
+    CommandAllocatorPool& operator=(const CommandAllocatorPool&) = delete;
+    CommandAllocatorPool& operator=(CommandAllocatorPool&&) = delete;
+    ~CommandAllocatorPool() = default;
+
+    // A reset allocator the caller owns until Release. completedFenceValue - the last value the GPU has passed.
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Acquire(D3D12_COMMAND_LIST_TYPE type, UINT64 completedFenceValue);
+    // fenceValue - signaled after the submission of the command lists recorded with the allocator, usually
+    // IRenderPipeline::GetPendingFenceValue. Fence values must not decrease.
+    void Release(D3D12_COMMAND_LIST_TYPE type, Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator, UINT64 fenceValue);
+
+    const Stats& GetStats(D3D12_COMMAND_LIST_TYPE type) const;
+    // The released allocators, available or still in flight.
+    UINT GetReleasedCount(D3D12_COMMAND_LIST_TYPE type) const;
+
+private:
+    struct ReleasedAllocator
+    {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+        UINT64 FenceValue = 0;
+    };
+
+    struct TypePool
+    {
+        std::deque<ReleasedAllocator> Released; // The oldest first.
+        Stats Statistics;
+    };
+
+    // Direct, bundle, compute and copy lists, the video ones aren't used.
+    static constexpr UINT TypesCount = D3D12_COMMAND_LIST_TYPE_COPY + 1;
+
+    TypePool& GetPool(D3D12_COMMAND_LIST_TYPE type);
+    const TypePool& GetPool(D3D12_COMMAND_LIST_TYPE type) const;
+
+    CreateFunc mCreate;
+    WaitFunc mWait;
+    UINT mMaxAllocatorsPerType = 0;
+    std::array<TypePool, TypesCount> mPools;
+};
+
+inline const CommandAllocatorPool::Stats& CommandAllocatorPool::GetStats(D3D12_COMMAND_LIST_TYPE type) const
+{
+    return GetPool(type).Statistics;
+}
+
+inline UINT CommandAllocatorPool::GetReleasedCount(D3D12_COMMAND_LIST_TYPE type) const
+{
+    return static_cast<UINT>(GetPool(type).Released.size());
+}
+}
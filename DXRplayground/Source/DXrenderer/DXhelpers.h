@@ -58,6 +58,11 @@ inline UINT Align(UINT size, UINT alignment)
     return (size + (alignment - 1)) & ~(alignment - 1);
 }
 
+inline UINT64 AlignUp(UINT64 size, UINT64 alignment)
+{
+    return (size + (alignment - 1)) & ~(alignment - 1);
+}
+
 #if defined(_DEBUG)
 inline void SetDXobjectName(ID3D12Object* object, LPCWSTR name)
 {
@@ -134,16 +139,20 @@ inline HRESULT CreateCommonRootSignature(ID3D12Device* device, REFIID riid, void
         }
     }
 
-    D3D12_DESCRIPTOR_RANGE1 texRange;
-    texRange.NumDescriptors = RenderContext::MaxTextures;
-    texRange.BaseShaderRegister = 0;
-    texRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-    texRange.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE; // Double check perf
-    texRange.RegisterSpace = 0;
-    texRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    // Both ranges cover the same descriptors: space 0 is read as Texture2D, space 1 as Texture2DArray.
+    std::array<D3D12_DESCRIPTOR_RANGE1, 2> texRanges;
+    for (UINT i = 0; i < texRanges.size(); ++i)
+    {
+        texRanges[i].NumDescriptors = RenderContext::MaxTextures;
+        texRanges[i].BaseShaderRegister = 0;
+        texRanges[i].OffsetInDescriptorsFromTableStart = 0;
+        texRanges[i].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_VOLATILE; // Double check perf
+        texRanges[i].RegisterSpace = i;
+        texRanges[i].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    }
 
     cbParams.emplace_back();
-    cbParams.back().InitAsDescriptorTable(1, &texRange, D3D12_SHADER_VISIBILITY_ALL);
+    cbParams.back().InitAsDescriptorTable(static_cast<UINT>(texRanges.size()), texRanges.data(), D3D12_SHADER_VISIBILITY_ALL);
 
     D3D12_DESCRIPTOR_RANGE1 cubeRange;
     cubeRange.NumDescriptors = RenderContext::MaxCubemaps;
@@ -234,11 +243,79 @@ inline D3D12_COMPUTE_PIPELINE_STATE_DESC GetDefaultComputePsoDescriptor(ID3D12Ro
     return desc;
 }
 
+// Returns 0 for the formats without a defined pixel size.
+inline UINT FindPixelSize(DXGI_FORMAT format)
+{
+    static const std::map<DXGI_FORMAT, UINT> formats{
+        { DXGI_FORMAT_R8_UNORM, 1 }, { DXGI_FORMAT_A8_UNORM, 1 },
+        { DXGI_FORMAT_R8G8_UNORM, 2 }, { DXGI_FORMAT_R16_UNORM, 2 }, { DXGI_FORMAT_R16_FLOAT, 2 },
+        { DXGI_FORMAT_R8G8B8A8_UNORM, 4 }, { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, 4 }, { DXGI_FORMAT_B8G8R8A8_UNORM, 4 }, { DXGI_FORMAT_B8G8R8A8_UNORM_SRGB, 4 },
+        { DXGI_FORMAT_B8G8R8X8_UNORM, 4 }, { DXGI_FORMAT_R10G10B10A2_UNORM, 4 }, { DXGI_FORMAT_R11G11B10_FLOAT, 4 },
+        { DXGI_FORMAT_R16G16_UNORM, 4 }, { DXGI_FORMAT_R16G16_FLOAT, 4 }, { DXGI_FORMAT_R32_FLOAT, 4 },
+        { DXGI_FORMAT_R16G16B16A16_UNORM, 8 }, { DXGI_FORMAT_R16G16B16A16_FLOAT, 8 }, { DXGI_FORMAT_R32G32_FLOAT, 8 },
+        { DXGI_FORMAT_R32G32B32_FLOAT, 12 }, { DXGI_FORMAT_R32G32B32A32_FLOAT, 16 } };
+    auto it = formats.find(format);
+    return it == formats.end() ? 0 : it->second;
+}
+
 inline UINT GetPixelSize(DXGI_FORMAT format)
 {
-    static const std::map<DXGI_FORMAT, UINT> formats{ { DXGI_FORMAT_R8G8B8A8_UNORM, 4 }, { DXGI_FORMAT_R32G32B32A32_FLOAT, 16 }, { DXGI_FORMAT_R32G32B32_FLOAT, 12 } };
-    assert(formats.count(format) == 1 && "Pixel size for the format isn't defined");
-    return formats.at(format);
+    UINT size = FindPixelSize(format);
+    assert(size != 0 && "Pixel size for the format isn't defined");
+    return size;
+}
+
+inline bool IsBlockCompressed(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Size of a 4x4 block in bytes.
+inline UINT GetBlockByteSize(DXGI_FORMAT format)
+{
+    assert(IsBlockCompressed(format) && "Block size is defined only for the block compressed formats");
+    switch (format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+        return 8;
+    default:
+        return 16;
+    }
+}
+
+inline size_t GetRowPitch(DXGI_FORMAT format, UINT width)
+{
+    if (IsBlockCompressed(format))
+        return size_t((width + 3) / 4) * GetBlockByteSize(format);
+    return size_t(width) * GetPixelSize(format);
+}
+
+// Block compressed formats store a row of 4x4 blocks per row.
+inline UINT GetRowsCount(DXGI_FORMAT format, UINT height)
+{
+    return IsBlockCompressed(format) ? (height + 3) / 4 : height;
 }
 
 inline constexpr DirectX::XMFLOAT4X4 IdentityMatrix{
@@ -1,24 +1,17 @@
 #include "DXrenderer/LightManager.h"
 
-#include "Utils/Helpers.h"
 #include "DXrenderer/RenderContext.h"
 
 namespace DirectxPlayground
 {
 
 LightManager::LightManager(RenderContext& ctx)
-{
-    mLightsBuffer = new UploadBuffer(*ctx.Device, sizeof(mLights), true, RenderContext::FramesCount);
-}
-
-LightManager::~LightManager()
-{
-    SafeDelete(mLightsBuffer);
-}
+    : mLightsConstants(ctx.Constants->CreatePersistent(sizeof(mLights)))
+{}
 
 void LightManager::UpdateLights(UINT frame)
 {
-    mLightsBuffer->UploadData(frame, mLights);
+    mLightsConstants.Update(frame, mLights);
 }
 
 }
\ No newline at end of file
@@ -1,12 +1,11 @@
 #pragma once
 
 #include "DXrenderer/Light.h"
-#include "DXrenderer/Buffers/UploadBuffer.h"
+#include "DXrenderer/Buffers/ConstantBufferAllocator.h"
 #include "External/Dx12Helpers/d3dx12.h"
 
 namespace DirectxPlayground
 {
-class UploadBuffer;
 struct RenderContext;
 
 
@@ -16,13 +15,13 @@ public:
     static constexpr UINT MaxLightsCount = 128;
 
     LightManager(RenderContext& ctx);
-    ~LightManager();
 
     UINT AddLight(const Light& light);
     Light& GetLightRef(UINT ind);
     void SetLight(UINT ind, const Light& light);
     Light* GetLights();
 
+    // Only writes the copy of the frame if the lights have changed.
     void UpdateLights(UINT frame);
 
     D3D12_GPU_VIRTUAL_ADDRESS GetLightsBufferGpuAddress(UINT frame) const;
@@ -33,12 +32,12 @@ private:
         Light Lights[MaxLightsCount] = {};
         UINT UsedLights = 0;
     } mLights;
-    UploadBuffer* mLightsBuffer = nullptr;
+    PersistentConstants mLightsConstants;
 };
 
 inline D3D12_GPU_VIRTUAL_ADDRESS LightManager::GetLightsBufferGpuAddress(UINT frame) const
 {
-    return mLightsBuffer->GetFrameDataGpuAddress(frame);
+    return mLightsConstants.GetGpuAddress(frame);
 }
 
 inline UINT LightManager::AddLight(const Light& light)
@@ -0,0 +1,91 @@
+#include "DXrenderer/Memory/BuddyAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace DirectxPlayground
+{
+BuddyAllocator::BuddyAllocator(UINT64 capacity, UINT64 minBlockSize)
+    : mCapacity(capacity)
+    , mMinBlockSize(minBlockSize)
+{
+    assert(capacity >= minBlockSize && minBlockSize > 0);
+    assert((capacity & (capacity - 1)) == 0 && (minBlockSize & (minBlockSize - 1)) == 0);
+    mFreeBlocks.resize(GetOrder(capacity) + 1);
+    mFreeBlocks.back().insert(0);
+}
+
+UINT64 BuddyAllocator::Allocate(UINT64 size, UINT64 alignment)
+{
+    assert(size > 0 && (alignment & (alignment - 1)) == 0);
+    if (size > mCapacity || alignment > mCapacity)
+        return InvalidOffset;
+
+    const UINT order = GetOrder(std::max(size, alignment));
+    UINT freeOrder = order;
+    while (freeOrder < mFreeBlocks.size() && mFreeBlocks[freeOrder].empty())
+        ++freeOrder;
+    if (freeOrder == mFreeBlocks.size())
+        return InvalidOffset;
+
+    UINT64 offset = *mFreeBlocks[freeOrder].begin();
+    mFreeBlocks[freeOrder].erase(mFreeBlocks[freeOrder].begin());
+    // The upper halves of the split block stay free.
+    while (freeOrder > order)
+    {
+        --freeOrder;
+        mFreeBlocks[freeOrder].insert(offset + GetBlockSize(freeOrder));
+    }
+
+    mAllocations[offset] = { order, size };
+    mAllocatedSize += GetBlockSize(order);
+    mRequestedSize += size;
+    return offset;
+}
+
+void BuddyAllocator::Free(UINT64 offset)
+{
+    auto it = mAllocations.find(offset);
+    assert(it != mAllocations.end() && "The offset wasn't allocated");
+    UINT order = it->second.Order;
+    mAllocatedSize -= GetBlockSize(order);
+    mRequestedSize -= it->second.Size;
+    mAllocations.erase(it);
+
+    while (order + 1 < mFreeBlocks.size())
+    {
+        UINT64 buddy = offset ^ GetBlockSize(order);
+        auto buddyIt = mFreeBlocks[order].find(buddy);
+        if (buddyIt == mFreeBlocks[order].end())
+            break;
+        mFreeBlocks[order].erase(buddyIt);
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+    mFreeBlocks[order].insert(offset);
+}
+
+BuddyAllocatorStats BuddyAllocator::GetStats() const
+{
+    BuddyAllocatorStats stats;
+    stats.Capacity = mCapacity;
+    stats.AllocatedSize = mAllocatedSize;
+    stats.RequestedSize = mRequestedSize;
+    stats.AllocationsCount = static_cast<UINT>(mAllocations.size());
+    for (UINT order = 0; order < mFreeBlocks.size(); ++order)
+    {
+        stats.FreeBlocksCount += static_cast<UINT>(mFreeBlocks[order].size());
+        if (!mFreeBlocks[order].empty())
+            stats.LargestFreeBlock = GetBlockSize(order);
+    }
+    return stats;
+}
+
+UINT BuddyAllocator::GetOrder(UINT64 size) const
+{
+    UINT order = 0;
+    while (GetBlockSize(order) < size)
+        ++order;
+    return order;
+}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+struct BuddyAllocatorStats
+{
+    UINT64 Capacity = 0;
+    UINT64 AllocatedSize = 0; // Sum of the blocks sizes.
+    UINT64 RequestedSize = 0; // Sum of the requested sizes, the rest of the allocated size is lost to the rounding.
+    UINT64 LargestFreeBlock = 0;
+    UINT AllocationsCount = 0;
+    UINT FreeBlocksCount = 0;
+};
+
+// Offsets in a range of capacity bytes, it doesn't touch the GPU. Blocks are powers of two from minBlockSize to capacity and every block
+// is aligned to its size, so an alignment is handled by rounding the size up to it. Freed blocks are merged with their buddies right away.
+// The lowest free offset of the fitting size is taken, so allocations are packed towards the beginning of the range.
+class BuddyAllocator
+{
+public:
+    static constexpr UINT64 InvalidOffset = ~0ull;
+
+    // capacity and minBlockSize are powers of two.
+    BuddyAllocator(UINT64 capacity, UINT64 minBlockSize);
+
+    // Returns InvalidOffset if there is no free block large enough. alignment is a power of two.
+    UINT64 Allocate(UINT64 size, UINT64 alignment);
+    void Free(UINT64 offset);
+
+    bool IsEmpty() const;
+    BuddyAllocatorStats GetStats() const;
+
+private:
+    struct Allocation
+    {
+        UINT Order = 0;
+        UINT64 Size = 0;
+    };
+
+    UINT GetOrder(UINT64 size) const;
+    UINT64 GetBlockSize(UINT order) const;
+
+    UINT64 mCapacity = 0;
+    UINT64 mMinBlockSize = 0;
+    std::vector<std::set<UINT64>> mFreeBlocks; // Offsets per order, the order of a block is log2(size / mMinBlockSize).
+    std::unordered_map<UINT64, Allocation> mAllocations; // By offset.
+    UINT64 mAllocatedSize = 0;
+    UINT64 mRequestedSize = 0;
+};
+
+inline bool BuddyAllocator::IsEmpty() const
+{
+    return mAllocations.empty();
+}
+
+inline UINT64 BuddyAllocator::GetBlockSize(UINT order) const
+{
+    return mMinBlockSize << order;
+}
+}
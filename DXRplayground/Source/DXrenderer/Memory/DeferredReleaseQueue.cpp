@@ -0,0 +1,29 @@
+#include "DXrenderer/Memory/DeferredReleaseQueue.h"
+
+#include <cassert>
+
+namespace DirectxPlayground
+{
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+    // The owner flushes the GPU before the destruction.
+    Drain(~0ull);
+}
+
+void DeferredReleaseQueue::Enqueue(UINT64 fenceValue, Deleter deleter)
+{
+    assert((mPending.empty() || mPending.back().FenceValue <= fenceValue) && "Fence values must not decrease");
+    mPending.push_back({ std::move(deleter), fenceValue });
+}
+
+void DeferredReleaseQueue::Drain(UINT64 completedFenceValue)
+{
+    while (!mPending.empty() && mPending.front().FenceValue <= completedFenceValue)
+    {
+        // Popped first, so a deleter can enqueue another release.
+        Deleter deleter = std::move(mPending.front().Delete);
+        mPending.pop_front();
+        deleter();
+    }
+}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// Keeps GPU objects alive until the GPU passes the fence value signaled after the last commands which could use them, so they can be
+// released in the middle of the frame without a flush. It is owned by RenderPipeline, which drains it after every fence wait. It doesn't
+// touch the GPU.
+class DeferredReleaseQueue
+{
+public:
+    // Called once the object is safe to destroy, e.g. to return placed memory to GpuMemoryAllocator.
+    using Deleter = std::function<void()>;
+
+    DeferredReleaseQueue() = default;
+    DeferredReleaseQueue(const DeferredReleaseQueue&) = delete;
+    DeferredReleaseQueue& operator=(const DeferredReleaseQueue&) = delete;
+    ~DeferredReleaseQueue();
+
+    // fenceValue - usually IRenderPipeline::GetPendingFenceValue, fence values must not decrease.
+    void Enqueue(UINT64 fenceValue, Deleter deleter);
+    // Keeps a copy of the owner, e.g. a ComPtr or a ResourceDX, until the fence value is passed.
+    template <typename T>
+    void Release(UINT64 fenceValue, T object);
+    // Runs the deleters of the objects the GPU is done with in the order they were enqueued.
+    void Drain(UINT64 completedFenceValue);
+
+    size_t GetPendingCount() const;
+
+private:
+    struct PendingRelease
+    {
+        Deleter Delete;
+        UINT64 FenceValue = 0;
+    };
+
+    std::deque<PendingRelease> mPending;
+};
+
+template <typename T>
+void DeferredReleaseQueue::Release(UINT64 fenceValue, T object)
+{
+    // The copy captured by the deleter is destroyed together with it.
+    Enqueue(fenceValue, [object = std::move(object)]() {});
+}
+
+inline size_t DeferredReleaseQueue::GetPendingCount() const
+{
+    return mPending.size();
+}
+}
@@ -0,0 +1,113 @@
+#include "DXrenderer/Memory/DescriptorAllocator.h"
+
+#include <cassert>
+#include <iterator>
+
+namespace DirectxPlayground
+{
+DescriptorAllocator::DescriptorAllocator(UINT persistentCount, UINT transientCount, UINT framesCount)
+    : mPersistentCount(persistentCount)
+    , mTransientCount(transientCount)
+    , mFramesCount(framesCount)
+{}
+
+UINT DescriptorAllocator::Allocate(UINT count)
+{
+    assert(count > 0);
+    UINT index = InvalidIndex;
+    auto fit = mFreeRangesBySize.lower_bound({ count, 0 });
+    if (fit != mFreeRangesBySize.end() && fit->first == count)
+    {
+        index = fit->second;
+        RemoveFreeRange(mFreeRanges.find(index));
+    }
+    else if (mPersistentEnd + count <= mPersistentCount)
+    {
+        index = mPersistentEnd;
+        mPersistentEnd += count;
+    }
+    else if (fit != mFreeRangesBySize.end())
+    {
+        index = fit->second;
+        UINT freeCount = fit->first;
+        RemoveFreeRange(mFreeRanges.find(index));
+        AddFreeRange(index + count, freeCount - count);
+    }
+    else
+    {
+        return InvalidIndex;
+    }
+    mAllocatedCount += count;
+    return index;
+}
+
+void DescriptorAllocator::Free(UINT index, UINT count, UINT64 fenceValue)
+{
+    assert(index + count <= mPersistentEnd && "Transient descriptors are freed by BeginFrame");
+    assert((mPendingFrees.empty() || mPendingFrees.back().FenceValue <= fenceValue) && "Fence values must not decrease");
+    mPendingFrees.push_back({ index, count, fenceValue });
+}
+
+void DescriptorAllocator::Reclaim(UINT64 completedFenceValue)
+{
+    while (!mPendingFrees.empty() && mPendingFrees.front().FenceValue <= completedFenceValue)
+    {
+        const PendingFree& pending = mPendingFrees.front();
+        AddFreeRange(pending.Index, pending.Count);
+        mAllocatedCount -= pending.Count;
+        mPendingFrees.pop_front();
+    }
+}
+
+void DescriptorAllocator::BeginFrame(UINT frameIndex)
+{
+    assert(frameIndex < mFramesCount);
+    mFrameIndex = frameIndex;
+    mTransientEnd = 0;
+}
+
+UINT DescriptorAllocator::AllocateTransient(UINT count)
+{
+    assert(count > 0 && mFramesCount > 0);
+    if (mTransientEnd + count > mTransientCount)
+        return InvalidIndex;
+    UINT index = mPersistentCount + mFrameIndex * mTransientCount + mTransientEnd;
+    mTransientEnd += count;
+    return index;
+}
+
+void DescriptorAllocator::AddFreeRange(UINT index, UINT count)
+{
+    FreeRange next = mFreeRanges.lower_bound(index);
+    if (next != mFreeRanges.begin())
+    {
+        FreeRange prev = std::prev(next);
+        assert(prev->first + prev->second <= index && "The range is already free");
+        if (prev->first + prev->second == index)
+        {
+            index = prev->first;
+            count += prev->second;
+            RemoveFreeRange(prev);
+        }
+    }
+    if (next != mFreeRanges.end() && next->first == index + count)
+    {
+        count += next->second;
+        RemoveFreeRange(next);
+    }
+
+    if (index + count == mPersistentEnd)
+    {
+        mPersistentEnd = index;
+        return;
+    }
+    mFreeRanges.emplace(index, count);
+    mFreeRangesBySize.emplace(count, index);
+}
+
+void DescriptorAllocator::RemoveFreeRange(FreeRange range)
+{
+    mFreeRangesBySize.erase({ range->second, range->first });
+    mFreeRanges.erase(range);
+}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <set>
+#include <utility>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+// Indices of descriptors in a range of a heap, it doesn't touch the GPU. The range starts with persistentCount descriptors which are
+// allocated and freed one range at a time, it is followed by framesCount linear regions of transientCount descriptors which are reset
+// as a whole in BeginFrame. Freed ranges are reused only after the GPU passes the fence value they were freed with. Reclaimed ranges are
+// merged with their free neighbours, so freed single descriptors can serve larger ranges again, and the ones at the end give the space
+// back to it. A free range of the size is reused first, then the space at the end, then the smallest larger free range is split.
+class DescriptorAllocator
+{
+public:
+    static constexpr UINT InvalidIndex = ~0u;
+
+    explicit DescriptorAllocator(UINT persistentCount, UINT transientCount = 0, UINT framesCount = 0);
+
+    // Returns the first index of count consecutive descriptors or InvalidIndex if the persistent part is full.
+    UINT Allocate(UINT count = 1);
+    // fenceValue - signaled after the last commands which could use the descriptors, fence values must not decrease.
+    void Free(UINT index, UINT count, UINT64 fenceValue);
+    void Reclaim(UINT64 completedFenceValue);
+
+    // The commands which used the region of the frame the previous time must be finished.
+    void BeginFrame(UINT frameIndex);
+    // Valid until the next BeginFrame with the same frame index. Returns InvalidIndex if the region of the frame is full.
+    UINT AllocateTransient(UINT count);
+
+    UINT GetCapacity() const;
+    // Persistent descriptors, including the freed ones the GPU could still use.
+    UINT GetAllocatedCount() const;
+
+private:
+    struct PendingFree
+    {
+        UINT Index = 0;
+        UINT Count = 0;
+        UINT64 FenceValue = 0;
+    };
+
+    using FreeRange = std::map<UINT, UINT>::iterator;
+
+    void AddFreeRange(UINT index, UINT count);
+    void RemoveFreeRange(FreeRange range);
+
+    std::map<UINT, UINT> mFreeRanges; // The count by the first index.
+    std::set<std::pair<UINT, UINT>> mFreeRangesBySize; // The count and the first index.
+    std::deque<PendingFree> mPendingFrees;
+    UINT mPersistentCount = 0;
+    UINT mPersistentEnd = 0; // Nothing is allocated after it.
+    UINT mAllocatedCount = 0;
+
+    UINT mTransientCount = 0;
+    UINT mFramesCount = 0;
+    UINT mFrameIndex = 0;
+    UINT mTransientEnd = 0; // In the region of the current frame.
+};
+
+inline UINT DescriptorAllocator::GetCapacity() const
+{
+    return mPersistentCount + mTransientCount * mFramesCount;
+}
+
+inline UINT DescriptorAllocator::GetAllocatedCount() const
+{
+    return mAllocatedCount;
+}
+}
@@ -0,0 +1,154 @@
+#include "DXrenderer/Memory/GpuMemoryAllocator.h"
+
+#include <cassert>
+#include <sstream>
+
+#include "External/Dx12Helpers/d3dx12.h"
+#include "DXrenderer/DXhelpers.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr D3D12_HEAP_FLAGS HeapFlags[] = { D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES };
+constexpr const char* HeapNames[] = { "buffers", "textures", "render targets" };
+}
+
+GpuMemoryAllocator::GpuMemoryAllocator(ID3D12Device* device, UINT64 heapSize)
+    : mDevice(device)
+    , mHeapSize(heapSize)
+{
+    assert(heapSize % D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT == 0);
+}
+
+void GpuMemoryAllocator::CreateResource(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue, ResourceDX& resource)
+{
+    HeapKind kind = GetHeapKind(desc);
+    D3D12_RESOURCE_DESC placedDesc = desc;
+    D3D12_RESOURCE_ALLOCATION_INFO info{};
+    // The small alignment is only allowed for textures of up to 64 KB, the device reports the default one otherwise.
+    if (kind == Textures && desc.SampleDesc.Count == 1)
+    {
+        placedDesc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+        info = mDevice->GetResourceAllocationInfo(0, 1, &placedDesc);
+    }
+    if (info.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+    {
+        placedDesc.Alignment = 0;
+        info = mDevice->GetResourceAllocationInfo(0, 1, &placedDesc);
+    }
+
+    if (info.SizeInBytes > mHeapSize)
+    {
+        CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+        ThrowIfFailed(mDevice->CreateCommittedResource(&heapProperties,
+            D3D12_HEAP_FLAG_NONE,
+            &desc,
+            resource.GetCurrentState(),
+            clearValue,
+            IID_PPV_ARGS(resource.GetAddressOf())));
+        ++mCommittedCount;
+        mCommittedSize += info.SizeInBytes;
+        return;
+    }
+
+    Allocation allocation;
+    allocation.Kind = kind;
+    allocation.Offset = BuddyAllocator::InvalidOffset;
+    std::vector<HeapBlock>& heaps = mHeaps[kind];
+    for (UINT i = 0; i < heaps.size() && allocation.Offset == BuddyAllocator::InvalidOffset; ++i)
+    {
+        allocation.HeapIndex = i;
+        allocation.Offset = heaps[i].Allocator.Allocate(info.SizeInBytes, info.Alignment);
+    }
+    if (allocation.Offset == BuddyAllocator::InvalidOffset)
+    {
+        CreateHeap(kind);
+        allocation.HeapIndex = static_cast<UINT>(heaps.size()) - 1;
+        allocation.Offset = heaps.back().Allocator.Allocate(info.SizeInBytes, info.Alignment);
+        assert(allocation.Offset != BuddyAllocator::InvalidOffset);
+    }
+
+    ThrowIfFailed(mDevice->CreatePlacedResource(heaps[allocation.HeapIndex].Heap.Get(),
+        allocation.Offset,
+        &placedDesc,
+        resource.GetCurrentState(),
+        clearValue,
+        IID_PPV_ARGS(resource.GetAddressOf())));
+    mAllocations[resource.Get()] = allocation;
+}
+
+void GpuMemoryAllocator::Release(ID3D12Resource* resource)
+{
+    auto it = mAllocations.find(resource);
+    if (it == mAllocations.end())
+        return;
+    mHeaps[it->second.Kind][it->second.HeapIndex].Allocator.Free(it->second.Offset);
+    mAllocations.erase(it);
+}
+
+GpuMemoryStats GpuMemoryAllocator::GetStats() const
+{
+    GpuMemoryStats stats;
+    for (const std::vector<HeapBlock>& heaps : mHeaps)
+    {
+        for (const HeapBlock& heap : heaps)
+        {
+            BuddyAllocatorStats heapStats = heap.Allocator.GetStats();
+            ++stats.HeapsCount;
+            stats.HeapsSize += heapStats.Capacity;
+            stats.PlacedCount += heapStats.AllocationsCount;
+            stats.PlacedSize += heapStats.AllocatedSize;
+            stats.RequestedSize += heapStats.RequestedSize;
+        }
+    }
+    stats.CommittedCount = mCommittedCount;
+    stats.CommittedSize = mCommittedSize;
+    return stats;
+}
+
+std::string GpuMemoryAllocator::GetFragmentationReport() const
+{
+    std::ostringstream report;
+    for (UINT kind = 0; kind < HeapKindsCount; ++kind)
+    {
+        for (UINT i = 0; i < mHeaps[kind].size(); ++i)
+        {
+            BuddyAllocatorStats stats = mHeaps[kind][i].Allocator.GetStats();
+            UINT64 freeSize = stats.Capacity - stats.AllocatedSize;
+            // 0 if all the free memory is one block, close to 1 if it is scattered over small ones.
+            float fragmentation = freeSize > 0 ? 1.0f - float(stats.LargestFreeBlock) / float(freeSize) : 0.0f;
+            report << HeapNames[kind] << " heap " << i << ": " << stats.AllocationsCount << " resources, "
+                << stats.AllocatedSize << " of " << stats.Capacity << " bytes used (" << stats.AllocatedSize - stats.RequestedSize << " lost to rounding), "
+                << stats.FreeBlocksCount << " free blocks, the largest one is " << stats.LargestFreeBlock << " bytes, fragmentation " << fragmentation << "\n";
+        }
+    }
+    report << mCommittedCount << " committed resources, " << mCommittedSize << " bytes\n";
+    return report.str();
+}
+
+GpuMemoryAllocator::HeapKind GpuMemoryAllocator::GetHeapKind(const D3D12_RESOURCE_DESC& desc)
+{
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        return Buffers;
+    if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+        return RenderTargets;
+    return Textures;
+}
+
+void GpuMemoryAllocator::CreateHeap(HeapKind kind)
+{
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes = mHeapSize;
+    heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    // MSAA render targets need the larger alignment of the heap too.
+    heapDesc.Alignment = kind == RenderTargets ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapDesc.Flags = HeapFlags[kind];
+
+    HeapBlock heap{ nullptr, BuddyAllocator(mHeapSize, D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) };
+    ThrowIfFailed(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap.Heap)));
+    std::wstring name = L"gpu_memory_heap_" + std::to_wstring(kind) + L"_" + std::to_wstring(mHeaps[kind].size());
+    SetDXobjectName(heap.Heap.Get(), name.c_str());
+    mHeaps[kind].push_back(std::move(heap));
+}
+}
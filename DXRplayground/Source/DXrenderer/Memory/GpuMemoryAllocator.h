@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <d3d12.h>
+#include <wrl.h>
+
+#include "DXrenderer/Memory/BuddyAllocator.h"
+#include "DXrenderer/ResourceDX.h"
+
+namespace DirectxPlayground
+{
+struct GpuMemoryStats
+{
+    UINT HeapsCount = 0;
+    UINT64 HeapsSize = 0;
+    UINT PlacedCount = 0;
+    UINT64 PlacedSize = 0; // Including the rounding to the blocks sizes.
+    UINT64 RequestedSize = 0;
+    UINT CommittedCount = 0; // Created so far because they didn't fit a heap.
+    UINT64 CommittedSize = 0;
+};
+
+// Default heap memory for textures and buffers. Resources are placed in large heaps which are split by BuddyAllocator, there are separate
+// heaps for buffers, textures and render target or depth textures, so heap tier 1 is enough. Small textures get 4 KB alignment, MSAA
+// ones 4 MB, the rest 64 KB. Resources larger than a heap are created as committed ones. Heaps are never released until the destruction.
+class GpuMemoryAllocator
+{
+public:
+    static constexpr UINT64 DefaultHeapSize = 64ull * 1024 * 1024;
+
+    GpuMemoryAllocator(ID3D12Device* device, UINT64 heapSize = DefaultHeapSize);
+    GpuMemoryAllocator(const GpuMemoryAllocator&) = delete;
+    GpuMemoryAllocator(GpuMemoryAllocator&&) = delete;
+    GpuMemoryAllocator& operator=(const GpuMemoryAllocator&) = delete;
+    GpuMemoryAllocator& operator=(GpuMemoryAllocator&&) = delete;
+    ~GpuMemoryAllocator() = default;
+
+    // The state of the resource is its current state. Placed render targets and depth textures have to be cleared,
+    // discarded or copied to before the first use.
+    void CreateResource(const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue, ResourceDX& resource);
+    // Call it once the GPU doesn't use the resource anymore, the memory can be reused right away. Committed resources are skipped.
+    void Release(ID3D12Resource* resource);
+
+    GpuMemoryStats GetStats() const;
+    // Per heap usage, free blocks and the largest free block.
+    std::string GetFragmentationReport() const;
+
+private:
+    enum HeapKind
+    {
+        Buffers,
+        Textures,
+        RenderTargets,
+        HeapKindsCount
+    };
+
+    struct HeapBlock
+    {
+        Microsoft::WRL::ComPtr<ID3D12Heap> Heap;
+        BuddyAllocator Allocator;
+    };
+
+    struct Allocation
+    {
+        HeapKind Kind = Buffers;
+        UINT HeapIndex = 0;
+        UINT64 Offset = 0;
+    };
+
+    static HeapKind GetHeapKind(const D3D12_RESOURCE_DESC& desc);
+    void CreateHeap(HeapKind kind);
+
+    ID3D12Device* mDevice = nullptr;
+    UINT64 mHeapSize = 0;
+    std::array<std::vector<HeapBlock>, HeapKindsCount> mHeaps;
+    std::unordered_map<ID3D12Resource*, Allocation> mAllocations;
+    UINT mCommittedCount = 0;
+    UINT64 mCommittedSize = 0;
+};
+}
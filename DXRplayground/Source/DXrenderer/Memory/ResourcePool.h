@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <vector>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+using ResourceHandle = UINT;
+constexpr ResourceHandle InvalidResourceHandle = ~0u;
+
+// Objects addressed by 32 bit handles: the low IndexBits are the slot and the rest is the generation of the slot. Destroying an object
+// bumps the generation, so a stale handle is detected instead of silently pointing to the object which reused the slot. Objects live in
+// pages of PageSize which are never moved, pointers stay valid until the object is destroyed. Freed slots are reused first.
+template <typename T, UINT PageSize = 256>
+class ResourcePool
+{
+public:
+    static constexpr UINT IndexBits = 20;
+    static constexpr UINT MaxCount = (1u << IndexBits) - 1; // The last index is taken by InvalidResourceHandle.
+
+    ResourcePool() = default;
+    ResourcePool(const ResourcePool&) = delete;
+    ResourcePool& operator=(const ResourcePool&) = delete;
+
+    ResourceHandle Create(T value);
+    // The slot is reset to T{}.
+    void Destroy(ResourceHandle handle);
+
+    // nullptr if the object was destroyed.
+    T* Get(ResourceHandle handle);
+    const T* Get(ResourceHandle handle) const;
+    bool IsValid(ResourceHandle handle) const;
+    UINT GetCount() const;
+    // Calls func(handle, object) for the live objects in the slot order, so the pages are walked front to back.
+    template <typename Func>
+    void ForEach(Func&& func);
+
+private:
+    static constexpr UINT IndexMask = (1u << IndexBits) - 1;
+
+    static UINT GetIndex(ResourceHandle handle);
+    static UINT GetGeneration(ResourceHandle handle);
+    T& GetSlot(UINT index);
+
+    std::vector<std::unique_ptr<T[]>> mPages;
+    std::vector<UINT> mGenerations; // Per slot.
+    std::vector<bool> mLive; // Per slot.
+    std::vector<UINT> mFreeSlots;
+    UINT mCount = 0;
+};
+
+template <typename T, UINT PageSize>
+ResourceHandle ResourcePool<T, PageSize>::Create(T value)
+{
+    UINT index = 0;
+    if (!mFreeSlots.empty())
+    {
+        index = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    }
+    else
+    {
+        index = static_cast<UINT>(mGenerations.size());
+        assert(index < MaxCount && "Too many objects in the pool");
+        if (index % PageSize == 0)
+            mPages.emplace_back(new T[PageSize]);
+        mGenerations.push_back(0);
+        mLive.push_back(false);
+    }
+    GetSlot(index) = std::move(value);
+    mLive[index] = true;
+    ++mCount;
+    return (mGenerations[index] << IndexBits) | index;
+}
+
+template <typename T, UINT PageSize>
+void ResourcePool<T, PageSize>::Destroy(ResourceHandle handle)
+{
+    assert(IsValid(handle) && "The object was destroyed already");
+    UINT index = GetIndex(handle);
+    GetSlot(index) = T{};
+    // Wraps around, a handle which outlives 4096 reuses of its slot isn't detected.
+    mGenerations[index] = (mGenerations[index] + 1) & (~0u >> IndexBits);
+    mLive[index] = false;
+    mFreeSlots.push_back(index);
+    --mCount;
+}
+
+template <typename T, UINT PageSize>
+T* ResourcePool<T, PageSize>::Get(ResourceHandle handle)
+{
+    return IsValid(handle) ? &GetSlot(GetIndex(handle)) : nullptr;
+}
+
+template <typename T, UINT PageSize>
+const T* ResourcePool<T, PageSize>::Get(ResourceHandle handle) const
+{
+    return const_cast<ResourcePool*>(this)->Get(handle);
+}
+
+template <typename T, UINT PageSize>
+bool ResourcePool<T, PageSize>::IsValid(ResourceHandle handle) const
+{
+    UINT index = GetIndex(handle);
+    return handle != InvalidResourceHandle && index < mGenerations.size() && mGenerations[index] == GetGeneration(handle);
+}
+
+template <typename T, UINT PageSize>
+UINT ResourcePool<T, PageSize>::GetCount() const
+{
+    return mCount;
+}
+
+template <typename T, UINT PageSize>
+template <typename Func>
+void ResourcePool<T, PageSize>::ForEach(Func&& func)
+{
+    for (UINT index = 0; index < mLive.size(); ++index)
+    {
+        if (mLive[index])
+            func((mGenerations[index] << IndexBits) | index, GetSlot(index));
+    }
+}
+
+template <typename T, UINT PageSize>
+UINT ResourcePool<T, PageSize>::GetIndex(ResourceHandle handle)
+{
+    return handle & IndexMask;
+}
+
+template <typename T, UINT PageSize>
+UINT ResourcePool<T, PageSize>::GetGeneration(ResourceHandle handle)
+{
+    return handle >> IndexBits;
+}
+
+template <typename T, UINT PageSize>
+T& ResourcePool<T, PageSize>::GetSlot(UINT index)
+{
+    return mPages[index / PageSize][index % PageSize];
+}
+}
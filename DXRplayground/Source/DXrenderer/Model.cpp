@@ -2,11 +2,12 @@
 
 #include "DXrenderer/RenderContext.h"
 #include "DXrenderer/Textures/TextureManager.h"
-#include "DXrenderer/Buffers/UploadBuffer.h"
+#include "DXrenderer/Buffers/ConstantBufferAllocator.h"
 #include "Utils/Logger.h"
 #include "Utils/BinaryContainer.h"
 #include "Utils/AssetSystem.h"
 
+#include <algorithm>
 #include <filesystem>
 
 #define TINYGLTF_IMPLEMENTATION
@@ -26,14 +27,16 @@ T GetElementFromBuffer(const byte* bufferStart, UINT byteStride, size_t elemInde
 }
 }
 
-Model::Model(RenderContext& ctx, const std::string& path)
+Model::Model(RenderContext& ctx, const std::string& path, CpuDataResidency residency /*= CpuDataResidency::Keep*/)
+    : mResidency(residency)
 {
     AssetSystem::Load(path, *this);
 
     InitializeRuntimeData(ctx, path);
 }
 
-Model::Model(RenderContext& ctx, std::vector<Vertex> vertices, std::vector<UINT> indices)
+Model::Model(RenderContext& ctx, std::vector<Vertex> vertices, std::vector<UINT> indices, CpuDataResidency residency /*= CpuDataResidency::Keep*/)
+    : mResidency(residency)
 {
     mMeshes.push_back({});
     Mesh* sMesh = &mMeshes.back();
@@ -42,18 +45,46 @@ Model::Model(RenderContext& ctx, std::vector<Vertex> vertices, std::vector<UINT>
     sMesh->mIndices.swap(indices);
     sMesh->mIndexCount = static_cast<UINT>(sMesh->mIndices.size());
 
-    sMesh->mVertexBuffer = new VertexBuffer(reinterpret_cast<byte*>(sMesh->mVertices.data()), static_cast<UINT>(sizeof(Vertex) * sMesh->mVertices.size()), sizeof(Vertex), ctx.CommandList, ctx.Device);
-    sMesh->mIndexBuffer = new IndexBuffer(reinterpret_cast<byte*>(sMesh->mIndices.data()), static_cast<UINT>(sizeof(UINT) * sMesh->mIndices.size()), ctx.CommandList, ctx.Device, DXGI_FORMAT_R32_UINT);
+    CreateMeshBuffers(ctx, *sMesh);
 }
 
 Model::~Model()
 {
+    // Other models loaded from the same files keep their references.
+    for (const TexResourceData& texture : mImageTextures)
+        mTextureManager->ReleaseTexture(texture);
 }
 
 void Model::UpdateMeshes(UINT frame)
 {
     for (auto& mesh : mMeshes)
-        mesh.UpdateMaterialBuffer(frame);
+    {
+        if (mTextureManager == nullptr)
+        {
+            mesh.UpdateMaterialBuffer(frame, mesh.mRuntimeMaterial);
+            continue;
+        }
+        // Streamed textures change their descriptors with the residency.
+        Material material = mesh.mRuntimeMaterial;
+        material.BaseColorTexture = mTextureManager->ResolveSrv(material.BaseColorTexture);
+        material.MetallicRoughnessTexture = mTextureManager->ResolveSrv(material.MetallicRoughnessTexture);
+        material.NormalTexture = mTextureManager->ResolveSrv(material.NormalTexture);
+        material.OcclusionTexture = mTextureManager->ResolveSrv(material.OcclusionTexture);
+        mesh.UpdateMaterialBuffer(frame, material);
+    }
+}
+
+void Model::UpdateTextureStreaming(bool visible, float screenSize)
+{
+    if (mTextureManager == nullptr)
+        return;
+    for (const auto& image : mImages)
+        mTextureManager->SetStreamingFeedback(image.IndexInHeap, visible, screenSize);
+}
+
+void Model::LogMemoryStats() const
+{
+    LOG("Model memory: ", mMemoryStats.ResidentCpuBytes, " bytes resident on CPU, ", mMemoryStats.ReleasedCpuBytes, " CPU bytes released");
 }
 
 void Model::Parse(const std::string& filename)
@@ -135,29 +166,89 @@ void Model::InitializeRuntimeData(RenderContext& ctx, const std::string& path)
 {
     std::filesystem::path pathToModel{ path };
     std::string dir = pathToModel.parent_path().string() + '\\';
-    for (auto& image : mImages)
+    std::vector<std::string> imagePaths;
+    imagePaths.reserve(mImages.size());
+    for (const auto& image : mImages)
+        imagePaths.push_back(dir + image.Name);
+
+    // An image shared between several material slots can't use a single channel format, so it falls back to the generic compression.
+    std::vector<TextureUsage> usages(mImages.size(), TextureUsage::Raw);
+    auto markUsage = [this, &usages](int textureIndex, TextureUsage usage)
+    {
+        if (textureIndex == -1)
+            return;
+        TextureUsage& imageUsage = usages[mTextures[textureIndex]];
+        imageUsage = (imageUsage == TextureUsage::Raw || imageUsage == usage) ? usage : TextureUsage::Generic;
+    };
+    for (const auto& mesh : mMeshes)
+    {
+        markUsage(mesh.mMaterial.BaseColorTexture, TextureUsage::BaseColor);
+        markUsage(mesh.mMaterial.MetallicRoughnessTexture, TextureUsage::MetallicRoughness);
+        markUsage(mesh.mMaterial.NormalTexture, TextureUsage::Normal);
+        markUsage(mesh.mMaterial.OcclusionTexture, TextureUsage::Occlusion);
+    }
+
+    mTextureManager = ctx.TexManager;
+    mImageTextures = mTextureManager->CreateStreamedTextures(ctx, imagePaths, usages);
+    for (size_t i = 0; i < mImages.size(); ++i)
     {
-        UINT index = ctx.TexManager->CreateTexture(ctx, dir + image.Name).SRVOffset;
-        image.IndexInHeap = index;
+        mImages[i].IndexInHeap = mImageTextures[i].SRVOffset;
+        mImages[i].ArraySlice = mImageTextures[i].ArraySlice;
     }
 
+    auto bindTexture = [this](int textureIndex, int& heapIndex, int& slice)
+    {
+        if (textureIndex == -1)
+            return;
+        const Image& image = mImages[mTextures[textureIndex]];
+        heapIndex = image.IndexInHeap;
+        slice = image.ArraySlice == InvalidOffset ? -1 : static_cast<int>(image.ArraySlice);
+    };
     for (auto& mesh : mMeshes)
     {
         const Material& modelMat = mesh.mMaterial;
-        if (modelMat.BaseColorTexture != -1)
-            mesh.mRuntimeMaterial.BaseColorTexture = mImages[mTextures[modelMat.BaseColorTexture]].IndexInHeap;
-        if (modelMat.MetallicRoughnessTexture != -1)
-            mesh.mRuntimeMaterial.MetallicRoughnessTexture = mImages[mTextures[modelMat.MetallicRoughnessTexture]].IndexInHeap;
-        if (modelMat.NormalTexture != -1)
-            mesh.mRuntimeMaterial.NormalTexture = mImages[mTextures[modelMat.NormalTexture]].IndexInHeap;
-        if (modelMat.OcclusionTexture != -1)
-            mesh.mRuntimeMaterial.OcclusionTexture = mImages[mTextures[modelMat.OcclusionTexture]].IndexInHeap;
+        Material& runtimeMat = mesh.mRuntimeMaterial;
+        bindTexture(modelMat.BaseColorTexture, runtimeMat.BaseColorTexture, runtimeMat.BaseColorSlice);
+        bindTexture(modelMat.MetallicRoughnessTexture, runtimeMat.MetallicRoughnessTexture, runtimeMat.MetallicRoughnessSlice);
+        bindTexture(modelMat.NormalTexture, runtimeMat.NormalTexture, runtimeMat.NormalSlice);
+        bindTexture(modelMat.OcclusionTexture, runtimeMat.OcclusionTexture, runtimeMat.OcclusionSlice);
         memcpy(mesh.mRuntimeMaterial.BaseColorFactor, modelMat.BaseColorFactor, sizeof(float) * 4);
 
-        mesh.mVertexBuffer = new VertexBuffer(reinterpret_cast<byte*>(mesh.mVertices.data()), static_cast<UINT>(sizeof(Vertex) * mesh.mVertices.size()), sizeof(Vertex), ctx.CommandList, ctx.Device);
-        mesh.mIndexBuffer = new IndexBuffer(reinterpret_cast<byte*>(mesh.mIndices.data()), static_cast<UINT>(sizeof(UINT) * mesh.mIndices.size()), ctx.CommandList, ctx.Device, DXGI_FORMAT_R32_UINT);
-        mesh.mMaterialBuffer = new UploadBuffer(*ctx.Device, sizeof(Material), true, RenderContext::FramesCount);
+        CreateMeshBuffers(ctx, mesh);
+        mesh.mMaterialConstants = ctx.Constants->CreatePersistent(sizeof(Material));
+    }
+}
+
+void Model::CreateMeshBuffers(RenderContext& ctx, Mesh& mesh)
+{
+    mesh.mVertexCount = static_cast<UINT>(mesh.mVertices.size());
+    for (const Vertex& v : mesh.mVertices)
+        mBoundingRadius = std::max(mBoundingRadius, XMVectorGetX(XMVector3Length(XMLoadFloat3(&v.Pos))));
+    mesh.mVertexBuffer = new VertexBuffer(ctx, reinterpret_cast<byte*>(mesh.mVertices.data()), static_cast<UINT>(sizeof(Vertex) * mesh.mVertices.size()), sizeof(Vertex));
+    mesh.mIndexBuffer = new IndexBuffer(ctx, reinterpret_cast<byte*>(mesh.mIndices.data()), static_cast<UINT>(sizeof(UINT) * mesh.mIndices.size()), DXGI_FORMAT_R32_UINT);
+
+    ApplyCpuDataResidency(mesh);
+}
+
+void Model::ApplyCpuDataResidency(Mesh& mesh)
+{
+    // The data is already copied to the upload heaps at this point, so the CPU copies aren't needed for rendering.
+    size_t sizeBefore = mesh.GetCpuDataSize();
+    if (mResidency == CpuDataResidency::PositionsOnly)
+    {
+        mesh.mPositions.reserve(mesh.mVertices.size());
+        for (const Vertex& v : mesh.mVertices)
+            mesh.mPositions.push_back(v.Pos);
     }
+    if (mResidency != CpuDataResidency::Keep)
+        std::vector<Vertex>().swap(mesh.mVertices);
+    if (mResidency == CpuDataResidency::Release)
+        std::vector<UINT>().swap(mesh.mIndices);
+
+    size_t sizeAfter = mesh.GetCpuDataSize();
+    mMemoryStats.ResidentCpuBytes += sizeAfter;
+    if (sizeBefore > sizeAfter)
+        mMemoryStats.ReleasedCpuBytes += sizeBefore - sizeAfter;
 }
 
 void Model::LoadModel(const std::string& path, tinygltf::Model& model)
@@ -5,8 +5,10 @@
 #include <string>
 #include <vector>
 
+#include "Buffers/ConstantBufferAllocator.h"
 #include "Buffers/HeapBuffer.h"
 #include "Buffers/UploadBuffer.h"
+#include "Textures/TextureCache.h"
 #include "Utils/Helpers.h"
 #include "Utils/Asset.h"
 
@@ -49,6 +51,7 @@ struct Vertex
 struct Image
 {
     UINT IndexInHeap = 0;
+    UINT ArraySlice = ~0U; // Set if the image is packed into a texture array.
     std::string Name;
 
     friend BinaryContainer& operator<<(BinaryContainer& op, const Image& i)
@@ -63,6 +66,20 @@ struct Image
     }
 };
 
+// What happens to the system memory copies of vertices and indices once they were copied to the upload heaps.
+enum class CpuDataResidency
+{
+    Keep,
+    Release,
+    PositionsOnly // Positions and indices stay for CPU culling and BVH builds.
+};
+
+struct ModelMemoryStats
+{
+    size_t ResidentCpuBytes = 0;
+    size_t ReleasedCpuBytes = 0;
+};
+
 struct Material
 {
     int BaseColorTexture = 0;
@@ -70,6 +87,11 @@ struct Material
     int NormalTexture = 0;
     int OcclusionTexture = 0;
     float BaseColorFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    // Runtime only, -1 unless the texture is a slice of a texture array. Not serialized.
+    int BaseColorSlice = -1;
+    int MetallicRoughnessSlice = -1;
+    int NormalSlice = -1;
+    int OcclusionSlice = -1;
 
     friend BinaryContainer& operator<<(BinaryContainer& op, const Material& m)
     {
@@ -94,16 +116,35 @@ public:
         {
             SafeDelete(mIndexBuffer);
             SafeDelete(mVertexBuffer);
-            SafeDelete(mMaterialBuffer);
         }
 
         UINT GetIndexCount() const
         {
-            return UINT(mIndices.size());
+            return mIndexCount;
         }
         UINT GetVertexCount() const
         {
-            return UINT(mVertices.size());
+            return mVertexCount;
+        }
+
+        const std::vector<Vertex>& GetVertices() const
+        {
+            return mVertices;
+        }
+
+        const std::vector<XMFLOAT3>& GetPositions() const
+        {
+            return mPositions;
+        }
+
+        const std::vector<UINT>& GetIndices() const
+        {
+            return mIndices;
+        }
+
+        size_t GetCpuDataSize() const
+        {
+            return sizeof(Vertex) * mVertices.size() + sizeof(XMFLOAT3) * mPositions.size() + sizeof(UINT) * mIndices.size();
         }
 
         const D3D12_VERTEX_BUFFER_VIEW& GetVertexBufferView() const
@@ -128,7 +169,7 @@ public:
 
         D3D12_GPU_VIRTUAL_ADDRESS GetMaterialBufferGpuAddress(UINT frame) const
         {
-            return mMaterialBuffer->GetFrameDataGpuAddress(frame);
+            return mMaterialConstants.GetGpuAddress(frame);
         }
 
         ID3D12Resource* GetIndexBufferResource() const
@@ -141,9 +182,10 @@ public:
             return mVertexBuffer->GetVertexBuffer();
         }
 
-        void UpdateMaterialBuffer(UINT frame)
+        // Only writes the copy of the frame if the material has changed, e.g. with the residency of a streamed texture.
+        void UpdateMaterialBuffer(UINT frame, const Material& material)
         {
-            mMaterialBuffer->UploadData(frame, mRuntimeMaterial);
+            mMaterialConstants.Update(frame, material);
         }
 
         friend BinaryContainer& operator<<(BinaryContainer& op, const Mesh& m)
@@ -161,20 +203,22 @@ public:
         friend class Model;
 
         UINT mIndexCount = 0;
+        UINT mVertexCount = 0;
         Material mMaterial{};
         Material mRuntimeMaterial{};
 
         std::vector<Vertex> mVertices;
         std::vector<UINT> mIndices;
+        std::vector<XMFLOAT3> mPositions;
 
         VertexBuffer* mVertexBuffer = nullptr;
         IndexBuffer* mIndexBuffer = nullptr;
 
-        UploadBuffer* mMaterialBuffer = nullptr;
+        PersistentConstants mMaterialConstants;
     };
 
-    Model(RenderContext& ctx, const std::string& path);
-    Model(RenderContext& ctx, std::vector<Vertex> vertices, std::vector<UINT> indices);
+    Model(RenderContext& ctx, const std::string& path, CpuDataResidency residency = CpuDataResidency::Keep);
+    Model(RenderContext& ctx, std::vector<Vertex> vertices, std::vector<UINT> indices, CpuDataResidency residency = CpuDataResidency::Keep);
     ~Model();
 
     UINT GetIndexCount() const;
@@ -185,6 +229,12 @@ public:
 
     const std::vector<Mesh>& GetMeshes() const;
     void UpdateMeshes(UINT frame);
+    // screenSize - size of the model bounding sphere on screen in pixels. Textures are streamed in only up to the level this size needs.
+    void UpdateTextureStreaming(bool visible, float screenSize);
+    float GetBoundingRadius() const;
+
+    void LogMemoryStats() const;
+    const ModelMemoryStats& GetMemoryStats() const;
 
     void Parse(const std::string& filename) override;
     void Serialize(BinaryContainer& container) override;
@@ -195,6 +245,8 @@ private:
     inline static constexpr size_t AssetSerializationVersion = 0;
 
     void InitializeRuntimeData(RenderContext& ctx, const std::string& path);
+    void CreateMeshBuffers(RenderContext& ctx, Mesh& mesh);
+    void ApplyCpuDataResidency(Mesh& mesh);
     void LoadModel(const std::string& path, tinygltf::Model& model);
     void ParseModelNodes(const tinygltf::Model& model, const tinygltf::Node& node);
     void ParseGLTFMesh(const tinygltf::Model& model, const tinygltf::Node& node, const tinygltf::Mesh& mesh);
@@ -203,8 +255,14 @@ private:
 
     std::vector<Mesh> mMeshes;
     std::vector<Image> mImages;
+    std::vector<TexResourceData> mImageTextures; // Per image, released with the model.
     std::vector<int> mTextures;
     std::vector<Material> mMaterials;
+
+    TextureManager* mTextureManager = nullptr; // Set if the model textures are streamed.
+    float mBoundingRadius = 0.0f; // Around the model space origin.
+    CpuDataResidency mResidency = CpuDataResidency::Keep;
+    ModelMemoryStats mMemoryStats{};
 };
 
 inline UINT Model::GetIndexCount() const
@@ -232,6 +290,16 @@ inline const std::vector<Model::Mesh>& Model::GetMeshes() const
     return mMeshes;
 }
 
+inline float Model::GetBoundingRadius() const
+{
+    return mBoundingRadius;
+}
+
+inline const ModelMemoryStats& Model::GetMemoryStats() const
+{
+    return mMemoryStats;
+}
+
 inline size_t Model::GetVersion() const
 {
     return AssetSerializationVersion;
@@ -6,6 +6,8 @@
 
 #include "DXrenderer/Shader.h"
 #include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/Memory/DeferredReleaseQueue.h"
+#include "DXrenderer/RenderPipeline.h"
 #include "Utils/FileWatcher.h"
 
 #include "Utils/Logger.h"
@@ -44,6 +46,7 @@ void PsoManager::BeginFrame(const RenderContext& context)
             std::vector<PsoDesc*>& psoVector = psoVectorIt->second;
             for (auto psoDesc : psoVector)
             {
+                ReleasePso(context, psoDesc->CompiledPso);
                 CompilePsoWithShader(context, IID_PPV_ARGS(&psoDesc->CompiledPso), path, psoDesc->Desc, psoDesc->GetDefines());
             }
         }
@@ -52,6 +55,7 @@ void PsoManager::BeginFrame(const RenderContext& context)
             std::vector<ComputePsoDesc*>& psoVector = psoVectorIt->second;
             for (auto psoDesc : psoVector)
             {
+                ReleasePso(context, psoDesc->CompiledPso);
                 CompilePsoWithShader(context, IID_PPV_ARGS(&psoDesc->CompiledPso), path, psoDesc->Desc, psoDesc->GetDefines());
             }
         }
@@ -59,6 +63,12 @@ void PsoManager::BeginFrame(const RenderContext& context)
     }
 }
 
+void PsoManager::ReleasePso(const RenderContext& context, const Microsoft::WRL::ComPtr<ID3D12PipelineState>& pso)
+{
+    // Recompiling overwrites the pointer, the frames in flight still use the old PSO.
+    context.ReleaseQueue->Release(context.Pipeline->GetPendingFenceValue(), pso);
+}
+
 void PsoManager::Shutdown() const
 {
     mShaderWatcher->Shutdown();
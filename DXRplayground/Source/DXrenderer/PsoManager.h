@@ -67,6 +67,7 @@ private:
     };
     static constexpr UINT MaxPso = 4096;
 
+    static void ReleasePso(const RenderContext& context, const Microsoft::WRL::ComPtr<ID3D12PipelineState>& pso);
     void CompilePsoWithShader(const RenderContext& context, REFIID psoRiid, void** psoPpv, const std::wstring& shaderPath, D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const std::vector<DxcDefine>* defines);
     void CompilePsoWithShader(const RenderContext& context, REFIID psoRiid, void** psoPpv, const std::wstring& shaderPath, D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const std::vector<DxcDefine>* defines);
 
@@ -9,6 +9,12 @@ class TextureManager;
 class PsoManager;
 class IRenderPipeline;
 class ImguiTextureManager;
+class UploadRing;
+class GpuMemoryAllocator;
+class DeferredReleaseQueue;
+class ConstantBufferAllocator;
+class ResourceStateTracker;
+class RenderGraphResources;
 
 struct RenderContext
 {
@@ -18,7 +24,6 @@ struct RenderContext
     static constexpr UINT CubemapsRangeStarts = MaxTextures;
     static constexpr UINT MaxUAVTextures = 10000;
     static constexpr UINT MaxRT = 100;
-    static constexpr UINT AllocatorsCount = 6;
     UINT CbvSrvUavDescriptorSize = -1;
     UINT RtvDescriptorSize = -1;
     UINT DsvDescriptorSize = -1;
@@ -33,6 +38,12 @@ struct RenderContext
     TextureManager* TexManager = nullptr;
     ImguiTextureManager* ImguiTexManager = nullptr;
     PsoManager* PsoManager = nullptr;
+    UploadRing* UploadRing = nullptr;
+    GpuMemoryAllocator* GpuAllocator = nullptr;
+    DeferredReleaseQueue* ReleaseQueue = nullptr;
+    ConstantBufferAllocator* Constants = nullptr;
+    ResourceStateTracker* StateTracker = nullptr; // Of CommandList.
+    RenderGraphResources* GraphResources = nullptr;
 
     IRenderPipeline* Pipeline = nullptr;
 };
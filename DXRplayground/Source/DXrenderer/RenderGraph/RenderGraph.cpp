@@ -0,0 +1,232 @@
+#include "DXrenderer/RenderGraph/RenderGraph.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "DXrenderer/DXhelpers.h"
+
+namespace DirectxPlayground
+{
+RgResource RenderGraph::CreateTexture(const std::string& name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue)
+{
+    assert(!mCompiled && "The graph can't change after Compile");
+    Resource res;
+    res.Name = name;
+    res.Desc = desc;
+    if (clearValue)
+    {
+        res.ClearValue = *clearValue;
+        res.HasClearValue = true;
+    }
+    mResources.push_back(res);
+    return static_cast<RgResource>(mResources.size() - 1);
+}
+
+RgResource RenderGraph::ImportResource(const std::string& name, ResourceDX* resource)
+{
+    assert(!mCompiled && "The graph can't change after Compile");
+    assert(resource != nullptr);
+    Resource res;
+    res.Name = name;
+    res.Imported = resource;
+    mResources.push_back(res);
+    return static_cast<RgResource>(mResources.size() - 1);
+}
+
+RgPass RenderGraph::AddPass(const std::string& name, ExecuteFunc execute)
+{
+    assert(!mCompiled && "The graph can't change after Compile");
+    Pass pass;
+    pass.Name = name;
+    pass.Execute = std::move(execute);
+    mPasses.push_back(std::move(pass));
+    return static_cast<RgPass>(mPasses.size() - 1);
+}
+
+void RenderGraph::Read(RgPass pass, RgResource resource, D3D12_RESOURCE_STATES state)
+{
+    AddAccess(pass, resource, state, false);
+}
+
+void RenderGraph::Write(RgPass pass, RgResource resource, D3D12_RESOURCE_STATES state)
+{
+    AddAccess(pass, resource, state, true);
+}
+
+void RenderGraph::SetSideEffects(RgPass pass)
+{
+    mPasses[pass].SideEffects = true;
+}
+
+void RenderGraph::AddAccess(RgPass pass, RgResource resource, D3D12_RESOURCE_STATES state, bool write)
+{
+    assert(!mCompiled && "The graph can't change after Compile");
+    assert(pass < mPasses.size() && resource < mResources.size());
+    for (Access& access : mPasses[pass].Accesses)
+    {
+        if (access.Resource != resource)
+            continue;
+        assert(!access.Write && !write && "A written resource can't be accessed by the pass in another way");
+        access.State = static_cast<D3D12_RESOURCE_STATES>(access.State | state);
+        return;
+    }
+    mPasses[pass].Accesses.push_back({ resource, state, write });
+}
+
+void RenderGraph::Compile(const AllocationInfoFunc& getAllocationInfo)
+{
+    assert(!mCompiled && "The graph is compiled once");
+    mCompiled = true;
+    CullPasses();
+    DeriveTransitions();
+    PlaceResources(getAllocationInfo);
+    AddSplitBarriers();
+}
+
+void RenderGraph::CullPasses()
+{
+    // A pass is needed if something after it uses what it writes. Writes modify the resources, so the earlier writers of a resource
+    // used by a needed pass are needed as well. Imported resources are used after the frame.
+    std::vector<bool> resourceNeeded(mResources.size());
+    for (size_t i = 0; i < mResources.size(); ++i)
+        resourceNeeded[i] = mResources[i].Imported != nullptr;
+
+    for (size_t i = mPasses.size(); i-- > 0;)
+    {
+        Pass& pass = mPasses[i];
+        bool needed = pass.SideEffects;
+        for (const Access& access : pass.Accesses)
+            needed = needed || (access.Write && resourceNeeded[access.Resource]);
+        pass.Culled = !needed;
+        if (pass.Culled)
+            continue;
+        for (const Access& access : pass.Accesses)
+            resourceNeeded[access.Resource] = true;
+    }
+}
+
+void RenderGraph::DeriveTransitions()
+{
+    std::vector<const Access*> lastAccess(mResources.size(), nullptr);
+    for (RgPass passIndex = 0; passIndex < mPasses.size(); ++passIndex)
+    {
+        const Pass& pass = mPasses[passIndex];
+        if (pass.Culled)
+            continue;
+
+        UINT compiledIndex = static_cast<UINT>(mCompiledPasses.size());
+        RgCompiledPass compiled;
+        compiled.Pass = passIndex;
+        for (const Access& access : pass.Accesses)
+        {
+            Resource& res = mResources[access.Resource];
+            const Access* last = lastAccess[access.Resource];
+            if (last == nullptr)
+            {
+                assert((res.Imported || access.Write) && "A transient resource is read before anything writes it");
+                res.FirstState = access.State;
+                res.Placement.FirstPass = compiledIndex;
+                compiled.Transitions.push_back({ access.Resource, D3D12_RESOURCE_STATE_COMMON, access.State, false });
+                if (!res.Imported)
+                    compiled.Acquired.push_back(access.Resource);
+            }
+            else if (last->State != access.State)
+            {
+                compiled.Transitions.push_back({ access.Resource, last->State, access.State, true });
+            }
+            else if (access.State == D3D12_RESOURCE_STATE_UNORDERED_ACCESS && (last->Write || access.Write))
+            {
+                compiled.UavBarriers.push_back(access.Resource);
+            }
+            res.UsedStates = static_cast<D3D12_RESOURCE_STATES>(res.UsedStates | access.State);
+            res.Placement.LastPass = compiledIndex;
+            lastAccess[access.Resource] = &access;
+        }
+        mCompiledPasses.push_back(std::move(compiled));
+    }
+}
+
+void RenderGraph::PlaceResources(const AllocationInfoFunc& getAllocationInfo)
+{
+    std::vector<RgResource> transient;
+    for (RgResource i = 0; i < mResources.size(); ++i)
+    {
+        Resource& res = mResources[i];
+        if (res.Imported || res.Placement.FirstPass == InvalidRgIndex)
+            continue;
+        res.AllocationInfo = getAllocationInfo(res.Desc);
+        assert(res.AllocationInfo.Alignment > 0 && "The alignment must be a power of 2");
+        res.Placement.HeapGroup = res.AllocationInfo.HeapGroup;
+        res.Placement.Size = res.AllocationInfo.Size;
+        if (res.AllocationInfo.HeapGroup >= mHeapSizes.size())
+            mHeapSizes.resize(res.AllocationInfo.HeapGroup + 1, 0);
+        transient.push_back(i);
+    }
+
+    // The large resources are placed first, the small ones fill the gaps between them. Each resource takes the lowest offset which
+    // doesn't intersect the memory of the placed resources alive at the same time.
+    std::stable_sort(transient.begin(), transient.end(), [this](RgResource l, RgResource r)
+    {
+        return mResources[l].AllocationInfo.Size > mResources[r].AllocationInfo.Size;
+    });
+
+    std::vector<RgResource> placed;
+    for (RgResource index : transient)
+    {
+        Resource& res = mResources[index];
+        RgPlacement& placement = res.Placement;
+        UINT64 offset = 0;
+        bool moved = true;
+        while (moved)
+        {
+            moved = false;
+            for (RgResource otherIndex : placed)
+            {
+                const RgPlacement& other = mResources[otherIndex].Placement;
+                bool sameTime = placement.FirstPass <= other.LastPass && other.FirstPass <= placement.LastPass;
+                bool sameMemory = offset < other.Offset + other.Size && other.Offset < offset + placement.Size;
+                if (other.HeapGroup == placement.HeapGroup && sameTime && sameMemory)
+                {
+                    offset = AlignUp(other.Offset + other.Size, res.AllocationInfo.Alignment);
+                    moved = true;
+                }
+            }
+        }
+        placement.Offset = offset;
+        mHeapSizes[placement.HeapGroup] = (std::max)(mHeapSizes[placement.HeapGroup], offset + placement.Size);
+
+        for (RgResource otherIndex : placed)
+        {
+            RgPlacement& other = mResources[otherIndex].Placement;
+            bool sameMemory = offset < other.Offset + other.Size && other.Offset < offset + placement.Size;
+            if (other.HeapGroup == placement.HeapGroup && sameMemory)
+            {
+                placement.Aliases.push_back(otherIndex);
+                other.Aliases.push_back(index);
+            }
+        }
+        placed.push_back(index);
+    }
+}
+
+void RenderGraph::AddSplitBarriers()
+{
+    // A transition can begin right after the previous access of the resource, the GPU has the passes in between to do it. The first
+    // transition of an imported resource begins with the frame, the first one of a transient resource has to follow its aliasing barrier.
+    std::vector<UINT> lastPass(mResources.size(), InvalidRgIndex);
+    for (UINT i = 0; i < mCompiledPasses.size(); ++i)
+    {
+        RgCompiledPass& compiled = mCompiledPasses[i];
+        for (const RgTransition& transition : compiled.Transitions)
+        {
+            if (!transition.BeforeKnown && !mResources[transition.Resource].Imported)
+                continue;
+            UINT begin = transition.BeforeKnown ? lastPass[transition.Resource] + 1 : 0;
+            if (begin < i)
+                mCompiledPasses[begin].SplitBegins.push_back(transition);
+        }
+        for (const Access& access : mPasses[compiled.Pass].Accesses)
+            lastPass[access.Resource] = i;
+    }
+}
+}
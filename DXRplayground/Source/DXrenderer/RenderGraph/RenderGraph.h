@@ -0,0 +1,224 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <d3d12.h>
+
+namespace DirectxPlayground
+{
+struct RenderContext;
+class ResourceDX;
+class RenderGraphResources;
+
+using RgResource = UINT;
+using RgPass = UINT;
+constexpr RgResource InvalidRgResource = ~0u;
+constexpr UINT InvalidRgIndex = ~0u;
+
+// The memory a transient resource needs. Resources of different heap groups are never placed in the same heap.
+struct RgAllocationInfo
+{
+    UINT64 Size = 0;
+    UINT64 Alignment = 0;
+    UINT HeapGroup = 0;
+};
+
+// A state change of a resource. Before is unknown for the first access in the frame, the tracked state of the resource is used then.
+struct RgTransition
+{
+    RgResource Resource = InvalidRgResource;
+    D3D12_RESOURCE_STATES Before = D3D12_RESOURCE_STATE_COMMON;
+    D3D12_RESOURCE_STATES After = D3D12_RESOURCE_STATE_COMMON;
+    bool BeforeKnown = false;
+};
+
+struct RgCompiledPass
+{
+    RgPass Pass = 0;
+    // Split transitions begun before the pass, they are ended by the Transitions of later passes.
+    std::vector<RgTransition> SplitBegins;
+    std::vector<RgTransition> Transitions;
+    // Resources which stay in the UAV state since a write of an earlier pass.
+    std::vector<RgResource> UavBarriers;
+    // Transient resources used for the first time in the frame. The ones which share memory with others need an aliasing barrier,
+    // their content is undefined.
+    std::vector<RgResource> Acquired;
+};
+
+// Where a transient resource lives. The passes are indices in the compiled passes.
+struct RgPlacement
+{
+    UINT HeapGroup = 0;
+    UINT64 Offset = 0;
+    UINT64 Size = 0;
+    UINT FirstPass = InvalidRgIndex; // InvalidRgIndex if all the passes using it were culled.
+    UINT LastPass = InvalidRgIndex;
+    std::vector<RgResource> Aliases; // The resources which share some of its memory at other times of the frame.
+};
+
+// A frame described as passes which read and write resources, rebuilt every frame. Transient resources are created by the graph and
+// live only between their first and last use, imported ones live outside, e.g. the back buffer. Compile culls the passes whose writes
+// nobody reads, derives the state transitions and places the transient resources, so the ones with disjoint lifetimes share memory.
+// Writes keep the previous content, a pass which overwrites a resource completely clears or discards it itself. The passes run in the
+// declaration order, the graph only compiles on the CPU, RenderGraphResources creates the resources and records the passes.
+class RenderGraph
+{
+public:
+    using ExecuteFunc = std::function<void(RenderContext&, RenderGraphResources&)>;
+    using AllocationInfoFunc = std::function<RgAllocationInfo(const D3D12_RESOURCE_DESC&)>;
+
+    RenderGraph() = default;
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    RgResource CreateTexture(const std::string& name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+    RgResource ImportResource(const std::string& name, ResourceDX* resource);
+
+    RgPass AddPass(const std::string& name, ExecuteFunc execute);
+    // Read only states of one pass are combined, a write has to be the only access of the pass to the resource.
+    void Read(RgPass pass, RgResource resource, D3D12_RESOURCE_STATES state);
+    void Write(RgPass pass, RgResource resource, D3D12_RESOURCE_STATES state);
+    // Never culled, e.g. a pass which writes to buffers outside of the graph.
+    void SetSideEffects(RgPass pass);
+
+    void Compile(const AllocationInfoFunc& getAllocationInfo);
+
+    const std::vector<RgCompiledPass>& GetCompiledPasses() const;
+    bool IsCulled(RgPass pass) const;
+    const std::string& GetPassName(RgPass pass) const;
+    void ExecutePass(RgPass pass, RenderContext& ctx, RenderGraphResources& resources) const;
+
+    UINT GetResourcesCount() const;
+    const std::string& GetResourceName(RgResource resource) const;
+    bool IsImported(RgResource resource) const;
+    ResourceDX* GetImportedResource(RgResource resource) const;
+    const D3D12_RESOURCE_DESC& GetDesc(RgResource resource) const;
+    // nullptr if the texture has no optimized clear value.
+    const D3D12_CLEAR_VALUE* GetClearValue(RgResource resource) const;
+    // States of all accesses of the compiled passes combined, they decide which views the resource needs.
+    D3D12_RESOURCE_STATES GetUsedStates(RgResource resource) const;
+    // The state of the first access in the frame.
+    D3D12_RESOURCE_STATES GetFirstState(RgResource resource) const;
+    const RgPlacement& GetPlacement(RgResource resource) const;
+    UINT GetHeapGroupsCount() const;
+    UINT64 GetHeapSize(UINT heapGroup) const;
+
+private:
+    struct Access
+    {
+        RgResource Resource = InvalidRgResource;
+        D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+        bool Write = false;
+    };
+
+    struct Pass
+    {
+        std::string Name;
+        ExecuteFunc Execute;
+        std::vector<Access> Accesses;
+        bool SideEffects = false;
+        bool Culled = false;
+    };
+
+    struct Resource
+    {
+        std::string Name;
+        D3D12_RESOURCE_DESC Desc{};
+        D3D12_CLEAR_VALUE ClearValue{};
+        bool HasClearValue = false;
+        ResourceDX* Imported = nullptr;
+        D3D12_RESOURCE_STATES UsedStates = D3D12_RESOURCE_STATE_COMMON;
+        D3D12_RESOURCE_STATES FirstState = D3D12_RESOURCE_STATE_COMMON;
+        RgAllocationInfo AllocationInfo;
+        RgPlacement Placement;
+    };
+
+    void AddAccess(RgPass pass, RgResource resource, D3D12_RESOURCE_STATES state, bool write);
+    void CullPasses();
+    void DeriveTransitions();
+    void PlaceResources(const AllocationInfoFunc& getAllocationInfo);
+    void AddSplitBarriers();
+
+    std::vector<Pass> mPasses;
+    std::vector<Resource> mResources;
+    std::vector<RgCompiledPass> mCompiledPasses;
+    std::vector<UINT64> mHeapSizes; // Per heap group.
+    bool mCompiled = false;
+};
+
+inline const std::vector<RgCompiledPass>& RenderGraph::GetCompiledPasses() const
+{
+    return mCompiledPasses;
+}
+
+inline bool RenderGraph::IsCulled(RgPass pass) const
+{
+    return mPasses[pass].Culled;
+}
+
+inline const std::string& RenderGraph::GetPassName(RgPass pass) const
+{
+    return mPasses[pass].Name;
+}
+
+inline void RenderGraph::ExecutePass(RgPass pass, RenderContext& ctx, RenderGraphResources& resources) const
+{
+    mPasses[pass].Execute(ctx, resources);
+}
+
+inline UINT RenderGraph::GetResourcesCount() const
+{
+    return static_cast<UINT>(mResources.size());
+}
+
+inline const std::string& RenderGraph::GetResourceName(RgResource resource) const
+{
+    return mResources[resource].Name;
+}
+
+inline bool RenderGraph::IsImported(RgResource resource) const
+{
+    return mResources[resource].Imported != nullptr;
+}
+
+inline ResourceDX* RenderGraph::GetImportedResource(RgResource resource) const
+{
+    return mResources[resource].Imported;
+}
+
+inline const D3D12_RESOURCE_DESC& RenderGraph::GetDesc(RgResource resource) const
+{
+    return mResources[resource].Desc;
+}
+
+inline const D3D12_CLEAR_VALUE* RenderGraph::GetClearValue(RgResource resource) const
+{
+    return mResources[resource].HasClearValue ? &mResources[resource].ClearValue : nullptr;
+}
+
+inline D3D12_RESOURCE_STATES RenderGraph::GetUsedStates(RgResource resource) const
+{
+    return mResources[resource].UsedStates;
+}
+
+inline D3D12_RESOURCE_STATES RenderGraph::GetFirstState(RgResource resource) const
+{
+    return mResources[resource].FirstState;
+}
+
+inline const RgPlacement& RenderGraph::GetPlacement(RgResource resource) const
+{
+    return mResources[resource].Placement;
+}
+
+inline UINT RenderGraph::GetHeapGroupsCount() const
+{
+    return static_cast<UINT>(mHeapSizes.size());
+}
+
+inline UINT64 RenderGraph::GetHeapSize(UINT heapGroup) const
+{
+    return mHeapSizes[heapGroup];
+}
+}
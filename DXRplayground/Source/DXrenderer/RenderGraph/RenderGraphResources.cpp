@@ -0,0 +1,323 @@
+#include "DXrenderer/RenderGraph/RenderGraphResources.h"
+
+#include <cassert>
+
+#include "External/Dx12Helpers/d3dx12.h"
+#include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/Memory/DeferredReleaseQueue.h"
+#include "DXrenderer/RenderContext.h"
+#include "DXrenderer/RenderPipeline.h"
+#include "DXrenderer/ResourceStateTracker.h"
+#include "DXrenderer/Textures/TextureManager.h"
+#include "Utils/PixProfiler.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT MaxRtvs = 64;
+constexpr UINT MaxDsvs = 16;
+constexpr D3D12_HEAP_FLAGS HeapFlags[] = { D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES };
+constexpr D3D12_RESOURCE_STATES ShaderResourceStates = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+// The states in which the content of a resource can be discarded.
+constexpr D3D12_RESOURCE_STATES DiscardStates = D3D12_RESOURCE_STATE_RENDER_TARGET | D3D12_RESOURCE_STATE_DEPTH_WRITE | D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+}
+
+RenderGraphResources::RenderGraphResources(RenderContext& ctx)
+    : mRtvs(MaxRtvs)
+    , mDsvs(MaxDsvs)
+{
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+    heapDesc.NumDescriptors = MaxRtvs;
+    ThrowIfFailed(ctx.Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mRtvHeap)));
+    AUTO_NAME_D3D12_OBJECT(mRtvHeap);
+
+    heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+    heapDesc.NumDescriptors = MaxDsvs;
+    ThrowIfFailed(ctx.Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mDsvHeap)));
+    AUTO_NAME_D3D12_OBJECT(mDsvHeap);
+}
+
+RenderGraphResources::~RenderGraphResources()
+{
+    for (PlacedResource*& placed : mPlaced)
+        SafeDelete(placed);
+}
+
+void RenderGraphResources::Execute(RenderContext& ctx, RenderGraph& graph)
+{
+    ID3D12Device* device = ctx.Device;
+    graph.Compile([device](const D3D12_RESOURCE_DESC& desc) { return GetAllocationInfo(device, desc); });
+
+    UINT64 completedFence = ctx.Pipeline->GetCompletedFenceValue();
+    mRtvs.Reclaim(completedFence);
+    mDsvs.Reclaim(completedFence);
+    AllocateHeaps(ctx, graph);
+    BindResources(ctx, graph);
+
+    ResourceStateTracker& tracker = *ctx.StateTracker;
+    const std::vector<RgCompiledPass>& passes = graph.GetCompiledPasses();
+    for (UINT i = 0; i < passes.size(); ++i)
+    {
+        const RgCompiledPass& pass = passes[i];
+        for (const RgTransition& split : pass.SplitBegins)
+            tracker.BeginTransition(GetResource(split.Resource), split.After);
+        if (!pass.Acquired.empty())
+            AcquireMemory(ctx, graph, pass, i);
+        for (const RgTransition& transition : pass.Transitions)
+            tracker.Transition(GetResource(transition.Resource), transition.After);
+        for (RgResource resource : pass.UavBarriers)
+            tracker.UavBarrier(GetResource(resource));
+        tracker.Flush(ctx.CommandList);
+
+        GPU_SCOPED_EVENT(ctx, graph.GetPassName(pass.Pass));
+        graph.ExecutePass(pass.Pass, ctx, *this);
+    }
+    mBindings.clear();
+}
+
+ResourceDX& RenderGraphResources::GetResource(RgResource resource)
+{
+    assert(resource < mBindings.size() && mBindings[resource].Resource != nullptr && "The resource isn't used by the executing graph");
+    return *mBindings[resource].Resource;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE RenderGraphResources::GetRtv(const RenderContext& ctx, RgResource resource) const
+{
+    const PlacedResource* placed = mBindings[resource].Placed;
+    assert(placed != nullptr && placed->Rtv != DescriptorAllocator::InvalidIndex);
+    CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mRtvHeap->GetCPUDescriptorHandleForHeapStart());
+    handle.Offset(placed->Rtv, ctx.RtvDescriptorSize);
+    return handle;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE RenderGraphResources::GetDsv(const RenderContext& ctx, RgResource resource) const
+{
+    const PlacedResource* placed = mBindings[resource].Placed;
+    assert(placed != nullptr && placed->Dsv != DescriptorAllocator::InvalidIndex);
+    CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mDsvHeap->GetCPUDescriptorHandleForHeapStart());
+    handle.Offset(placed->Dsv, ctx.DsvDescriptorSize);
+    return handle;
+}
+
+UINT RenderGraphResources::GetSrv(RgResource resource) const
+{
+    assert(mBindings[resource].Srv != DescriptorAllocator::InvalidIndex && "The resource isn't read by a shader");
+    return mBindings[resource].Srv;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE RenderGraphResources::GetUav(const RenderContext& ctx, RgResource resource) const
+{
+    assert(mBindings[resource].Uav != DescriptorAllocator::InvalidIndex && "The resource isn't accessed as UAV");
+    CD3DX12_GPU_DESCRIPTOR_HANDLE handle(ctx.TexManager->GetDescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
+    handle.Offset(mBindings[resource].Uav, ctx.CbvSrvUavDescriptorSize);
+    return handle;
+}
+
+UINT64 RenderGraphResources::GetHeapsSize() const
+{
+    UINT64 size = 0;
+    for (const HeapBlock& heap : mHeaps)
+        size += heap.Size;
+    return size;
+}
+
+RgAllocationInfo RenderGraphResources::GetAllocationInfo(ID3D12Device* device, const D3D12_RESOURCE_DESC& desc)
+{
+    assert(desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && "Only textures are transient");
+    D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+    RgAllocationInfo result;
+    result.Size = info.SizeInBytes;
+    result.Alignment = info.Alignment;
+    result.HeapGroup = (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) ? RenderTargets : Textures;
+    return result;
+}
+
+bool RenderGraphResources::IsSameDesc(const D3D12_RESOURCE_DESC& l, const D3D12_RESOURCE_DESC& r)
+{
+    return l.Dimension == r.Dimension && l.Alignment == r.Alignment && l.Width == r.Width && l.Height == r.Height
+        && l.DepthOrArraySize == r.DepthOrArraySize && l.MipLevels == r.MipLevels && l.Format == r.Format
+        && l.SampleDesc.Count == r.SampleDesc.Count && l.SampleDesc.Quality == r.SampleDesc.Quality && l.Layout == r.Layout && l.Flags == r.Flags;
+}
+
+void RenderGraphResources::AllocateHeaps(RenderContext& ctx, const RenderGraph& graph)
+{
+    for (UINT group = 0; group < HeapGroupsCount; ++group)
+    {
+        UINT64 size = group < graph.GetHeapGroupsCount() ? graph.GetHeapSize(group) : 0;
+        HeapBlock& heap = mHeaps[group];
+        if (size <= heap.Size)
+            continue;
+
+        // The resources placed in the old heap go together with it.
+        for (size_t i = 0; i < mPlaced.size();)
+        {
+            if (mPlaced[i]->HeapGroup != group)
+            {
+                ++i;
+                continue;
+            }
+            ReleasePlaced(ctx, mPlaced[i]);
+            mPlaced.erase(mPlaced.begin() + i);
+        }
+        if (heap.Heap != nullptr)
+            ctx.ReleaseQueue->Release(ctx.Pipeline->GetPendingFenceValue(), heap.Heap);
+
+        D3D12_HEAP_DESC heapDesc = {};
+        heapDesc.SizeInBytes = AlignUp(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+        heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+        // MSAA render targets need the larger alignment of the heap too.
+        heapDesc.Alignment = group == RenderTargets ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapDesc.Flags = HeapFlags[group];
+        ThrowIfFailed(ctx.Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap.Heap)));
+        std::wstring name = L"render_graph_heap_" + std::to_wstring(group);
+        SetDXobjectName(heap.Heap.Get(), name.c_str());
+        heap.Size = heapDesc.SizeInBytes;
+    }
+}
+
+void RenderGraphResources::BindResources(RenderContext& ctx, const RenderGraph& graph)
+{
+    for (PlacedResource* placed : mPlaced)
+        placed->Used = false;
+
+    mBindings.assign(graph.GetResourcesCount(), {});
+    for (RgResource resource = 0; resource < graph.GetResourcesCount(); ++resource)
+    {
+        Binding& binding = mBindings[resource];
+        if (graph.IsImported(resource))
+        {
+            binding.Resource = graph.GetImportedResource(resource);
+            continue;
+        }
+        if (graph.GetPlacement(resource).FirstPass == InvalidRgIndex)
+            continue;
+        binding.Placed = AcquirePlaced(ctx, graph, resource);
+        binding.Resource = &binding.Placed->Resource;
+        CreateViews(ctx, graph, resource, binding);
+    }
+
+    // Kept only while the graphs use them, a different frame setup would keep the memory otherwise.
+    for (size_t i = 0; i < mPlaced.size();)
+    {
+        if (mPlaced[i]->Used)
+        {
+            ++i;
+            continue;
+        }
+        ReleasePlaced(ctx, mPlaced[i]);
+        mPlaced.erase(mPlaced.begin() + i);
+    }
+}
+
+RenderGraphResources::PlacedResource* RenderGraphResources::AcquirePlaced(RenderContext& ctx, const RenderGraph& graph, RgResource resource)
+{
+    const RgPlacement& placement = graph.GetPlacement(resource);
+    const D3D12_RESOURCE_DESC& desc = graph.GetDesc(resource);
+    for (PlacedResource* placed : mPlaced)
+    {
+        if (!placed->Used && placed->HeapGroup == placement.HeapGroup && placed->Offset == placement.Offset && IsSameDesc(placed->Desc, desc))
+        {
+            placed->Used = true;
+            return placed;
+        }
+    }
+
+    PlacedResource* placed = new PlacedResource();
+    placed->Desc = desc;
+    placed->HeapGroup = placement.HeapGroup;
+    placed->Offset = placement.Offset;
+    placed->Used = true;
+    placed->Resource.SetInitialState(graph.GetFirstState(resource));
+    ThrowIfFailed(ctx.Device->CreatePlacedResource(mHeaps[placement.HeapGroup].Heap.Get(),
+        placement.Offset,
+        &desc,
+        placed->Resource.GetCurrentState(),
+        graph.GetClearValue(resource),
+        IID_PPV_ARGS(placed->Resource.GetAddressOf())));
+#if defined(_DEBUG)
+    placed->Resource.SetName(graph.GetResourceName(resource));
+#endif
+
+    if (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)
+    {
+        placed->Rtv = mRtvs.Allocate();
+        assert(placed->Rtv != DescriptorAllocator::InvalidIndex && "Out of render graph RTVs");
+        CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mRtvHeap->GetCPUDescriptorHandleForHeapStart());
+        handle.Offset(placed->Rtv, ctx.RtvDescriptorSize);
+        ctx.Device->CreateRenderTargetView(placed->Resource.Get(), nullptr, handle);
+    }
+    if (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
+    {
+        placed->Dsv = mDsvs.Allocate();
+        assert(placed->Dsv != DescriptorAllocator::InvalidIndex && "Out of render graph DSVs");
+        CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mDsvHeap->GetCPUDescriptorHandleForHeapStart());
+        handle.Offset(placed->Dsv, ctx.DsvDescriptorSize);
+        ctx.Device->CreateDepthStencilView(placed->Resource.Get(), nullptr, handle);
+    }
+    mPlaced.push_back(placed);
+    return placed;
+}
+
+void RenderGraphResources::CreateViews(RenderContext& ctx, const RenderGraph& graph, RgResource resource, Binding& binding)
+{
+    // The views of the frame, the same resource can be used by the frames in flight with other views. The formats of the transient
+    // textures aren't typeless, the views take the format of the resource.
+    D3D12_RESOURCE_STATES states = graph.GetUsedStates(resource);
+    if (states & ShaderResourceStates)
+    {
+        binding.Srv = ctx.TexManager->AllocateTransientSrvs(1);
+        CD3DX12_CPU_DESCRIPTOR_HANDLE handle(ctx.TexManager->GetDescriptorHeap()->GetCPUDescriptorHandleForHeapStart());
+        handle.Offset(binding.Srv, ctx.CbvSrvUavDescriptorSize);
+        ctx.Device->CreateShaderResourceView(binding.Resource->Get(), nullptr, handle);
+    }
+    if (states & D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+    {
+        binding.Uav = ctx.TexManager->AllocateTransientSrvs(1);
+        CD3DX12_CPU_DESCRIPTOR_HANDLE handle(ctx.TexManager->GetDescriptorHeap()->GetCPUDescriptorHandleForHeapStart());
+        handle.Offset(binding.Uav, ctx.CbvSrvUavDescriptorSize);
+        ctx.Device->CreateUnorderedAccessView(binding.Resource->Get(), nullptr, nullptr, handle);
+    }
+}
+
+void RenderGraphResources::ReleasePlaced(RenderContext& ctx, PlacedResource* placed)
+{
+    UINT64 fence = ctx.Pipeline->GetPendingFenceValue();
+    if (placed->Rtv != DescriptorAllocator::InvalidIndex)
+        mRtvs.Free(placed->Rtv, 1, fence);
+    if (placed->Dsv != DescriptorAllocator::InvalidIndex)
+        mDsvs.Free(placed->Dsv, 1, fence);
+    ctx.ReleaseQueue->Release(fence, placed->Resource);
+    SafeDelete(placed);
+}
+
+void RenderGraphResources::AcquireMemory(RenderContext& ctx, const RenderGraph& graph, const RgCompiledPass& pass, UINT passIndex)
+{
+    // The memory of a transient resource was used by other resources before, in this frame or in the previous ones. An aliasing barrier
+    // hands it over, the content is undefined then and has to be discarded, a clear or a copy of the pass follows.
+    ResourceStateTracker& tracker = *ctx.StateTracker;
+    for (RgResource resource : pass.Acquired)
+    {
+        ID3D12Resource* before = nullptr;
+        UINT earlierCount = 0;
+        for (RgResource alias : graph.GetPlacement(resource).Aliases)
+        {
+            if (graph.GetPlacement(alias).LastPass < passIndex)
+            {
+                before = mBindings[alias].Resource->Get();
+                ++earlierCount;
+            }
+        }
+        tracker.AliasingBarrier(earlierCount == 1 ? before : nullptr, GetResource(resource).Get());
+        tracker.Transition(GetResource(resource), graph.GetFirstState(resource));
+    }
+    tracker.Flush(ctx.CommandList);
+    for (RgResource resource : pass.Acquired)
+    {
+        if (graph.GetFirstState(resource) & DiscardStates)
+            ctx.CommandList->DiscardResource(GetResource(resource).Get(), nullptr);
+    }
+}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <d3d12.h>
+#include <wrl.h>
+
+#include "DXrenderer/Memory/DescriptorAllocator.h"
+#include "DXrenderer/RenderGraph/RenderGraph.h"
+#include "DXrenderer/ResourceDX.h"
+
+namespace DirectxPlayground
+{
+struct RenderContext;
+
+// Creates the transient resources of render graphs and records their passes on the frame command list. Transient resources are placed
+// resources in one heap per heap group, placed where RenderGraph::Compile says, so the ones with disjoint lifetimes share memory. They
+// are kept between frames while the next graph places a resource with the same description at the same offset, the rest are released
+// through the release queue, as well as the heaps once they have to grow. Owned by RenderPipeline.
+class RenderGraphResources
+{
+public:
+    explicit RenderGraphResources(RenderContext& ctx);
+    RenderGraphResources(const RenderGraphResources&) = delete;
+    RenderGraphResources(RenderGraphResources&&) = delete;
+    RenderGraphResources& operator=(const RenderGraphResources&) = delete;
+    RenderGraphResources& operator=(RenderGraphResources&&) = delete;
+    ~RenderGraphResources();
+
+    // Compiles the graph and records the passes which weren't culled in the declaration order. Leaves the resources in the states of their
+    // last accesses.
+    void Execute(RenderContext& ctx, RenderGraph& graph);
+
+    // The following are valid in the passes of the executing graph, the views only for transient textures which support them.
+    ResourceDX& GetResource(RgResource resource);
+    D3D12_CPU_DESCRIPTOR_HANDLE GetRtv(const RenderContext& ctx, RgResource resource) const;
+    D3D12_CPU_DESCRIPTOR_HANDLE GetDsv(const RenderContext& ctx, RgResource resource) const;
+    // In the textures range of the TextureManager heap, only for the resources read by a shader.
+    UINT GetSrv(RgResource resource) const;
+    // In the TextureManager heap, only for the resources accessed as UAV.
+    D3D12_GPU_DESCRIPTOR_HANDLE GetUav(const RenderContext& ctx, RgResource resource) const;
+
+    // The memory of the heaps, the aliasing saves the difference to the sum of the transient resources sizes.
+    UINT64 GetHeapsSize() const;
+
+private:
+    enum HeapGroup
+    {
+        RenderTargets,
+        Textures,
+        HeapGroupsCount
+    };
+
+    struct HeapBlock
+    {
+        Microsoft::WRL::ComPtr<ID3D12Heap> Heap;
+        UINT64 Size = 0;
+    };
+
+    struct PlacedResource
+    {
+        ResourceDX Resource;
+        D3D12_RESOURCE_DESC Desc{};
+        UINT HeapGroup = 0;
+        UINT64 Offset = 0;
+        UINT Rtv = DescriptorAllocator::InvalidIndex;
+        UINT Dsv = DescriptorAllocator::InvalidIndex;
+        bool Used = false; // By the executing graph.
+    };
+
+    // The views of a graph resource in the executing graph.
+    struct Binding
+    {
+        ResourceDX* Resource = nullptr;
+        PlacedResource* Placed = nullptr; // nullptr for imported resources.
+        UINT Srv = DescriptorAllocator::InvalidIndex;
+        UINT Uav = DescriptorAllocator::InvalidIndex;
+    };
+
+    static RgAllocationInfo GetAllocationInfo(ID3D12Device* device, const D3D12_RESOURCE_DESC& desc);
+    static bool IsSameDesc(const D3D12_RESOURCE_DESC& l, const D3D12_RESOURCE_DESC& r);
+    void AllocateHeaps(RenderContext& ctx, const RenderGraph& graph);
+    void BindResources(RenderContext& ctx, const RenderGraph& graph);
+    PlacedResource* AcquirePlaced(RenderContext& ctx, const RenderGraph& graph, RgResource resource);
+    void CreateViews(RenderContext& ctx, const RenderGraph& graph, RgResource resource, Binding& binding);
+    void ReleasePlaced(RenderContext& ctx, PlacedResource* placed);
+    void AcquireMemory(RenderContext& ctx, const RenderGraph& graph, const RgCompiledPass& pass, UINT passIndex);
+
+    std::array<HeapBlock, HeapGroupsCount> mHeaps;
+    std::vector<PlacedResource*> mPlaced;
+    std::vector<Binding> mBindings; // Per resource of the executing graph.
+
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mRtvHeap;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mDsvHeap;
+    DescriptorAllocator mRtvs;
+    DescriptorAllocator mDsvs;
+};
+}
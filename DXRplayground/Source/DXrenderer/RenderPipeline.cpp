@@ -8,23 +8,49 @@
 #include "WindowsApp.h"
 
 #include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/Buffers/ConstantBufferAllocator.h"
+#include "DXrenderer/Buffers/UploadRing.h"
+#include "DXrenderer/CommandAllocatorPool.h"
+#include "DXrenderer/Memory/DeferredReleaseQueue.h"
+#include "DXrenderer/Memory/GpuMemoryAllocator.h"
+#include "DXrenderer/RenderGraph/RenderGraphResources.h"
 #include "DXrenderer/Textures/TextureManager.h"
 #include "DXrenderer/PsoManager.h"
+#include "DXrenderer/ResourceStateTracker.h"
 #include "DXrenderer/Shader.h"
 
 #include "Scene/Scene.h"
 
 #include "Utils/PixProfiler.h"
 #include "Utils/Logger.h"
+#include "Utils/ParallelFor.h"
 
 namespace DirectxPlayground
 {
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+// The initial size, the ring grows if a single submission uploads more.
+constexpr UINT64 UploadRingSize = 64ull * 1024 * 1024;
+constexpr UINT64 FrameConstantsSize = 1024 * 1024;
+constexpr UINT64 PersistentConstantsSize = 4 * 1024 * 1024;
+constexpr UINT MaxRecordingWorkers = 8;
+// Per command list type. The main and the parallel lists of FramesCount frames in flight take far less.
+constexpr UINT MaxCommandAllocators = 64;
+}
+
 RenderPipeline::~RenderPipeline()
 {
     SafeDelete(mTextureManager);
     SafeDelete(mImguiTextureManager);
+    SafeDelete(mStateTracker);
+    SafeDelete(mGraphResources);
+    SafeDelete(mUploadRing);
+    SafeDelete(mConstants);
+    SafeDelete(mAllocatorPool);
+    SafeDelete(mReleaseQueue);
+    SafeDelete(mGpuAllocator);
 }
 
 void RenderPipeline::Init(HWND hwnd, int width, int height, Scene* scene)
@@ -70,19 +96,26 @@ void RenderPipeline::Init(HWND hwnd, int width, int height, Scene* scene)
     mSwapChain.Init(mIsTearingSupported, hwnd, mContext, mFactory.Get(), mDevice.Get(), mCommandQueue.Get());
     mContext.SwapChain = &mSwapChain;
 
-    for (int i = 0; i < RenderContext::AllocatorsCount; ++i)
-    {
-        ThrowIfFailed(mDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&mCommandAllocators[i])));
-        std::wstring name = L"command_allocator_" + std::to_wstring(i);
-        NAME_D3D12_OBJECT(mCommandAllocators[i], name.c_str());
-    }
-    ThrowIfFailed(mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, mCommandAllocators[mCurrentAllocatorIdx].Get(), nullptr, IID_PPV_ARGS(&mCommandList)));
+    mAllocatorPool = new CommandAllocatorPool(mDevice.Get(), [this](UINT64 fenceValue) { WaitForFence(fenceValue); }, MaxCommandAllocators);
+    // Closed, ResetCommandList gives it an allocator.
+    ThrowIfFailed(mDevice->CreateCommandList1(0, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(&mCommandList)));
     NAME_D3D12_OBJECT(mCommandList, L"main_command_list");
-    mCommandList->Close();
+    mRecordingWorkersCount = std::clamp(std::thread::hardware_concurrency(), 1u, MaxRecordingWorkers);
+    mStateTracker = new ResourceStateTracker();
+    mContext.StateTracker = mStateTracker;
 
     ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
     NAME_D3D12_OBJECT(mFence, L"frame_fence");
 
+    mReleaseQueue = new DeferredReleaseQueue();
+    mContext.ReleaseQueue = mReleaseQueue;
+    mUploadRing = new UploadRing(mDevice.Get(), mReleaseQueue, UploadRingSize);
+    mContext.UploadRing = mUploadRing;
+    mConstants = new ConstantBufferAllocator(mDevice.Get(), RenderContext::FramesCount, FrameConstantsSize, PersistentConstantsSize);
+    mContext.Constants = mConstants;
+    mGpuAllocator = new GpuMemoryAllocator(mDevice.Get());
+    mContext.GpuAllocator = mGpuAllocator;
+
     mContext.CbvSrvUavDescriptorSize = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
     mContext.RtvDescriptorSize = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
     mContext.DsvDescriptorSize = mDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
@@ -95,50 +128,77 @@ void RenderPipeline::Init(HWND hwnd, int width, int height, Scene* scene)
 
     mTextureManager = new TextureManager(mContext);
     mContext.TexManager = mTextureManager;
+    mGraphResources = new RenderGraphResources(mContext);
+    mContext.GraphResources = mGraphResources;
 
-    Flush();
     Resize(width, height);
 
     InitImGui();
 
-    IncrementAllocatorIndex();
-    mCommandAllocators[mCurrentAllocatorIdx]->Reset();
-    mCommandList->Reset(mCommandAllocators[mCurrentAllocatorIdx].Get(), nullptr);
+    ResetCommandList(mCommandList.Get());
 
     mContext.CommandList = mCommandList.Get();
     scene->InitResources(mContext);
 
-    mCommandList->Close();
-    ID3D12CommandList* cmdLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+    SubmitCommandLists();
+
+    // The scene expects the uploads to be finished.
+    Flush();
 
-    Flush(); // 3 flushes in a row...
+    scene->OnResourcesUploaded(mContext);
+    LOG("GPU memory after the scene loading:\n", mGpuAllocator->GetFragmentationReport());
 }
 
 void RenderPipeline::Flush()
 {
-    ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
+    Signal();
+    WaitForFence(mCurrentFence);
+    ReleaseCompleted();
+}
 
-    if (mFence->GetCompletedValue() < mCurrentFence)
-    {
-        HANDLE fenceEventHandle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-        if (fenceEventHandle == nullptr)
-        {
-            ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
-        }
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, fenceEventHandle));
+void RenderPipeline::WaitForFence(UINT64 fenceValue)
+{
+    assert(fenceValue <= mCurrentFence && "The fence value isn't signaled yet");
+    if (mFence->GetCompletedValue() >= fenceValue)
+        return;
 
-        WaitForSingleObjectEx(fenceEventHandle, INFINITE, false);
-        CloseHandle(fenceEventHandle);
-        ++mCurrentFence;
+    HANDLE fenceEventHandle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (fenceEventHandle == nullptr)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
     }
+    ThrowIfFailed(mFence->SetEventOnCompletion(fenceValue, fenceEventHandle));
+
+    WaitForSingleObjectEx(fenceEventHandle, INFINITE, false);
+    CloseHandle(fenceEventHandle);
+}
+
+void RenderPipeline::Signal()
+{
+    ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), ++mCurrentFence));
+    // A flush between ResetCommandList and the submission signals before the commands recorded so far.
+    if (mCommandAllocator == nullptr)
+        mSubmittedFence = mCurrentFence;
+    // Everything recorded from now on is finished when the next value is signaled.
+    mUploadRing->SetPendingFenceValue(GetPendingFenceValue());
+}
+
+void RenderPipeline::ReleaseCompleted()
+{
+    // The staging memory and the objects released while the command list is open are used only after its submission.
+    UINT64 completedFence = (std::min)(mFence->GetCompletedValue(), mSubmittedFence);
+    mUploadRing->Reclaim(completedFence);
+    mReleaseQueue->Drain(completedFence);
 }
 
 void RenderPipeline::ExecuteAndFlushCmdList(ID3D12GraphicsCommandList* commandList)
 {
+    PixProfiler::EndOpenEvents(commandList);
     ExecuteCommandList(commandList);
-    ResetCommandList(commandList);
     Flush();
+    // After the flush the allocator of the submitted commands is available again.
+    ResetCommandList(commandList);
+    PixProfiler::ReopenEvents(commandList, commandList);
 }
 
 void RenderPipeline::ExecuteAndFlushCmdList(RenderContext* ctx)
@@ -148,16 +208,119 @@ void RenderPipeline::ExecuteAndFlushCmdList(RenderContext* ctx)
 
 void RenderPipeline::ExecuteCommandList(ID3D12GraphicsCommandList* commandList)
 {
+    if (commandList == mCommandList.Get())
+    {
+        SubmitCommandLists();
+        return;
+    }
     commandList->Close();
     ID3D12CommandList* cmdLists[] = { commandList };
     mCommandQueue->ExecuteCommandLists(1, cmdLists);
 }
 
+void RenderPipeline::SubmitCommandLists()
+{
+    CloseCommandList();
+    mRecordedLists.push_back(mCommandList);
+    std::vector<ID3D12CommandList*> cmdLists;
+    cmdLists.reserve(mRecordedLists.size());
+    for (const auto& list : mRecordedLists)
+        cmdLists.push_back(list.Get());
+    mCommandQueue->ExecuteCommandLists(static_cast<UINT>(cmdLists.size()), cmdLists.data());
+
+    // The next signal follows the submission.
+    UINT64 fence = GetPendingFenceValue();
+    mAllocatorPool->Release(D3D12_COMMAND_LIST_TYPE_DIRECT, std::move(mCommandAllocator), fence);
+    for (auto& allocator : mRecordedAllocators)
+        mAllocatorPool->Release(D3D12_COMMAND_LIST_TYPE_DIRECT, std::move(allocator), fence);
+    mRecordedAllocators.clear();
+
+    // A submitted list can be reset right away, the commands stay in its allocator. mCommandList is recorded next.
+    mRecordedLists.pop_back();
+    for (auto& list : mRecordedLists)
+        mFreeLists.push_back(std::move(list));
+    mRecordedLists.clear();
+}
+
+bool RenderPipeline::RecordParallel(RenderContext& ctx, UINT itemsCount, UINT minItemsPerList, const ParallelRecordFunc& record)
+{
+    assert(ctx.CommandList == mCommandList.Get() && "Parallel recording continues the main command list");
+    UINT listsCount = (itemsCount + minItemsPerList - 1) / (std::max)(minItemsPerList, 1u);
+    listsCount = (std::min)(listsCount, mRecordingWorkersCount);
+    if (listsCount <= 1)
+    {
+        record(ctx, 0, itemsCount);
+        return false;
+    }
+
+    // The worker lists go between the part of the main list recorded so far and the rest, which continues in a new list. Splits
+    // and PIX events can't cross command lists, the open ones end here.
+    mStateTracker->EndOpenSplits();
+    ID3D12GraphicsCommandList* previousList = mCommandList.Get();
+    PixProfiler::EndOpenEvents(previousList);
+    CloseCommandList();
+    mRecordedLists.push_back(mCommandList);
+
+    // The allocators and the lists are taken here, the workers only record.
+    std::vector<ComPtr<ID3D12GraphicsCommandList5>> lists(listsCount);
+    std::vector<RenderContext> contexts(listsCount, ctx);
+    for (UINT i = 0; i < listsCount; ++i)
+    {
+        mRecordedAllocators.push_back(mAllocatorPool->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, GetCompletedFenceValue()));
+        lists[i] = AcquireCommandList(mRecordedAllocators.back().Get());
+        contexts[i].CommandList = lists[i].Get();
+        contexts[i].StateTracker = nullptr;
+    }
+    ParallelFor(listsCount, [&](size_t i)
+    {
+        UINT first = static_cast<UINT>(static_cast<UINT64>(itemsCount) * i / listsCount);
+        UINT last = static_cast<UINT>(static_cast<UINT64>(itemsCount) * (i + 1) / listsCount);
+        record(contexts[i], first, last);
+    }, listsCount);
+    for (auto& list : lists)
+    {
+        ThrowIfFailed(list->Close());
+        mRecordedLists.push_back(std::move(list));
+    }
+
+    // The allocator of the closed main list can take the commands of another list.
+    mCommandList = AcquireCommandList(mCommandAllocator.Get());
+    ctx.CommandList = mCommandList.Get();
+    mContext.CommandList = mCommandList.Get();
+    PixProfiler::ReopenEvents(previousList, mCommandList.Get());
+    return true;
+}
+
+ComPtr<ID3D12GraphicsCommandList5> RenderPipeline::AcquireCommandList(ID3D12CommandAllocator* allocator)
+{
+    ComPtr<ID3D12GraphicsCommandList5> list;
+    if (!mFreeLists.empty())
+    {
+        list = std::move(mFreeLists.back());
+        mFreeLists.pop_back();
+        ThrowIfFailed(list->Reset(allocator, nullptr));
+    }
+    else
+    {
+        ThrowIfFailed(mDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator, nullptr, IID_PPV_ARGS(&list)));
+        std::wstring name = L"command_list_" + std::to_wstring(mCreatedListsCount++);
+        NAME_D3D12_OBJECT(list, name.c_str());
+    }
+    return list;
+}
+
+void RenderPipeline::CloseCommandList()
+{
+    mStateTracker->Flush(mCommandList.Get());
+    assert(mStateTracker->GetOpenSplitCount() == 0 && "A split barrier has to end in the command list it began in");
+    ThrowIfFailed(mCommandList->Close());
+}
+
 void RenderPipeline::ResetCommandList(ID3D12GraphicsCommandList* commandList)
 {
-    IncrementAllocatorIndex();
-    mCommandAllocators[mCurrentAllocatorIdx]->Reset();
-    commandList->Reset(mCommandAllocators[mCurrentAllocatorIdx].Get(), nullptr);
+    assert(commandList == mCommandList.Get() && mCommandAllocator == nullptr && "Only the submitted main command list is reset");
+    mCommandAllocator = mAllocatorPool->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, GetCompletedFenceValue());
+    ThrowIfFailed(mCommandList->Reset(mCommandAllocator.Get(), nullptr));
 }
 
 void RenderPipeline::Resize(int width, int height)
@@ -165,6 +328,8 @@ void RenderPipeline::Resize(int width, int height)
     if (width == mContext.Width && height == mContext.Height)
         return;
 
+    // The back buffers and the objects of ImGui can't be in use.
+    Flush();
     ImGui::ImplDX12InvalidateDeviceObjects();
 
     mContext.Width = width;
@@ -173,19 +338,14 @@ void RenderPipeline::Resize(int width, int height)
     for (auto fenceVals : mFenceValues)
         fenceVals = mCurrentFence;
 
-    IncrementAllocatorIndex();
-    mCommandAllocators[mCurrentAllocatorIdx]->Reset();
-    ThrowIfFailed(mCommandList->Reset(mCommandAllocators[mCurrentAllocatorIdx].Get(), nullptr));
+    ResetCommandList(mCommandList.Get());
 
-    mSwapChain.Resize(mDevice.Get(), mCommandList.Get(), mContext);
+    mSwapChain.Resize(mDevice.Get(), mContext);
 
-    ThrowIfFailed(mCommandList->Close());
-    ID3D12CommandList* cmdLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+    SubmitCommandLists();
+    Signal();
 
     ImGui::ImplDX12CreateDeviceObjects();
-
-    Flush();
 }
 
 void RenderPipeline::Render(Scene* scene)
@@ -196,58 +356,46 @@ void RenderPipeline::Render(Scene* scene)
 
     ImGui::Begin("Stats", NULL, ImGuiWindowFlags_NoFocusOnAppearing);
     ImGui::Text("Avg %.3f ms/F (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    const CommandAllocatorPool::Stats& allocatorStats = mAllocatorPool->GetStats(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    ImGui::Text("Command allocators %u, waits for the GPU %llu", allocatorStats.Created, allocatorStats.Waits);
     ImGui::End();
 
-    IncrementAllocatorIndex();
-    // To BeginFrame. Direct approach won't work here.
-    mCommandAllocators[mCurrentAllocatorIdx]->Reset();
-    mCommandList->Reset(mCommandAllocators[mCurrentAllocatorIdx].Get(), nullptr);
+    ResetCommandList(mCommandList.Get());
 
     mContext.CommandList = mCommandList.Get();
 
     mContext.PsoManager->BeginFrame(mContext);
+    mConstants->BeginFrame(mSwapChain.GetCurrentBackBufferIndex());
+    mTextureManager->BeginFrame(mContext);
+    mTextureManager->UpdateStreaming(mContext);
 
     scene->Render(mContext);
 
     ImguiLogger::Logger.Draw("Logger");
 
-    // Redundant but for this playground - ok
-    auto toRt = CD3DX12_RESOURCE_BARRIER::Transition(mSwapChain.GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-    mCommandList->ResourceBarrier(1, &toRt);
+    // The graph of the scene leaves the back buffer as a render target.
+    mStateTracker->Transition(mSwapChain.GetCurrentBackBufferResource(), D3D12_RESOURCE_STATE_RENDER_TARGET);
 
     RenderImGui();
 
-    auto toPresent = CD3DX12_RESOURCE_BARRIER::Transition(mSwapChain.GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-    mCommandList->ResourceBarrier(1, &toPresent);
+    mStateTracker->Transition(mSwapChain.GetCurrentBackBufferResource(), D3D12_RESOURCE_STATE_PRESENT);
 
-    mCommandList->Close();
-    ID3D12CommandList* cmdLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+    SubmitCommandLists();
     mSwapChain.Present();
 
-    mFenceValues[mSwapChain.GetCurrentBackBufferIndex()] = ++mCurrentFence;
-    mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+    Signal();
+    mFenceValues[mSwapChain.GetCurrentBackBufferIndex()] = mCurrentFence;
 
     mSwapChain.ProceedToNextFrame();
 
-    if (mFenceValues[mSwapChain.GetCurrentBackBufferIndex()] != 0 && mFence->GetCompletedValue() < mFenceValues[mSwapChain.GetCurrentBackBufferIndex()])
-    {
-        HANDLE fenceEventHandle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-        if (fenceEventHandle == nullptr)
-        {
-            ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
-        }
-        ThrowIfFailed(mFence->SetEventOnCompletion(mFenceValues[mSwapChain.GetCurrentBackBufferIndex()], fenceEventHandle));
-
-        WaitForSingleObjectEx(fenceEventHandle, INFINITE, false);
-        CloseHandle(fenceEventHandle);
-    }
+    WaitForFence(mFenceValues[mSwapChain.GetCurrentBackBufferIndex()]);
+    ReleaseCompleted();
 }
 
 void RenderPipeline::Shutdown()
 {
     mPsoManager->Shutdown();
-    SafeDelete(mTextureManager); // To dtor to safely delete stuff
+    // The texture manager is kept until the destructor, the scene releases its textures when it's destroyed.
     SafeDelete(mPsoManager);
     if (mContext.Device != nullptr)
         Flush();
@@ -316,6 +464,7 @@ void RenderPipeline::RenderImGui()
 
     ID3D12DescriptorHeap* descHeap[] = { mImguiTextureManager->GetHeap() };
     mContext.CommandList->SetDescriptorHeaps(1, descHeap);
+    mStateTracker->Flush(mContext.CommandList);
     ImGui::Render();
     ImGui::ImplDX12RenderDrawData(ImGui::GetDrawData(), mContext.CommandList);
 }
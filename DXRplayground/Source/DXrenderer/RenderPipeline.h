@@ -3,10 +3,12 @@
 #include <array>
 #include <cassert>
 #include <exception>
+#include <functional>
 #include <map>
 #include <d3d12.h>
 #include <dxgi1_6.h>
 #include <string>
+#include <vector>
 #include <wrl.h>
 
 #include "DXrenderer/RenderContext.h"
@@ -18,6 +20,13 @@ namespace DirectxPlayground
 class Scene;
 
 class ImguiTextureManager;
+class UploadRing;
+class GpuMemoryAllocator;
+class DeferredReleaseQueue;
+class ConstantBufferAllocator;
+class ResourceStateTracker;
+class RenderGraphResources;
+class CommandAllocatorPool;
 
 class IRenderPipeline
 {
@@ -29,6 +38,19 @@ public:
     virtual void ExecuteAndFlushCmdList(RenderContext* ctx) = 0;
     virtual void ExecuteCommandList(ID3D12GraphicsCommandList* commandList) = 0;
     virtual void ResetCommandList(ID3D12GraphicsCommandList* commandList) = 0;
+    // The fence value signaled after the commands recorded now and the last value the GPU has passed.
+    virtual UINT64 GetPendingFenceValue() const = 0;
+    virtual UINT64 GetCompletedFenceValue() const = 0;
+
+    // Records the items [first, last) of a chunk. ctx is a copy of the main context with the command list of the chunk, which inherits
+    // no state, and without a state tracker, the barriers have to be recorded before. Runs on a worker thread, the context services
+    // aren't thread safe, so it only records.
+    using ParallelRecordFunc = std::function<void(RenderContext& ctx, UINT first, UINT last)>;
+    // Splits [0, itemsCount) into chunks of at least minItemsPerList items recorded in parallel, each into its own command list. The lists
+    // execute in order after the commands recorded in ctx.CommandList so far and before the next ones, ctx.CommandList continues in a new
+    // list then, without the state set before. The open PIX events continue in the new list. Returns false if there's too little work to
+    // split, record was called with ctx then.
+    virtual bool RecordParallel(RenderContext& ctx, UINT itemsCount, UINT minItemsPerList, const ParallelRecordFunc& record) = 0;
 };
 
 class RenderPipeline : public IRenderPipeline
@@ -41,7 +63,11 @@ public:
     void ExecuteAndFlushCmdList(ID3D12GraphicsCommandList* commandList) override;
     void ExecuteAndFlushCmdList(RenderContext* ctx) override;
     void ExecuteCommandList(ID3D12GraphicsCommandList* commandList) override;
-    void ResetCommandList(ID3D12GraphicsCommandList* commandList) override; // TODO: Nice way to mess things up, rethink
+    // Only for the main command list, it takes an allocator from the pool.
+    void ResetCommandList(ID3D12GraphicsCommandList* commandList) override;
+    UINT64 GetPendingFenceValue() const override;
+    UINT64 GetCompletedFenceValue() const override;
+    bool RecordParallel(RenderContext& ctx, UINT itemsCount, UINT minItemsPerList, const ParallelRecordFunc& record) override;
     void Resize(int width, int height);
 
     void Render(Scene* scene);
@@ -54,7 +80,14 @@ private:
     void InitImGui();
     void RenderImGui();
     void ShutdownImGui();
-    void IncrementAllocatorIndex();
+    void Signal();
+    // A value which wasn't signaled can't be waited for.
+    void WaitForFence(UINT64 fenceValue);
+    void ReleaseCompleted();
+    void CloseCommandList();
+    // Submits the lists recorded in parallel together with mCommandList, in the recording order.
+    void SubmitCommandLists();
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList5> AcquireCommandList(ID3D12CommandAllocator* allocator);
 
     bool mIsTearingSupported = false;
 
@@ -63,6 +96,13 @@ private:
     Swapchain mSwapChain;
     TextureManager* mTextureManager = nullptr;
     PsoManager* mPsoManager = nullptr;
+    UploadRing* mUploadRing = nullptr;
+    ConstantBufferAllocator* mConstants = nullptr;
+    ResourceStateTracker* mStateTracker = nullptr; // Of mCommandList.
+    RenderGraphResources* mGraphResources = nullptr;
+    CommandAllocatorPool* mAllocatorPool = nullptr;
+    GpuMemoryAllocator* mGpuAllocator = nullptr; // Deleted in the destructor, after the scene has released its resources.
+    DeferredReleaseQueue* mReleaseQueue = nullptr; // The same, its deleters return the memory to mGpuAllocator.
 
     ImguiTextureManager* mImguiTextureManager = nullptr;
 
@@ -71,15 +111,28 @@ private:
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCommandQueue;
 
     Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
-    std::array<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>, RenderContext::AllocatorsCount> mCommandAllocators;
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList5> mCommandList;
+    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mCommandAllocator; // Of mCommandList, nullptr while it's closed.
     UINT64 mFenceValues[RenderContext::FramesCount]{};
     UINT64 mCurrentFence = 0;
-    UINT64 mCurrentAllocatorIdx = 0; // TODO: recheck allocators
+    UINT64 mSubmittedFence = 0; // The last value signaled with nothing recorded and not submitted.
+
+    UINT mRecordingWorkersCount = 1;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList5>> mRecordedLists; // Closed and waiting for SubmitCommandLists.
+    // Of the lists recorded in parallel, they go back to the pool with the submission.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> mRecordedAllocators;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList5>> mFreeLists; // Submitted, they can be reset.
+    UINT mCreatedListsCount = 0;
 };
 
-inline void RenderPipeline::IncrementAllocatorIndex()
+// Every signal uses a new value, see Signal.
+inline UINT64 RenderPipeline::GetPendingFenceValue() const
 {
-    mCurrentAllocatorIdx = (mCurrentAllocatorIdx + 1) % RenderContext::AllocatorsCount;
+    return mCurrentFence + 1;
+}
+
+inline UINT64 RenderPipeline::GetCompletedFenceValue() const
+{
+    return mFence->GetCompletedValue();
 }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "External/Dx12Helpers/d3dx12.h"
 #include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/ResourceStateTracker.h"
 
 namespace DirectxPlayground
 {
@@ -20,7 +21,10 @@ public:
     void SetName(const std::wstring& name);
 
     void SetInitialState(D3D12_RESOURCE_STATES state);
+    // The state of the whole resource, asserts if its subresources are in different states.
     D3D12_RESOURCE_STATES GetCurrentState() const;
+    // For ResourceStateTracker. The transitions below are issued right away, a resource recorded through a tracker goes through it only.
+    SubresourceStates& GetStates();
     bool GetBarrier(D3D12_RESOURCE_STATES after, CD3DX12_RESOURCE_BARRIER& transition);
     CD3DX12_RESOURCE_BARRIER GetBarrier(D3D12_RESOURCE_STATES after);
     void Transition(ID3D12GraphicsCommandList* cmdList, D3D12_RESOURCE_STATES after);
@@ -29,11 +33,21 @@ public:
 
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mResource = nullptr;
-    D3D12_RESOURCE_STATES mState = D3D12_RESOURCE_STATE_GENERIC_READ;
+    SubresourceStates mStates{ D3D12_RESOURCE_STATE_GENERIC_READ };
     bool mInitialStateSet = false;
 };
 
-inline ResourceDX::ResourceDX(D3D12_RESOURCE_STATES initialState) : mState(initialState), mInitialStateSet(true)
+// Plane slices aren't counted, planar formats are transitioned as a whole.
+inline UINT CountSubresources(const D3D12_RESOURCE_DESC& desc)
+{
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        return 1;
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+        return desc.MipLevels;
+    return desc.MipLevels * desc.DepthOrArraySize;
+}
+
+inline ResourceDX::ResourceDX(D3D12_RESOURCE_STATES initialState) : mStates(initialState), mInitialStateSet(true)
 {}
 
 inline ID3D12Resource* ResourceDX::Get() const
@@ -64,41 +78,44 @@ inline void ResourceDX::SetName(const std::wstring& name)
 
 inline void ResourceDX::SetInitialState(D3D12_RESOURCE_STATES state)
 {
-    mState = state;
+    mStates.Reset(state);
     mInitialStateSet = true;
 }
 
 inline D3D12_RESOURCE_STATES ResourceDX::GetCurrentState() const
 {
     assert(mInitialStateSet);
-    return mState;
+    return mStates.Get();
 }
 
-inline bool ResourceDX::GetBarrier(D3D12_RESOURCE_STATES after, CD3DX12_RESOURCE_BARRIER& transition)
+inline SubresourceStates& ResourceDX::GetStates()
 {
     assert(mInitialStateSet);
-    if (after == mState)
+    if (mStates.GetSubresourceCount() == 0 && Get() != nullptr)
+        mStates.SetSubresourceCount(CountSubresources(Get()->GetDesc()));
+    return mStates;
+}
+
+inline bool ResourceDX::GetBarrier(D3D12_RESOURCE_STATES after, CD3DX12_RESOURCE_BARRIER& transition)
+{
+    if (after == GetCurrentState())
         return false;
-    transition = CD3DX12_RESOURCE_BARRIER::Transition(Get(), mState, after);
-    mState = after;
+    transition = CD3DX12_RESOURCE_BARRIER::Transition(Get(), GetCurrentState(), after);
+    mStates.Set(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, after);
     return true;
 }
 
 inline CD3DX12_RESOURCE_BARRIER ResourceDX::GetBarrier(D3D12_RESOURCE_STATES after)
 {
-    assert(mInitialStateSet);
-    assert(mState != after);
-    D3D12_RESOURCE_STATES before = mState;
-    mState = after;
+    D3D12_RESOURCE_STATES before = GetCurrentState();
+    assert(before != after);
+    mStates.Set(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, after);
     return CD3DX12_RESOURCE_BARRIER::Transition(Get(), before, after);
 }
 
 inline void ResourceDX::Transition(ID3D12GraphicsCommandList* cmdList, D3D12_RESOURCE_STATES after)
 {
-    assert(mInitialStateSet);
-    assert(after != mState);
-    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(Get(), mState, after);
-    mState = after;
+    CD3DX12_RESOURCE_BARRIER barrier = GetBarrier(after);
     cmdList->ResourceBarrier(1, &barrier);
 }
 
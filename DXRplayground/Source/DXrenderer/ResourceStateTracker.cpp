@@ -0,0 +1,217 @@
+#include "DXrenderer/ResourceStateTracker.h"
+
+#include <cassert>
+
+#include "External/Dx12Helpers/d3dx12.h"
+#include "DXrenderer/ResourceDX.h"
+
+namespace DirectxPlayground
+{
+void SubresourceStates::SetSubresourceCount(UINT count)
+{
+    assert(IsUniform() && "The count can't change while the subresources are in different states");
+    mSubresourceCount = count;
+}
+
+D3D12_RESOURCE_STATES SubresourceStates::Get() const
+{
+    assert(IsUniform() && "The subresources are in different states");
+    return mState;
+}
+
+D3D12_RESOURCE_STATES SubresourceStates::Get(UINT subresource) const
+{
+    if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES || IsUniform())
+        return Get();
+    assert(subresource < mSubresources.size());
+    return mSubresources[subresource];
+}
+
+void SubresourceStates::Set(UINT subresource, D3D12_RESOURCE_STATES state)
+{
+    if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+    {
+        mState = state;
+        mSubresources.clear();
+        return;
+    }
+    if (IsUniform())
+    {
+        if (state == mState)
+            return;
+        assert(subresource < mSubresourceCount && "The subresource count is unknown or the subresource is out of range");
+        mSubresources.assign(mSubresourceCount, mState);
+    }
+    mSubresources[subresource] = state;
+    for (D3D12_RESOURCE_STATES subresourceState : mSubresources)
+    {
+        if (subresourceState != state)
+            return;
+    }
+    mState = state;
+    mSubresources.clear();
+}
+
+void ResourceStateTracker::Transition(ID3D12Resource* resource, SubresourceStates& states, D3D12_RESOURCE_STATES after, UINT subresource)
+{
+    EndSplits(resource, subresource);
+    if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && !states.IsUniform())
+    {
+        for (UINT i = 0; i < states.GetSubresourceCount(); ++i)
+            AddTransition(resource, i, states.Get(i), after);
+    }
+    else
+    {
+        AddTransition(resource, subresource, states.Get(subresource), after);
+    }
+    states.Set(subresource, after);
+}
+
+void ResourceStateTracker::Transition(ResourceDX& resource, D3D12_RESOURCE_STATES after, UINT subresource)
+{
+    Transition(resource.Get(), resource.GetStates(), after, subresource);
+}
+
+void ResourceStateTracker::BeginTransition(ID3D12Resource* resource, SubresourceStates& states, D3D12_RESOURCE_STATES after, UINT subresource)
+{
+    EndSplits(resource, subresource);
+    if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && !states.IsUniform())
+    {
+        for (UINT i = 0; i < states.GetSubresourceCount(); ++i)
+            AddSplit(resource, i, states.Get(i), after);
+    }
+    else
+    {
+        AddSplit(resource, subresource, states.Get(subresource), after);
+    }
+    states.Set(subresource, after);
+}
+
+void ResourceStateTracker::BeginTransition(ResourceDX& resource, D3D12_RESOURCE_STATES after, UINT subresource)
+{
+    BeginTransition(resource.Get(), resource.GetStates(), after, subresource);
+}
+
+void ResourceStateTracker::UavBarrier(ID3D12Resource* resource)
+{
+    // Nothing runs between the barriers of one batch, a second one for the same resource has nothing to wait for.
+    for (const D3D12_RESOURCE_BARRIER& barrier : mPending)
+    {
+        if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV && (barrier.UAV.pResource == resource || barrier.UAV.pResource == nullptr))
+            return;
+    }
+    mPending.push_back(CD3DX12_RESOURCE_BARRIER::UAV(resource));
+}
+
+void ResourceStateTracker::UavBarrier(ResourceDX& resource)
+{
+    UavBarrier(resource.Get());
+}
+
+void ResourceStateTracker::AliasingBarrier(ID3D12Resource* before, ID3D12Resource* after)
+{
+    mPending.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(before, after));
+}
+
+void ResourceStateTracker::Flush(ID3D12GraphicsCommandList* commandList)
+{
+    if (mPending.empty())
+        return;
+    commandList->ResourceBarrier(static_cast<UINT>(mPending.size()), mPending.data());
+    ClearPending();
+}
+
+void ResourceStateTracker::Flush(std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+{
+    barriers.insert(barriers.end(), mPending.begin(), mPending.end());
+    ClearPending();
+}
+
+void ResourceStateTracker::EndOpenSplits()
+{
+    while (!mSplits.empty())
+        EndSplits(mSplits.front().Resource, mSplits.front().Subresource);
+}
+
+void ResourceStateTracker::ClearPending()
+{
+    mPending.clear();
+    for (SplitTransition& split : mSplits)
+        split.PendingIndex = Flushed;
+}
+
+void ResourceStateTracker::EndSplits(ID3D12Resource* resource, UINT subresource)
+{
+    for (size_t i = 0; i < mSplits.size();)
+    {
+        const SplitTransition& split = mSplits[i];
+        bool overlaps = split.Resource == resource && (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES
+            || split.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES || split.Subresource == subresource);
+        if (!overlaps)
+        {
+            ++i;
+            continue;
+        }
+        // A begin which wasn't flushed has no work to overlap with, the end goes into the same barrier.
+        if (split.PendingIndex != Flushed)
+            mPending[split.PendingIndex].Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        else
+            mPending.push_back(CD3DX12_RESOURCE_BARRIER::Transition(split.Resource, split.Before, split.After, split.Subresource, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+        mSplits.erase(mSplits.begin() + i);
+    }
+}
+
+void ResourceStateTracker::AddTransition(ID3D12Resource* resource, UINT subresource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+{
+    if (before == after)
+        return;
+
+    // Only the last barrier of the resource in the batch can be merged with, the ones before it must keep their order.
+    for (size_t i = mPending.size(); i-- > 0;)
+    {
+        D3D12_RESOURCE_BARRIER& barrier = mPending[i];
+        if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV)
+        {
+            if (barrier.UAV.pResource == resource || barrier.UAV.pResource == nullptr)
+                break;
+            continue;
+        }
+        if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_ALIASING)
+        {
+            if (barrier.Aliasing.pResourceBefore == resource || barrier.Aliasing.pResourceBefore == nullptr || barrier.Aliasing.pResourceAfter == resource)
+                break;
+            continue;
+        }
+        if (barrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION || barrier.Transition.pResource != resource)
+            continue;
+        if (barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE && barrier.Transition.Subresource == subresource)
+        {
+            assert(barrier.Transition.StateAfter == before);
+            barrier.Transition.StateAfter = after;
+            if (barrier.Transition.StateBefore == after)
+                ErasePending(i);
+            return;
+        }
+        break;
+    }
+    mPending.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after, subresource));
+}
+
+void ResourceStateTracker::AddSplit(ID3D12Resource* resource, UINT subresource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+{
+    if (before == after)
+        return;
+    mSplits.push_back({ resource, subresource, before, after, mPending.size() });
+    mPending.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after, subresource, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+}
+
+void ResourceStateTracker::ErasePending(size_t index)
+{
+    mPending.erase(mPending.begin() + index);
+    for (SplitTransition& split : mSplits)
+    {
+        if (split.PendingIndex != Flushed && split.PendingIndex > index)
+            --split.PendingIndex;
+    }
+}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vector>
+#include <d3d12.h>
+
+namespace DirectxPlayground
+{
+class ResourceDX;
+
+// States of the subresources of one resource. One value while all of them are in the same state, which is the common case, a value
+// per subresource otherwise.
+class SubresourceStates
+{
+public:
+    SubresourceStates() = default;
+    explicit SubresourceStates(D3D12_RESOURCE_STATES state);
+
+    void Reset(D3D12_RESOURCE_STATES state);
+    // 0 is unknown, only transitions of all subresources are possible then.
+    void SetSubresourceCount(UINT count);
+    UINT GetSubresourceCount() const;
+
+    bool IsUniform() const;
+    // The state shared by all subresources.
+    D3D12_RESOURCE_STATES Get() const;
+    D3D12_RESOURCE_STATES Get(UINT subresource) const;
+    // D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES sets all of them.
+    void Set(UINT subresource, D3D12_RESOURCE_STATES state);
+
+private:
+    D3D12_RESOURCE_STATES mState = D3D12_RESOURCE_STATE_COMMON;
+    std::vector<D3D12_RESOURCE_STATES> mSubresources; // Empty while uniform.
+    UINT mSubresourceCount = 0;
+};
+
+// Records the barriers of one command list. Transitions are collected until Flush, which issues them with a single ResourceBarrier call,
+// so Flush goes right before every draw, dispatch, copy or clear. Transitions to the current state are dropped, transitions of the
+// same subresource in one batch are merged into one, and a pair which returns the subresource to its state cancels out. A split
+// transition begun with BeginTransition is ended by the next Transition of the subresource, it becomes a regular barrier if no Flush
+// happened in between. The states are updated while recording, so the command lists have to execute in the recording order.
+// The tracker never dereferences the resources, GetPendingBarriers can be checked without a device.
+class ResourceStateTracker
+{
+public:
+    ResourceStateTracker() = default;
+    ResourceStateTracker(const ResourceStateTracker&) = delete;
+    ResourceStateTracker(ResourceStateTracker&&) = delete;
+    ResourceStateTracker& operator=(const ResourceStateTracker&) = delete;
+    ResourceStateTracker& operator=(ResourceStateTracker&&) = delete;
+
+    void Transition(ID3D12Resource* resource, SubresourceStates& states, D3D12_RESOURCE_STATES after, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+    void Transition(ResourceDX& resource, D3D12_RESOURCE_STATES after, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+    void BeginTransition(ID3D12Resource* resource, SubresourceStates& states, D3D12_RESOURCE_STATES after, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+    void BeginTransition(ResourceDX& resource, D3D12_RESOURCE_STATES after, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+    // nullptr waits for the UAV accesses of all resources.
+    void UavBarrier(ID3D12Resource* resource);
+    void UavBarrier(ResourceDX& resource);
+    // For placed resources which share memory, after starts to use it. nullptr before stands for any resource.
+    void AliasingBarrier(ID3D12Resource* before, ID3D12Resource* after);
+
+    void Flush(ID3D12GraphicsCommandList* commandList);
+    // Appends the batch to barriers instead of recording it, so the batches can be checked without a command list.
+    void Flush(std::vector<D3D12_RESOURCE_BARRIER>& barriers);
+    // Ends the split transitions which are still open, e.g. before a command list is closed in the middle of the frame. The ends
+    // are pending until the next Flush.
+    void EndOpenSplits();
+
+    const std::vector<D3D12_RESOURCE_BARRIER>& GetPendingBarriers() const;
+    // Split transitions which weren't ended yet, the command list can't be closed with any.
+    UINT GetOpenSplitCount() const;
+
+private:
+    static constexpr size_t Flushed = ~size_t(0);
+
+    struct SplitTransition
+    {
+        ID3D12Resource* Resource = nullptr;
+        UINT Subresource = 0;
+        D3D12_RESOURCE_STATES Before = D3D12_RESOURCE_STATE_COMMON;
+        D3D12_RESOURCE_STATES After = D3D12_RESOURCE_STATE_COMMON;
+        size_t PendingIndex = Flushed; // The begin barrier in mPending until it's flushed.
+    };
+
+    void ClearPending();
+    void EndSplits(ID3D12Resource* resource, UINT subresource);
+    void AddTransition(ID3D12Resource* resource, UINT subresource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+    void AddSplit(ID3D12Resource* resource, UINT subresource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+    void ErasePending(size_t index);
+
+    std::vector<D3D12_RESOURCE_BARRIER> mPending;
+    std::vector<SplitTransition> mSplits;
+};
+
+inline SubresourceStates::SubresourceStates(D3D12_RESOURCE_STATES state) : mState(state)
+{}
+
+inline void SubresourceStates::Reset(D3D12_RESOURCE_STATES state)
+{
+    mState = state;
+    mSubresources.clear();
+    mSubresourceCount = 0;
+}
+
+inline UINT SubresourceStates::GetSubresourceCount() const
+{
+    return mSubresourceCount;
+}
+
+inline bool SubresourceStates::IsUniform() const
+{
+    return mSubresources.empty();
+}
+
+inline const std::vector<D3D12_RESOURCE_BARRIER>& ResourceStateTracker::GetPendingBarriers() const
+{
+    return mPending;
+}
+
+inline UINT ResourceStateTracker::GetOpenSplitCount() const
+{
+    return static_cast<UINT>(mSplits.size());
+}
+}
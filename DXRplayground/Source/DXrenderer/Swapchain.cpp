@@ -1,6 +1,8 @@
 #include "Swapchain.h"
 
 #include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/Memory/DeferredReleaseQueue.h"
+#include "DXrenderer/RenderPipeline.h"
 
 namespace DirectxPlayground
 {
@@ -44,14 +46,20 @@ void Swapchain::Init(bool isTearingSupported, HWND hwnd, const RenderContext& ct
 }
 
 
-void Swapchain::Resize(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, const RenderContext& ctx)
+void Swapchain::Resize(ID3D12Device* device, const RenderContext& ctx)
 {
     mCurrentFrameIndex = 0;
 
+    // The swap chain needs its buffers released right away, the depth buffer can wait for the frames in flight.
+    if (mDsResource.Get() != nullptr)
+        ctx.ReleaseQueue->Release(ctx.Pipeline->GetPendingFenceValue(), mDsResource.GetWrlPtr());
     mDsResource.GetWrlPtr().Reset();
     mDsResource.SetInitialState(D3D12_RESOURCE_STATE_COMMON);
     for (auto& backBufferRes : mBackBufferResources)
+    {
         backBufferRes.GetWrlPtr().Reset();
+        backBufferRes.SetInitialState(D3D12_RESOURCE_STATE_PRESENT);
+    }
 
     UINT flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
     if (mIsTearingSupported)
@@ -103,7 +111,7 @@ void Swapchain::Resize(ID3D12Device* device, ID3D12GraphicsCommandList* commandL
 
     device->CreateDepthStencilView(mDsResource.Get(), &dsViewDesc, mDsvHeap->GetCPUDescriptorHandleForHeapStart());
 
-    mDsResource.Transition(commandList, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    ctx.StateTracker->Transition(mDsResource, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 }
 
 void Swapchain::Present()
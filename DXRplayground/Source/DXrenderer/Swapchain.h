@@ -20,7 +20,7 @@ public:
 
     void Init(bool isTearingSupported, HWND hwnd, const RenderContext& state,
         IDXGIFactory7* factory, ID3D12Device* device, ID3D12CommandQueue* commandQueue);
-    void Resize(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, const RenderContext& ctx);
+    void Resize(ID3D12Device* device, const RenderContext& ctx);
 
     void Present();
     void ProceedToNextFrame();
@@ -29,6 +29,8 @@ public:
     D3D12_CPU_DESCRIPTOR_HANDLE GetDSCPUhandle() const;
     UINT GetCurrentBackBufferIndex() const;
     ID3D12Resource* GetCurrentBackBuffer() const;
+    ResourceDX& GetCurrentBackBufferResource();
+    ResourceDX& GetDepthStencilResource();
 
     DXGI_FORMAT GetBackBufferFormat() const;
     DXGI_FORMAT GetDepthStencilFormat() const;
@@ -74,6 +76,16 @@ inline ID3D12Resource* Swapchain::GetCurrentBackBuffer() const
     return mBackBufferResources[GetCurrentBackBufferIndex()].Get();
 }
 
+inline ResourceDX& Swapchain::GetCurrentBackBufferResource()
+{
+    return mBackBufferResources[GetCurrentBackBufferIndex()];
+}
+
+inline ResourceDX& Swapchain::GetDepthStencilResource()
+{
+    return mDsResource;
+}
+
 inline DXGI_FORMAT Swapchain::GetBackBufferFormat() const
 {
     return mBackBufferFormat;
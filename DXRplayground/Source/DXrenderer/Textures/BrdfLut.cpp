@@ -0,0 +1,87 @@
+#include "DXrenderer/Textures/BrdfLut.h"
+
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+#include <string>
+
+#include "DXrenderer/Textures/SamplingHelpers.h"
+#include "Utils/BinaryContainer.h"
+#include "Utils/ParallelFor.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+// Schlick-GGX with the IBL remapping k = a / 2, Lighting.hlsl uses the direct lighting one.
+float GeometrySmith(float NdotV, float NdotL, float roughness)
+{
+    float k = roughness * roughness / 2.0f;
+    return (NdotV / (NdotV * (1.0f - k) + k)) * (NdotL / (NdotL * (1.0f - k) + k));
+}
+
+// Returns the scale and the bias of F0, N is +Z and V lies in the XZ plane.
+void Integrate(float NdotV, float roughness, UINT samplesCount, float& scale, float& bias)
+{
+    const float v[3] = { std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV };
+    const float a = roughness * roughness;
+    const float a2 = a * a;
+    scale = 0.0f;
+    bias = 0.0f;
+    for (UINT i = 0; i < samplesCount; ++i)
+    {
+        float phi = 2.0f * Pi * i / samplesCount;
+        float xi = RadicalInverse(i);
+        float cosTheta = std::sqrt((1.0f - xi) / (1.0f + (a2 - 1.0f) * xi));
+        float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+        float h[3] = { sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta };
+
+        float VdotH = v[0] * h[0] + v[2] * h[2];
+        float NdotL = 2.0f * VdotH * h[2] - v[2];
+        if (NdotL <= 0.0f)
+            continue;
+
+        // The pdf of L is D * NdotH / (4 * VdotH), D cancels out with the BRDF.
+        float visibility = GeometrySmith(NdotV, NdotL, roughness) * VdotH / (h[2] * NdotV);
+        float fresnel = std::pow(1.0f - VdotH, 5.0f);
+        scale += (1.0f - fresnel) * visibility;
+        bias += fresnel * visibility;
+    }
+    scale /= samplesCount;
+    bias /= samplesCount;
+}
+}
+
+void BrdfLut::Parse(const std::string& name)
+{
+    mData.resize(size_t(mSize) * mSize * sizeof(UINT16) * 2);
+    UINT16* dst = reinterpret_cast<UINT16*>(mData.data());
+    ParallelFor(mSize, [this, dst](size_t y)
+    {
+        float roughness = (y + 0.5f) / mSize;
+        for (UINT x = 0; x < mSize; ++x)
+        {
+            float scale = 0.0f;
+            float bias = 0.0f;
+            Integrate((x + 0.5f) / mSize, roughness, mSamplesCount, scale, bias);
+            UINT texel = static_cast<UINT>(_mm_cvtsi128_si32(_mm_cvtps_ph(_mm_setr_ps(scale, bias, 0.0f, 0.0f), _MM_FROUND_TO_NEAREST_INT)));
+            memcpy(dst + (y * mSize + x) * 2, &texel, sizeof(texel));
+        }
+    });
+}
+
+std::string BrdfLut::GetCookedNameSuffix() const
+{
+    return "." + std::to_string(mSize) + "x" + std::to_string(mSamplesCount);
+}
+
+void BrdfLut::Serialize(BinaryContainer& container)
+{
+    container << mSize << mSamplesCount << mData;
+}
+
+void BrdfLut::Deserialize(BinaryContainer& container)
+{
+    container >> mSize >> mSamplesCount >> mData;
+}
+}
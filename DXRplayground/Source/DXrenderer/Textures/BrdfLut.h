@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Utils/Asset.h"
+
+#include <vector>
+#include <dxgi1_6.h>
+
+namespace DirectxPlayground
+{
+// Environment BRDF of the split sum approximation: F0 * R + G is the specular reflectance under uniform lighting.
+// X is NdotV, Y is roughness, texel centers are sampled. There is no source file, load it with AssetSystem::LoadGenerated,
+// the size and the samples count are a part of the cooked name.
+class BrdfLut : public Asset
+{
+public:
+    BrdfLut(UINT size, UINT samplesCount) : mSize(size), mSamplesCount(samplesCount)
+    {}
+
+    // The name is ignored, the table is integrated on all cores with the Hammersley sequence, so the result is always the same.
+    void Parse(const std::string& name) override;
+    void Serialize(BinaryContainer& container) override;
+    void Deserialize(BinaryContainer& container) override;
+    size_t GetVersion() const override
+    {
+        return AssetSerializationVersion;
+    }
+    std::string GetCookedNameSuffix() const override;
+
+    // R16G16_FLOAT texels.
+    const std::vector<byte>& GetData() const
+    {
+        return mData;
+    }
+
+    UINT GetSize() const
+    {
+        return mSize;
+    }
+
+    static constexpr DXGI_FORMAT Format = DXGI_FORMAT_R16G16_FLOAT;
+private:
+    inline static constexpr size_t AssetSerializationVersion = 1;
+
+    std::vector<byte> mData;
+    UINT mSize;
+    UINT mSamplesCount;
+};
+}
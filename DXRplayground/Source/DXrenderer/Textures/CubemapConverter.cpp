@@ -0,0 +1,100 @@
+#include "DXrenderer/Textures/CubemapConverter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+#include "DXrenderer/Textures/SamplingHelpers.h"
+#include "Utils/ParallelFor.h"
+
+namespace DirectxPlayground::CubemapConverter
+{
+namespace
+{
+struct BilinearTap
+{
+    UINT X0 = 0;
+    UINT X1 = 0;
+    UINT Y0 = 0;
+    UINT Y1 = 0;
+    float Tx = 0.0f;
+    float Ty = 0.0f;
+};
+
+// Wraps horizontally and clamps vertically.
+BilinearTap GetTap(float u, float v, UINT width, UINT height)
+{
+    float x = u * width - 0.5f;
+    float y = std::clamp(v * height - 0.5f, 0.0f, float(height - 1));
+    float x0 = std::floor(x);
+    float y0 = std::floor(y);
+
+    BilinearTap res;
+    res.Tx = x - x0;
+    res.Ty = y - y0;
+    res.X0 = UINT(int(x0) + int(width)) % width;
+    res.X1 = (res.X0 + 1) % width;
+    res.Y0 = UINT(y0);
+    res.Y1 = std::min(res.Y0 + 1, height - 1);
+    return res;
+}
+
+// The whole texel is filtered at once, one float4 per tap.
+__m128 Sample(const float* equirect, UINT width, const BilinearTap& tap)
+{
+    const float* row0 = equirect + size_t(tap.Y0) * width * 4;
+    const float* row1 = equirect + size_t(tap.Y1) * width * 4;
+    __m128 tx = _mm_set1_ps(tap.Tx);
+    __m128 c00 = _mm_loadu_ps(row0 + tap.X0 * 4);
+    __m128 c10 = _mm_loadu_ps(row0 + tap.X1 * 4);
+    __m128 c01 = _mm_loadu_ps(row1 + tap.X0 * 4);
+    __m128 c11 = _mm_loadu_ps(row1 + tap.X1 * 4);
+    __m128 top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), tx));
+    __m128 bottom = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), tx));
+    return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), _mm_set1_ps(tap.Ty)));
+}
+}
+
+void GetFaceDirection(UINT face, float u, float v, float dir[3])
+{
+    switch (face)
+    {
+    case 0: dir[0] = 1.0f; dir[1] = -v; dir[2] = -u; break;
+    case 1: dir[0] = -1.0f; dir[1] = -v; dir[2] = u; break;
+    case 2: dir[0] = u; dir[1] = 1.0f; dir[2] = v; break;
+    case 3: dir[0] = u; dir[1] = -1.0f; dir[2] = -v; break;
+    case 4: dir[0] = u; dir[1] = -v; dir[2] = 1.0f; break;
+    default: dir[0] = -u; dir[1] = -v; dir[2] = -1.0f; break;
+    }
+    float invLength = 1.0f / std::sqrt(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+    dir[0] *= invLength;
+    dir[1] *= invLength;
+    dir[2] *= invLength;
+}
+
+void GetEquirectCoords(const float dir[3], float& u, float& v)
+{
+    u = (std::atan2(dir[0], dir[2]) + Pi) / (2.0f * Pi);
+    v = std::acos(std::clamp(dir[1], -1.0f, 1.0f)) / Pi;
+}
+
+std::vector<float> ConvertFace(const float* equirect, UINT width, UINT height, UINT face, UINT size)
+{
+    std::vector<float> res(size_t(size) * size * 4);
+    ParallelFor(size, [&](size_t y)
+    {
+        float v = (y + 0.5f) * 2.0f / size - 1.0f;
+        float* dst = res.data() + y * size * 4;
+        for (UINT x = 0; x < size; ++x, dst += 4)
+        {
+            float dir[3];
+            GetFaceDirection(face, (x + 0.5f) * 2.0f / size - 1.0f, v, dir);
+            float eqU = 0.0f;
+            float eqV = 0.0f;
+            GetEquirectCoords(dir, eqU, eqV);
+            _mm_storeu_ps(dst, Sample(equirect, width, GetTap(eqU, eqV, width, height)));
+        }
+    });
+    return res;
+}
+}
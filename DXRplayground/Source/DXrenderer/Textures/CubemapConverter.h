@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+#include <dxgi1_6.h>
+
+namespace DirectxPlayground::CubemapConverter
+{
+// Normalized direction through the point (u, v) of the face, u and v are in [-1, 1].
+// Faces go in the D3D order +X, -X, +Y, -Y, +Z, -Z with the hardware orientation.
+void GetFaceDirection(UINT face, float u, float v, float dir[3]);
+
+// Equirect texture coordinates of a normalized direction. Columns go around Y starting from -Z, rows go from +Y down to -Y.
+void GetEquirectCoords(const float dir[3], float& u, float& v);
+
+// Bilinearly resamples one face from the RGBA32F equirect, directions go through texel centers.
+// Returns size x size RGBA32F texels.
+std::vector<float> ConvertFace(const float* equirect, UINT width, UINT height, UINT face, UINT size);
+}
@@ -0,0 +1,228 @@
+#include "DXrenderer/Textures/DdsParser.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "DXrenderer/DXhelpers.h"
+#include "Utils/Logger.h"
+
+namespace DirectxPlayground::DdsParser
+{
+namespace
+{
+constexpr UINT DdsMagic = 0x20534444; // "DDS "
+
+constexpr UINT DdpfAlpha = 0x2;
+constexpr UINT DdpfFourCC = 0x4;
+constexpr UINT DdpfRgb = 0x40;
+constexpr UINT DdpfLuminance = 0x20000;
+
+constexpr UINT DdsHeaderFlagsVolume = 0x800000;
+constexpr UINT DdsCubemap = 0x200;
+constexpr UINT DdsCubemapAllFaces = 0xFC00;
+constexpr UINT DdsResourceMiscTextureCube = 0x4;
+constexpr UINT DdsDimensionTexture3D = 4;
+
+struct DdsPixelFormat
+{
+    UINT Size;
+    UINT Flags;
+    UINT FourCC;
+    UINT RGBBitCount;
+    UINT RBitMask;
+    UINT GBitMask;
+    UINT BBitMask;
+    UINT ABitMask;
+};
+
+struct DdsHeader
+{
+    UINT Size;
+    UINT Flags;
+    UINT Height;
+    UINT Width;
+    UINT PitchOrLinearSize;
+    UINT Depth;
+    UINT MipMapCount;
+    UINT Reserved1[11];
+    DdsPixelFormat PixelFormat;
+    UINT Caps;
+    UINT Caps2;
+    UINT Caps3;
+    UINT Caps4;
+    UINT Reserved2;
+};
+
+struct DdsHeaderDxt10
+{
+    UINT DxgiFormat;
+    UINT ResourceDimension;
+    UINT MiscFlag;
+    UINT ArraySize;
+    UINT MiscFlags2;
+};
+
+static_assert(sizeof(DdsHeader) == 124, "DDS header size mismatch");
+static_assert(sizeof(DdsHeaderDxt10) == 20, "DDS DX10 header size mismatch");
+
+constexpr UINT MakeFourCC(char a, char b, char c, char d)
+{
+    return UINT(byte(a)) | (UINT(byte(b)) << 8) | (UINT(byte(c)) << 16) | (UINT(byte(d)) << 24);
+}
+
+bool IsBitMask(const DdsPixelFormat& pf, UINT r, UINT g, UINT b, UINT a)
+{
+    return pf.RBitMask == r && pf.GBitMask == g && pf.BBitMask == b && pf.ABitMask == a;
+}
+
+DXGI_FORMAT GetLegacyFormat(const DdsPixelFormat& pf)
+{
+    if (pf.Flags & DdpfFourCC)
+    {
+        switch (pf.FourCC)
+        {
+        case MakeFourCC('D', 'X', 'T', '1'): return DXGI_FORMAT_BC1_UNORM;
+        case MakeFourCC('D', 'X', 'T', '2'):
+        case MakeFourCC('D', 'X', 'T', '3'): return DXGI_FORMAT_BC2_UNORM;
+        case MakeFourCC('D', 'X', 'T', '4'):
+        case MakeFourCC('D', 'X', 'T', '5'): return DXGI_FORMAT_BC3_UNORM;
+        case MakeFourCC('A', 'T', 'I', '1'):
+        case MakeFourCC('B', 'C', '4', 'U'): return DXGI_FORMAT_BC4_UNORM;
+        case MakeFourCC('B', 'C', '4', 'S'): return DXGI_FORMAT_BC4_SNORM;
+        case MakeFourCC('A', 'T', 'I', '2'):
+        case MakeFourCC('B', 'C', '5', 'U'): return DXGI_FORMAT_BC5_UNORM;
+        case MakeFourCC('B', 'C', '5', 'S'): return DXGI_FORMAT_BC5_SNORM;
+        // D3DFORMAT values written by the old D3DX exporters.
+        case 36: return DXGI_FORMAT_R16G16B16A16_UNORM;
+        case 111: return DXGI_FORMAT_R16_FLOAT;
+        case 112: return DXGI_FORMAT_R16G16_FLOAT;
+        case 113: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+        case 114: return DXGI_FORMAT_R32_FLOAT;
+        case 115: return DXGI_FORMAT_R32G32_FLOAT;
+        case 116: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        default: return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+    if (pf.Flags & DdpfRgb)
+    {
+        if (pf.RGBBitCount == 32)
+        {
+            if (IsBitMask(pf, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000))
+                return DXGI_FORMAT_R8G8B8A8_UNORM;
+            if (IsBitMask(pf, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000))
+                return DXGI_FORMAT_B8G8R8A8_UNORM;
+            if (IsBitMask(pf, 0x00FF0000, 0x0000FF00, 0x000000FF, 0))
+                return DXGI_FORMAT_B8G8R8X8_UNORM;
+            if (IsBitMask(pf, 0x0000FFFF, 0xFFFF0000, 0, 0))
+                return DXGI_FORMAT_R16G16_UNORM;
+            if (IsBitMask(pf, 0xFFFFFFFF, 0, 0, 0))
+                return DXGI_FORMAT_R32_FLOAT;
+        }
+        return DXGI_FORMAT_UNKNOWN;
+    }
+    if (pf.Flags & DdpfLuminance)
+    {
+        if (pf.RGBBitCount == 8 && IsBitMask(pf, 0xFF, 0, 0, 0))
+            return DXGI_FORMAT_R8_UNORM;
+        if (pf.RGBBitCount == 16 && IsBitMask(pf, 0xFFFF, 0, 0, 0))
+            return DXGI_FORMAT_R16_UNORM;
+        if (pf.RGBBitCount == 16 && IsBitMask(pf, 0xFF, 0, 0, 0xFF00))
+            return DXGI_FORMAT_R8G8_UNORM;
+        return DXGI_FORMAT_UNKNOWN;
+    }
+    if ((pf.Flags & DdpfAlpha) && pf.RGBBitCount == 8)
+        return DXGI_FORMAT_A8_UNORM;
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+bool IsSupportedFormat(DXGI_FORMAT format)
+{
+    return IsBlockCompressed(format) || FindPixelSize(format) != 0;
+}
+
+size_t GetSliceSize(DXGI_FORMAT format, UINT width, UINT height, UINT mipsCount)
+{
+    size_t res = 0;
+    for (UINT mip = 0; mip < mipsCount; ++mip)
+        res += GetRowPitch(format, std::max(1U, width >> mip)) * GetRowsCount(format, std::max(1U, height >> mip));
+    return res;
+}
+}
+
+bool Parse(const byte* data, size_t size, DdsImage& image)
+{
+    if (size < sizeof(UINT) + sizeof(DdsHeader))
+    {
+        LOG("DDS parsing error: the file is too small");
+        return false;
+    }
+    UINT magic = 0;
+    memcpy(&magic, data, sizeof(UINT));
+    DdsHeader header;
+    memcpy(&header, data + sizeof(UINT), sizeof(DdsHeader));
+    if (magic != DdsMagic || header.Size != sizeof(DdsHeader) || header.PixelFormat.Size != sizeof(DdsPixelFormat))
+    {
+        LOG("DDS parsing error: invalid header");
+        return false;
+    }
+
+    image = {};
+    image.Width = header.Width;
+    image.Height = header.Height;
+    image.MipsCount = std::max(1U, header.MipMapCount);
+    image.DataOffset = sizeof(UINT) + sizeof(DdsHeader);
+
+    if ((header.PixelFormat.Flags & DdpfFourCC) && header.PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0'))
+    {
+        if (size < image.DataOffset + sizeof(DdsHeaderDxt10))
+        {
+            LOG("DDS parsing error: the DX10 header is truncated");
+            return false;
+        }
+        DdsHeaderDxt10 dx10;
+        memcpy(&dx10, data + image.DataOffset, sizeof(DdsHeaderDxt10));
+        image.DataOffset += sizeof(DdsHeaderDxt10);
+        if (dx10.ResourceDimension == DdsDimensionTexture3D)
+        {
+            LOG("DDS parsing error: volume textures aren't supported");
+            return false;
+        }
+        image.Format = static_cast<DXGI_FORMAT>(dx10.DxgiFormat);
+        image.IsCubemap = (dx10.MiscFlag & DdsResourceMiscTextureCube) != 0;
+        image.ArraySize = std::max(1U, dx10.ArraySize) * (image.IsCubemap ? 6 : 1);
+    }
+    else
+    {
+        if ((header.Flags & DdsHeaderFlagsVolume) || header.Depth > 1)
+        {
+            LOG("DDS parsing error: volume textures aren't supported");
+            return false;
+        }
+        image.Format = GetLegacyFormat(header.PixelFormat);
+        if (header.Caps2 & DdsCubemap)
+        {
+            if ((header.Caps2 & DdsCubemapAllFaces) != DdsCubemapAllFaces)
+            {
+                LOG("DDS parsing error: partial cubemaps aren't supported");
+                return false;
+            }
+            image.IsCubemap = true;
+            image.ArraySize = 6;
+        }
+    }
+
+    if (!IsSupportedFormat(image.Format))
+    {
+        LOG("DDS parsing error: unsupported format ", static_cast<UINT>(image.Format));
+        return false;
+    }
+
+    image.DataSize = GetSliceSize(image.Format, image.Width, image.Height, image.MipsCount) * image.ArraySize;
+    if (image.DataOffset + image.DataSize > size)
+    {
+        LOG("DDS parsing error: the texel data is truncated");
+        return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include <dxgi1_6.h>
+
+namespace DirectxPlayground::DdsParser
+{
+struct DdsImage
+{
+    UINT Width = 0;
+    UINT Height = 0;
+    UINT MipsCount = 1;
+    UINT ArraySize = 1; // Faces included, a cubemap has 6.
+    bool IsCubemap = false;
+    DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+    size_t DataOffset = 0; // From the beginning of the file.
+    size_t DataSize = 0;
+};
+
+// Reads the DDS header, both the legacy pixel formats and the DX10 extension. Volume textures aren't supported.
+// The texel data in the file is already in the D3D12 subresource order: all mips of the first slice, then the next slice.
+bool Parse(const byte* data, size_t size, DdsImage& image);
+}
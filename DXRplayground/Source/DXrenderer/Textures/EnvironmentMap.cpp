@@ -1,115 +1,164 @@
 #include "DXrenderer/Textures/EnvironmentMap.h"
 
+#include "DXrenderer/Buffers/HeapBuffer.h"
 #include "DXrenderer/Buffers/UploadBuffer.h"
+#include "DXrenderer/Textures/EnvironmentSampling.h"
+#include "DXrenderer/Textures/TextureCompression.h"
 #include "DXrenderer/Shader.h"
 #include "DXrenderer/PsoManager.h"
-#include "DXrenderer/RenderPipeline.h"
+#include "Utils/AssetSystem.h"
 #include "Utils/Helpers.h"
 #include "Utils/PixProfiler.h"
 
+#include <algorithm>
+#include <immintrin.h>
+
 namespace DirectxPlayground
 {
+namespace
+{
+constexpr UINT MaxProjectionSize = 128;
+
+void HalfToFloat(const UINT16* src, size_t texelsCount, float* dst)
+{
+    for (size_t i = 0; i < texelsCount * 4; i += 4)
+        _mm_storeu_ps(dst + i, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i))));
+}
+
+// SH9 keeps only the lowest frequencies, so the projection reads the first mip level which isn't larger than MaxProjectionSize.
+// Every face is stored with all its mips, the level is gathered from the six of them. BC6H levels are decoded first.
+std::vector<float> GetProjectionFaces(const Texture& cubemap, UINT& size)
+{
+    assert(cubemap.IsCubemap() && (cubemap.GetFormat() == DXGI_FORMAT_R16G16B16A16_FLOAT || cubemap.GetFormat() == DXGI_FORMAT_BC6H_UF16));
+
+    const DXGI_FORMAT format = cubemap.GetFormat();
+    UINT projectionMip = 0;
+    while (projectionMip + 1 < cubemap.GetMipsCount() && std::max(1U, cubemap.GetWidth() >> projectionMip) > MaxProjectionSize)
+        ++projectionMip;
+
+    size_t faceSize = 0;
+    size_t levelOffset = 0;
+    for (UINT mip = 0; mip < cubemap.GetMipsCount(); ++mip)
+    {
+        if (mip == projectionMip)
+            levelOffset = faceSize;
+        UINT mipSize = std::max(1U, cubemap.GetWidth() >> mip);
+        faceSize += GetRowPitch(format, mipSize) * GetRowsCount(format, mipSize);
+    }
+    size = std::max(1U, cubemap.GetWidth() >> projectionMip);
+
+    const size_t texelsCount = size_t(size) * size;
+    std::vector<float> res(texelsCount * 4 * 6);
+    for (UINT face = 0; face < 6; ++face)
+    {
+        const byte* level = cubemap.GetData().data() + face * faceSize + levelOffset;
+        if (format == DXGI_FORMAT_BC6H_UF16)
+        {
+            std::vector<UINT16> decoded = TextureCompression::DecompressHdr(level, size, size);
+            HalfToFloat(decoded.data(), texelsCount, res.data() + face * texelsCount * 4);
+        }
+        else
+        {
+            HalfToFloat(reinterpret_cast<const UINT16*>(level), texelsCount, res.data() + face * texelsCount * 4);
+        }
+    }
+    return res;
+}
+}
 
-EnvironmentMap::EnvironmentMap(RenderContext& ctx, const std::string& path, UINT cubemapSize, UINT irradianceMapSize)
-    : mDataBuffer(new UploadBuffer(*ctx.Device, sizeof(mGraphicsData), true, 1))
-    , mConvolutionDataBuffer(new UploadBuffer(*ctx.Device, sizeof(mConvolutionData), true, 1))
-    , mDownsampleDataBuffer(new UploadBuffer(*ctx.Device, sizeof(mDownsampleData), true, 1))
-    , mCubemapSize(cubemapSize)
+EnvironmentMap::EnvironmentMap(RenderContext& ctx, const std::string& path, UINT irradianceMapSize, bool compressCubemap /*= false*/)
+    : mConvolutionDataBuffer(new UploadBuffer(*ctx.Device, sizeof(mConvolutionData), true, 1))
+    , mTextureManager(ctx.TexManager)
     , mIrradianceMapSize(irradianceMapSize)
 {
     CreateRootSig(ctx);
     CreateDescriptorHeap(ctx);
     D3D12_COMPUTE_PIPELINE_STATE_DESC desc = GetDefaultComputePsoDescriptor(mRootSig.Get());
 
-    auto shaderPath = ASSETS_DIR_W + std::wstring(L"Shaders//EnvMapConvertion.hlsl");
-    ctx.PsoManager->CreatePso(ctx, mPsoName, shaderPath, desc);
-
-    shaderPath = ASSETS_DIR_W + std::wstring(L"Shaders//IrradianceMapConvertion.hlsl");
+    auto shaderPath = ASSETS_DIR_W + std::wstring(L"Shaders//IrradianceMapConvertion.hlsl");
     ctx.PsoManager->CreatePso(ctx, mConvolutionPsoName, shaderPath, desc);
 
-    shaderPath = ASSETS_DIR_W + std::wstring(L"Shaders//DownsampleEnvMap.hlsl");
-    ctx.PsoManager->CreatePso(ctx, mDownsamplePsoName, shaderPath, desc);
-
-    mEnvMapData = ctx.TexManager->CreateTexture(ctx, path, true);
-    mEnvMapData.Resource->SetName(L"EnvEquirectMap");
-    mCubemapData = ctx.TexManager->CreateCubemap(ctx, mCubemapSize, DXGI_FORMAT_R32G32B32A32_FLOAT, true);
-    mCubemapData.Resource->SetName(L"EnvCubemap");
+    // The cubemap, the specular map and the sampling tables are cooked from the equirect HDR, which is decoded only if one of them
+    // has to be cooked and only once for all three.
+    Texture source(TextureUsage::Raw);
+    auto getSource = [&source, &path]() -> const Texture&
+    {
+        if (source.GetData().empty())
+            source.Parse(path);
+        return source;
+    };
+    Texture cubemap(compressCubemap ? TextureUsage::CubemapCompressed : TextureUsage::Cubemap);
+    AssetSystem::Load(path, cubemap, [&]() { cubemap.CookFrom(getSource()); });
+    // Baked on the CPU, the specular map is cached next to the other cooked versions of the source.
+    Texture specularMap(TextureUsage::SpecularEnvironment);
+    AssetSystem::Load(path, specularMap, [&]() { specularMap.CookFrom(getSource()); });
+    EnvironmentSampling sampling;
+    AssetSystem::Load(path, sampling, [&]() { sampling.CookFrom(getSource()); });
+    source = Texture(); // Only the cooked versions are needed from here.
+
+    // The cubemap is read on the CPU first to project the irradiance to SH.
+    UINT projectionSize = 0;
+    std::vector<float> projectionFaces = GetProjectionFaces(cubemap, projectionSize);
+    mIrradianceSH = SphericalHarmonics::ConvolveIrradiance(SphericalHarmonics::ProjectCubemap(projectionFaces.data(), projectionSize));
+
+    mCubemapData = ctx.TexManager->CreateTexture(ctx, std::move(cubemap), path);
+    ctx.TexManager->GetResource(mCubemapData.Resource)->SetName(L"EnvCubemap");
     mIrradianceMapData = ctx.TexManager->CreateCubemap(ctx, mIrradianceMapSize, DXGI_FORMAT_R32G32B32A32_FLOAT, true);
-    mIrradianceMapData.Resource->SetName(L"IrradianceMap");
-    mDownsampledCubeData = ctx.TexManager->CreateCubemap(ctx, DownsampledCubeSize, DXGI_FORMAT_R32G32B32A32_FLOAT, true);
-
-    mGraphicsData.EqMapCubeMapWH.x = static_cast<float>(mEnvMapData.Resource->Get()->GetDesc().Width);
-    mGraphicsData.EqMapCubeMapWH.y = static_cast<float>(mEnvMapData.Resource->Get()->GetDesc().Height);
-    mGraphicsData.EqMapCubeMapWH.z = static_cast<float>(mCubemapData.Resource->Get()->GetDesc().Width);
-    mGraphicsData.EqMapCubeMapWH.w = static_cast<float>(mCubemapData.Resource->Get()->GetDesc().Height);
+    ctx.TexManager->GetResource(mIrradianceMapData.Resource)->SetName(L"IrradianceMap");
+    mSpecularMipsCount = specularMap.GetMipsCount();
+    mSpecularMapData = ctx.TexManager->CreateTexture(ctx, std::move(specularMap), path);
+    ctx.TexManager->GetResource(mSpecularMapData.Resource)->SetName(L"SpecularMap");
+    mBrdfLutData = ctx.TexManager->GetBrdfLut(ctx);
 
-    mConvolutionData.size.x = static_cast<float>(irradianceMapSize);
-    mConvolutionData.size.y = static_cast<float>(DownsampledCubeSize);
+    mSamplingTablesWidth = sampling.GetWidth();
+    mSamplingTablesHeight = sampling.GetHeight();
+    const std::vector<float>& tables = sampling.GetTables();
+    mSamplingTables = new HeapBuffer(ctx, reinterpret_cast<const byte*>(tables.data()), static_cast<UINT>(tables.size() * sizeof(float)), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    mSamplingTables->GetBuffer()->SetName(L"EnvSamplingTables");
 
-    mDownsampleData.iterCount = cubemapSize / DownsampledCubeSize;
+    mConvolutionData.IrradianceSH = mIrradianceSH;
+    mConvolutionData.Size = static_cast<float>(irradianceMapSize);
 
     CreateViews(ctx);
 
-    mDataBuffer->UploadData(0, mGraphicsData);
     mConvolutionDataBuffer->UploadData(0, mConvolutionData);
-    mDownsampleDataBuffer->UploadData(0, mDownsampleData);
 }
 
 EnvironmentMap::~EnvironmentMap()
 {
-    SafeDelete(mDataBuffer);
     SafeDelete(mConvolutionDataBuffer);
-    SafeDelete(mDownsampleDataBuffer);
+    SafeDelete(mSamplingTables);
+    mTextureManager->ReleaseTexture(mCubemapData);
+    mTextureManager->ReleaseTexture(mSpecularMapData);
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS EnvironmentMap::GetSamplingTablesAddress() const
+{
+    return mSamplingTables->GetBuffer()->GetGPUVirtualAddress();
 }
 
-void EnvironmentMap::ConvertToCubemap(RenderContext& ctx)
+void EnvironmentMap::BakeIrradianceMap(RenderContext& ctx)
 {
-    GPU_SCOPED_EVENT(ctx, "ConverToCubemap");
-    ctx.Pipeline->Flush();
-
-    D3D12_RESOURCE_STATES cubeState = mCubemapData.Resource->GetCurrentState();
-    D3D12_RESOURCE_STATES texState = mEnvMapData.Resource->GetCurrentState();
-    D3D12_RESOURCE_STATES irrMapState = mIrradianceMapData.Resource->GetCurrentState();
-    D3D12_RESOURCE_STATES downsampledState = mDownsampledCubeData.Resource->GetCurrentState();
-    std::array<CD3DX12_RESOURCE_BARRIER, 4> barriers;
-    barriers[0] = mCubemapData.Resource->GetBarrier(D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    barriers[1] = mEnvMapData.Resource->GetBarrier(D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    barriers[2] = mIrradianceMapData.Resource->GetBarrier(D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    barriers[3] = mDownsampledCubeData.Resource->GetBarrier(D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    ctx.CommandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+    GPU_SCOPED_EVENT(ctx, "BakeIrradianceMap");
+
+    ResourceDX* irradianceMap = ctx.TexManager->GetResourceDX(mIrradianceMapData.Resource);
+    D3D12_RESOURCE_STATES irrMapState = irradianceMap->GetCurrentState();
+    ctx.StateTracker->Transition(*irradianceMap, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
     ctx.CommandList->SetComputeRootSignature(mRootSig.Get());
-    ctx.CommandList->SetPipelineState(ctx.PsoManager->GetPso(mPsoName));
+    ctx.CommandList->SetPipelineState(ctx.PsoManager->GetPso(mConvolutionPsoName));
 
     ID3D12DescriptorHeap* descHeaps[] = { mHeap.Get() };
     ctx.CommandList->SetDescriptorHeaps(1, descHeaps);
 
-    ctx.CommandList->SetComputeRootConstantBufferView(0, mDataBuffer->GetFrameDataGpuAddress(0));
-    CD3DX12_GPU_DESCRIPTOR_HANDLE tableHandle(mHeap->GetGPUDescriptorHandleForHeapStart());
-    ctx.CommandList->SetComputeRootDescriptorTable(1, tableHandle);
-    tableHandle.Offset(ctx.CbvSrvUavDescriptorSize);
-    ctx.CommandList->SetComputeRootDescriptorTable(2, tableHandle);
-
-    ctx.CommandList->Dispatch(static_cast<UINT>(mCubemapData.Resource->Get()->GetDesc().Width / 32), static_cast<UINT>(mCubemapData.Resource->Get()->GetDesc().Height / 32), 6);
-    barriers[0] = mCubemapData.Resource->GetBarrier(D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    barriers[1] = mEnvMapData.Resource->GetBarrier(texState);
-    ctx.CommandList->ResourceBarrier(2U, barriers.data());
-
-    Downsample(ctx);
-    barriers[0] = mCubemapData.Resource->GetBarrier(cubeState);
-    barriers[1] = mDownsampledCubeData.Resource->GetBarrier(D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    ctx.CommandList->ResourceBarrier(2U, barriers.data());
-
-    Convolute(ctx);
+    // The irradiance comes from the SH in the constant buffer, only the target is bound.
+    ctx.CommandList->SetComputeRootConstantBufferView(0, mConvolutionDataBuffer->GetFrameDataGpuAddress(0));
+    ctx.CommandList->SetComputeRootDescriptorTable(1, mHeap->GetGPUDescriptorHandleForHeapStart());
 
-    barriers[0] = mDownsampledCubeData.Resource->GetBarrier(downsampledState);
-    barriers[1] = mIrradianceMapData.Resource->GetBarrier(irrMapState);
-    ctx.CommandList->ResourceBarrier(2U, barriers.data());
-}
+    ctx.StateTracker->Flush(ctx.CommandList);
+    ctx.CommandList->Dispatch(static_cast<UINT>(irradianceMap->Get()->GetDesc().Width / 32), static_cast<UINT>(irradianceMap->Get()->GetDesc().Height / 32), 6);
 
-bool EnvironmentMap::IsConvertedToCubemap() const
-{
-    return mConverted;
+    ctx.StateTracker->Transition(*irradianceMap, irrMapState);
 }
 
 void EnvironmentMap::CreateRootSig(const RenderContext& ctx)
@@ -118,33 +167,15 @@ void EnvironmentMap::CreateRootSig(const RenderContext& ctx)
     params.emplace_back();
     params.back().InitAsConstantBufferView(0, 0);
 
-    D3D12_DESCRIPTOR_RANGE1 envMap{};
-    envMap.NumDescriptors = 1;
-    envMap.BaseShaderRegister = 0;
-    envMap.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-    envMap.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
-    envMap.RegisterSpace = 0;
-    envMap.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-    params.emplace_back();
-    params.back().InitAsDescriptorTable(1, &envMap, D3D12_SHADER_VISIBILITY_ALL);
-
-    D3D12_DESCRIPTOR_RANGE1 cubeMap{};
-    cubeMap.NumDescriptors = 1;
-    cubeMap.BaseShaderRegister = 0;
-    cubeMap.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-    cubeMap.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
-    cubeMap.RegisterSpace = 0;
-    cubeMap.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+    D3D12_DESCRIPTOR_RANGE1 irradianceMap{};
+    irradianceMap.NumDescriptors = 1;
+    irradianceMap.BaseShaderRegister = 0;
+    irradianceMap.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+    irradianceMap.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
+    irradianceMap.RegisterSpace = 0;
+    irradianceMap.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
     params.emplace_back();
-    params.back().InitAsDescriptorTable(1, &cubeMap, D3D12_SHADER_VISIBILITY_ALL);
-
-    CD3DX12_STATIC_SAMPLER_DESC linearClamp(
-        0,
-        D3D12_FILTER_MIN_MAG_MIP_LINEAR,
-        D3D12_TEXTURE_ADDRESS_MODE_WRAP,
-        D3D12_TEXTURE_ADDRESS_MODE_WRAP,
-        D3D12_TEXTURE_ADDRESS_MODE_WRAP);
-    std::array<CD3DX12_STATIC_SAMPLER_DESC, 1> staticSamplers = { linearClamp };
+    params.back().InitAsDescriptorTable(1, &irradianceMap, D3D12_SHADER_VISIBILITY_ALL);
 
     D3D12_FEATURE_DATA_ROOT_SIGNATURE signatureData = {};
     signatureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
@@ -154,7 +185,7 @@ void EnvironmentMap::CreateRootSig(const RenderContext& ctx)
 
     D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
     CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
-    rootSignatureDesc.Init_1_1(static_cast<UINT>(params.size()), params.data(), static_cast<UINT>(staticSamplers.size()), staticSamplers.data(), flags);
+    rootSignatureDesc.Init_1_1(static_cast<UINT>(params.size()), params.data(), 0, nullptr, flags);
 
     Microsoft::WRL::ComPtr<ID3DBlob> signature;
     Microsoft::WRL::ComPtr<ID3DBlob> rootSignatureCreationError;
@@ -168,151 +199,21 @@ void EnvironmentMap::CreateRootSig(const RenderContext& ctx)
 
 void EnvironmentMap::CreateDescriptorHeap(RenderContext& ctx)
 {
-    // 2d eqmap
-    // uav envmap target
-    // srv envmap src
     // irradiance map target
-    // downsampled map src
-    // downsample map dst
-    // envmap map array
     D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
     heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
     heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-    heapDesc.NumDescriptors = 7;
+    heapDesc.NumDescriptors = 1;
     ThrowIfFailed(ctx.Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
     NAME_D3D12_OBJECT(mHeap, L"EnvMap heap");
-    CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart());
-
-    D3D12_SHADER_RESOURCE_VIEW_DESC src{};
-    src.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    src.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-    src.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-    src.Texture2D.MipLevels = 1;
-    src.Texture2D.MostDetailedMip = 0;
-    src.Texture2D.ResourceMinLODClamp = 0.0f;
-    ctx.Device->CreateShaderResourceView(nullptr, &src, handle);
-
-    handle.Offset(static_cast<int>(ctx.CbvSrvUavDescriptorSize));
-
-    D3D12_UNORDERED_ACCESS_VIEW_DESC viewDesc = {};
-    viewDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2DARRAY;
-    viewDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-    ctx.Device->CreateUnorderedAccessView(nullptr, nullptr, &viewDesc, handle);
-
-    handle.Offset(static_cast<int>(ctx.CbvSrvUavDescriptorSize));
-
-    src.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-    ctx.Device->CreateShaderResourceView(nullptr, &src, handle);
-
-    handle.Offset(static_cast<int>(ctx.CbvSrvUavDescriptorSize));
-
-    ctx.Device->CreateUnorderedAccessView(nullptr, nullptr, &viewDesc, handle);
-
-    handle.Offset(static_cast<int>(ctx.CbvSrvUavDescriptorSize));
-
-    ctx.Device->CreateShaderResourceView(nullptr, &src, handle);
-
-    handle.Offset(static_cast<int>(ctx.CbvSrvUavDescriptorSize));
-    ctx.Device->CreateUnorderedAccessView(nullptr, nullptr, &viewDesc, handle);
-
-    handle.Offset(static_cast<int>(ctx.CbvSrvUavDescriptorSize));
-    
-    src.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    src.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-    src.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-    src.Texture2DArray.MipLevels = 1;
-    src.Texture2DArray.MostDetailedMip = 0;
-    src.Texture2DArray.ResourceMinLODClamp = 0.0f;
-    src.Texture2DArray.ArraySize = 6;
-    ctx.Device->CreateShaderResourceView(nullptr, &src, handle);
 }
 
 void EnvironmentMap::CreateViews(RenderContext& ctx) const
 {
-    CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart());
-
-    D3D12_RESOURCE_DESC envRDesc = mEnvMapData.Resource->Get()->GetDesc();
-    D3D12_SHADER_RESOURCE_VIEW_DESC envRtvD{};
-    envRtvD.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    envRtvD.Format = envRDesc.Format;
-    envRtvD.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-    envRtvD.Texture2D.MipLevels = envRDesc.MipLevels;
-    envRtvD.Texture2D.MostDetailedMip = 0;
-    envRtvD.Texture2D.ResourceMinLODClamp = 0.0f;
-    ctx.Device->CreateShaderResourceView(mEnvMapData.Resource->Get(), &envRtvD, handle);
-    handle.Offset(ctx.CbvSrvUavDescriptorSize);
-
     D3D12_UNORDERED_ACCESS_VIEW_DESC viewDesc = {};
     viewDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2DARRAY;
     viewDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
     viewDesc.Texture2DArray.ArraySize = 6;
-
-    ctx.Device->CreateUnorderedAccessView(mCubemapData.Resource->Get(), nullptr, &viewDesc, handle);
-    handle.Offset(ctx.CbvSrvUavDescriptorSize);
-
-    D3D12_RESOURCE_DESC envCubeRDesc = mCubemapData.Resource->Get()->GetDesc();
-    D3D12_SHADER_RESOURCE_VIEW_DESC envCubeRView{};
-    envCubeRView.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    envCubeRView.Format = envCubeRDesc.Format;
-    envCubeRView.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-    envCubeRView.TextureCube.MipLevels = envCubeRDesc.MipLevels;
-    envCubeRView.TextureCube.MostDetailedMip = 0;
-    envCubeRView.TextureCube.ResourceMinLODClamp = 0.0f;
-    ctx.Device->CreateShaderResourceView(mCubemapData.Resource->Get(), &envCubeRView, handle);
-    handle.Offset(ctx.CbvSrvUavDescriptorSize);
-
-    ctx.Device->CreateUnorderedAccessView(mIrradianceMapData.Resource->Get(), nullptr, &viewDesc, handle);
-    handle.Offset(ctx.CbvSrvUavDescriptorSize);
-
-    envCubeRDesc = mDownsampledCubeData.Resource->Get()->GetDesc();
-    envCubeRView.Format = envCubeRDesc.Format;
-    envCubeRView.TextureCube.MipLevels = envCubeRDesc.MipLevels;
-    ctx.Device->CreateShaderResourceView(mDownsampledCubeData.Resource->Get(), &envCubeRView, handle);
-    handle.Offset(ctx.CbvSrvUavDescriptorSize);
-
-    ctx.Device->CreateUnorderedAccessView(mDownsampledCubeData.Resource->Get(), nullptr, &viewDesc, handle);
-
-    handle.Offset(ctx.CbvSrvUavDescriptorSize);
-    D3D12_SHADER_RESOURCE_VIEW_DESC cubeArrayView{};
-    cubeArrayView.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    cubeArrayView.Format = envCubeRDesc.Format;
-    cubeArrayView.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-    cubeArrayView.Texture2DArray.MipLevels = 1;
-    cubeArrayView.Texture2DArray.MostDetailedMip = 0;
-    cubeArrayView.Texture2DArray.ResourceMinLODClamp = 0.0f;
-    cubeArrayView.Texture2DArray.ArraySize = 6;
-    ctx.Device->CreateShaderResourceView(mCubemapData.Resource->Get(), &cubeArrayView, handle);
-};
-
-void EnvironmentMap::Convolute(RenderContext& ctx) const
-{
-    GPU_SCOPED_EVENT(ctx, "Convolution");
-
-    ctx.CommandList->SetPipelineState(ctx.PsoManager->GetPso(mConvolutionPsoName));
-    ctx.CommandList->SetComputeRootConstantBufferView(0, mConvolutionDataBuffer->GetFrameDataGpuAddress(0));
-    CD3DX12_GPU_DESCRIPTOR_HANDLE tableHandle(mHeap->GetGPUDescriptorHandleForHeapStart());
-    tableHandle.Offset(ctx.CbvSrvUavDescriptorSize * 4);
-    ctx.CommandList->SetComputeRootDescriptorTable(1, tableHandle);
-    tableHandle = mHeap->GetGPUDescriptorHandleForHeapStart();
-    tableHandle.Offset(ctx.CbvSrvUavDescriptorSize * 3);
-    ctx.CommandList->SetComputeRootDescriptorTable(2, tableHandle);
-
-    ctx.CommandList->Dispatch(static_cast<UINT>(mIrradianceMapData.Resource->Get()->GetDesc().Width / 32), static_cast<UINT>(mIrradianceMapData.Resource->Get()->GetDesc().Height / 32), 6);
-}
-
-void EnvironmentMap::Downsample(RenderContext& ctx) const
-{
-    GPU_SCOPED_EVENT(ctx, "Downsample_Cubemap");
-    ctx.CommandList->SetPipelineState(ctx.PsoManager->GetPso(mDownsamplePsoName));
-    ctx.CommandList->SetComputeRootConstantBufferView(0, mDownsampleDataBuffer->GetFrameDataGpuAddress(0));
-    CD3DX12_GPU_DESCRIPTOR_HANDLE tableHandle(mHeap->GetGPUDescriptorHandleForHeapStart());
-    tableHandle.Offset(ctx.CbvSrvUavDescriptorSize * 6);
-    ctx.CommandList->SetComputeRootDescriptorTable(1, tableHandle);
-
-    CD3DX12_GPU_DESCRIPTOR_HANDLE tableHandle2(mHeap->GetGPUDescriptorHandleForHeapStart());
-    tableHandle2.Offset(ctx.CbvSrvUavDescriptorSize * 5);
-    ctx.CommandList->SetComputeRootDescriptorTable(2, tableHandle2);
-
-    ctx.CommandList->Dispatch(static_cast<UINT>(mDownsampledCubeData.Resource->Get()->GetDesc().Width / 32), static_cast<UINT>(mDownsampledCubeData.Resource->Get()->GetDesc().Height / 32), 6);
+    ctx.Device->CreateUnorderedAccessView(ctx.TexManager->GetResource(mIrradianceMapData.Resource), nullptr, &viewDesc, mHeap->GetCPUDescriptorHandleForHeapStart());
 }
 }
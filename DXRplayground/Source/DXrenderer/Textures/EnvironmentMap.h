@@ -3,10 +3,12 @@
 #include "DXrenderer/DXhelpers.h"
 #include "External/Dx12Helpers/d3dx12.h"
 
+#include "DXrenderer/Textures/SphericalHarmonics.h"
 #include "DXrenderer/Textures/TextureManager.h"
 
 namespace DirectxPlayground
 {
+class HeapBuffer;
 class UnorderedAccessBuffer;
 class UploadBuffer;
 
@@ -14,59 +16,67 @@ struct EnvironmentData
 {
     UINT CubemapIndex;
     UINT IrradianceMapIndex;
+    UINT SpecularMapIndex;
+    UINT SpecularMipsCount;
+    UINT BrdfLutIndex;
     UINT Pad0;
     UINT Pad1;
+    UINT Pad2;
 };
 
 class EnvironmentMap
 {
 public:
-    EnvironmentMap(RenderContext& ctx, const std::string& path, UINT cubemapSize, UINT irradianceMapSize);
+    // The cubemap, the specular map and the sampling tables are cooked from the equirect HDR on the first run and loaded from the cache
+    // afterwards, the HDR is decoded once for all of them.
+    // compressCubemap - BC6H faces instead of half floats, a quarter of the memory.
+    EnvironmentMap(RenderContext& ctx, const std::string& path, UINT irradianceMapSize, bool compressCubemap = false);
     ~EnvironmentMap();
 
-    void ConvertToCubemap(RenderContext& ctx);
-    bool IsConvertedToCubemap() const;
+    // Records the irradiance map evaluation from SH, doesn't wait for the GPU.
+    void BakeIrradianceMap(RenderContext& ctx);
 
     UINT GetCubemapIndex() const;
     UINT GetIrradianceMapIndex() const;
+    // GGX prefiltered radiance, mip i is convolved with roughness i / (GetSpecularMipsCount() - 1).
+    UINT GetSpecularMapIndex() const;
+    UINT GetSpecularMipsCount() const;
+    // In the textures range of the heap, see TextureManager::GetBrdfLut.
+    UINT GetBrdfLutIndex() const;
+    // Already convolved with the cosine lobe, see SphericalHarmonics::ConvolveIrradiance.
+    const SphericalHarmonics::SH9& GetIrradianceSH() const;
+    // Importance sampling tables of the environment for StructuredBuffer<float>, see EnvironmentSampling.hlsl.
+    D3D12_GPU_VIRTUAL_ADDRESS GetSamplingTablesAddress() const;
+    UINT GetSamplingTablesWidth() const;
+    UINT GetSamplingTablesHeight() const;
 
 private:
-    static constexpr UINT DownsampledCubeSize = 64;
     struct
     {
-        DirectX::XMFLOAT4 EqMapCubeMapWH{};
-    } mGraphicsData {};
-    struct
-    {
-        DirectX::XMFLOAT2 size;
+        SphericalHarmonics::SH9 IrradianceSH;
+        float Size;
     } mConvolutionData {};
-    struct
-    {
-        UINT iterCount;
-    } mDownsampleData {};
 
     void CreateRootSig(const RenderContext& ctx);
     void CreateDescriptorHeap(RenderContext& ctx);
     void CreateViews(RenderContext& ctx) const;
-    void Convolute(RenderContext& ctx) const;
-    void Downsample(RenderContext& ctx) const;
 
     TexResourceData mCubemapData;
-    TexResourceData mEnvMapData;
     TexResourceData mIrradianceMapData;
-    TexResourceData mDownsampledCubeData;
+    TexResourceData mSpecularMapData;
+    TexResourceData mBrdfLutData;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> mRootSig;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
-    UploadBuffer* mDataBuffer = nullptr;
     UploadBuffer* mConvolutionDataBuffer = nullptr;
-    UploadBuffer* mDownsampleDataBuffer = nullptr;
-    const std::string mPsoName = "CubemapConvertor_PBR";
+    HeapBuffer* mSamplingTables = nullptr;
+    TextureManager* mTextureManager = nullptr; // Releases the cubemap and the specular map.
+    UINT mSamplingTablesWidth = 0;
+    UINT mSamplingTablesHeight = 0;
     const std::string mConvolutionPsoName = "CubemapConvolution_PBR";
-    const std::string mDownsamplePsoName = "CubemapDownsample_PBR";
 
-    bool mConverted = false;
-    UINT mCubemapSize = 0;
     UINT mIrradianceMapSize = 0;
+    UINT mSpecularMipsCount = 0;
+    SphericalHarmonics::SH9 mIrradianceSH;
 };
 
 inline UINT EnvironmentMap::GetIrradianceMapIndex() const
@@ -79,4 +89,34 @@ inline UINT EnvironmentMap::GetCubemapIndex() const
     return mCubemapData.SRVOffset;
 }
 
+inline UINT EnvironmentMap::GetSpecularMapIndex() const
+{
+    return mSpecularMapData.SRVOffset;
+}
+
+inline UINT EnvironmentMap::GetSpecularMipsCount() const
+{
+    return mSpecularMipsCount;
+}
+
+inline UINT EnvironmentMap::GetBrdfLutIndex() const
+{
+    return mBrdfLutData.SRVOffset;
+}
+
+inline const SphericalHarmonics::SH9& EnvironmentMap::GetIrradianceSH() const
+{
+    return mIrradianceSH;
+}
+
+inline UINT EnvironmentMap::GetSamplingTablesWidth() const
+{
+    return mSamplingTablesWidth;
+}
+
+inline UINT EnvironmentMap::GetSamplingTablesHeight() const
+{
+    return mSamplingTablesHeight;
+}
+
 }
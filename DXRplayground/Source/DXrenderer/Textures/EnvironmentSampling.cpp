@@ -0,0 +1,147 @@
+#include "DXrenderer/Textures/EnvironmentSampling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "DXrenderer/Textures/MipChain.h"
+#include "DXrenderer/Textures/SamplingHelpers.h"
+#include "DXrenderer/Textures/Texture.h"
+#include "Utils/BinaryContainer.h"
+#include "Utils/ParallelFor.h"
+
+namespace DirectxPlayground
+{
+namespace
+{
+// Index of the first entry greater than xi, the last entry is 1 and xi is below it.
+UINT FindInterval(const float* cdf, UINT count, float xi)
+{
+    return std::min(UINT(std::upper_bound(cdf, cdf + count, xi) - cdf), count - 1);
+}
+
+// Remaps xi to [0, 1) within the picked interval, so the point inside the texel is continuous in xi.
+float GetIntervalOffset(const float* cdf, UINT index, float xi)
+{
+    float begin = index == 0 ? 0.0f : cdf[index - 1];
+    float size = cdf[index] - begin;
+    return size > 0.0f ? std::min((xi - begin) / size, 0.99999994f) : 0.5f;
+}
+}
+
+void EnvironmentSampling::Parse(const std::string& filename)
+{
+    Texture image(TextureUsage::Raw);
+    image.Parse(filename);
+    CookFrom(image);
+}
+
+void EnvironmentSampling::CookFrom(const Texture& source)
+{
+    assert(source.GetFormat() == DXGI_FORMAT_R32G32B32A32_FLOAT && "Sampling tables are built for HDR images only");
+
+    const float* level = reinterpret_cast<const float*>(source.GetData().data());
+    UINT width = source.GetWidth();
+    UINT height = source.GetHeight();
+    std::vector<byte> chain;
+    if (width > MaxWidth)
+    {
+        chain = MipChain::Generate(level, width, height);
+        level = reinterpret_cast<const float*>(chain.data());
+        for (; width > MaxWidth; width = std::max(1U, width / 2), height = std::max(1U, height / 2))
+            level += size_t(width) * height * 4;
+    }
+    Build(level, width, height);
+}
+
+void EnvironmentSampling::Build(const float* rgba, UINT width, UINT height)
+{
+    mWidth = width;
+    mHeight = height;
+    mTables.assign(size_t(height) + size_t(width) * height * 2, 0.0f);
+    float* marginal = mTables.data();
+    float* conditional = marginal + height;
+    float* pdf = conditional + size_t(width) * height;
+
+    // The luminance goes to the pdf first, it is normalized once the total is known.
+    std::vector<float> rowSums(height);
+    ParallelFor(height, [&](size_t y)
+    {
+        float sinTheta = std::sin(Pi * (y + 0.5f) / height);
+        const float* texel = rgba + y * width * 4;
+        float* rowCdf = conditional + y * width;
+        float* rowPdf = pdf + y * width;
+        double sum = 0.0;
+        for (UINT x = 0; x < width; ++x, texel += 4)
+        {
+            rowPdf[x] = std::max(0.0f, 0.2126f * texel[0] + 0.7152f * texel[1] + 0.0722f * texel[2]) * sinTheta;
+            sum += rowPdf[x];
+            rowCdf[x] = float(sum);
+        }
+        for (UINT x = 0; x < width; ++x)
+            rowCdf[x] = sum > 0.0 ? float(rowCdf[x] / sum) : float(x + 1) / width;
+        rowCdf[width - 1] = 1.0f;
+        rowSums[y] = float(sum);
+    });
+
+    double total = 0.0;
+    for (UINT y = 0; y < height; ++y)
+    {
+        total += rowSums[y];
+        marginal[y] = float(total);
+    }
+    for (UINT y = 0; y < height; ++y)
+        marginal[y] = total > 0.0 ? float(marginal[y] / total) : float(y + 1) / height;
+    marginal[height - 1] = 1.0f;
+
+    const float pdfScale = total > 0.0 ? float(double(width) * height / total) : 0.0f;
+    ParallelFor(height, [&](size_t y)
+    {
+        float* rowPdf = pdf + y * width;
+        for (UINT x = 0; x < width; ++x)
+            rowPdf[x] = total > 0.0 ? rowPdf[x] * pdfScale : 1.0f;
+    });
+}
+
+void EnvironmentSampling::Sample(float xi0, float xi1, float& u, float& v, float& pdf) const
+{
+    UINT y = FindInterval(GetMarginalCdf(), mHeight, xi0);
+    const float* rowCdf = GetConditionalCdf(y);
+    UINT x = FindInterval(rowCdf, mWidth, xi1);
+    u = (x + GetIntervalOffset(rowCdf, x, xi1)) / mWidth;
+    v = (y + GetIntervalOffset(GetMarginalCdf(), y, xi0)) / mHeight;
+    pdf = GetTexelsPdf()[size_t(y) * mWidth + x];
+}
+
+float EnvironmentSampling::GetPdf(float u, float v) const
+{
+    UINT x = std::min(UINT(std::max(u, 0.0f) * mWidth), mWidth - 1);
+    UINT y = std::min(UINT(std::max(v, 0.0f) * mHeight), mHeight - 1);
+    return GetTexelsPdf()[size_t(y) * mWidth + x];
+}
+
+const float* EnvironmentSampling::GetMarginalCdf() const
+{
+    return mTables.data();
+}
+
+const float* EnvironmentSampling::GetConditionalCdf(UINT row) const
+{
+    return mTables.data() + mHeight + size_t(row) * mWidth;
+}
+
+const float* EnvironmentSampling::GetTexelsPdf() const
+{
+    return mTables.data() + mHeight + size_t(mWidth) * mHeight;
+}
+
+void EnvironmentSampling::Serialize(BinaryContainer& container)
+{
+    container << mWidth << mHeight << mTables;
+}
+
+void EnvironmentSampling::Deserialize(BinaryContainer& container)
+{
+    container >> mWidth >> mHeight >> mTables;
+}
+}
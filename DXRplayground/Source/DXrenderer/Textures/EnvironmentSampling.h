@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Utils/Asset.h"
+
+#include <vector>
+#include <dxgi1_6.h>
+
+namespace DirectxPlayground
+{
+class Texture;
+
+// Importance sampling tables of an equirect environment for ray traced lighting, texels are picked proportionally to their luminance
+// times the solid angle. A row is picked with the marginal CDF and a texel with the conditional CDF of the row, the point is uniform
+// within the texel. Coordinates are the same as CubemapConverter::GetEquirectCoords, GetPdf(u, v) / (2 * pi^2 * sin(pi * v))
+// is the pdf over the solid angle. EnvironmentSampling.hlsl does the same on the GPU.
+class EnvironmentSampling : public Asset
+{
+public:
+    // Decodes the HDR image and builds the tables from a level no wider than MaxWidth.
+    void Parse(const std::string& filename) override;
+    // The same from the HDR image which is already decoded.
+    void CookFrom(const Texture& source);
+    void Serialize(BinaryContainer& container) override;
+    void Deserialize(BinaryContainer& container) override;
+    size_t GetVersion() const override
+    {
+        return AssetSerializationVersion;
+    }
+    std::string GetCookedNameSuffix() const override
+    {
+        return ".sampling";
+    }
+
+    // rgba - RGBA32F texels, rows are built in parallel.
+    void Build(const float* rgba, UINT width, UINT height);
+
+    // xi0 and xi1 are uniform in [0, 1), returns the equirect coordinates and their pdf over [0, 1]^2.
+    void Sample(float xi0, float xi1, float& u, float& v, float& pdf) const;
+    float GetPdf(float u, float v) const;
+
+    UINT GetWidth() const
+    {
+        return mWidth;
+    }
+
+    UINT GetHeight() const
+    {
+        return mHeight;
+    }
+
+    // The marginal CDF (height entries), the conditional CDFs (height rows of width entries) and the pdf of every texel, one after another.
+    // Every CDF entry is the inclusive sum, the last one of each CDF is 1.
+    const std::vector<float>& GetTables() const
+    {
+        return mTables;
+    }
+
+    static constexpr UINT MaxWidth = 1024;
+private:
+    inline static constexpr size_t AssetSerializationVersion = 1;
+
+    const float* GetMarginalCdf() const;
+    const float* GetConditionalCdf(UINT row) const;
+    const float* GetTexelsPdf() const;
+
+    std::vector<float> mTables;
+    UINT mWidth = 0;
+    UINT mHeight = 0;
+};
+}
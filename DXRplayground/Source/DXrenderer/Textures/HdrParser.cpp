@@ -0,0 +1,204 @@
+#include "DXrenderer/Textures/HdrParser.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <immintrin.h>
+#include <string>
+
+#include "Utils/Logger.h"
+#include "Utils/ParallelFor.h"
+
+namespace DirectxPlayground::HdrParser
+{
+namespace
+{
+constexpr UINT RowsPerTask = 16;
+constexpr UINT MinRleWidth = 8;
+constexpr UINT MaxRleWidth = 0x7FFF;
+
+bool ReadLine(const byte* data, size_t size, size_t& offset, std::string& line)
+{
+    const byte* end = static_cast<const byte*>(memchr(data + offset, '\n', size - offset));
+    if (end == nullptr)
+        return false;
+    line.assign(reinterpret_cast<const char*>(data + offset), end - (data + offset));
+    offset = end - data + 1;
+    return true;
+}
+
+bool ParseHeader(const byte* data, size_t size, size_t& offset, UINT& width, UINT& height)
+{
+    std::string line;
+    if (!ReadLine(data, size, offset, line) || (line != "#?RADIANCE" && line != "#?RGBE"))
+    {
+        LOG("HDR parsing error: invalid signature");
+        return false;
+    }
+    // Variables go line by line until an empty one, only the pixel format matters.
+    while (true)
+    {
+        if (!ReadLine(data, size, offset, line))
+        {
+            LOG("HDR parsing error: the header is truncated");
+            return false;
+        }
+        if (line.empty())
+            break;
+        if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe")
+        {
+            LOG("HDR parsing error: unsupported format ", line);
+            return false;
+        }
+    }
+
+    int h = 0;
+    int w = 0;
+    if (!ReadLine(data, size, offset, line) || sscanf(line.c_str(), "-Y %d +X %d", &h, &w) != 2 || w <= 0 || h <= 0)
+    {
+        LOG("HDR parsing error: unsupported resolution line");
+        return false;
+    }
+    width = static_cast<UINT>(w);
+    height = static_cast<UINT>(h);
+    return true;
+}
+
+// Every scanline starts with 2, 2 and the width, then the four channels go one after another, each as a sequence of runs and literals.
+bool IsRleScanline(const byte* data, size_t size, size_t offset, UINT width)
+{
+    if (width < MinRleWidth || width > MaxRleWidth || offset + 4 > size)
+        return false;
+    const byte* p = data + offset;
+    return p[0] == 2 && p[1] == 2 && (p[2] & 0x80) == 0 && ((UINT(p[2]) << 8) | p[3]) == width;
+}
+
+// The scanline sizes are only known after walking the runs, which is cheap compared to decoding, so it is done upfront to decode rows in parallel.
+bool FindRleScanlines(const byte* data, size_t size, size_t offset, UINT width, UINT height, std::vector<size_t>& scanlines)
+{
+    scanlines.resize(height);
+    for (UINT y = 0; y < height; ++y)
+    {
+        if (!IsRleScanline(data, size, offset, width))
+        {
+            LOG("HDR parsing error: invalid scanline ", y);
+            return false;
+        }
+        scanlines[y] = offset;
+        offset += 4;
+        for (UINT channel = 0; channel < 4; ++channel)
+        {
+            for (UINT x = 0; x < width;)
+            {
+                if (offset >= size)
+                {
+                    LOG("HDR parsing error: the data is truncated");
+                    return false;
+                }
+                UINT count = data[offset++];
+                bool isRun = count > 128;
+                count = isRun ? count - 128 : count;
+                offset += isRun ? 1 : count;
+                x += count;
+                if (count == 0 || x > width || offset > size)
+                {
+                    LOG("HDR parsing error: invalid run in scanline ", y);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void DecodeRleScanline(const byte* src, UINT width, byte* rgbe)
+{
+    src += 4;
+    for (UINT channel = 0; channel < 4; ++channel)
+    {
+        for (UINT x = 0; x < width;)
+        {
+            UINT count = *src++;
+            if (count > 128)
+            {
+                count -= 128;
+                byte value = *src++;
+                for (UINT i = 0; i < count; ++i)
+                    rgbe[(x + i) * 4 + channel] = value;
+            }
+            else
+            {
+                for (UINT i = 0; i < count; ++i)
+                    rgbe[(x + i) * 4 + channel] = *src++;
+            }
+            x += count;
+        }
+    }
+}
+
+// The mantissas are widened to a float4 at once, the shared exponent comes from a table and alpha is set with a blend.
+void ConvertScanline(const byte* rgbe, UINT width, float* dst)
+{
+    static const std::array<float, 256> exponents = []()
+    {
+        std::array<float, 256> res;
+        res[0] = 0.0f;
+        for (int i = 1; i < 256; ++i)
+            res[i] = std::ldexp(1.0f, i - (128 + 8));
+        return res;
+    }();
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (UINT x = 0; x < width; ++x)
+    {
+        int texel = 0;
+        memcpy(&texel, rgbe + x * 4, sizeof(texel));
+        __m128 color = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(texel)));
+        color = _mm_mul_ps(color, _mm_set1_ps(exponents[rgbe[x * 4 + 3]]));
+        _mm_storeu_ps(dst + size_t(x) * 4, _mm_blend_ps(color, one, 0x8));
+    }
+}
+}
+
+bool Parse(const byte* data, size_t size, std::vector<byte>& rgba, UINT& width, UINT& height)
+{
+    size_t offset = 0;
+    if (!ParseHeader(data, size, offset, width, height))
+        return false;
+
+    // The same as the other decoders, the format is decided by the first scanline and the flat files have no RLE scanlines at all.
+    bool isRle = IsRleScanline(data, size, offset, width);
+    std::vector<size_t> scanlines;
+    if (isRle)
+    {
+        if (!FindRleScanlines(data, size, offset, width, height, scanlines))
+            return false;
+    }
+    else if (offset + size_t(width) * height * 4 > size)
+    {
+        LOG("HDR parsing error: the data is truncated");
+        return false;
+    }
+
+    rgba.resize(size_t(width) * height * sizeof(float) * 4);
+    float* dst = reinterpret_cast<float*>(rgba.data());
+    ParallelFor((height + RowsPerTask - 1) / RowsPerTask, [&](size_t task)
+    {
+        std::vector<byte> rgbe(isRle ? size_t(width) * 4 : 0);
+        UINT end = std::min(height, UINT(task + 1) * RowsPerTask);
+        for (UINT y = UINT(task) * RowsPerTask; y < end; ++y)
+        {
+            const byte* row = data + offset + size_t(y) * width * 4;
+            if (isRle)
+            {
+                DecodeRleScanline(data + scanlines[y], width, rgbe.data());
+                row = rgbe.data();
+            }
+            ConvertScanline(row, width, dst + size_t(y) * width * 4);
+        }
+    });
+    return true;
+}
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+#include <dxgi1_6.h>
+
+namespace DirectxPlayground::HdrParser
+{
+// Decodes Radiance RGBE files, both the flat and the run length encoded scanlines, to RGBA32 floats with alpha set to 1.
+// Only the standard "-Y height +X width" orientation is supported. Scanlines are decoded in parallel row blocks.
+bool Parse(const byte* data, size_t size, std::vector<byte>& rgba, UINT& width, UINT& height);
+}
@@ -0,0 +1,169 @@
+#include "DXrenderer/Textures/MipChain.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+#include "Utils/ParallelFor.h"
+
+namespace DirectxPlayground::MipChain
+{
+namespace
+{
+struct FilterTaps
+{
+    UINT First = 0;
+    UINT Count = 0;
+    float Weights[3] = {};
+};
+
+// For an odd source size 2n + 1 every destination texel x covers 2 + 1/(2n + 1) source texels,
+// which gives the weights (n - x, n, x + 1) / (2n + 1).
+std::vector<FilterTaps> BuildTaps(UINT srcSize, UINT dstSize)
+{
+    std::vector<FilterTaps> taps(dstSize);
+    for (UINT x = 0; x < dstSize; ++x)
+    {
+        FilterTaps& t = taps[x];
+        if (srcSize == 1)
+        {
+            t.First = 0;
+            t.Count = 1;
+            t.Weights[0] = 1.0f;
+        }
+        else if (srcSize % 2 == 0)
+        {
+            t.First = x * 2;
+            t.Count = 2;
+            t.Weights[0] = 0.5f;
+            t.Weights[1] = 0.5f;
+        }
+        else
+        {
+            float norm = 1.0f / (2 * dstSize + 1);
+            t.First = x * 2;
+            t.Count = 3;
+            t.Weights[0] = (dstSize - x) * norm;
+            t.Weights[1] = dstSize * norm;
+            t.Weights[2] = (x + 1) * norm;
+        }
+    }
+    return taps;
+}
+
+void Downsample(const float* src, UINT srcWidth, UINT srcHeight, float* dst, UINT dstWidth, UINT dstHeight)
+{
+    std::vector<FilterTaps> tapsX = BuildTaps(srcWidth, dstWidth);
+    std::vector<FilterTaps> tapsY = BuildTaps(srcHeight, dstHeight);
+    ParallelFor(dstHeight, [&](size_t y)
+    {
+        const FilterTaps& ty = tapsY[y];
+        for (UINT x = 0; x < dstWidth; ++x)
+        {
+            const FilterTaps& tx = tapsX[x];
+            __m128 sum = _mm_setzero_ps();
+            for (UINT j = 0; j < ty.Count; ++j)
+            {
+                const float* row = src + size_t(ty.First + j) * srcWidth * 4;
+                __m128 rowSum = _mm_setzero_ps();
+                for (UINT i = 0; i < tx.Count; ++i)
+                    rowSum = _mm_add_ps(rowSum, _mm_mul_ps(_mm_loadu_ps(row + size_t(tx.First + i) * 4), _mm_set1_ps(tx.Weights[i])));
+                sum = _mm_add_ps(sum, _mm_mul_ps(rowSum, _mm_set1_ps(ty.Weights[j])));
+            }
+            _mm_storeu_ps(dst + (y * dstWidth + x) * 4, sum);
+        }
+    });
+}
+
+size_t GetChainTexelsCount(UINT width, UINT height)
+{
+    size_t res = 0;
+    for (UINT mip = 0; mip < GetMipsCount(width, height); ++mip)
+        res += size_t(std::max(1U, width >> mip)) * std::max(1U, height >> mip);
+    return res;
+}
+
+// Level 0 is expected to be already in chain.
+void GenerateLevels(float* chain, UINT width, UINT height)
+{
+    float* src = chain;
+    for (UINT mip = 1; mip < GetMipsCount(width, height); ++mip)
+    {
+        UINT srcWidth = std::max(1U, width >> (mip - 1));
+        UINT srcHeight = std::max(1U, height >> (mip - 1));
+        UINT dstWidth = std::max(1U, width >> mip);
+        UINT dstHeight = std::max(1U, height >> mip);
+        float* dst = src + size_t(srcWidth) * srcHeight * 4;
+        Downsample(src, srcWidth, srcHeight, dst, dstWidth, dstHeight);
+        src = dst;
+    }
+}
+
+float SrgbToLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSrgb(float c)
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+}
+
+UINT GetMipsCount(UINT width, UINT height)
+{
+    UINT count = 1;
+    while ((std::max(width, height) >> count) > 0)
+        ++count;
+    return count;
+}
+
+std::vector<byte> Generate(const byte* rgba, UINT width, UINT height, bool srgb)
+{
+    static const std::array<float, 256> srgbToLinear = []()
+    {
+        std::array<float, 256> res;
+        for (UINT i = 0; i < 256; ++i)
+            res[i] = SrgbToLinear(i / 255.0f);
+        return res;
+    }();
+
+    const size_t levelTexels = size_t(width) * height;
+    const size_t chainTexels = GetChainTexelsCount(width, height);
+
+    std::vector<float> chain(chainTexels * 4);
+    for (size_t i = 0; i < levelTexels * 4; ++i)
+        chain[i] = (srgb && i % 4 != 3) ? srgbToLinear[rgba[i]] : rgba[i] / 255.0f;
+    GenerateLevels(chain.data(), width, height);
+
+    std::vector<byte> res(chainTexels * 4);
+    memcpy(res.data(), rgba, levelTexels * 4);
+    constexpr size_t TexelsPerTask = 4096;
+    const size_t mipTexels = chainTexels - levelTexels;
+    ParallelFor((mipTexels + TexelsPerTask - 1) / TexelsPerTask, [&](size_t task)
+    {
+        size_t begin = task * TexelsPerTask * 4;
+        size_t end = std::min(mipTexels, (task + 1) * TexelsPerTask) * 4;
+        for (size_t i = begin; i < end; ++i)
+        {
+            size_t offset = levelTexels * 4 + i;
+            float value = std::clamp(chain[offset], 0.0f, 1.0f);
+            if (srgb && i % 4 != 3)
+                value = LinearToSrgb(value);
+            res[offset] = static_cast<byte>(value * 255.0f + 0.5f);
+        }
+    });
+    return res;
+}
+
+std::vector<byte> Generate(const float* rgba, UINT width, UINT height)
+{
+    std::vector<byte> res(GetChainTexelsCount(width, height) * sizeof(float) * 4);
+    float* chain = reinterpret_cast<float*>(res.data());
+    memcpy(chain, rgba, size_t(width) * height * sizeof(float) * 4);
+    GenerateLevels(chain, width, height);
+    return res;
+}
+}
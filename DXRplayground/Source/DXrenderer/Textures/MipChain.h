@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+#include <dxgi1_6.h>
+
+namespace DirectxPlayground::MipChain
+{
+// Number of levels in the full chain down to 1x1.
+UINT GetMipsCount(UINT width, UINT height);
+
+// Both functions return the whole chain, level 0 included, with levels tightly packed one after another.
+// Levels are filtered with a box filter which uses three taps per axis for odd sizes, so every source texel keeps its weight.
+// sRGB data is filtered in linear space, alpha is always linear.
+std::vector<byte> Generate(const byte* rgba, UINT width, UINT height, bool srgb);
+std::vector<byte> Generate(const float* rgba, UINT width, UINT height);
+}
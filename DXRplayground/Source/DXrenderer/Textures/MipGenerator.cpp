@@ -13,6 +13,7 @@ namespace DirectxPlayground
 {
 // [a_vorontcov] TODO: create pairing UAV resource, no need for ALLOW_UAV flag for every texture. Also too many descs and buffers.
 MipGenerator::MipGenerator(RenderContext& ctx)
+    : mViews(0, RenderContext::MaxUAVTextures, 1)
 {
     CreateUavHeap(ctx);
 
@@ -56,12 +57,8 @@ void MipGenerator::Flush(RenderContext& ctx)
     ctx.CommandList->SetDescriptorHeaps(1, descHeaps);
     ctx.CommandList->SetComputeRootDescriptorTable(UAVTableIndex, mUavHeap->GetGPUDescriptorHandleForHeapStart());
 
-    std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
-    barriers.reserve(mResourcesPtrs.size());
-    for (size_t i = 0; i < mResourcesPtrs.size(); ++i)
-        barriers.push_back(mResourcesPtrs[i]->GetBarrier(D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
-    ctx.CommandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
-    barriers.clear();
+    for (ResourceDX* resource : mResourcesPtrs)
+        ctx.StateTracker->Transition(*resource, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
     UINT currTexInd = 0;
     ID3D12Resource* currTex = mResourcesPtrs[currTexInd++]->Get();
@@ -69,9 +66,9 @@ void MipGenerator::Flush(RenderContext& ctx)
     for (UINT i = 0; i < mQueuedMipsToGenerateNumber; ++i)
     {
         ctx.CommandList->SetComputeRootConstantBufferView(GetCBRootParamIndex(0), mConstantBuffers->GetFrameDataGpuAddress(i));
+        ctx.StateTracker->Flush(ctx.CommandList);
         ctx.CommandList->Dispatch(DISPATCH_TG_COUNT_2D(mQueuedMips[i].Width, 32, mQueuedMips[i].Height, 32));
-        auto uav = CD3DX12_RESOURCE_BARRIER::UAV(currTex);
-        ctx.CommandList->ResourceBarrier(1, &uav);
+        ctx.StateTracker->UavBarrier(currTex);
 
         --dispatchesLeft;
         if (dispatchesLeft == 0 && i < mQueuedMipsToGenerateNumber - 1)
@@ -80,15 +77,22 @@ void MipGenerator::Flush(RenderContext& ctx)
             dispatchesLeft = currTex->GetDesc().MipLevels - 1;
         }
     }
-    for (size_t i = 0; i < mResourcesPtrs.size(); ++i)
-        barriers.push_back(mResourcesPtrs[i]->GetBarrier(D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-    ctx.CommandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+    for (ResourceDX* resource : mResourcesPtrs)
+        ctx.StateTracker->Transition(*resource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
     mQueuedMipsToGenerateNumber = 0;
-    mCurrViewsCount = 0;
     mQueuedMips.clear();
     mResourcesPtrs.clear();
-    ctx.Pipeline->Flush();
+    // The constants are reused by the next batch, the views only after BeginFrame.
+    mViewsFenceValue = ctx.Pipeline->GetPendingFenceValue();
+    ctx.Pipeline->ExecuteAndFlushCmdList(&ctx);
+}
+
+void MipGenerator::BeginFrame(UINT64 completedFenceValue)
+{
+    // The mips queued since the last flush already have their views.
+    if (mQueuedMipsToGenerateNumber == 0 && completedFenceValue >= mViewsFenceValue)
+        mViews.BeginFrame(0);
 }
 
 void MipGenerator::CreateUavHeap(RenderContext& ctx)
@@ -122,10 +126,11 @@ void MipGenerator::CreatePso(RenderContext& ctx) const
 
 UINT MipGenerator::CreateMipViews(RenderContext& ctx, ResourceDX* resource)
 {
-    UINT baseOffset = mCurrViewsCount;
     UINT mipsCount = resource->Get()->GetDesc().MipLevels;
+    UINT baseOffset = mViews.AllocateTransient(mipsCount);
+    assert(baseOffset != DescriptorAllocator::InvalidIndex && "Out of mip views, they are reset once the generated mips are finished");
     CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mUavHeap->GetCPUDescriptorHandleForHeapStart());
-    handle.Offset(ctx.CbvSrvUavDescriptorSize * mCurrViewsCount);
+    handle.Offset(ctx.CbvSrvUavDescriptorSize * baseOffset);
 
     D3D12_UNORDERED_ACCESS_VIEW_DESC viewDesc{};
     viewDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
@@ -137,7 +142,6 @@ UINT MipGenerator::CreateMipViews(RenderContext& ctx, ResourceDX* resource)
         ctx.Device->CreateUnorderedAccessView(resource->Get(), nullptr, &viewDesc, handle);
 
         handle.Offset(ctx.CbvSrvUavDescriptorSize);
-        ++mCurrViewsCount;
     }
 
     return baseOffset;
@@ -4,6 +4,7 @@
 
 #include <wrl.h>
 #include "DXrenderer/ResourceDX.h"
+#include "DXrenderer/Memory/DescriptorAllocator.h"
 #include "External/Dx12Helpers/d3dx12.h"
 
 namespace DirectxPlayground
@@ -18,6 +19,8 @@ public:
 
     void GenerateMips(RenderContext& ctx, ResourceDX* resource);
     void Flush(RenderContext& ctx);
+    // Resets the views once the GPU is done with the flushed mips and nothing is queued.
+    void BeginFrame(UINT64 completedFenceValue);
 
 private:
     struct MipGenData
@@ -36,7 +39,8 @@ private:
     std::vector<ResourceDX*> mResourcesPtrs;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mUavHeap;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> mCommonRootSig;
-    UINT mCurrViewsCount = 0;
+    DescriptorAllocator mViews; // Only the transient part, reset by BeginFrame.
+    UINT64 mViewsFenceValue = 0; // Signaled after the last flushed dispatches.
     UINT mQueuedMipsToGenerateNumber = 0;
     const std::string mPsoName = "Generate_Mips";
     UploadBuffer* mConstantBuffers = nullptr;
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <windows.h>
+
+// Shared by the CPU bakers of the environment lighting.
+namespace DirectxPlayground
+{
+inline constexpr float Pi = 3.14159265358979323846f;
+
+// Van der Corput sequence in base 2, i / count and RadicalInverse(i) are the Hammersley points.
+inline float RadicalInverse(UINT bits)
+{
+    bits = (bits << 16) | (bits >> 16);
+    bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+    bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+    bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+    bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+    return bits * 2.3283064365386963e-10f;
+}
+}
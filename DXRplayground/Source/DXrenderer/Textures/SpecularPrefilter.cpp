@@ -0,0 +1,198 @@
+#include "DXrenderer/Textures/SpecularPrefilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+#include "DXrenderer/Textures/CubemapConverter.h"
+#include "DXrenderer/Textures/MipChain.h"
+#include "DXrenderer/Textures/SamplingHelpers.h"
+#include "Utils/ParallelFor.h"
+
+namespace DirectxPlayground::SpecularPrefilter
+{
+namespace
+{
+constexpr UINT SamplesCount = 128;
+
+struct SourceLevel
+{
+    const float* Data = nullptr;
+    UINT Width = 0;
+    UINT Height = 0;
+};
+
+// L in the tangent space of N, the weight is NdotL.
+struct LobeSample
+{
+    float Dir[3] = {};
+    float Weight = 0.0f;
+    float Lod = 0.0f;
+};
+
+struct OutputRow
+{
+    UINT Face = 0;
+    UINT Mip = 0;
+    UINT Y = 0;
+    size_t Offset = 0; // In floats from the beginning of the result.
+};
+
+// With V = N the lobe is the same for every texel, so it is built once per level in the tangent space.
+std::vector<LobeSample> BuildLobe(float roughness, float outputTexelSolidAngle, float sourceTexelSolidAngle)
+{
+    std::vector<LobeSample> res;
+    if (roughness == 0.0f)
+    {
+        LobeSample mirror;
+        mirror.Dir[2] = 1.0f;
+        mirror.Weight = 1.0f;
+        mirror.Lod = std::max(0.0f, 0.5f * std::log2(outputTexelSolidAngle / sourceTexelSolidAngle));
+        res.push_back(mirror);
+        return res;
+    }
+
+    const float a = roughness * roughness;
+    const float a2 = a * a;
+    res.reserve(SamplesCount);
+    for (UINT i = 0; i < SamplesCount; ++i)
+    {
+        float phi = 2.0f * Pi * i / SamplesCount;
+        float xi = RadicalInverse(i);
+        float cosTheta = std::sqrt((1.0f - xi) / (1.0f + (a2 - 1.0f) * xi));
+        float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+        // L = reflect(-N, H), NdotH == VdotH.
+        LobeSample sample;
+        sample.Dir[0] = 2.0f * cosTheta * sinTheta * std::cos(phi);
+        sample.Dir[1] = 2.0f * cosTheta * sinTheta * std::sin(phi);
+        sample.Dir[2] = 2.0f * cosTheta * cosTheta - 1.0f;
+        sample.Weight = sample.Dir[2];
+        if (sample.Weight <= 0.0f)
+            continue;
+
+        float denom = cosTheta * cosTheta * (a2 - 1.0f) + 1.0f;
+        float pdf = a2 / (Pi * denom * denom) / 4.0f;
+        float sampleSolidAngle = 1.0f / (SamplesCount * pdf + 0.0001f);
+        sample.Lod = std::max(0.0f, 0.5f * std::log2(sampleSolidAngle / sourceTexelSolidAngle) + 1.0f);
+        res.push_back(sample);
+    }
+    return res;
+}
+
+// Bilinear, wraps horizontally and clamps vertically.
+__m128 SampleLevel(const SourceLevel& level, float u, float v)
+{
+    float x = u * level.Width - 0.5f;
+    float y = std::clamp(v * level.Height - 0.5f, 0.0f, float(level.Height - 1));
+    float x0f = std::floor(x);
+    float y0f = std::floor(y);
+    float tx = x - x0f;
+    float ty = y - y0f;
+    UINT x0 = UINT(int(x0f) + int(level.Width)) % level.Width;
+    UINT x1 = (x0 + 1) % level.Width;
+    UINT y0 = UINT(y0f);
+    UINT y1 = std::min(y0 + 1, level.Height - 1);
+
+    const float* row0 = level.Data + size_t(y0) * level.Width * 4;
+    const float* row1 = level.Data + size_t(y1) * level.Width * 4;
+    __m128 top = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(row0 + x0 * 4), _mm_set1_ps(1.0f - tx)), _mm_mul_ps(_mm_loadu_ps(row0 + x1 * 4), _mm_set1_ps(tx)));
+    __m128 bottom = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(row1 + x0 * 4), _mm_set1_ps(1.0f - tx)), _mm_mul_ps(_mm_loadu_ps(row1 + x1 * 4), _mm_set1_ps(tx)));
+    return _mm_add_ps(_mm_mul_ps(top, _mm_set1_ps(1.0f - ty)), _mm_mul_ps(bottom, _mm_set1_ps(ty)));
+}
+
+__m128 SampleSource(const std::vector<SourceLevel>& levels, const float dir[3], float lod)
+{
+    float u = 0.0f;
+    float v = 0.0f;
+    CubemapConverter::GetEquirectCoords(dir, u, v);
+    lod = std::min(lod, float(levels.size() - 1));
+    UINT lod0 = UINT(lod);
+    UINT lod1 = std::min(lod0 + 1, UINT(levels.size() - 1));
+    float t = lod - lod0;
+    __m128 c0 = SampleLevel(levels[lod0], u, v);
+    if (t == 0.0f || lod0 == lod1)
+        return c0;
+    __m128 c1 = SampleLevel(levels[lod1], u, v);
+    return _mm_add_ps(c0, _mm_mul_ps(_mm_sub_ps(c1, c0), _mm_set1_ps(t)));
+}
+
+__m128 Prefilter(const std::vector<SourceLevel>& levels, const std::vector<LobeSample>& lobe, const float n[3])
+{
+    float up[3] = { 0.0f, 0.0f, 1.0f };
+    if (std::abs(n[2]) > 0.999f)
+    {
+        up[0] = 1.0f;
+        up[2] = 0.0f;
+    }
+    float t[3] = { up[1] * n[2] - up[2] * n[1], up[2] * n[0] - up[0] * n[2], up[0] * n[1] - up[1] * n[0] };
+    float invLength = 1.0f / std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+    t[0] *= invLength;
+    t[1] *= invLength;
+    t[2] *= invLength;
+    float b[3] = { n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+
+    __m128 sum = _mm_setzero_ps();
+    float weightSum = 0.0f;
+    for (const LobeSample& sample : lobe)
+    {
+        float l[3];
+        for (UINT i = 0; i < 3; ++i)
+            l[i] = t[i] * sample.Dir[0] + b[i] * sample.Dir[1] + n[i] * sample.Dir[2];
+        sum = _mm_add_ps(sum, _mm_mul_ps(SampleSource(levels, l, sample.Lod), _mm_set1_ps(sample.Weight)));
+        weightSum += sample.Weight;
+    }
+    return _mm_div_ps(sum, _mm_set1_ps(weightSum));
+}
+}
+
+std::vector<float> Bake(const float* equirect, UINT width, UINT height, UINT size, UINT mipsCount)
+{
+    std::vector<byte> chain = MipChain::Generate(equirect, width, height);
+    std::vector<SourceLevel> levels(MipChain::GetMipsCount(width, height));
+    const float* levelData = reinterpret_cast<const float*>(chain.data());
+    for (UINT mip = 0; mip < levels.size(); ++mip)
+    {
+        levels[mip] = { levelData, std::max(1U, width >> mip), std::max(1U, height >> mip) };
+        levelData += size_t(levels[mip].Width) * levels[mip].Height * 4;
+    }
+
+    const float sourceTexelSolidAngle = 4.0f * Pi / (float(width) * height);
+    std::vector<std::vector<LobeSample>> lobes(mipsCount);
+    std::vector<OutputRow> rows;
+    size_t offset = 0;
+    for (UINT face = 0; face < 6; ++face)
+    {
+        for (UINT mip = 0; mip < mipsCount; ++mip)
+        {
+            UINT mipSize = std::max(1U, size >> mip);
+            if (face == 0)
+            {
+                float roughness = mipsCount == 1 ? 0.0f : float(mip) / (mipsCount - 1);
+                lobes[mip] = BuildLobe(roughness, 4.0f * Pi / (6.0f * mipSize * mipSize), sourceTexelSolidAngle);
+            }
+            for (UINT y = 0; y < mipSize; ++y)
+            {
+                rows.push_back({ face, mip, y, offset });
+                offset += size_t(mipSize) * 4;
+            }
+        }
+    }
+
+    std::vector<float> res(offset);
+    ParallelFor(rows.size(), [&](size_t i)
+    {
+        const OutputRow& row = rows[i];
+        UINT mipSize = std::max(1U, size >> row.Mip);
+        float v = (row.Y + 0.5f) * 2.0f / mipSize - 1.0f;
+        for (UINT x = 0; x < mipSize; ++x)
+        {
+            float u = (x + 0.5f) * 2.0f / mipSize - 1.0f;
+            float n[3];
+            CubemapConverter::GetFaceDirection(row.Face, u, v, n);
+            _mm_storeu_ps(res.data() + row.Offset + size_t(x) * 4, Prefilter(levels, lobes[row.Mip], n));
+        }
+    });
+    return res;
+}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+#include <dxgi1_6.h>
+
+namespace DirectxPlayground::SpecularPrefilter
+{
+// Prefilters the radiance for the split sum approximation with N = V = R: level i of the result is convolved with the GGX lobe
+// of roughness i / (mipsCount - 1). The lobe is importance sampled and every sample reads the source level which matches its pdf,
+// so a small number of samples gives a result without bright speckles.
+// equirect - RGBA32F map laid out as CubemapConverter::GetEquirectCoords expects.
+// Returns RGBA32F cubemap faces in the D3D12 subresource order: all levels of +X, then -X, +Y, -Y, +Z and -Z.
+std::vector<float> Bake(const float* equirect, UINT width, UINT height, UINT size, UINT mipsCount);
+}
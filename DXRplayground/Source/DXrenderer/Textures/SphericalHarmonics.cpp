@@ -0,0 +1,155 @@
+#include "DXrenderer/Textures/SphericalHarmonics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <immintrin.h>
+#include <vector>
+
+#include "DXrenderer/Textures/CubemapConverter.h"
+#include "DXrenderer/Textures/SamplingHelpers.h"
+#include "Utils/ParallelFor.h"
+
+namespace DirectxPlayground::SphericalHarmonics
+{
+namespace
+{
+constexpr UINT RowsPerBlock = 8;
+
+void EvaluateBasis(float x, float y, float z, float basis[9])
+{
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * y;
+    basis[2] = 0.488603f * z;
+    basis[3] = 0.488603f * x;
+    basis[4] = 1.092548f * x * y;
+    basis[5] = 1.092548f * y * z;
+    basis[6] = 0.315392f * (3.0f * z * z - 1.0f);
+    basis[7] = 1.092548f * x * z;
+    basis[8] = 0.546274f * (x * x - y * y);
+}
+
+// The whole texel goes through one float4 per coefficient.
+void AddSample(__m128 sums[9], const float* rgba, float x, float y, float z, float weight)
+{
+    float basis[9];
+    EvaluateBasis(x, y, z, basis);
+    __m128 color = _mm_mul_ps(_mm_loadu_ps(rgba), _mm_set1_ps(weight));
+    for (UINT i = 0; i < 9; ++i)
+        sums[i] = _mm_add_ps(sums[i], _mm_mul_ps(color, _mm_set1_ps(basis[i])));
+}
+
+// Every block of rows has its own partial sums, they are added in the block order afterwards.
+SH9 ProjectRows(UINT rowsCount, const std::function<void(UINT, __m128*)>& projectRow)
+{
+    const size_t blocksCount = (rowsCount + RowsPerBlock - 1) / RowsPerBlock;
+    std::vector<SH9> partial(blocksCount);
+    ParallelFor(blocksCount, [&](size_t block)
+    {
+        __m128 sums[9];
+        for (UINT i = 0; i < 9; ++i)
+            sums[i] = _mm_setzero_ps();
+        UINT end = std::min(rowsCount, UINT(block + 1) * RowsPerBlock);
+        for (UINT row = UINT(block) * RowsPerBlock; row < end; ++row)
+            projectRow(row, sums);
+        for (UINT i = 0; i < 9; ++i)
+            _mm_storeu_ps(&partial[block].Coefficients[i].x, sums[i]);
+    });
+
+    SH9 res;
+    for (const SH9& block : partial)
+    {
+        for (UINT i = 0; i < 9; ++i)
+        {
+            res.Coefficients[i].x += block.Coefficients[i].x;
+            res.Coefficients[i].y += block.Coefficients[i].y;
+            res.Coefficients[i].z += block.Coefficients[i].z;
+        }
+    }
+    return res;
+}
+
+// Solid angle of the part of the face from its center to (x, y), the face spans [-1, 1] at the distance 1.
+float GetAreaElement(float x, float y)
+{
+    return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0f));
+}
+}
+
+SH9 ProjectCubemap(const float* faces, UINT size)
+{
+    const float texelSize = 2.0f / size;
+    return ProjectRows(size * 6, [faces, size, texelSize](UINT row, __m128* sums)
+    {
+        UINT face = row / size;
+        float v = (row % size + 0.5f) * texelSize - 1.0f;
+        const float* texel = faces + size_t(row) * size * 4;
+        for (UINT x = 0; x < size; ++x, texel += 4)
+        {
+            float u = (x + 0.5f) * texelSize - 1.0f;
+            float u0 = u - texelSize * 0.5f;
+            float u1 = u + texelSize * 0.5f;
+            float v0 = v - texelSize * 0.5f;
+            float v1 = v + texelSize * 0.5f;
+            float solidAngle = GetAreaElement(u0, v0) - GetAreaElement(u0, v1) - GetAreaElement(u1, v0) + GetAreaElement(u1, v1);
+
+            float dir[3];
+            CubemapConverter::GetFaceDirection(face, u, v, dir);
+            AddSample(sums, texel, dir[0], dir[1], dir[2], solidAngle);
+        }
+    });
+}
+
+SH9 ProjectEquirect(const float* rgba, UINT width, UINT height)
+{
+    // Columns go around Y starting from -Z, rows go from +Y down to -Y.
+    std::vector<float> sinTheta(width);
+    std::vector<float> cosTheta(width);
+    for (UINT x = 0; x < width; ++x)
+    {
+        float theta = (x + 0.5f) / width * 2.0f * Pi - Pi;
+        sinTheta[x] = std::sin(theta);
+        cosTheta[x] = std::cos(theta);
+    }
+
+    const float texelAngle = (2.0f * Pi / width) * (Pi / height);
+    return ProjectRows(height, [&](UINT y, __m128* sums)
+    {
+        float phi = 0.5f * Pi - (y + 0.5f) / height * Pi;
+        float sinPhi = std::sin(phi);
+        float cosPhi = std::cos(phi);
+        float solidAngle = cosPhi * texelAngle;
+        const float* texel = rgba + size_t(y) * width * 4;
+        for (UINT x = 0; x < width; ++x, texel += 4)
+            AddSample(sums, texel, cosPhi * sinTheta[x], sinPhi, cosPhi * cosTheta[x], solidAngle);
+    });
+}
+
+SH9 ConvolveIrradiance(const SH9& radiance)
+{
+    // The cosine lobe in SH is (pi, 2pi/3, pi/4) per band.
+    static const float bandScales[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+    SH9 res;
+    for (UINT i = 0; i < 9; ++i)
+    {
+        res.Coefficients[i].x = radiance.Coefficients[i].x * bandScales[i];
+        res.Coefficients[i].y = radiance.Coefficients[i].y * bandScales[i];
+        res.Coefficients[i].z = radiance.Coefficients[i].z * bandScales[i];
+    }
+    return res;
+}
+
+DirectX::XMFLOAT3 Evaluate(const SH9& sh, const DirectX::XMFLOAT3& dir)
+{
+    float basis[9];
+    EvaluateBasis(dir.x, dir.y, dir.z, basis);
+    DirectX::XMFLOAT3 res{ 0.0f, 0.0f, 0.0f };
+    for (UINT i = 0; i < 9; ++i)
+    {
+        res.x += sh.Coefficients[i].x * basis[i];
+        res.y += sh.Coefficients[i].y * basis[i];
+        res.z += sh.Coefficients[i].z * basis[i];
+    }
+    return res;
+}
+}
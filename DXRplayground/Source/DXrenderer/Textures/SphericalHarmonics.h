@@ -0,0 +1,28 @@
+#pragma once
+
+#include <windows.h>
+#include <DirectXMath.h>
+
+namespace DirectxPlayground::SphericalHarmonics
+{
+// Third order real SH, RGB in xyz. float4 per coefficient to match the constant buffer layout in SphericalHarmonics.hlsl.
+struct SH9
+{
+    DirectX::XMFLOAT4 Coefficients[9] = {};
+};
+
+// Directions are in the space cubemaps are sampled in: the D3D face order +X, -X, +Y, -Y, +Z, -Z.
+// Both projections weight every texel by its solid angle. The work is split into fixed row blocks which are summed in order,
+// so the result doesn't depend on the number of threads.
+// faces - six RGBA32F faces of size x size texels one after another.
+SH9 ProjectCubemap(const float* faces, UINT size);
+// rgba - RGBA32F equirectangular map laid out as CubemapConverter::GetEquirectCoords expects.
+SH9 ProjectEquirect(const float* rgba, UINT width, UINT height);
+
+// Convolves the radiance with the clamped cosine lobe and divides by pi, so Evaluate returns the value a Lambertian surface
+// multiplies by its albedo, the same as a sample of an irradiance map.
+SH9 ConvolveIrradiance(const SH9& radiance);
+
+// dir has to be normalized. Ringing can make the result slightly negative for high contrast environments.
+DirectX::XMFLOAT3 Evaluate(const SH9& sh, const DirectX::XMFLOAT3& dir);
+}
@@ -1,15 +1,26 @@
 #include "DXrenderer/Textures/Texture.h"
 
+#include "DXrenderer/Textures/CubemapConverter.h"
+#include "DXrenderer/Textures/DdsParser.h"
+#include "DXrenderer/Textures/HdrParser.h"
+#include "DXrenderer/Textures/MipChain.h"
+#include "DXrenderer/Textures/SpecularPrefilter.h"
+#include "DXrenderer/Textures/TextureCompression.h"
 
 #include "Utils/Logger.h"
+#include "Utils/ParallelFor.h"
 
 #include "External/lodepng/lodepng.h"
 
 #define TINYEXR_IMPLEMENTATION
+#define TINYEXR_USE_THREAD 1 // Scanline blocks and tiles are decompressed on all cores.
 #include "External/TinyEXR/tinyexr.h"
 
 #define STB_IMAGE_IMPLEMENTATION
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <immintrin.h>
 
 #include "External/stb/stb_image.h"
 
@@ -66,47 +77,96 @@ namespace DirectxPlayground
 
         bool ParseHDR(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat)
         {
-            int width = 0;
-            int height = 0;
-            int nComponents = 0;
-            float* data = stbi_loadf(filename.c_str(), &width, &height, &nComponents, 0);
-            if (data == nullptr)
+            std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+            if (!file)
             {
-                LOG("HDR decoding error");
+                LOG("HDR reading error ", filename);
                 return false;
             }
-            if (nComponents != 3 && nComponents != 4)
-            {
-                LOG("HDR decoding error. Invalid number of color channels in the file");
+            std::vector<byte> fileData(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(fileData.data()), fileData.size());
+
+            // Decoded straight to 4 components because we want to use the texture as uav, and currently R32G32B32 format isn't supported.
+            if (!HdrParser::Parse(fileData.data(), fileData.size(), buffer, w, h))
                 return false;
-            }
-            w = static_cast<UINT>(width);
-            h = static_cast<UINT>(height);
+            textureFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
+            return true;
+        }
 
-            size_t imageSize = size_t(w) * size_t(h) * sizeof(float) * 4U;
-            buffer.resize(imageSize);
-            // [a_vorontcov] Well extension to 4 components because we want to use the texture as uav, and currently R32G32B32 format isn't supported.
-            if (nComponents == 4)
+        bool ParseDDS(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, UINT& mipsCount, UINT& arraySize, bool& isCubemap, DXGI_FORMAT& textureFormat)
+        {
+            std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+            if (!file)
             {
-                memcpy(buffer.data(), data, imageSize);
+                LOG("DDS reading error ", filename);
+                return false;
             }
-            else
+            std::vector<byte> fileData(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(fileData.data()), fileData.size());
+
+            DdsParser::DdsImage image;
+            if (!DdsParser::Parse(fileData.data(), fileData.size(), image))
+                return false;
+
+            buffer.assign(fileData.begin() + image.DataOffset, fileData.begin() + image.DataOffset + image.DataSize);
+            w = image.Width;
+            h = image.Height;
+            mipsCount = image.MipsCount;
+            arraySize = image.ArraySize;
+            isCubemap = image.IsCubemap;
+            textureFormat = image.Format;
+            return true;
+        }
+
+        void ConvertToHalf(std::vector<byte>& buffer, DXGI_FORMAT& textureFormat)
+        {
+            assert(textureFormat == DXGI_FORMAT_R32G32B32A32_FLOAT);
+
+            constexpr size_t TexelsPerTask = 4096;
+            const size_t texelsCount = buffer.size() / (sizeof(float) * 4U);
+            std::vector<byte> halfBuffer(texelsCount * sizeof(UINT16) * 4U);
+            const float* src = reinterpret_cast<const float*>(buffer.data());
+            UINT16* dst = reinterpret_cast<UINT16*>(halfBuffer.data());
+            // F16C converts a whole RGBA texel per instruction.
+            ParallelFor((texelsCount + TexelsPerTask - 1) / TexelsPerTask, [src, dst, texelsCount](size_t task)
             {
-                float* bufferAsFloat = reinterpret_cast<float*>(buffer.data());
-                for (size_t i = 0; i < size_t(w) * size_t(h); ++i)
+                size_t end = std::min(texelsCount, (task + 1) * TexelsPerTask) * 4;
+                for (size_t i = task * TexelsPerTask * 4; i < end; i += 4)
                 {
-                    bufferAsFloat[i * 4 + 0] = data[i * 3 + 0];
-                    bufferAsFloat[i * 4 + 1] = data[i * 3 + 1];
-                    bufferAsFloat[i * 4 + 2] = data[i * 3 + 2];
-                    bufferAsFloat[i * 4 + 3] = 1.0f;
+                    __m128i texel = _mm_cvtps_ph(_mm_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), texel);
                 }
-            }
-
-            textureFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
+            });
 
-            stbi_image_free(data);
+            buffer.swap(halfBuffer);
+            textureFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+        }
 
-            return true;
+        DXGI_FORMAT SelectCompressedFormat(TextureUsage usage, const std::vector<byte>& rgba)
+        {
+            switch (usage)
+            {
+            case TextureUsage::Generic:
+            {
+                for (size_t i = 3; i < rgba.size(); i += 4)
+                {
+                    if (rgba[i] != 255)
+                        return DXGI_FORMAT_BC3_UNORM;
+                }
+                return DXGI_FORMAT_BC1_UNORM;
+            }
+            case TextureUsage::BaseColor:
+                return DXGI_FORMAT_BC7_UNORM;
+            case TextureUsage::Normal:
+            case TextureUsage::MetallicRoughness:
+                return DXGI_FORMAT_BC5_UNORM;
+            case TextureUsage::Occlusion:
+                return DXGI_FORMAT_BC4_UNORM;
+            default:
+                return DXGI_FORMAT_UNKNOWN;
+            }
         }
     }
 
@@ -126,22 +186,182 @@ namespace DirectxPlayground
         {
             bool success = TextureUtils::ParseHDR(filename, mData, mWidth, mHeight, mFormat);
         }
+        else if (extension == L".dds" || extension == L".DDS")
+        {
+            // Already cooked by the artists, no mips generation or compression.
+            bool success = TextureUtils::ParseDDS(filename, mData, mWidth, mHeight, mMipsCount, mArraySize, mIsCubemap, mFormat);
+            assert(success && "DDS parsing failed");
+            return;
+        }
         else
         {
             assert("Unknown image format for parsing" && false);
         }
+        Cook();
+    }
+
+    void Texture::CookFrom(const Texture& source)
+    {
+        assert(source.mUsage == TextureUsage::Raw && source.mMipsCount == 1 && source.mArraySize == 1 && "The source is a decoded image");
+        mData = source.mData;
+        mWidth = source.mWidth;
+        mHeight = source.mHeight;
+        mFormat = source.mFormat;
+        Cook();
+    }
+
+    void Texture::Cook()
+    {
+        if (mUsage == TextureUsage::Cubemap || mUsage == TextureUsage::CubemapCompressed)
+        {
+            BakeCubemap();
+            return;
+        }
+        if (mUsage == TextureUsage::SpecularEnvironment)
+        {
+            BakeSpecularEnvironment();
+            return;
+        }
+        GenerateMips();
+        Compress();
+    }
+
+    std::string Texture::GetCookedNameSuffix() const
+    {
+        static const char* suffixes[] = { "", ".generic", ".basecolor", ".normal", ".metallicroughness", ".occlusion", ".cubemap", ".cubemap.bc6h", ".specular" };
+        return suffixes[static_cast<size_t>(mUsage)];
+    }
+
+    void Texture::GenerateMips()
+    {
+        if (mUsage == TextureUsage::Raw)
+            return;
+
+        if (mFormat == DXGI_FORMAT_R8G8B8A8_UNORM)
+            mData = MipChain::Generate(mData.data(), mWidth, mHeight, mUsage == TextureUsage::BaseColor);
+        else if (mFormat == DXGI_FORMAT_R32G32B32A32_FLOAT)
+            mData = MipChain::Generate(reinterpret_cast<const float*>(mData.data()), mWidth, mHeight);
+        else
+            return;
+        mMipsCount = MipChain::GetMipsCount(mWidth, mHeight);
+    }
+
+    void Texture::Compress()
+    {
+        // D3D12 requires the top mip of block compressed textures to be a multiple of the block size.
+        if (mUsage == TextureUsage::Raw || mFormat != DXGI_FORMAT_R8G8B8A8_UNORM || mWidth % 4 != 0 || mHeight % 4 != 0)
+            return;
+
+        DXGI_FORMAT format = TextureUtils::SelectCompressedFormat(mUsage, mData);
+        std::vector<byte> compressed;
+        const byte* level = mData.data();
+        for (UINT mip = 0; mip < mMipsCount; ++mip)
+        {
+            UINT w = std::max(1U, mWidth >> mip);
+            UINT h = std::max(1U, mHeight >> mip);
+            std::vector<byte> blocks = TextureCompression::Compress(level, w, h, format);
+            compressed.insert(compressed.end(), blocks.begin(), blocks.end());
+            level += size_t(w) * h * 4;
+        }
+
+        mData.swap(compressed);
+        mFormat = format;
+    }
+
+    // Every level of every slice is encoded separately.
+    void Texture::CompressHdr()
+    {
+        assert(mFormat == DXGI_FORMAT_R16G16B16A16_FLOAT);
+        // Sizes which aren't a multiple of the block size stay in half floats.
+        if (mWidth % 4 != 0 || mHeight % 4 != 0)
+            return;
+
+        std::vector<byte> compressed;
+        const UINT16* level = reinterpret_cast<const UINT16*>(mData.data());
+        for (UINT slice = 0; slice < mArraySize; ++slice)
+        {
+            for (UINT mip = 0; mip < mMipsCount; ++mip)
+            {
+                UINT w = std::max(1U, mWidth >> mip);
+                UINT h = std::max(1U, mHeight >> mip);
+                std::vector<byte> blocks = TextureCompression::CompressHdr(level, w, h);
+                compressed.insert(compressed.end(), blocks.begin(), blocks.end());
+                level += size_t(w) * h * 4;
+            }
+        }
+        mData.swap(compressed);
+        mFormat = DXGI_FORMAT_BC6H_UF16;
+    }
+
+    void Texture::BakeCubemap()
+    {
+        assert(mFormat == DXGI_FORMAT_R32G32B32A32_FLOAT && "Cubemaps are converted from HDR images only");
+
+        // Four faces go around the equator, so a quarter of the width keeps the source density.
+        UINT size = 1;
+        while (size * 2 <= std::min(mWidth / 4, MaxCubemapSize))
+            size *= 2;
+
+        // Face by face, only one float face with its mips is alive next to the source.
+        std::vector<byte> faces;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        for (UINT face = 0; face < 6; ++face)
+        {
+            std::vector<float> level = CubemapConverter::ConvertFace(reinterpret_cast<const float*>(mData.data()), mWidth, mHeight, face, size);
+            std::vector<byte> chain = MipChain::Generate(level.data(), size, size);
+            format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+            TextureUtils::ConvertToHalf(chain, format);
+            faces.insert(faces.end(), chain.begin(), chain.end());
+        }
+
+        mData.swap(faces);
+        mWidth = size;
+        mHeight = size;
+        mMipsCount = MipChain::GetMipsCount(size, size);
+        mArraySize = 6;
+        mIsCubemap = true;
+        mFormat = format;
+
+        if (mUsage == TextureUsage::CubemapCompressed)
+            CompressHdr();
+    }
+
+    void Texture::BakeSpecularEnvironment()
+    {
+        assert(mFormat == DXGI_FORMAT_R32G32B32A32_FLOAT && "The specular environment is baked from HDR images only");
+
+        std::vector<float> faces = SpecularPrefilter::Bake(reinterpret_cast<const float*>(mData.data()), mWidth, mHeight, SpecularEnvironmentSize, SpecularEnvironmentMipsCount);
+        mData.resize(faces.size() * sizeof(float));
+        memcpy(mData.data(), faces.data(), mData.size());
+        mWidth = SpecularEnvironmentSize;
+        mHeight = SpecularEnvironmentSize;
+        mMipsCount = SpecularEnvironmentMipsCount;
+        mArraySize = 6;
+        mIsCubemap = true;
+        TextureUtils::ConvertToHalf(mData, mFormat);
+    }
+
+    void Texture::AddArraySlice(const Texture& slice)
+    {
+        assert(!mIsCubemap && slice.mArraySize == 1 && !slice.mIsCubemap);
+        assert(slice.mWidth == mWidth && slice.mHeight == mHeight && slice.mMipsCount == mMipsCount && slice.mFormat == mFormat);
+        mData.insert(mData.end(), slice.mData.begin(), slice.mData.end());
+        ++mArraySize;
     }
 
     void Texture::Serialize(BinaryContainer& container)
     {
         UINT format = static_cast<UINT>(mFormat);
-        container << format << mWidth << mHeight << mData;
+        UINT isCubemap = mIsCubemap ? 1 : 0;
+        container << format << mWidth << mHeight << mMipsCount << mArraySize << isCubemap << mData;
     }
 
     void Texture::Deserialize(BinaryContainer& container)
     {
         UINT format = 0;
-        container >> format >> mWidth >> mHeight >> mData;
+        UINT isCubemap = 0;
+        container >> format >> mWidth >> mHeight >> mMipsCount >> mArraySize >> isCubemap >> mData;
         mFormat = static_cast<DXGI_FORMAT>(format);
+        mIsCubemap = isCubemap != 0;
     }
 }
@@ -13,21 +13,45 @@ namespace TextureUtils
     bool ParsePNG(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat);
     bool ParseEXR(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat);
     bool ParseHDR(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, DXGI_FORMAT& textureFormat);
+    // DDS data is taken as is, pre-built mips, block compression, cubemaps and arrays included.
+    bool ParseDDS(const std::string& filename, std::vector<byte>& buffer, UINT& w, UINT& h, UINT& mipsCount, UINT& arraySize, bool& isCubemap, DXGI_FORMAT& textureFormat);
+    void ConvertToHalf(std::vector<byte>& buffer, DXGI_FORMAT& textureFormat);
 }
 
+// Selects the block compression format at cook time. Raw textures are stored as they were decoded.
+enum class TextureUsage
+{
+    Raw,
+    Generic, // BC1, or BC3 if the image has transparent texels.
+    BaseColor, // BC7
+    Normal, // BC5, Z is reconstructed in shaders.
+    MetallicRoughness, // BC5, the shaders read metalness and roughness from RG.
+    Occlusion, // BC4
+    Cubemap, // R16G16B16A16_FLOAT cubemap with the full mip chain, converted from an equirectangular HDR.
+    CubemapCompressed, // The same with BC6H_UF16 faces, a quarter of the size.
+    SpecularEnvironment // R16G16B16A16_FLOAT cubemap, the GGX prefiltered radiance of an equirectangular HDR with roughness growing per mip.
+};
+
 class Texture : public Asset
 {
 public:
-    Texture() : mWidth(-1), mHeight(-1), mFormat(DXGI_FORMAT_UNKNOWN)
+    Texture(TextureUsage usage = TextureUsage::Raw) : mWidth(-1), mHeight(-1), mMipsCount(1), mArraySize(1), mIsCubemap(false), mFormat(DXGI_FORMAT_UNKNOWN), mUsage(usage)
+    {}
+    // For textures generated in code, a single level of tightly packed texels.
+    Texture(UINT width, UINT height, DXGI_FORMAT format, std::vector<byte>&& data)
+        : mData(std::move(data)), mWidth(width), mHeight(height), mMipsCount(1), mArraySize(1), mIsCubemap(false), mFormat(format), mUsage(TextureUsage::Raw)
     {}
 
     void Parse(const std::string& filename) override;
+    // Cooks for the usage from a Raw texture which is already decoded, e.g. one HDR image for several usages.
+    void CookFrom(const Texture& source);
     void Serialize(BinaryContainer& container) override;
     void Deserialize(BinaryContainer& container) override;
     size_t GetVersion() const override
     {
         return AssetSerializationVersion;
     }
+    std::string GetCookedNameSuffix() const override;
 
     const std::vector<byte>& GetData() const
     {
@@ -44,16 +68,50 @@ public:
         return mHeight;
     }
 
+    // Every usage except Raw is cooked with the full mip chain, levels are stored one after another in GetData.
+    UINT GetMipsCount() const
+    {
+        return mMipsCount;
+    }
+
+    // Slices are stored one after another, each with all its mips. DDS files and baked specular environments can have more than one.
+    UINT GetArraySize() const
+    {
+        return mArraySize;
+    }
+
+    bool IsCubemap() const
+    {
+        return mIsCubemap;
+    }
+
     DXGI_FORMAT GetFormat() const
     {
         return mFormat;
     }
+
+    // Appends the slice data, the texture becomes an array. The slice has to be a single texture of the same size, mips count and format.
+    void AddArraySlice(const Texture& slice);
 private:
-    inline static constexpr size_t AssetSerializationVersion = 0;
+    inline static constexpr size_t AssetSerializationVersion = 2;
+    inline static constexpr UINT MaxCubemapSize = 2048;
+    inline static constexpr UINT SpecularEnvironmentSize = 256;
+    inline static constexpr UINT SpecularEnvironmentMipsCount = 6;
+
+    void Cook();
+    void GenerateMips();
+    void Compress();
+    void CompressHdr();
+    void BakeCubemap();
+    void BakeSpecularEnvironment();
 
     std::vector<byte> mData;
     UINT mWidth;
     UINT mHeight;
+    UINT mMipsCount;
+    UINT mArraySize;
+    bool mIsCubemap;
     DXGI_FORMAT mFormat;
+    TextureUsage mUsage;
 };
 }
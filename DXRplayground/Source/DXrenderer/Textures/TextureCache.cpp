@@ -0,0 +1,63 @@
+#include "DXrenderer/Textures/TextureCache.h"
+
+#include <cassert>
+
+namespace DirectxPlayground
+{
+const TextureCache::Location* TextureCache::FindPath(const std::string& pathKey) const
+{
+    auto it = mPaths.find(pathKey);
+    return it == mPaths.end() ? nullptr : &it->second;
+}
+
+const TextureCache::Location* TextureCache::FindContent(UINT64 contentKey) const
+{
+    auto it = mContents.find(contentKey);
+    return it == mContents.end() ? nullptr : &it->second;
+}
+
+void TextureCache::Add(UINT slot, const TexResourceData& data, const std::vector<UINT64>& contentKeys, bool isArray)
+{
+    assert((isArray || contentKeys.size() <= 1) && "A single texture has one content key");
+    auto [it, added] = mTextures.emplace(slot, CachedTexture{});
+    assert(added && "The slot is taken by a texture which wasn't released");
+    it->second.Data = data;
+    it->second.ContentKeys = contentKeys;
+    for (UINT slice = 0; slice < contentKeys.size(); ++slice)
+        mContents[contentKeys[slice]] = { slot, isArray ? slice : InvalidOffset };
+}
+
+TexResourceData TextureCache::AddRef(const Location& location, const std::string& pathKey)
+{
+    CachedTexture& cached = mTextures.at(location.Slot);
+    ++cached.RefCount;
+    if (!pathKey.empty() && mPaths.emplace(pathKey, location).second)
+        cached.PathKeys.push_back(pathKey);
+    TexResourceData res = cached.Data;
+    res.ArraySlice = location.ArraySlice;
+    return res;
+}
+
+bool TextureCache::Release(UINT slot, TexResourceData& data)
+{
+    auto it = mTextures.find(slot);
+    assert(it != mTextures.end() && it->second.RefCount > 0);
+    CachedTexture& cached = it->second;
+    if (--cached.RefCount > 0)
+        return false;
+
+    for (const std::string& pathKey : cached.PathKeys)
+        mPaths.erase(pathKey);
+    for (UINT64 contentKey : cached.ContentKeys)
+        mContents.erase(contentKey);
+    data = cached.Data;
+    mTextures.erase(it);
+    return true;
+}
+
+UINT TextureCache::GetRefCount(UINT slot) const
+{
+    auto it = mTextures.find(slot);
+    return it == mTextures.end() ? 0 : it->second.RefCount;
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <windows.h>
+
+#include "DXrenderer/Memory/ResourcePool.h"
+
+namespace DirectxPlayground
+{
+constexpr UINT InvalidOffset = 0xFFFFFFFF;
+
+struct TexResourceData
+{
+    UINT RTVOffset = InvalidOffset;
+    UINT SRVOffset = InvalidOffset;
+    UINT UAVOffset = InvalidOffset;
+    UINT ArraySlice = InvalidOffset; // Set if the texture is packed into a texture array together with other small textures.
+    bool IsCubemap = false; // SRVOffset is in the cubemaps range of the heap.
+    ResourceHandle Resource = InvalidResourceHandle; // Not set for streamed textures, their resource changes with the residency.
+};
+
+// The reference counted textures of TextureManager by their heap slot, and where a path or a cooked content was created before.
+// It doesn't touch the GPU, TextureManager destroys the texture once Release returns true.
+class TextureCache
+{
+public:
+    struct Location
+    {
+        UINT Slot = InvalidOffset;
+        UINT ArraySlice = InvalidOffset;
+    };
+
+    // nullptr if nothing was created from the path or the content.
+    const Location* FindPath(const std::string& pathKey) const;
+    const Location* FindContent(UINT64 contentKey) const;
+
+    // A texture without references yet. contentKeys - one per array slice of a texture array, one for a single texture, none if it
+    // isn't shared by the content.
+    void Add(UINT slot, const TexResourceData& data, const std::vector<UINT64>& contentKeys, bool isArray);
+    // pathKey - empty if the request isn't shared by the path. Returns the data of the requested array slice.
+    TexResourceData AddRef(const Location& location, const std::string& pathKey);
+    // Returns true once the last reference is released, the texture and its keys are forgotten then and data is the one Add got.
+    bool Release(UINT slot, TexResourceData& data);
+    UINT GetRefCount(UINT slot) const;
+
+private:
+    // A texture array is one entry, its slices are released together when none of them is referenced.
+    struct CachedTexture
+    {
+        TexResourceData Data;
+        UINT RefCount = 0;
+        std::vector<UINT64> ContentKeys; // One per array slice.
+        std::vector<std::string> PathKeys; // Every path the texture was requested with.
+    };
+
+    std::map<UINT, CachedTexture> mTextures; // Heap slot -> texture.
+    std::map<std::string, Location> mPaths;
+    std::map<UINT64, Location> mContents;
+};
+}
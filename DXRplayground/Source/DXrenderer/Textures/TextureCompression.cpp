@@ -0,0 +1,859 @@
+#include "DXrenderer/Textures/TextureCompression.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "DXrenderer/DXhelpers.h"
+#include "Utils/ParallelFor.h"
+
+namespace DirectxPlayground::TextureCompression
+{
+namespace
+{
+constexpr UINT BlockDim = 4;
+constexpr UINT TexelsInBlock = BlockDim * BlockDim;
+
+using Texel = std::array<int, 4>;
+using Block = std::array<Texel, TexelsInBlock>;
+
+constexpr float BC1Weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f }; // Weight of the first endpoint for every index.
+constexpr int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+void FetchBlock(const byte* rgba, UINT width, UINT height, UINT blockX, UINT blockY, Block& block)
+{
+    for (UINT y = 0; y < BlockDim; ++y)
+    {
+        UINT srcY = std::min(blockY * BlockDim + y, height - 1);
+        for (UINT x = 0; x < BlockDim; ++x)
+        {
+            UINT srcX = std::min(blockX * BlockDim + x, width - 1);
+            const byte* src = rgba + (size_t(srcY) * width + srcX) * 4;
+            for (UINT c = 0; c < 4; ++c)
+                block[y * BlockDim + x][c] = src[c];
+        }
+    }
+}
+
+void StoreBlock(byte* rgba, UINT width, UINT height, UINT blockX, UINT blockY, const Block& block)
+{
+    for (UINT y = 0; y < BlockDim && blockY * BlockDim + y < height; ++y)
+    {
+        for (UINT x = 0; x < BlockDim && blockX * BlockDim + x < width; ++x)
+        {
+            byte* dst = rgba + (size_t(blockY * BlockDim + y) * width + blockX * BlockDim + x) * 4;
+            for (UINT c = 0; c < 4; ++c)
+                dst[c] = static_cast<byte>(block[y * BlockDim + x][c]);
+        }
+    }
+}
+
+template<UINT N>
+int Distance(const Texel& a, const Texel& b)
+{
+    int res = 0;
+    for (UINT c = 0; c < N; ++c)
+        res += (a[c] - b[c]) * (a[c] - b[c]);
+    return res;
+}
+
+// Endpoints are the extremes of the block projected on its principal axis.
+template<UINT N>
+void FindEndpoints(const Block& block, std::array<float, N>& e0, std::array<float, N>& e1, float maxValue = 255.0f)
+{
+    std::array<float, N> mean{};
+    std::array<float, N> minColor{};
+    std::array<float, N> maxColor{};
+    minColor.fill(maxValue);
+    for (const Texel& t : block)
+    {
+        for (UINT c = 0; c < N; ++c)
+        {
+            mean[c] += t[c];
+            minColor[c] = std::min(minColor[c], float(t[c]));
+            maxColor[c] = std::max(maxColor[c], float(t[c]));
+        }
+    }
+    for (UINT c = 0; c < N; ++c)
+        mean[c] /= TexelsInBlock;
+
+    std::array<std::array<float, N>, N> covariance{};
+    for (const Texel& t : block)
+        for (UINT i = 0; i < N; ++i)
+            for (UINT j = 0; j < N; ++j)
+                covariance[i][j] += (t[i] - mean[i]) * (t[j] - mean[j]);
+
+    std::array<float, N> axis{};
+    for (UINT c = 0; c < N; ++c)
+        axis[c] = maxColor[c] - minColor[c];
+
+    for (UINT iteration = 0; iteration < 8; ++iteration)
+    {
+        std::array<float, N> next{};
+        for (UINT i = 0; i < N; ++i)
+            for (UINT j = 0; j < N; ++j)
+                next[i] += covariance[i][j] * axis[j];
+
+        float length = 0.0f;
+        for (UINT c = 0; c < N; ++c)
+            length = std::max(length, std::abs(next[c]));
+        if (length < 1e-6f)
+            break;
+        for (UINT c = 0; c < N; ++c)
+            axis[c] = next[c] / length;
+    }
+
+    float axisLengthSq = 0.0f;
+    for (UINT c = 0; c < N; ++c)
+        axisLengthSq += axis[c] * axis[c];
+    if (axisLengthSq < 1e-6f)
+    {
+        e0 = mean;
+        e1 = mean;
+        return;
+    }
+
+    float minProj = std::numeric_limits<float>::max();
+    float maxProj = std::numeric_limits<float>::lowest();
+    for (const Texel& t : block)
+    {
+        float proj = 0.0f;
+        for (UINT c = 0; c < N; ++c)
+            proj += (t[c] - mean[c]) * axis[c];
+        minProj = std::min(minProj, proj);
+        maxProj = std::max(maxProj, proj);
+    }
+    for (UINT c = 0; c < N; ++c)
+    {
+        e0[c] = std::clamp(mean[c] + axis[c] * minProj / axisLengthSq, 0.0f, maxValue);
+        e1[c] = std::clamp(mean[c] + axis[c] * maxProj / axisLengthSq, 0.0f, maxValue);
+    }
+}
+
+// Least squares fit of both endpoints for the fixed indices. Returns false for degenerate systems (all texels use the same weight).
+template<UINT N>
+bool RefitEndpoints(const Block& block, const float* firstEndpointWeights, std::array<float, N>& e0, std::array<float, N>& e1, float maxValue = 255.0f)
+{
+    float a00 = 0.0f;
+    float a01 = 0.0f;
+    float a11 = 0.0f;
+    std::array<float, N> b0{};
+    std::array<float, N> b1{};
+    for (UINT i = 0; i < TexelsInBlock; ++i)
+    {
+        float w0 = firstEndpointWeights[i];
+        float w1 = 1.0f - w0;
+        a00 += w0 * w0;
+        a01 += w0 * w1;
+        a11 += w1 * w1;
+        for (UINT c = 0; c < N; ++c)
+        {
+            b0[c] += w0 * block[i][c];
+            b1[c] += w1 * block[i][c];
+        }
+    }
+    float det = a00 * a11 - a01 * a01;
+    if (std::abs(det) < 1e-6f)
+        return false;
+    for (UINT c = 0; c < N; ++c)
+    {
+        e0[c] = std::clamp((a11 * b0[c] - a01 * b1[c]) / det, 0.0f, maxValue);
+        e1[c] = std::clamp((a00 * b1[c] - a01 * b0[c]) / det, 0.0f, maxValue);
+    }
+    return true;
+}
+
+void WriteBits(byte* dst, UINT& bitOffset, UINT value, UINT bitsCount)
+{
+    for (UINT i = 0; i < bitsCount; ++i, ++bitOffset)
+    {
+        if ((value >> i) & 1)
+            dst[bitOffset / 8] |= static_cast<byte>(1 << (bitOffset % 8));
+    }
+}
+
+UINT ReadBits(const byte* src, UINT& bitOffset, UINT bitsCount)
+{
+    UINT value = 0;
+    for (UINT i = 0; i < bitsCount; ++i, ++bitOffset)
+        value |= ((src[bitOffset / 8] >> (bitOffset % 8)) & 1) << i;
+    return value;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// BC1 color block (also used in BC3)
+//////////////////////////////////////////////////////////////////////////
+
+UINT16 PackRgb565(const std::array<float, 3>& color)
+{
+    UINT r = static_cast<UINT>(color[0] * 31.0f / 255.0f + 0.5f);
+    UINT g = static_cast<UINT>(color[1] * 63.0f / 255.0f + 0.5f);
+    UINT b = static_cast<UINT>(color[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<UINT16>((r << 11) | (g << 5) | b);
+}
+
+Texel UnpackRgb565(UINT16 color)
+{
+    int r = (color >> 11) & 31;
+    int g = (color >> 5) & 63;
+    int b = color & 31;
+    return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255 };
+}
+
+// BC3 color blocks always use four colors, BC1 blocks switch to three colors and transparent black when color0 <= color1.
+void BuildColorPalette(UINT16 color0, UINT16 color1, bool allowThreeColors, Texel (&palette)[4])
+{
+    palette[0] = UnpackRgb565(color0);
+    palette[1] = UnpackRgb565(color1);
+    bool fourColors = !allowThreeColors || color0 > color1;
+    for (UINT c = 0; c < 3; ++c)
+    {
+        if (fourColors)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = fourColors ? 255 : 0;
+}
+
+int FindColorIndices(const Block& block, UINT16 color0, UINT16 color1, std::array<UINT, TexelsInBlock>& indices)
+{
+    Texel palette[4];
+    BuildColorPalette(color0, color1, false, palette);
+    int error = 0;
+    for (UINT i = 0; i < TexelsInBlock; ++i)
+    {
+        int bestDistance = std::numeric_limits<int>::max();
+        for (UINT p = 0; p < 4; ++p)
+        {
+            int distance = Distance<3>(block[i], palette[p]);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                indices[i] = p;
+            }
+        }
+        error += bestDistance;
+    }
+    return error;
+}
+
+void EncodeColorBlock(const Block& block, byte* dst)
+{
+    std::array<float, 3> e0;
+    std::array<float, 3> e1;
+    FindEndpoints<3>(block, e0, e1);
+
+    UINT16 color0 = PackRgb565(e1);
+    UINT16 color1 = PackRgb565(e0);
+    std::array<UINT, TexelsInBlock> indices{};
+    int error = FindColorIndices(block, color0, color1, indices);
+
+    for (UINT iteration = 0; iteration < 2 && error > 0; ++iteration)
+    {
+        float weights[TexelsInBlock];
+        for (UINT i = 0; i < TexelsInBlock; ++i)
+            weights[i] = BC1Weights[indices[i]];
+        if (!RefitEndpoints<3>(block, weights, e0, e1))
+            break;
+
+        UINT16 refitColor0 = PackRgb565(e0);
+        UINT16 refitColor1 = PackRgb565(e1);
+        std::array<UINT, TexelsInBlock> refitIndices{};
+        int refitError = FindColorIndices(block, refitColor0, refitColor1, refitIndices);
+        if (refitError >= error)
+            break;
+        color0 = refitColor0;
+        color1 = refitColor1;
+        indices = refitIndices;
+        error = refitError;
+    }
+
+    // color0 > color1 selects the four color mode in BC1.
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+        for (UINT& index : indices)
+            index ^= 1;
+    }
+    else if (color0 == color1)
+    {
+        indices.fill(0);
+    }
+
+    memcpy(dst, &color0, sizeof(UINT16));
+    memcpy(dst + 2, &color1, sizeof(UINT16));
+    UINT packedIndices = 0;
+    for (UINT i = 0; i < TexelsInBlock; ++i)
+        packedIndices |= indices[i] << (i * 2);
+    memcpy(dst + 4, &packedIndices, sizeof(UINT));
+}
+
+void DecodeColorBlock(const byte* src, bool allowThreeColors, Block& block)
+{
+    UINT16 color0 = 0;
+    UINT16 color1 = 0;
+    UINT packedIndices = 0;
+    memcpy(&color0, src, sizeof(UINT16));
+    memcpy(&color1, src + 2, sizeof(UINT16));
+    memcpy(&packedIndices, src + 4, sizeof(UINT));
+
+    Texel palette[4];
+    BuildColorPalette(color0, color1, allowThreeColors, palette);
+    for (UINT i = 0; i < TexelsInBlock; ++i)
+    {
+        const Texel& color = palette[(packedIndices >> (i * 2)) & 3];
+        for (UINT c = 0; c < 3; ++c)
+            block[i][c] = color[c];
+        if (allowThreeColors)
+            block[i][3] = color[3];
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// BC4 single channel block (also used in BC3 and BC5)
+//////////////////////////////////////////////////////////////////////////
+
+void BuildChannelPalette(int value0, int value1, int (&palette)[8])
+{
+    palette[0] = value0;
+    palette[1] = value1;
+    if (value0 > value1)
+    {
+        for (int i = 1; i < 7; ++i)
+            palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+    }
+    else
+    {
+        for (int i = 1; i < 5; ++i)
+            palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+void EncodeChannelBlock(const Block& block, UINT channel, byte* dst)
+{
+    int minValue = 255;
+    int maxValue = 0;
+    for (const Texel& t : block)
+    {
+        minValue = std::min(minValue, t[channel]);
+        maxValue = std::max(maxValue, t[channel]);
+    }
+
+    dst[0] = static_cast<byte>(maxValue);
+    dst[1] = static_cast<byte>(minValue);
+
+    int palette[8];
+    BuildChannelPalette(maxValue, minValue, palette);
+
+    UINT64 packedIndices = 0;
+    for (UINT i = 0; i < TexelsInBlock; ++i)
+    {
+        UINT bestIndex = 0;
+        int bestDistance = std::numeric_limits<int>::max();
+        for (UINT p = 0; p < 8 && maxValue != minValue; ++p)
+        {
+            int distance = std::abs(block[i][channel] - palette[p]);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                bestIndex = p;
+            }
+        }
+        packedIndices |= UINT64(bestIndex) << (i * 3);
+    }
+    for (UINT i = 0; i < 6; ++i)
+        dst[2 + i] = static_cast<byte>(packedIndices >> (i * 8));
+}
+
+void DecodeChannelBlock(const byte* src, UINT channel, Block& block)
+{
+    int palette[8];
+    BuildChannelPalette(src[0], src[1], palette);
+
+    UINT64 packedIndices = 0;
+    for (UINT i = 0; i < 6; ++i)
+        packedIndices |= UINT64(src[2 + i]) << (i * 8);
+    for (UINT i = 0; i < TexelsInBlock; ++i)
+        block[i][channel] = palette[(packedIndices >> (i * 3)) & 7];
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// BC7 mode 6: one subset, RGBA 7.7.7.7 endpoints with a unique p-bit each, 4 bit indices
+//////////////////////////////////////////////////////////////////////////
+
+struct BC7Endpoint
+{
+    std::array<int, 4> Quantized{}; // 7 bits per channel
+    int PBit = 0;
+
+    Texel Expand() const
+    {
+        Texel res;
+        for (UINT c = 0; c < 4; ++c)
+            res[c] = (Quantized[c] << 1) | PBit;
+        return res;
+    }
+};
+
+BC7Endpoint QuantizeBC7Endpoint(const std::array<float, 4>& color)
+{
+    BC7Endpoint best;
+    float bestError = std::numeric_limits<float>::max();
+    for (int pBit = 0; pBit < 2; ++pBit)
+    {
+        BC7Endpoint candidate;
+        candidate.PBit = pBit;
+        float error = 0.0f;
+        for (UINT c = 0; c < 4; ++c)
+        {
+            candidate.Quantized[c] = std::clamp(static_cast<int>((color[c] - pBit) * 0.5f + 0.5f), 0, 127);
+            float diff = float((candidate.Quantized[c] << 1) | pBit) - color[c];
+            error += diff * diff;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+void BuildBC7Palette(const BC7Endpoint& e0, const BC7Endpoint& e1, Texel (&palette)[16])
+{
+    Texel c0 = e0.Expand();
+    Texel c1 = e1.Expand();
+    for (UINT i = 0; i < 16; ++i)
+        for (UINT c = 0; c < 4; ++c)
+            palette[i][c] = ((64 - BC7Weights[i]) * c0[c] + BC7Weights[i] * c1[c] + 32) >> 6;
+}
+
+int FindBC7Indices(const Block& block, const BC7Endpoint& e0, const BC7Endpoint& e1, std::array<UINT, TexelsInBlock>& indices)
+{
+    Texel palette[16];
+    BuildBC7Palette(e0, e1, palette);
+    int error = 0;
+    for (UINT i = 0; i < TexelsInBlock; ++i)
+    {
+        int bestDistance = std::numeric_limits<int>::max();
+        for (UINT p = 0; p < 16; ++p)
+        {
+            int distance = Distance<4>(block[i], palette[p]);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                indices[i] = p;
+            }
+        }
+        error += bestDistance;
+    }
+    return error;
+}
+
+void EncodeBC7Block(const Block& block, byte* dst)
+{
+    std::array<float, 4> c0;
+    std::array<float, 4> c1;
+    FindEndpoints<4>(block, c0, c1);
+
+    BC7Endpoint e0 = QuantizeBC7Endpoint(c0);
+    BC7Endpoint e1 = QuantizeBC7Endpoint(c1);
+    std::array<UINT, TexelsInBlock> indices{};
+    int error = FindBC7Indices(block, e0, e1, indices);
+
+    for (UINT iteration = 0; iteration < 2 && error > 0; ++iteration)
+    {
+        float weights[TexelsInBlock];
+        for (UINT i = 0; i < TexelsInBlock; ++i)
+            weights[i] = (64 - BC7Weights[indices[i]]) / 64.0f;
+        if (!RefitEndpoints<4>(block, weights, c0, c1))
+            break;
+
+        BC7Endpoint refitE0 = QuantizeBC7Endpoint(c0);
+        BC7Endpoint refitE1 = QuantizeBC7Endpoint(c1);
+        std::array<UINT, TexelsInBlock> refitIndices{};
+        int refitError = FindBC7Indices(block, refitE0, refitE1, refitIndices);
+        if (refitError >= error)
+            break;
+        e0 = refitE0;
+        e1 = refitE1;
+        indices = refitIndices;
+        error = refitError;
+    }
+
+    // The anchor index is stored without its most significant bit, so it must be below 8.
+    if (indices[0] >= 8)
+    {
+        std::swap(e0, e1);
+        for (UINT& index : indices)
+            index = 15 - index;
+    }
+
+    memset(dst, 0, 16);
+    UINT bitOffset = 0;
+    WriteBits(dst, bitOffset, 1 << 6, 7);
+    for (UINT c = 0; c < 4; ++c)
+    {
+        WriteBits(dst, bitOffset, e0.Quantized[c], 7);
+        WriteBits(dst, bitOffset, e1.Quantized[c], 7);
+    }
+    WriteBits(dst, bitOffset, e0.PBit, 1);
+    WriteBits(dst, bitOffset, e1.PBit, 1);
+    WriteBits(dst, bitOffset, indices[0], 3);
+    for (UINT i = 1; i < TexelsInBlock; ++i)
+        WriteBits(dst, bitOffset, indices[i], 4);
+    assert(bitOffset == 128);
+}
+
+void DecodeBC7Block(const byte* src, Block& block)
+{
+    if ((src[0] & 0x7F) != (1 << 6))
+    {
+        assert("Only BC7 mode 6 blocks can be decoded" && false);
+        for (Texel& t : block)
+            t = { 255, 0, 255, 255 };
+        return;
+    }
+
+    UINT bitOffset = 7;
+    BC7Endpoint e0;
+    BC7Endpoint e1;
+    for (UINT c = 0; c < 4; ++c)
+    {
+        e0.Quantized[c] = ReadBits(src, bitOffset, 7);
+        e1.Quantized[c] = ReadBits(src, bitOffset, 7);
+    }
+    e0.PBit = ReadBits(src, bitOffset, 1);
+    e1.PBit = ReadBits(src, bitOffset, 1);
+
+    Texel palette[16];
+    BuildBC7Palette(e0, e1, palette);
+    for (UINT i = 0; i < TexelsInBlock; ++i)
+        block[i] = palette[ReadBits(src, bitOffset, i == 0 ? 3 : 4)];
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// BC6H mode 11: one region, unsigned 10 bit endpoints without deltas, 4 bit indices
+//////////////////////////////////////////////////////////////////////////
+
+// BC6H interpolates the bit patterns of half floats as integers. Endpoints are unquantized to 16 bits
+// and the interpolated values are rescaled to the half range with (v * 31) >> 6, so blocks are encoded in that 16 bit domain.
+constexpr int BC6HMaxValue = 0xFFFF;
+constexpr int MaxHalfBits = 0x7BFF; // 65504.0f
+
+int HalfBitsToBC6HDomain(UINT16 half)
+{
+    // Negative values and NaNs can't be represented in BC6H_UF16.
+    int value = (half & 0x8000) ? 0 : std::min<int>(half, MaxHalfBits);
+    return (value * 64 + 15) / 31;
+}
+
+int UnquantizeBC6H(int value)
+{
+    if (value == 0)
+        return 0;
+    if (value == 1023)
+        return BC6HMaxValue;
+    return ((value << 16) + 0x8000) >> 10;
+}
+
+std::array<int, 3> QuantizeBC6H(const std::array<float, 3>& color)
+{
+    std::array<int, 3> res;
+    for (UINT c = 0; c < 3; ++c)
+        res[c] = std::clamp(static_cast<int>((color[c] - 32.0f) / 64.0f + 0.5f), 0, 1023);
+    return res;
+}
+
+void BuildBC6HPalette(const std::array<int, 3>& e0, const std::array<int, 3>& e1, Texel (&palette)[16])
+{
+    for (UINT i = 0; i < 16; ++i)
+    {
+        for (UINT c = 0; c < 3; ++c)
+            palette[i][c] = ((64 - BC7Weights[i]) * UnquantizeBC6H(e0[c]) + BC7Weights[i] * UnquantizeBC6H(e1[c]) + 32) >> 6;
+        palette[i][3] = 0;
+    }
+}
+
+INT64 FindBC6HIndices(const Block& block, const std::array<int, 3>& e0, const std::array<int, 3>& e1, std::array<UINT, TexelsInBlock>& indices)
+{
+    Texel palette[16];
+    BuildBC6HPalette(e0, e1, palette);
+    INT64 error = 0;
+    for (UINT i = 0; i < TexelsInBlock; ++i)
+    {
+        INT64 bestDistance = std::numeric_limits<INT64>::max();
+        for (UINT p = 0; p < 16; ++p)
+        {
+            INT64 distance = 0;
+            for (UINT c = 0; c < 3; ++c)
+                distance += INT64(block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                indices[i] = p;
+            }
+        }
+        error += bestDistance;
+    }
+    return error;
+}
+
+void EncodeBC6HBlock(const Block& block, byte* dst)
+{
+    std::array<float, 3> c0;
+    std::array<float, 3> c1;
+    FindEndpoints<3>(block, c0, c1, float(BC6HMaxValue));
+
+    std::array<int, 3> e0 = QuantizeBC6H(c0);
+    std::array<int, 3> e1 = QuantizeBC6H(c1);
+    std::array<UINT, TexelsInBlock> indices{};
+    INT64 error = FindBC6HIndices(block, e0, e1, indices);
+
+    for (UINT iteration = 0; iteration < 2 && error > 0; ++iteration)
+    {
+        float weights[TexelsInBlock];
+        for (UINT i = 0; i < TexelsInBlock; ++i)
+            weights[i] = (64 - BC7Weights[indices[i]]) / 64.0f;
+        if (!RefitEndpoints<3>(block, weights, c0, c1, float(BC6HMaxValue)))
+            break;
+
+        std::array<int, 3> refitE0 = QuantizeBC6H(c0);
+        std::array<int, 3> refitE1 = QuantizeBC6H(c1);
+        std::array<UINT, TexelsInBlock> refitIndices{};
+        INT64 refitError = FindBC6HIndices(block, refitE0, refitE1, refitIndices);
+        if (refitError >= error)
+            break;
+        e0 = refitE0;
+        e1 = refitE1;
+        indices = refitIndices;
+        error = refitError;
+    }
+
+    if (indices[0] >= 8)
+    {
+        std::swap(e0, e1);
+        for (UINT& index : indices)
+            index = 15 - index;
+    }
+
+    memset(dst, 0, 16);
+    UINT bitOffset = 0;
+    WriteBits(dst, bitOffset, 0x03, 5);
+    for (UINT c = 0; c < 3; ++c)
+        WriteBits(dst, bitOffset, e0[c], 10);
+    for (UINT c = 0; c < 3; ++c)
+        WriteBits(dst, bitOffset, e1[c], 10);
+    WriteBits(dst, bitOffset, indices[0], 3);
+    for (UINT i = 1; i < TexelsInBlock; ++i)
+        WriteBits(dst, bitOffset, indices[i], 4);
+    assert(bitOffset == 128);
+}
+
+void DecodeBC6HBlock(const byte* src, std::array<std::array<UINT16, 4>, TexelsInBlock>& block)
+{
+    UINT bitOffset = 0;
+    if (ReadBits(src, bitOffset, 5) != 0x03)
+    {
+        assert("Only BC6H mode 11 blocks can be decoded" && false);
+        for (auto& t : block)
+            t = { 0x3C00, 0, 0x3C00, 0x3C00 };
+        return;
+    }
+
+    std::array<int, 3> e0;
+    std::array<int, 3> e1;
+    for (UINT c = 0; c < 3; ++c)
+        e0[c] = ReadBits(src, bitOffset, 10);
+    for (UINT c = 0; c < 3; ++c)
+        e1[c] = ReadBits(src, bitOffset, 10);
+
+    Texel palette[16];
+    BuildBC6HPalette(e0, e1, palette);
+    for (UINT i = 0; i < TexelsInBlock; ++i)
+    {
+        const Texel& color = palette[ReadBits(src, bitOffset, i == 0 ? 3 : 4)];
+        for (UINT c = 0; c < 3; ++c)
+            block[i][c] = static_cast<UINT16>((color[c] * 31) >> 6);
+        block[i][3] = 0x3C00; // 1.0f
+    }
+}
+
+void EncodeBlock(const Block& block, DXGI_FORMAT format, byte* dst)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+        EncodeColorBlock(block, dst);
+        break;
+    case DXGI_FORMAT_BC3_UNORM:
+        EncodeChannelBlock(block, 3, dst);
+        EncodeColorBlock(block, dst + 8);
+        break;
+    case DXGI_FORMAT_BC4_UNORM:
+        EncodeChannelBlock(block, 0, dst);
+        break;
+    case DXGI_FORMAT_BC5_UNORM:
+        EncodeChannelBlock(block, 0, dst);
+        EncodeChannelBlock(block, 1, dst + 8);
+        break;
+    case DXGI_FORMAT_BC7_UNORM:
+        EncodeBC7Block(block, dst);
+        break;
+    default:
+        assert("Unsupported block compression format" && false);
+    }
+}
+
+void DecodeBlock(const byte* src, DXGI_FORMAT format, Block& block)
+{
+    for (Texel& t : block)
+        t = { 0, 0, 0, 255 };
+
+    switch (format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+        DecodeColorBlock(src, true, block);
+        break;
+    case DXGI_FORMAT_BC3_UNORM:
+        DecodeChannelBlock(src, 3, block);
+        DecodeColorBlock(src + 8, false, block);
+        break;
+    case DXGI_FORMAT_BC4_UNORM:
+        DecodeChannelBlock(src, 0, block);
+        break;
+    case DXGI_FORMAT_BC5_UNORM:
+        DecodeChannelBlock(src, 0, block);
+        DecodeChannelBlock(src + 8, 1, block);
+        break;
+    case DXGI_FORMAT_BC7_UNORM:
+        DecodeBC7Block(src, block);
+        break;
+    default:
+        assert("Unsupported block compression format" && false);
+    }
+}
+}
+
+std::vector<byte> Compress(const byte* rgba, UINT width, UINT height, DXGI_FORMAT format)
+{
+    const UINT blocksX = (width + BlockDim - 1) / BlockDim;
+    const UINT blocksY = (height + BlockDim - 1) / BlockDim;
+    const UINT blockSize = GetBlockByteSize(format);
+
+    std::vector<byte> res(size_t(blocksX) * blocksY * blockSize);
+    ParallelFor(blocksY, [&](size_t blockY)
+    {
+        Block block;
+        for (UINT blockX = 0; blockX < blocksX; ++blockX)
+        {
+            FetchBlock(rgba, width, height, blockX, static_cast<UINT>(blockY), block);
+            EncodeBlock(block, format, res.data() + (blockY * blocksX + blockX) * blockSize);
+        }
+    });
+    return res;
+}
+
+std::vector<byte> Decompress(const byte* data, UINT width, UINT height, DXGI_FORMAT format)
+{
+    const UINT blocksX = (width + BlockDim - 1) / BlockDim;
+    const UINT blocksY = (height + BlockDim - 1) / BlockDim;
+    const UINT blockSize = GetBlockByteSize(format);
+
+    std::vector<byte> res(size_t(width) * height * 4);
+    ParallelFor(blocksY, [&](size_t blockY)
+    {
+        Block block;
+        for (UINT blockX = 0; blockX < blocksX; ++blockX)
+        {
+            DecodeBlock(data + (blockY * blocksX + blockX) * blockSize, format, block);
+            StoreBlock(res.data(), width, height, blockX, static_cast<UINT>(blockY), block);
+        }
+    });
+    return res;
+}
+
+std::vector<byte> CompressHdr(const UINT16* rgbaHalf, UINT width, UINT height)
+{
+    const UINT blocksX = (width + BlockDim - 1) / BlockDim;
+    const UINT blocksY = (height + BlockDim - 1) / BlockDim;
+    const UINT blockSize = GetBlockByteSize(DXGI_FORMAT_BC6H_UF16);
+
+    std::vector<byte> res(size_t(blocksX) * blocksY * blockSize);
+    ParallelFor(blocksY, [&](size_t blockY)
+    {
+        Block block;
+        for (UINT blockX = 0; blockX < blocksX; ++blockX)
+        {
+            for (UINT y = 0; y < BlockDim; ++y)
+            {
+                UINT srcY = std::min(static_cast<UINT>(blockY) * BlockDim + y, height - 1);
+                for (UINT x = 0; x < BlockDim; ++x)
+                {
+                    UINT srcX = std::min(blockX * BlockDim + x, width - 1);
+                    const UINT16* src = rgbaHalf + (size_t(srcY) * width + srcX) * 4;
+                    for (UINT c = 0; c < 3; ++c)
+                        block[y * BlockDim + x][c] = HalfBitsToBC6HDomain(src[c]);
+                }
+            }
+            EncodeBC6HBlock(block, res.data() + (blockY * blocksX + blockX) * blockSize);
+        }
+    });
+    return res;
+}
+
+std::vector<UINT16> DecompressHdr(const byte* data, UINT width, UINT height)
+{
+    const UINT blocksX = (width + BlockDim - 1) / BlockDim;
+    const UINT blocksY = (height + BlockDim - 1) / BlockDim;
+    const UINT blockSize = GetBlockByteSize(DXGI_FORMAT_BC6H_UF16);
+
+    std::vector<UINT16> res(size_t(width) * height * 4);
+    ParallelFor(blocksY, [&](size_t blockY)
+    {
+        std::array<std::array<UINT16, 4>, TexelsInBlock> block;
+        for (UINT blockX = 0; blockX < blocksX; ++blockX)
+        {
+            DecodeBC6HBlock(data + (blockY * blocksX + blockX) * blockSize, block);
+            for (UINT y = 0; y < BlockDim && blockY * BlockDim + y < height; ++y)
+                for (UINT x = 0; x < BlockDim && blockX * BlockDim + x < width; ++x)
+                    memcpy(&res[((blockY * BlockDim + y) * width + blockX * BlockDim + x) * 4], block[y * BlockDim + x].data(), sizeof(UINT16) * 4);
+        }
+    });
+    return res;
+}
+
+float ComputePSNR(const byte* rgbaA, const byte* rgbaB, UINT width, UINT height, UINT channelsMask /*= 0xF*/)
+{
+    double squaredErrorSum = 0.0;
+    size_t samplesCount = 0;
+    for (size_t i = 0; i < size_t(width) * height; ++i)
+    {
+        for (UINT c = 0; c < 4; ++c)
+        {
+            if ((channelsMask & (1 << c)) == 0)
+                continue;
+            double diff = double(rgbaA[i * 4 + c]) - double(rgbaB[i * 4 + c]);
+            squaredErrorSum += diff * diff;
+            ++samplesCount;
+        }
+    }
+    if (samplesCount == 0 || squaredErrorSum == 0.0)
+        return std::numeric_limits<float>::infinity();
+    double mse = squaredErrorSum / samplesCount;
+    return static_cast<float>(10.0 * std::log10(255.0 * 255.0 / mse));
+}
+}
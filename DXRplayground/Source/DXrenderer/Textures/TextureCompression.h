@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include <dxgi1_6.h>
+
+namespace DirectxPlayground::TextureCompression
+{
+// CPU block compression of RGBA8 images. Blocks are encoded in parallel, the partial blocks at the right and bottom edges replicate the edge texels.
+// Supported formats: BC1, BC3, BC4 (R channel), BC5 (RG channels) and BC7 (mode 6 only).
+std::vector<byte> Compress(const byte* rgba, UINT width, UINT height, DXGI_FORMAT format);
+
+// Decodes the formats produced by Compress back to RGBA8. Used by the tests to validate the encoder.
+std::vector<byte> Decompress(const byte* data, UINT width, UINT height, DXGI_FORMAT format);
+
+// Encodes RGBA16F texels to BC6H_UF16 (mode 11 only), alpha is dropped and negative values are clamped to zero.
+std::vector<byte> CompressHdr(const UINT16* rgbaHalf, UINT width, UINT height);
+
+// Decodes the BC6H blocks produced by CompressHdr to RGBA16F.
+std::vector<UINT16> DecompressHdr(const byte* data, UINT width, UINT height);
+
+// channelsMask: bit 0 - R, bit 1 - G, bit 2 - B, bit 3 - A.
+float ComputePSNR(const byte* rgbaA, const byte* rgbaB, UINT width, UINT height, UINT channelsMask = 0xF);
+}
@@ -1,28 +1,172 @@
 #include "TextureManager.h"
 
+#include <algorithm>
+#include <cctype>
 #include <filesystem>
 #include <vector>
 #include <sstream>
+#include <tuple>
 
 #include "External/Dx12Helpers/d3dx12.h"
 
 #include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/Buffers/UploadRing.h"
+#include "DXrenderer/Memory/DeferredReleaseQueue.h"
+#include "DXrenderer/Memory/GpuMemoryAllocator.h"
+#include "DXrenderer/RenderPipeline.h"
+#include "DXrenderer/ResourceStateTracker.h"
+#include "DXrenderer/Textures/BrdfLut.h"
 #include "DXrenderer/Textures/Texture.h"
 
 #include "Utils/AssetSystem.h"
+#include "Utils/Helpers.h"
+#include "Utils/ParallelFor.h"
 
 namespace DirectxPlayground
 {
 namespace
 {
 constexpr UINT MaxImguiTexturesCount = 128;
-constexpr UINT MaxResources = 32768;
+constexpr UINT64 DefaultStreamingBudget = 256ull * 1024 * 1024;
+constexpr UINT MaxStreamingLoadsPerFrame = 4;
+constexpr UINT MipTailMaxSize = 128;
+constexpr UINT ArraySliceMaxSize = 128;
+constexpr UINT BrdfLutSize = 128;
+constexpr UINT BrdfLutSamplesCount = 1024;
+
+// Subresources of the texture starting from FirstSubresource go to the resource subresources starting from 0.
+struct MipsUpload
+{
+    ResourceDX* Resource = nullptr;
+    const Texture* Tex = nullptr;
+    UINT FirstSubresource = 0;
+    UINT SubresourcesCount = 0;
+};
+
+// In the D3D12 subresource order: mip + slice * mipsCount.
+std::vector<D3D12_SUBRESOURCE_DATA> GetSubresourcesData(const Texture& tex)
+{
+    std::vector<D3D12_SUBRESOURCE_DATA> res;
+    res.reserve(size_t(tex.GetMipsCount()) * tex.GetArraySize());
+    const byte* mipData = tex.GetData().data();
+    for (UINT slice = 0; slice < tex.GetArraySize(); ++slice)
+    {
+        for (UINT mip = 0; mip < tex.GetMipsCount(); ++mip)
+        {
+            D3D12_SUBRESOURCE_DATA data = {};
+            data.pData = mipData;
+            data.RowPitch = GetRowPitch(tex.GetFormat(), std::max(1U, tex.GetWidth() >> mip));
+            data.SlicePitch = data.RowPitch * GetRowsCount(tex.GetFormat(), std::max(1U, tex.GetHeight() >> mip));
+            mipData += data.SlicePitch;
+            res.push_back(data);
+        }
+    }
+    return res;
+}
+
+UINT GetHeapSlot(const TexResourceData& tex)
+{
+    return tex.IsCubemap ? RenderContext::CubemapsRangeStarts + tex.SRVOffset : tex.SRVOffset;
+}
+
+ResourceDX CreateTextureResource(RenderContext& ctx, const Texture& tex, UINT firstMip, UINT16 mipLevels, D3D12_RESOURCE_FLAGS flags, const std::string& name)
+{
+    ResourceDX resource{ D3D12_RESOURCE_STATE_COPY_DEST };
+
+    D3D12_RESOURCE_DESC texDesc = {};
+    texDesc.MipLevels = mipLevels;
+    texDesc.Format = tex.GetFormat();
+    texDesc.Width = std::max(1U, tex.GetWidth() >> firstMip); // TODO: to the next pot (h too)
+    texDesc.Height = std::max(1U, tex.GetHeight() >> firstMip);
+    texDesc.Flags = flags;
+    texDesc.DepthOrArraySize = static_cast<UINT16>(tex.GetArraySize());
+    texDesc.SampleDesc.Count = 1;
+    texDesc.SampleDesc.Quality = 0;
+    texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+
+    ctx.GpuAllocator->CreateResource(texDesc, nullptr, resource);
+
+#if defined(_DEBUG)
+    resource.SetName(name);
+#endif
+    return resource;
+}
+
+// The staging data goes to the upload ring, it is reclaimed once the GPU passes the commands recorded now.
+void UploadMips(RenderContext& ctx, const std::vector<MipsUpload>& uploads)
+{
+    ctx.StateTracker->Flush(ctx.CommandList);
+    for (const MipsUpload& upload : uploads)
+    {
+        UINT64 size = GetRequiredIntermediateSize(upload.Resource->Get(), 0, upload.SubresourcesCount);
+        UploadAllocation staging = ctx.UploadRing->Allocate(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        std::vector<D3D12_SUBRESOURCE_DATA> texData = GetSubresourcesData(*upload.Tex);
+        UpdateSubresources(ctx.CommandList, upload.Resource->Get(), staging.Resource, staging.Offset, 0, upload.SubresourcesCount, texData.data() + upload.FirstSubresource);
+    }
+}
+
+// The same file is cooked differently for different usages, so the usage and the creation flags are a part of the cache keys.
+std::string GetTextureFlagsKey(TextureUsage usage, bool streamed, bool generateMips)
+{
+    return "|" + std::to_string(static_cast<int>(usage)) + (streamed ? "|streamed" : "") + (generateMips ? "|mips" : "");
+}
+
+std::string NormalizeTexturePath(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path normalized = std::filesystem::weakly_canonical(path, error);
+    if (error)
+        normalized = std::filesystem::path(path).lexically_normal();
+    normalized.make_preferred();
+    // Windows paths are case insensitive.
+    std::string res = normalized.string();
+    std::transform(res.begin(), res.end(), res.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+    return res;
+}
+
+UINT64 GetTextureContentKey(const Texture& tex, const std::string& flagsKey)
+{
+    UINT desc[] = { tex.GetWidth(), tex.GetHeight(), tex.GetMipsCount(), tex.GetArraySize(), tex.IsCubemap() ? 1U : 0U, static_cast<UINT>(tex.GetFormat()) };
+    UINT64 hash = HashBytes(flagsKey.data(), flagsKey.size());
+    hash = HashBytes(desc, sizeof(desc), hash);
+    return HashBytes(tex.GetData().data(), tex.GetData().size(), hash);
+}
+
+// The tail is the first level which fits MipTailMaxSize. Block compressed resources need the top level to be a multiple of the block size,
+// so for them the tail starts earlier if some level above it isn't. Arrays aren't streamed, they are resident as a whole.
+UINT GetMipTailStart(const Texture& tex)
+{
+    UINT tail = 0;
+    if (tex.GetArraySize() > 1)
+        return tail;
+    while (tail + 1 < tex.GetMipsCount() && std::max(tex.GetWidth() >> tail, tex.GetHeight() >> tail) > MipTailMaxSize)
+        ++tail;
+    if (IsBlockCompressed(tex.GetFormat()))
+    {
+        for (UINT mip = 1; mip <= tail; ++mip)
+        {
+            if ((tex.GetWidth() >> mip) % 4 != 0 || (tex.GetHeight() >> mip) % 4 != 0)
+            {
+                tail = mip - 1;
+                break;
+            }
+        }
+    }
+    return tail;
+}
 }
 
 TextureManager::TextureManager(RenderContext& ctx)
+    : mStreamer(DefaultStreamingBudget)
+    , mPipeline(ctx.Pipeline)
+    , mGpuAllocator(ctx.GpuAllocator)
+    , mReleaseQueue(ctx.ReleaseQueue)
+    , mTextureSrvs(RenderContext::MaxTextures - TransientSrvsPerFrame * RenderContext::FramesCount, TransientSrvsPerFrame, RenderContext::FramesCount)
+    , mCubemapSrvs(RenderContext::MaxCubemaps)
+    , mCubemapUavs(RenderContext::MaxUAVTextures)
+    , mRtvs(RenderContext::MaxRT)
 {
     mMipGenerator = new MipGenerator(ctx);
-    mResources.resize(MaxResources);
     CreateSRVHeap(ctx);
     CreateRTVHeap(ctx);
     CreateUAVHeap(ctx);
@@ -35,97 +179,497 @@ TextureManager::~TextureManager()
 
 TexResourceData TextureManager::CreateTexture(RenderContext& ctx, const std::string& filename, bool generateMips /*= true*/, bool allowUAV /*= false*/)
 {
-    Texture tex{};
-    AssetSystem::Load(filename, tex);
+    return CreateTextures(ctx, { filename }, {}, generateMips).front();
+}
 
-    ResourceDX resource{ D3D12_RESOURCE_STATE_COPY_DEST };
-    ResourceDX uploadResource{ D3D12_RESOURCE_STATE_GENERIC_READ };
+std::vector<Texture> TextureManager::LoadTextures(const std::vector<std::string>& filenames, const std::vector<TextureUsage>& usages) const
+{
+    assert(usages.empty() || usages.size() == filenames.size());
+
+    // Decoding (or reading the cooked .bast) is the expensive part, so all files are loaded concurrently and uploaded afterwards.
+    std::vector<Texture> textures;
+    textures.reserve(filenames.size());
+    for (size_t i = 0; i < filenames.size(); ++i)
+        textures.emplace_back(usages.empty() ? TextureUsage::Raw : usages[i]);
+    ParallelFor(filenames.size(), [&filenames, &textures](size_t i)
+    {
+        AssetSystem::Load(filenames[i], textures[i]);
+    });
+    return textures;
+}
 
-    UINT16 mipLevels = generateMips ? Log2(std::min(tex.GetWidth(), tex.GetHeight())) + 1 : 1;
-    D3D12_RESOURCE_FLAGS flags = generateMips ? D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS : D3D12_RESOURCE_FLAG_NONE;
+std::vector<TexResourceData> TextureManager::CreateTextures(RenderContext& ctx, const std::vector<std::string>& filenames, const std::vector<TextureUsage>& usages /*= {}*/, bool generateMips /*= false*/)
+{
+    return CreateCachedTextures(ctx, filenames, usages, false, generateMips);
+}
 
-    D3D12_RESOURCE_DESC texDesc = {};
-    texDesc.MipLevels = mipLevels;
-    texDesc.Format = tex.GetFormat();
-    texDesc.Width = tex.GetWidth(); // TODO: to the next pot (h too)
-    texDesc.Height = tex.GetHeight();
-    texDesc.Flags = flags;
-    texDesc.DepthOrArraySize = 1;
-    texDesc.SampleDesc.Count = 1;
-    texDesc.SampleDesc.Quality = 0;
-    texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+std::vector<TexResourceData> TextureManager::CreateStreamedTextures(RenderContext& ctx, const std::vector<std::string>& filenames, const std::vector<TextureUsage>& usages)
+{
+    return CreateCachedTextures(ctx, filenames, usages, true, false);
+}
 
-    CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
-    ThrowIfFailed(ctx.Device->CreateCommittedResource(&heapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &texDesc,
-        resource.GetCurrentState(),
-        nullptr,
-        IID_PPV_ARGS(resource.GetAddressOf())));
+std::vector<TexResourceData> TextureManager::CreateCachedTextures(RenderContext& ctx, const std::vector<std::string>& filenames, const std::vector<TextureUsage>& usages, bool streamed, bool generateMips)
+{
+    if (filenames.empty())
+        return {};
+    assert(usages.empty() || usages.size() == filenames.size());
+
+    // Repeated paths are resolved before loading, so they are decoded only once.
+    std::vector<TextureCache::Location> locations(filenames.size());
+    std::vector<size_t> sources(filenames.size()); // The first request of the same texture in this batch.
+    std::vector<std::string> pathKeys(filenames.size());
+    std::vector<std::string> flagsKeys(filenames.size());
+    std::map<std::string, size_t> batchPaths;
+    std::vector<size_t> toLoad;
+    for (size_t i = 0; i < filenames.size(); ++i)
+    {
+        flagsKeys[i] = GetTextureFlagsKey(usages.empty() ? TextureUsage::Raw : usages[i], streamed, generateMips);
+        pathKeys[i] = NormalizeTexturePath(filenames[i]) + flagsKeys[i];
+        sources[i] = i;
+        if (const TextureCache::Location* cached = mCache.FindPath(pathKeys[i]))
+        {
+            locations[i] = *cached;
+            continue;
+        }
+        auto batchPath = batchPaths.emplace(pathKeys[i], i);
+        if (batchPath.second)
+            toLoad.push_back(i);
+        else
+            sources[i] = batchPath.first->second;
+    }
 
-#if defined(_DEBUG)
-    std::wstring s{ filename.begin(), filename.end() };
-    SetDXobjectName(resource.Get(), s.c_str());
-#endif
+    std::vector<std::string> loadNames;
+    std::vector<TextureUsage> loadUsages;
+    for (size_t i : toLoad)
+    {
+        loadNames.push_back(filenames[i]);
+        loadUsages.push_back(usages.empty() ? TextureUsage::Raw : usages[i]);
+    }
+    std::vector<Texture> textures = LoadTextures(loadNames, loadUsages);
+    std::vector<UINT64> contentKeys(textures.size());
+    ParallelFor(textures.size(), [&](size_t i)
+    {
+        contentKeys[i] = GetTextureContentKey(textures[i], flagsKeys[toLoad[i]]);
+    });
+
+    // Different files with the same cooked content share the resource too.
+    std::vector<Texture> uniqueTextures;
+    std::vector<std::string> uniqueNames;
+    std::vector<size_t> uniqueRequests;
+    std::vector<UINT64> uniqueContentKeys;
+    std::map<UINT64, size_t> batchContents;
+    for (size_t i = 0; i < textures.size(); ++i)
+    {
+        size_t request = toLoad[i];
+        if (const TextureCache::Location* cached = mCache.FindContent(contentKeys[i]))
+        {
+            locations[request] = *cached;
+            continue;
+        }
+        auto batchContent = batchContents.emplace(contentKeys[i], request);
+        if (!batchContent.second)
+        {
+            sources[request] = batchContent.first->second;
+            continue;
+        }
+        uniqueTextures.push_back(std::move(textures[i]));
+        uniqueNames.push_back(filenames[request]);
+        uniqueRequests.push_back(request);
+        uniqueContentKeys.push_back(contentKeys[i]);
+    }
 
-    const UINT64 uploadBufferSize = GetRequiredIntermediateSize(resource.Get(), 0, 1);
+    // Small textures gain nothing from streaming, in arrays they take one resource and one descriptor per group instead.
+    std::vector<std::vector<size_t>> groups = generateMips ? std::vector<std::vector<size_t>>{} : GroupSmallTextures(uniqueTextures);
+    std::vector<Texture> arrays;
+    std::vector<std::string> arrayNames;
+    std::vector<bool> packed(uniqueTextures.size(), false);
+    for (const std::vector<size_t>& group : groups)
+    {
+        arrays.push_back(std::move(uniqueTextures[group[0]]));
+        for (size_t slice = 1; slice < group.size(); ++slice)
+            arrays.back().AddArraySlice(uniqueTextures[group[slice]]);
+        for (size_t i : group)
+            packed[i] = true;
+        arrayNames.push_back(uniqueNames[group[0]] + "_array");
+    }
+    if (!arrays.empty())
+    {
+        std::vector<TexResourceData> created = CreateTextureResources(ctx, arrays, arrayNames, false);
+        for (size_t i = 0; i < created.size(); ++i)
+        {
+            UINT slot = GetHeapSlot(created[i]);
+            std::vector<UINT64> sliceContentKeys;
+            for (UINT slice = 0; slice < groups[i].size(); ++slice)
+            {
+                size_t unique = groups[i][slice];
+                sliceContentKeys.push_back(uniqueContentKeys[unique]);
+                locations[uniqueRequests[unique]] = { slot, slice };
+            }
+            mCache.Add(slot, created[i], sliceContentKeys, true);
+        }
+    }
 
-    size_t texSize = tex.GetData().size() * sizeof(byte);
-    CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
-    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
-    ThrowIfFailed(ctx.Device->CreateCommittedResource(
-        &uploadHeapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
-        uploadResource.GetCurrentState(),
-        nullptr,
-        IID_PPV_ARGS(uploadResource.GetAddressOf())));
+    std::vector<Texture> singleTextures;
+    std::vector<std::string> singleNames;
+    std::vector<size_t> singleUniques;
+    for (size_t i = 0; i < uniqueTextures.size(); ++i)
+    {
+        if (packed[i])
+            continue;
+        singleTextures.push_back(std::move(uniqueTextures[i]));
+        singleNames.push_back(uniqueNames[i]);
+        singleUniques.push_back(i);
+    }
+    if (!singleTextures.empty())
+    {
+        std::vector<TexResourceData> created = streamed ? CreateStreamedResources(ctx, singleTextures, singleNames) : CreateTextureResources(ctx, singleTextures, singleNames, generateMips);
+        for (size_t i = 0; i < created.size(); ++i)
+        {
+            UINT slot = GetHeapSlot(created[i]);
+            mCache.Add(slot, created[i], { uniqueContentKeys[singleUniques[i]] }, false);
+            locations[uniqueRequests[singleUniques[i]]] = { slot, InvalidOffset };
+        }
+    }
 
-    D3D12_SUBRESOURCE_DATA texData = {};
-    texData.pData = tex.GetData().data();
-    texData.RowPitch = size_t(tex.GetWidth()) * GetPixelSize(tex.GetFormat());
-    texData.SlicePitch = texData.RowPitch * tex.GetHeight();
+    std::vector<TexResourceData> result;
+    result.reserve(filenames.size());
+    for (size_t i = 0; i < filenames.size(); ++i)
+    {
+        if (locations[i].Slot == InvalidOffset)
+            locations[i] = locations[sources[i]];
+        result.push_back(mCache.AddRef(locations[i], pathKeys[i]));
+    }
+    return result;
+}
 
-    UpdateSubresources(ctx.CommandList, resource.Get(), uploadResource.Get(), 0, 0, 1, &texData);
-    resource.Transition(ctx.CommandList, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+// Groups of at least two textures with the same size, mips count and format, each group is at most the array size limit.
+std::vector<std::vector<size_t>> TextureManager::GroupSmallTextures(const std::vector<Texture>& textures) const
+{
+    std::map<std::tuple<UINT, UINT, UINT, DXGI_FORMAT>, std::vector<size_t>> candidates;
+    for (size_t i = 0; i < textures.size(); ++i)
+    {
+        const Texture& tex = textures[i];
+        if (tex.GetArraySize() != 1 || tex.IsCubemap() || std::max(tex.GetWidth(), tex.GetHeight()) > ArraySliceMaxSize)
+            continue;
+        candidates[{ tex.GetWidth(), tex.GetHeight(), tex.GetMipsCount(), tex.GetFormat() }].push_back(i);
+    }
 
-    D3D12_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
-    viewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    viewDesc.Format = resource.Get()->GetDesc().Format;
-    viewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-    viewDesc.Texture2D.MipLevels = resource.Get()->GetDesc().MipLevels;
-    viewDesc.Texture2D.MostDetailedMip = 0;
-    viewDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+    std::vector<std::vector<size_t>> groups;
+    for (const auto& candidate : candidates)
+    {
+        const std::vector<size_t>& ids = candidate.second;
+        for (size_t first = 0; first + 1 < ids.size(); first += D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION)
+        {
+            size_t last = std::min(ids.size(), first + D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION);
+            groups.emplace_back(ids.begin() + first, ids.begin() + last);
+        }
+    }
+    return groups;
+}
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
-    handle.Offset(mCurrentTexCount * ctx.CbvSrvUavDescriptorSize);
-    ctx.Device->CreateShaderResourceView(resource.Get(), &viewDesc, handle);
+TexResourceData TextureManager::CreateTexture(RenderContext& ctx, Texture&& texture, const std::string& name, bool generateMips /*= false*/)
+{
+    std::vector<Texture> textures;
+    textures.push_back(std::move(texture));
+    TexResourceData res = CreateTextureResources(ctx, textures, { name }, generateMips).front();
+    UINT slot = GetHeapSlot(res);
+    mCache.Add(slot, res, {}, false);
+    return mCache.AddRef({ slot, InvalidOffset }, {});
+}
 
-    mResources.push_back(resource);
-    mUploadResources.push_back(uploadResource);
+void TextureManager::ReleaseTexture(const TexResourceData& texture)
+{
+    TexResourceData cached;
+    if (!mCache.Release(GetHeapSlot(texture), cached))
+        return;
 
-    TexResourceData res{};
-    res.SRVOffset = mCurrentTexCount++;
-    res.ResourceIdx = static_cast<UINT>(mResources.size()) - 1;
-    res.Resource = &mResources.back();
+    auto streamed = texture.IsCubemap ? mStreamedSrvs.end() : mStreamedSrvs.find(texture.SRVOffset);
+    if (streamed != mStreamedSrvs.end())
+    {
+        ReleaseStreamedTexture(streamed->second);
+        mStreamedSrvs.erase(streamed);
+    }
+    else
+    {
+        RetireResource(*mResources.Get(cached.Resource));
+        mResources.Destroy(cached.Resource);
+        (texture.IsCubemap ? mCubemapSrvs : mTextureSrvs).Free(texture.SRVOffset, 1, mPipeline->GetPendingFenceValue());
+    }
+}
 
-    if (generateMips)
-        mMipGenerator->GenerateMips(ctx, &mResources.back());
+void TextureManager::ReleaseStreamedTexture(UINT id)
+{
+    mStreamer.Unregister(id);
+    StreamedTexture& streamed = mStreamedTextures[id];
+    RetireResource(streamed.Resource);
+    // Both descriptors, a frame in flight could use either of them.
+    mTextureSrvs.Free(streamed.SrvSlots[0], 2, mPipeline->GetPendingFenceValue());
+    // The uploads copy the levels to the staging memory while recording, so the CPU copy isn't needed by the GPU.
+    streamed = StreamedTexture();
+}
 
-    return res;
+UINT TextureManager::GetTextureRefCount(const TexResourceData& texture) const
+{
+    return mCache.GetRefCount(GetHeapSlot(texture));
+}
+
+std::vector<TexResourceData> TextureManager::CreateTextureResources(RenderContext& ctx, std::vector<Texture>& textures, const std::vector<std::string>& names, bool generateMips)
+{
+    std::vector<ResourceDX> resources;
+    std::vector<bool> mipsRequested;
+    resources.reserve(textures.size());
+    mipsRequested.reserve(textures.size());
+    for (size_t i = 0; i < textures.size(); ++i)
+    {
+        const Texture& tex = textures[i];
+
+        // Cooked textures already have their mips. Runtime mips are generated with compute shaders, which can't write to block compressed formats.
+        bool withMips = generateMips && tex.GetMipsCount() == 1 && tex.GetArraySize() == 1 && !IsBlockCompressed(tex.GetFormat());
+        mipsRequested.push_back(withMips);
+
+        UINT16 mipLevels = withMips ? Log2(std::min(tex.GetWidth(), tex.GetHeight())) + 1 : static_cast<UINT16>(tex.GetMipsCount());
+        D3D12_RESOURCE_FLAGS flags = withMips ? D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS : D3D12_RESOURCE_FLAG_NONE;
+        resources.push_back(CreateTextureResource(ctx, tex, 0, mipLevels, flags, names[i]));
+    }
+
+    std::vector<MipsUpload> uploads;
+    uploads.reserve(resources.size());
+    for (size_t i = 0; i < textures.size(); ++i)
+        uploads.push_back({ &resources[i], &textures[i], 0, textures[i].GetMipsCount() * textures[i].GetArraySize() });
+    UploadMips(ctx, uploads);
+    for (ResourceDX& resource : resources)
+        ctx.StateTracker->Transition(resource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    std::vector<TexResourceData> result;
+    result.reserve(resources.size());
+    for (size_t i = 0; i < resources.size(); ++i)
+    {
+        // Cubemaps go to their own range of the heap, the same as the ones created with CreateCubemap.
+        TexResourceData res{};
+        res.IsCubemap = textures[i].IsCubemap();
+        res.SRVOffset = AllocateDescriptors(res.IsCubemap ? mCubemapSrvs : mTextureSrvs);
+        CreateTextureSRV(ctx, resources[i].Get(), GetHeapSlot(res), res.IsCubemap);
+
+        res.Resource = mResources.Create(resources[i]);
+
+        if (mipsRequested[i])
+            mMipGenerator->GenerateMips(ctx, mResources.Get(res.Resource));
+        result.push_back(res);
+    }
+
+    return result;
+}
+
+std::vector<TexResourceData> TextureManager::CreateStreamedResources(RenderContext& ctx, std::vector<Texture>& textures, const std::vector<std::string>& names)
+{
+    std::vector<UINT> ids;
+    ids.reserve(textures.size());
+    for (size_t i = 0; i < textures.size(); ++i)
+    {
+        StreamedTexture streamed;
+        streamed.Data = std::move(textures[i]);
+        const Texture& tex = streamed.Data;
+        assert(!tex.IsCubemap() && "Cubemaps can't be streamed");
+
+        StreamedTextureDesc desc;
+        desc.Width = tex.GetWidth();
+        desc.Height = tex.GetHeight();
+        desc.MipTailStart = GetMipTailStart(tex);
+        desc.MipSizes.resize(tex.GetMipsCount());
+        std::vector<D3D12_SUBRESOURCE_DATA> subresources = GetSubresourcesData(tex);
+        for (size_t subresource = 0; subresource < subresources.size(); ++subresource)
+            desc.MipSizes[subresource % tex.GetMipsCount()] += subresources[subresource].SlicePitch;
+
+        UINT id = mStreamer.Register(desc);
+        assert(id <= mStreamedTextures.size());
+
+        streamed.ResidentMip = desc.MipTailStart;
+        streamed.Resource = CreateTextureResource(ctx, tex, streamed.ResidentMip, static_cast<UINT16>(tex.GetMipsCount() - streamed.ResidentMip), D3D12_RESOURCE_FLAG_NONE, names[i]);
+        // Two descriptors per texture: a residency change writes the one the frames in flight don't use.
+        streamed.SrvSlots[0] = AllocateDescriptors(mTextureSrvs, 2);
+        streamed.SrvSlots[1] = streamed.SrvSlots[0] + 1;
+        mStreamedSrvs[streamed.SrvSlots[0]] = id;
+        // The ids of the released textures are reused.
+        if (id == mStreamedTextures.size())
+            mStreamedTextures.push_back(std::move(streamed));
+        else
+            mStreamedTextures[id] = std::move(streamed);
+        ids.push_back(id);
+    }
+
+    std::vector<MipsUpload> uploads;
+    for (UINT id : ids)
+    {
+        StreamedTexture& streamed = mStreamedTextures[id];
+        uploads.push_back({ &streamed.Resource, &streamed.Data, streamed.ResidentMip, (streamed.Data.GetMipsCount() - streamed.ResidentMip) * streamed.Data.GetArraySize() });
+    }
+    UploadMips(ctx, uploads);
+    for (UINT id : ids)
+        ctx.StateTracker->Transition(mStreamedTextures[id].Resource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    std::vector<TexResourceData> result;
+    result.reserve(textures.size());
+    for (UINT id : ids)
+    {
+        StreamedTexture& streamed = mStreamedTextures[id];
+        CreateTextureSRV(ctx, streamed.Resource.Get(), streamed.SrvSlots[0]);
+
+        TexResourceData res{};
+        res.SRVOffset = streamed.SrvSlots[0];
+        result.push_back(res);
+    }
+    return result;
+}
+
+void TextureManager::BeginFrame(RenderContext& ctx)
+{
+    UINT64 completedFence = ctx.Pipeline->GetCompletedFenceValue();
+    mTextureSrvs.Reclaim(completedFence);
+    mCubemapSrvs.Reclaim(completedFence);
+    mTextureSrvs.BeginFrame(ctx.SwapChain->GetCurrentBackBufferIndex());
+    mMipGenerator->BeginFrame(completedFence);
+}
+
+UINT TextureManager::AllocateTransientSrvs(UINT count)
+{
+    UINT index = mTextureSrvs.AllocateTransient(count);
+    assert(index != DescriptorAllocator::InvalidIndex && "Out of transient descriptors, increase TransientSrvsPerFrame");
+    return index;
+}
+
+void TextureManager::RetireResource(const ResourceDX& resource)
+{
+    // The frames in flight could still sample it, the placed memory is reused once they are finished.
+    GpuMemoryAllocator* allocator = mGpuAllocator;
+    mReleaseQueue->Enqueue(mPipeline->GetPendingFenceValue(), [allocator, resource]()
+    {
+        allocator->Release(resource.Get());
+    });
+}
+
+UINT TextureManager::AllocateDescriptors(DescriptorAllocator& allocator, UINT count)
+{
+    UINT index = allocator.Allocate(count);
+    assert(index != DescriptorAllocator::InvalidIndex && "Out of descriptors");
+    return index;
+}
+
+void TextureManager::UpdateStreaming(RenderContext& ctx)
+{
+    ++mFrameIndex;
+
+    // The frames which could reference the spare descriptors are finished after FramesCount frames.
+    for (UINT id = 0; id < mStreamedTextures.size(); ++id)
+    {
+        StreamedTexture& streamed = mStreamedTextures[id];
+        if (streamed.Busy && streamed.ChangeFrame + RenderContext::FramesCount <= mFrameIndex)
+        {
+            streamed.Busy = false;
+            mStreamer.SetBusy(id, false);
+        }
+    }
+
+    std::vector<StreamingRequest> requests = mStreamer.Update(MaxStreamingLoadsPerFrame);
+    if (requests.empty())
+        return;
+
+    // Every change recreates the resource with the requested levels. New levels come from the CPU copy, the rest is copied from the old resource.
+    std::vector<ResourceDX> newResources;
+    std::vector<MipsUpload> uploads;
+    newResources.reserve(requests.size());
+    for (const StreamingRequest& request : requests)
+    {
+        StreamedTexture& streamed = mStreamedTextures[request.TextureId];
+        const Texture& tex = streamed.Data;
+        newResources.push_back(CreateTextureResource(ctx, tex, request.MostDetailedMip, static_cast<UINT16>(tex.GetMipsCount() - request.MostDetailedMip), D3D12_RESOURCE_FLAG_NONE, "streamed_texture"));
+        if (request.MostDetailedMip < streamed.ResidentMip)
+            uploads.push_back({ &newResources.back(), &tex, request.MostDetailedMip, streamed.ResidentMip - request.MostDetailedMip });
+        ctx.StateTracker->Transition(streamed.Resource, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    }
+    UploadMips(ctx, uploads);
+
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        StreamedTexture& streamed = mStreamedTextures[requests[i].TextureId];
+        UINT targetMip = requests[i].MostDetailedMip;
+        for (UINT mip = std::max(targetMip, streamed.ResidentMip); mip < streamed.Data.GetMipsCount(); ++mip)
+        {
+            CD3DX12_TEXTURE_COPY_LOCATION dst(newResources[i].Get(), mip - targetMip);
+            CD3DX12_TEXTURE_COPY_LOCATION src(streamed.Resource.Get(), mip - streamed.ResidentMip);
+            ctx.CommandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+        }
+        ctx.StateTracker->Transition(newResources[i], D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    }
+
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        StreamedTexture& streamed = mStreamedTextures[requests[i].TextureId];
+        RetireResource(streamed.Resource);
+        streamed.Resource = newResources[i];
+        streamed.ResidentMip = requests[i].MostDetailedMip;
+        streamed.CurrentSlot ^= 1;
+        CreateTextureSRV(ctx, streamed.Resource.Get(), streamed.SrvSlots[streamed.CurrentSlot]);
+
+        streamed.Busy = true;
+        streamed.ChangeFrame = mFrameIndex;
+        mStreamer.SetBusy(requests[i].TextureId, true);
+    }
+}
+
+void TextureManager::SetStreamingFeedback(UINT srv, bool visible, float screenSize)
+{
+    auto it = mStreamedSrvs.find(srv);
+    if (it != mStreamedSrvs.end())
+        mStreamer.SetFeedback(it->second, visible, screenSize);
+}
+
+UINT TextureManager::ResolveSrv(UINT srv) const
+{
+    auto it = mStreamedSrvs.find(srv);
+    if (it == mStreamedSrvs.end())
+        return srv;
+    const StreamedTexture& streamed = mStreamedTextures[it->second];
+    return streamed.SrvSlots[streamed.CurrentSlot];
+}
+
+void TextureManager::CreateTextureSRV(RenderContext& ctx, ID3D12Resource* resource, UINT slot, bool isCubemap /*= false*/)
+{
+    D3D12_RESOURCE_DESC desc = resource->GetDesc();
+    D3D12_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+    viewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    viewDesc.Format = desc.Format;
+    if (isCubemap && desc.DepthOrArraySize > 6)
+    {
+        viewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBEARRAY;
+        viewDesc.TextureCubeArray.MipLevels = desc.MipLevels;
+        viewDesc.TextureCubeArray.NumCubes = desc.DepthOrArraySize / 6;
+    }
+    else if (isCubemap)
+    {
+        viewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+        viewDesc.TextureCube.MipLevels = desc.MipLevels;
+    }
+    else if (desc.DepthOrArraySize > 1)
+    {
+        viewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+        viewDesc.Texture2DArray.MipLevels = desc.MipLevels;
+        viewDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
+    }
+    else
+    {
+        viewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        viewDesc.Texture2D.MipLevels = desc.MipLevels;
+    }
+
+    CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
+    handle.Offset(slot * ctx.CbvSrvUavDescriptorSize);
+    ctx.Device->CreateShaderResourceView(resource, &viewDesc, handle);
 }
 
 TexResourceData TextureManager::CreateTexture(RenderContext& ctx, D3D12_RESOURCE_DESC desc, const std::wstring& name, D3D12_RESOURCE_STATES initialState)
 {
     ResourceDX resource{ initialState };
-
-    CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
-    ThrowIfFailed(ctx.Device->CreateCommittedResource(&heapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        initialState,
-        nullptr,
-        IID_PPV_ARGS(resource.GetAddressOf())));
+    ctx.GpuAllocator->CreateResource(desc, nullptr, resource);
 
 #if defined(_DEBUG)
     SetDXobjectName(resource.Get(), name.c_str());
@@ -140,15 +684,12 @@ TexResourceData TextureManager::CreateTexture(RenderContext& ctx, D3D12_RESOURCE
     viewDesc.Texture2D.MostDetailedMip = 0;
     viewDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 
+    res.SRVOffset = AllocateDescriptors(mTextureSrvs);
     CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
-    handle.Offset(mCurrentTexCount * ctx.CbvSrvUavDescriptorSize);
+    handle.Offset(res.SRVOffset * ctx.CbvSrvUavDescriptorSize);
     ctx.Device->CreateShaderResourceView(resource.Get(), &viewDesc, handle);
 
-    res.SRVOffset = mCurrentTexCount++;
-
-    mResources.push_back(resource);
-    res.ResourceIdx = static_cast<UINT>(mResources.size()) - 1;
-    res.Resource = &mResources.back();
+    res.Resource = mResources.Create(resource);
 
     return res;
 }
@@ -170,19 +711,13 @@ TexResourceData TextureManager::CreateCubemap(RenderContext& ctx, UINT size, DXG
     texDesc.SampleDesc.Quality = 0;
     texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 
-    CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
-    ThrowIfFailed(ctx.Device->CreateCommittedResource(&heapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &texDesc,
-        D3D12_RESOURCE_STATE_COMMON,
-        nullptr,
-        IID_PPV_ARGS(resource.GetAddressOf())));
+    ctx.GpuAllocator->CreateResource(texDesc, nullptr, resource);
 
 #if defined(_DEBUG)
     resource.SetName("cubemap");
 #endif
 
-    resource.Transition(ctx.CommandList, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    ctx.StateTracker->Transition(resource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
     D3D12_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
     viewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -192,15 +727,14 @@ TexResourceData TextureManager::CreateCubemap(RenderContext& ctx, UINT size, DXG
     viewDesc.Texture2D.MostDetailedMip = 0;
     viewDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 
+    TexResourceData res{};
+    res.IsCubemap = true;
+    res.SRVOffset = AllocateDescriptors(mCubemapSrvs);
+
     CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
-    handle.Offset((mCurrentCubemapCount + RenderContext::CubemapsRangeStarts) * ctx.CbvSrvUavDescriptorSize);
+    handle.Offset(GetHeapSlot(res) * ctx.CbvSrvUavDescriptorSize);
     ctx.Device->CreateShaderResourceView(resource.Get(), &viewDesc, handle);
 
-    TexResourceData res{};
-    res.SRVOffset = mCurrentCubemapCount;
-    res.ResourceIdx = static_cast<UINT>(mResources.size()) - 1;
-    ++mCurrentCubemapCount;
-
     if (allowUAV)
     {
         D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
@@ -210,62 +744,28 @@ TexResourceData TextureManager::CreateCubemap(RenderContext& ctx, UINT size, DXG
         uavDesc.Texture2DArray.FirstArraySlice = 0;
         uavDesc.Texture2DArray.MipSlice = 0;
 
+        res.UAVOffset = AllocateDescriptors(mCubemapUavs);
         CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mUavHeap->GetCPUDescriptorHandleForHeapStart());
-        handle.Offset(mCurrentUavCount * ctx.CbvSrvUavDescriptorSize);
+        handle.Offset(res.UAVOffset * ctx.CbvSrvUavDescriptorSize);
         ctx.Device->CreateUnorderedAccessView(resource.Get(), nullptr, &uavDesc, handle);
-        res.UAVOffset = mCurrentUavCount++;
     }
 
-    mResources.push_back(resource);
-    res.Resource = &mResources.back();
+    res.Resource = mResources.Create(resource);
 
     return res;
 }
 
-
-UINT TextureManager::CreateDxrOutput(RenderContext& ctx, D3D12_RESOURCE_DESC desc)
+const TexResourceData& TextureManager::GetBrdfLut(RenderContext& ctx)
 {
-    static UINT i = 0;
-    assert(i == 0);
-    i++;
-
-    CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
-    ThrowIfFailed(ctx.Device->CreateCommittedResource(&heapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        mRtResource.GetCurrentState(),
-        nullptr,
-        IID_PPV_ARGS(mRtResource.GetAddressOf())));
-
-#if defined(_DEBUG)
-    mRtResource.SetName("DXR Resource");
-#endif
-    D3D12_DESCRIPTOR_HEAP_DESC uavHeapDesc = {};
-    uavHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-    uavHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-    uavHeapDesc.NumDescriptors = 1;
-    ThrowIfFailed(ctx.Device->CreateDescriptorHeap(&uavHeapDesc, IID_PPV_ARGS(&mRtUavHeap)));
-    SetDXobjectName(mRtUavHeap.Get(), L"RT_UAV_HEAP");
-
-    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
-    uavDesc.Format = mRtResource.Get()->GetDesc().Format;
-    uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
-    uavDesc.Texture2D.MipSlice = 0;
-    uavDesc.Texture2D.PlaneSlice = 0;
-    ctx.Device->CreateUnorderedAccessView(mRtResource.Get(), nullptr, &uavDesc, mRtUavHeap->GetCPUDescriptorHandleForHeapStart());
-
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.Format = desc.Format;
-    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.Texture2D.MipLevels = mRtResource.Get()->GetDesc().MipLevels;
-    srvDesc.Texture2D.MostDetailedMip = 0;
-    srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-
-    CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
-    handle.Offset(mCurrentTexCount * ctx.CbvSrvUavDescriptorSize);
-    ctx.Device->CreateShaderResourceView(mRtResource.Get(), &srvDesc, handle);
-    return mCurrentTexCount++;
+    if (mBrdfLut.Resource == InvalidResourceHandle)
+    {
+        BrdfLut lut(BrdfLutSize, BrdfLutSamplesCount);
+        AssetSystem::LoadGenerated("BrdfLut", lut);
+        std::vector<byte> data = lut.GetData();
+        mBrdfLut = CreateTexture(ctx, Texture(lut.GetSize(), lut.GetSize(), BrdfLut::Format, std::move(data)), "BrdfLut");
+        GetResource(mBrdfLut.Resource)->SetName(L"BrdfLut");
+    }
+    return mBrdfLut;
 }
 
 void TextureManager::FlushMipsQueue(RenderContext& ctx)
@@ -276,14 +776,9 @@ void TextureManager::FlushMipsQueue(RenderContext& ctx)
 TexResourceData TextureManager::CreateRT(RenderContext& ctx, D3D12_RESOURCE_DESC desc, const std::wstring& name, D3D12_CLEAR_VALUE* clearValue /*= nullptr*/, bool createSRV /*= true*/, bool allowUAV /*= false*/)
 {
     ResourceDX resource{ D3D12_RESOURCE_STATE_RENDER_TARGET };
-
-    CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
-    ThrowIfFailed(ctx.Device->CreateCommittedResource(&heapProperties,
-        D3D12_HEAP_FLAG_NONE,
-        &desc,
-        resource.GetCurrentState(),
-        clearValue,
-        IID_PPV_ARGS(resource.GetAddressOf())));
+    ctx.GpuAllocator->CreateResource(desc, clearValue, resource);
+    // The placed memory could be used by another resource before, its content has to be initialized.
+    ctx.CommandList->DiscardResource(resource.Get(), nullptr);
 
 #if defined(_DEBUG)
     resource.SetName(name.c_str());
@@ -293,13 +788,12 @@ TexResourceData TextureManager::CreateRT(RenderContext& ctx, D3D12_RESOURCE_DESC
     rtDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D;
     rtDesc.Texture2D = { 0, 0 };
 
+    TexResourceData res;
+    res.RTVOffset = AllocateDescriptors(mRtvs);
     CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(mRtvHeap->GetCPUDescriptorHandleForHeapStart());
-    rtvHandle.Offset(mCurrentRtCount, ctx.RtvDescriptorSize);
+    rtvHandle.Offset(res.RTVOffset, ctx.RtvDescriptorSize);
     ctx.Device->CreateRenderTargetView(resource.Get(), &rtDesc, rtvHandle);
 
-    TexResourceData res;
-    res.RTVOffset = mCurrentRtCount++;
-
     if (createSRV)
     {
         D3D12_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
@@ -310,15 +804,12 @@ TexResourceData TextureManager::CreateRT(RenderContext& ctx, D3D12_RESOURCE_DESC
         viewDesc.Texture2D.MostDetailedMip = 0;
         viewDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 
+        res.SRVOffset = AllocateDescriptors(mTextureSrvs);
         CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mSrvHeap->GetCPUDescriptorHandleForHeapStart());
-        handle.Offset(mCurrentTexCount * ctx.CbvSrvUavDescriptorSize);
+        handle.Offset(res.SRVOffset * ctx.CbvSrvUavDescriptorSize);
         ctx.Device->CreateShaderResourceView(resource.Get(), &viewDesc, handle);
-
-        res.SRVOffset = mCurrentTexCount++;
     }
-    mResources.push_back(resource);
-    res.ResourceIdx = static_cast<UINT>(mResources.size()) - 1;
-    res.Resource = &mResources.back();
+    res.Resource = mResources.Create(resource);
 
     return res;
 }
@@ -3,89 +3,131 @@
 #include <cassert>
 #include <string>
 #include <map>
+#include <vector>
 
 #include <wrl.h>
 #include "External/Dx12Helpers/d3dx12.h"
 #include "DXrenderer/RenderContext.h"
+#include "DXrenderer/Memory/DescriptorAllocator.h"
+#include "DXrenderer/Memory/ResourcePool.h"
 #include "DXrenderer/Textures/MipGenerator.h"
+#include "DXrenderer/Textures/Texture.h"
+#include "DXrenderer/Textures/TextureCache.h"
+#include "DXrenderer/Textures/TextureStreamer.h"
 #include "DXrenderer/ResourceDX.h"
 
 namespace DirectxPlayground
 {
 struct RenderContext;
 
-constexpr UINT InvalidOffset = 0xFFFFFFFF;
-
-struct TexResourceData
-{
-    UINT RTVOffset = InvalidOffset;
-    UINT SRVOffset = InvalidOffset;
-    UINT UAVOffset = InvalidOffset;
-    UINT ResourceIdx = InvalidOffset;
-
-    ResourceDX* Resource = nullptr;
-};
-
 class TextureManager
 {
 public:
     TextureManager(RenderContext& ctx);
     ~TextureManager();
 
+    // Textures loaded from files are cached by the normalized path and by the content hash of the cooked data, a repeated request returns
+    // the existing TexResourceData and increments its reference count. Every returned texture has to be released with ReleaseTexture.
+    // Small textures of the same size, mips count and format loaded in one batch are packed into a texture array, check ArraySlice.
     TexResourceData CreateTexture(RenderContext& ctx, const std::string& filename, bool generateMips = false, bool allowUAV = false);
+    // usages may be empty, all textures are loaded as TextureUsage::Raw then. generateMips only affects Raw textures, the rest are cooked with mips.
+    std::vector<TexResourceData> CreateTextures(RenderContext& ctx, const std::vector<std::string>& filenames, const std::vector<TextureUsage>& usages = {}, bool generateMips = false);
+    // Only the mip tail is created right away, the detailed levels are streamed in by UpdateStreaming within the streaming budget.
+    // SRVOffset of the result is a handle, the descriptor behind it changes with the residency, so pass it through ResolveSrv every frame.
+    std::vector<TexResourceData> CreateStreamedTextures(RenderContext& ctx, const std::vector<std::string>& filenames, const std::vector<TextureUsage>& usages);
+    // Not shared with other requests, released with ReleaseTexture too. For textures the caller has already loaded, e.g. to read them
+    // on the CPU first.
+    TexResourceData CreateTexture(RenderContext& ctx, Texture&& texture, const std::string& name, bool generateMips = false);
+    void ReleaseTexture(const TexResourceData& texture);
+    UINT GetTextureRefCount(const TexResourceData& texture) const;
     TexResourceData CreateTexture(RenderContext& ctx, D3D12_RESOURCE_DESC desc, const std::wstring& name, D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
     TexResourceData CreateRT(RenderContext& ctx, D3D12_RESOURCE_DESC desc, const std::wstring& name, D3D12_CLEAR_VALUE* clearValue = nullptr, bool createSRV = true, bool allowUAV = false);
 
     TexResourceData CreateCubemap(RenderContext& ctx, UINT size, DXGI_FORMAT format, bool allowUAV = false, const byte* data = nullptr);
 
+    // The split sum environment BRDF shared by the PBR shaders, see BrdfLut. Created on the first call, cooked only once.
+    const TexResourceData& GetBrdfLut(RenderContext& ctx);
+
     ID3D12DescriptorHeap* GetDescriptorHeap() const;
     ID3D12DescriptorHeap* GetCubemapUAVHeap() const;
 
-    ID3D12DescriptorHeap* GetDXRUavHeap() const
-    {
-        return mRtUavHeap.Get();
-    }
-    //ID3D12DescriptorHeap* GetDXRSrvHeap() const
-    //{
-    //    return m_rtSrvHeap.Get();
-    //}
-    ID3D12Resource* GetDXRResource()
-    {
-        return mRtResource.Get();
-    }
-
     D3D12_CPU_DESCRIPTOR_HANDLE GetRtHandle(RenderContext& ctx, UINT index) const;
 
-    ID3D12Resource* GetResource(UINT index) const;
-
-    UINT CreateDxrOutput(RenderContext& ctx, D3D12_RESOURCE_DESC desc);
+    // nullptr once the texture is released.
+    ID3D12Resource* GetResource(ResourceHandle handle) const;
+    ResourceDX* GetResourceDX(ResourceHandle handle);
 
     void FlushMipsQueue(RenderContext& ctx);
 
     MipGenerator* GetMipGenerator();
 
+    // Reclaims the descriptors of the released textures the GPU is done with and resets the transient ones of the frame.
+    // Call it once per frame before anything else.
+    void BeginFrame(RenderContext& ctx);
+    // count consecutive SRVs in the textures range of the heap, valid until the same back buffer index is used again.
+    UINT AllocateTransientSrvs(UINT count);
+
+    // Records the residency changes on the frame command list, call it once per frame before the scene is rendered.
+    void UpdateStreaming(RenderContext& ctx);
+    // screenSize - size in pixels the texture spans on screen along its longest side. Textures without feedback are streamed in fully.
+    void SetStreamingFeedback(UINT srv, bool visible, float screenSize);
+    void SetStreamingBudget(UINT64 budget);
+    // Returns the descriptor to use in the current frame. Not streamed textures are returned as is.
+    UINT ResolveSrv(UINT srv) const;
+    const TextureStreamer& GetStreamer() const;
+
 private:
+    static constexpr UINT TransientSrvsPerFrame = 256;
+
+    struct StreamedTexture
+    {
+        Texture Data;
+        ResourceDX Resource;
+        UINT ResidentMip = 0;
+        UINT SrvSlots[2] = {};
+        UINT CurrentSlot = 0;
+        UINT64 ChangeFrame = 0;
+        bool Busy = false;
+    };
+
+    std::vector<TexResourceData> CreateCachedTextures(RenderContext& ctx, const std::vector<std::string>& filenames, const std::vector<TextureUsage>& usages, bool streamed, bool generateMips);
+    std::vector<std::vector<size_t>> GroupSmallTextures(const std::vector<Texture>& textures) const;
+    std::vector<Texture> LoadTextures(const std::vector<std::string>& filenames, const std::vector<TextureUsage>& usages) const;
+    std::vector<TexResourceData> CreateTextureResources(RenderContext& ctx, std::vector<Texture>& textures, const std::vector<std::string>& names, bool generateMips);
+    std::vector<TexResourceData> CreateStreamedResources(RenderContext& ctx, std::vector<Texture>& textures, const std::vector<std::string>& names);
+    void CreateTextureSRV(RenderContext& ctx, ID3D12Resource* resource, UINT slot, bool isCubemap = false);
+    static UINT AllocateDescriptors(DescriptorAllocator& allocator, UINT count = 1);
+    void RetireResource(const ResourceDX& resource);
+    void ReleaseStreamedTexture(UINT id);
+
     void CreateSRVHeap(RenderContext& ctx);
     void CreateRTVHeap(RenderContext& ctx);
     void CreateUAVHeap(RenderContext& ctx);
 
-    std::vector<ResourceDX> mResources;
-    std::vector<ResourceDX> mUploadResources;
+    ResourcePool<ResourceDX> mResources;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mSrvHeap = nullptr;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mRtvHeap = nullptr;
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mUavHeap = nullptr;
 
-    // DXR
-    //Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_rtSrvHeap = nullptr;
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mRtUavHeap = nullptr;
-    ResourceDX mRtResource{ D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE };
-    //
     MipGenerator* mMipGenerator = nullptr;
 
-    UINT mCurrentTexCount = 0;
-    UINT mCurrentCubemapCount = 0;
-    UINT mCurrentRtCount = 0;
-    UINT mCurrentUavCount = 0;
+    TextureStreamer mStreamer;
+    std::vector<StreamedTexture> mStreamedTextures; // Indexed by the streamer ids, the released ones are empty.
+    std::map<UINT, UINT> mStreamedSrvs; // SRV handle -> streamed texture.
+    UINT64 mFrameIndex = 0; // Incremented by UpdateStreaming.
+
+    TextureCache mCache;
+
+    TexResourceData mBrdfLut;
+
+    IRenderPipeline* mPipeline = nullptr;
+    GpuMemoryAllocator* mGpuAllocator = nullptr;
+    DeferredReleaseQueue* mReleaseQueue = nullptr;
+    // Indices in the textures and the cubemaps ranges of the SRV heap, the cubemaps UAV heap and the RTV heap.
+    DescriptorAllocator mTextureSrvs;
+    DescriptorAllocator mCubemapSrvs;
+    DescriptorAllocator mCubemapUavs;
+    DescriptorAllocator mRtvs;
 };
 
 inline ID3D12DescriptorHeap* TextureManager::GetDescriptorHeap() const
@@ -105,9 +147,15 @@ inline D3D12_CPU_DESCRIPTOR_HANDLE TextureManager::GetRtHandle(RenderContext& ct
     return handle;
 }
 
-inline ID3D12Resource* TextureManager::GetResource(UINT index) const
+inline ID3D12Resource* TextureManager::GetResource(ResourceHandle handle) const
+{
+    const ResourceDX* resource = mResources.Get(handle);
+    return resource != nullptr ? resource->Get() : nullptr;
+}
+
+inline ResourceDX* TextureManager::GetResourceDX(ResourceHandle handle)
 {
-    return mResources[index].Get();
+    return mResources.Get(handle);
 }
 
 inline MipGenerator* TextureManager::GetMipGenerator()
@@ -115,6 +163,16 @@ inline MipGenerator* TextureManager::GetMipGenerator()
     return mMipGenerator;
 }
 
+inline void TextureManager::SetStreamingBudget(UINT64 budget)
+{
+    mStreamer.SetBudget(budget);
+}
+
+inline const TextureStreamer& TextureManager::GetStreamer() const
+{
+    return mStreamer;
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// Imgui Texture Manager
 //////////////////////////////////////////////////////////////////////////
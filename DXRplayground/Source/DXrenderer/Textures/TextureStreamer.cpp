@@ -0,0 +1,201 @@
+#include "DXrenderer/Textures/TextureStreamer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace DirectxPlayground
+{
+namespace
+{
+constexpr UINT NoRequester = 0xFFFFFFFF;
+}
+
+TextureStreamer::TextureStreamer(UINT64 budget)
+    : mBudget(budget)
+{
+}
+
+UINT TextureStreamer::Register(const StreamedTextureDesc& desc)
+{
+    assert(desc.MipTailStart < desc.MipSizes.size());
+
+    TextureState tex;
+    tex.Desc = desc;
+    tex.ResidentMip = desc.MipTailStart;
+    tex.ScreenSize = static_cast<float>(std::max(desc.Width, desc.Height));
+    tex.LastVisibleUpdate = mUpdateIndex;
+    tex.Registered = true;
+    for (UINT mip = desc.MipTailStart; mip < desc.MipSizes.size(); ++mip)
+        mResidentBytes += desc.MipSizes[mip];
+
+    if (!mFreeIds.empty())
+    {
+        UINT id = mFreeIds.back();
+        mFreeIds.pop_back();
+        mTextures[id] = std::move(tex);
+        return id;
+    }
+    mTextures.push_back(std::move(tex));
+    return static_cast<UINT>(mTextures.size()) - 1;
+}
+
+void TextureStreamer::Unregister(UINT textureId)
+{
+    TextureState& tex = mTextures[textureId];
+    assert(tex.Registered && "The texture is already unregistered");
+    for (UINT mip = tex.ResidentMip; mip < tex.Desc.MipSizes.size(); ++mip)
+        mResidentBytes -= tex.Desc.MipSizes[mip];
+    tex = TextureState();
+    mFreeIds.push_back(textureId);
+}
+
+void TextureStreamer::SetFeedback(UINT textureId, bool visible, float screenSize)
+{
+    TextureState& tex = mTextures[textureId];
+    tex.Visible = visible;
+    tex.ScreenSize = screenSize;
+    if (visible)
+        tex.LastVisibleUpdate = mUpdateIndex;
+}
+
+UINT TextureStreamer::GetDesiredMip(UINT textureId) const
+{
+    return ComputeDesiredMip(mTextures[textureId]);
+}
+
+std::vector<StreamingRequest> TextureStreamer::Update(UINT maxLoads)
+{
+    ++mUpdateIndex;
+    std::vector<UINT> changed;
+
+    // The budget could be lowered since the last update.
+    if (mResidentBytes > mBudget)
+        EvictBytes(std::min(mResidentBytes - mBudget, GetEvictableBytes(NoRequester)), NoRequester, changed);
+
+    std::vector<UINT> candidates;
+    for (UINT id = 0; id < mTextures.size(); ++id)
+    {
+        if (mTextures[id].Registered && !mTextures[id].Busy && mTextures[id].ResidentMip > ComputeDesiredMip(mTextures[id]))
+            candidates.push_back(id);
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](UINT a, UINT b)
+    {
+        const TextureState& ta = mTextures[a];
+        const TextureState& tb = mTextures[b];
+        if (ta.Visible != tb.Visible)
+            return ta.Visible;
+        UINT missingA = ta.ResidentMip - ComputeDesiredMip(ta);
+        UINT missingB = tb.ResidentMip - ComputeDesiredMip(tb);
+        if (missingA != missingB)
+            return missingA > missingB;
+        if (ta.ScreenSize != tb.ScreenSize)
+            return ta.ScreenSize > tb.ScreenSize;
+        return a < b;
+    });
+
+    UINT loads = 0;
+    for (UINT id : candidates)
+    {
+        if (loads == maxLoads)
+            break;
+
+        TextureState& tex = mTextures[id];
+        UINT64 size = tex.Desc.MipSizes[tex.ResidentMip - 1];
+        if (mResidentBytes + size > mBudget)
+        {
+            UINT64 bytesNeeded = mResidentBytes + size - mBudget;
+            if (GetEvictableBytes(id) < bytesNeeded)
+                continue;
+            EvictBytes(bytesNeeded, id, changed);
+        }
+        --tex.ResidentMip;
+        mResidentBytes += size;
+        changed.push_back(id);
+        ++loads;
+    }
+
+    // A texture can be touched several times during one update, only its final state is reported.
+    std::vector<StreamingRequest> requests;
+    std::vector<bool> reported(mTextures.size(), false);
+    for (UINT id : changed)
+    {
+        if (reported[id])
+            continue;
+        reported[id] = true;
+        requests.push_back({ id, mTextures[id].ResidentMip });
+    }
+    return requests;
+}
+
+UINT TextureStreamer::ComputeDesiredMip(const TextureState& tex) const
+{
+    if (!tex.Visible)
+        return tex.Desc.MipTailStart;
+
+    // One texel per pixel, every halving of the screen size drops a level.
+    float texelsPerPixel = static_cast<float>(std::max(tex.Desc.Width, tex.Desc.Height)) / std::max(tex.ScreenSize, 1.0f);
+    UINT mip = texelsPerPixel <= 1.0f ? 0 : static_cast<UINT>(std::floor(std::log2(texelsPerPixel)));
+    return std::min(mip, tex.Desc.MipTailStart);
+}
+
+// Visible textures give away only the levels they don't need.
+UINT TextureStreamer::GetEvictionLimit(const TextureState& tex) const
+{
+    return tex.Visible ? ComputeDesiredMip(tex) : tex.Desc.MipTailStart;
+}
+
+UINT64 TextureStreamer::GetEvictableBytes(UINT requesterId) const
+{
+    UINT64 res = 0;
+    for (UINT id = 0; id < mTextures.size(); ++id)
+    {
+        const TextureState& tex = mTextures[id];
+        if (id == requesterId || !tex.Registered || tex.Busy)
+            continue;
+        for (UINT mip = tex.ResidentMip; mip < GetEvictionLimit(tex); ++mip)
+            res += tex.Desc.MipSizes[mip];
+    }
+    return res;
+}
+
+void TextureStreamer::EvictBytes(UINT64 bytesNeeded, UINT requesterId, std::vector<UINT>& changed)
+{
+    std::vector<UINT> victims;
+    for (UINT id = 0; id < mTextures.size(); ++id)
+    {
+        const TextureState& tex = mTextures[id];
+        if (id != requesterId && tex.Registered && !tex.Busy && tex.ResidentMip < GetEvictionLimit(tex))
+            victims.push_back(id);
+    }
+    std::sort(victims.begin(), victims.end(), [this](UINT a, UINT b)
+    {
+        const TextureState& ta = mTextures[a];
+        const TextureState& tb = mTextures[b];
+        if (ta.Visible != tb.Visible)
+            return !ta.Visible;
+        if (ta.LastVisibleUpdate != tb.LastVisibleUpdate)
+            return ta.LastVisibleUpdate < tb.LastVisibleUpdate;
+        if (ta.ScreenSize != tb.ScreenSize)
+            return ta.ScreenSize < tb.ScreenSize;
+        return a < b;
+    });
+
+    UINT64 freed = 0;
+    for (UINT id : victims)
+    {
+        if (freed >= bytesNeeded)
+            break;
+
+        TextureState& tex = mTextures[id];
+        UINT limit = GetEvictionLimit(tex);
+        while (tex.ResidentMip < limit && freed < bytesNeeded)
+        {
+            freed += tex.Desc.MipSizes[tex.ResidentMip];
+            mResidentBytes -= tex.Desc.MipSizes[tex.ResidentMip];
+            ++tex.ResidentMip;
+        }
+        changed.push_back(id);
+    }
+}
+}
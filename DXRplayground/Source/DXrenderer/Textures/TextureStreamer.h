@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <windows.h>
+
+namespace DirectxPlayground
+{
+struct StreamedTextureDesc
+{
+    UINT Width = 0;
+    UINT Height = 0;
+    UINT MipTailStart = 0; // Levels starting from this one are always resident.
+    std::vector<UINT64> MipSizes; // One entry per level.
+};
+
+// After the request is executed every level starting from MostDetailedMip must be resident and nothing above it.
+struct StreamingRequest
+{
+    UINT TextureId = 0;
+    UINT MostDetailedMip = 0;
+};
+
+// Decides which mips of the streamed textures are resident. It doesn't touch the GPU, the owner executes the requests returned by Update.
+// Loads go one level per request: visible textures first, then by the number of missing levels, then by the screen size.
+// When a load doesn't fit the budget the least recently visible textures lose their most detailed levels, the mip tail is never evicted.
+// Textures without feedback are treated as visible and fully needed.
+class TextureStreamer
+{
+public:
+    explicit TextureStreamer(UINT64 budget);
+
+    // Ids of the unregistered textures are reused.
+    UINT Register(const StreamedTextureDesc& desc);
+    // The texture stops taking the budget and never appears in the requests again, the owner frees its resources.
+    void Unregister(UINT textureId);
+
+    // screenSize - estimated size in pixels the whole texture spans on screen along its longest side.
+    void SetFeedback(UINT textureId, bool visible, float screenSize);
+    // Busy textures are skipped by Update, e.g. while the previous residency change is still used by the frames in flight.
+    void SetBusy(UINT textureId, bool busy);
+    void SetBudget(UINT64 budget);
+
+    std::vector<StreamingRequest> Update(UINT maxLoads);
+
+    UINT GetResidentMip(UINT textureId) const;
+    UINT GetDesiredMip(UINT textureId) const;
+    UINT64 GetResidentBytes() const;
+    UINT64 GetBudget() const;
+
+private:
+    struct TextureState
+    {
+        StreamedTextureDesc Desc;
+        UINT ResidentMip = 0;
+        bool Visible = true;
+        bool Busy = false;
+        float ScreenSize = 0.0f;
+        UINT64 LastVisibleUpdate = 0;
+        bool Registered = false;
+    };
+
+    UINT ComputeDesiredMip(const TextureState& tex) const;
+    UINT GetEvictionLimit(const TextureState& tex) const;
+    UINT64 GetEvictableBytes(UINT requesterId) const;
+    void EvictBytes(UINT64 bytesNeeded, UINT requesterId, std::vector<UINT>& changed);
+
+    std::vector<TextureState> mTextures;
+    std::vector<UINT> mFreeIds;
+    UINT64 mBudget = 0;
+    UINT64 mResidentBytes = 0;
+    UINT64 mUpdateIndex = 0;
+};
+
+inline void TextureStreamer::SetBudget(UINT64 budget)
+{
+    mBudget = budget;
+}
+
+inline void TextureStreamer::SetBusy(UINT textureId, bool busy)
+{
+    mTextures[textureId].Busy = busy;
+}
+
+inline UINT TextureStreamer::GetResidentMip(UINT textureId) const
+{
+    return mTextures[textureId].ResidentMip;
+}
+
+inline UINT64 TextureStreamer::GetResidentBytes() const
+{
+    return mResidentBytes;
+}
+
+inline UINT64 TextureStreamer::GetBudget() const
+{
+    return mBudget;
+}
+}
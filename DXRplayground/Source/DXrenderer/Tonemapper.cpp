@@ -3,10 +3,11 @@
 #include "External/IMGUI/imgui.h"
 
 #include "DXrenderer/DXhelpers.h"
+#include "DXrenderer/Buffers/ConstantBufferAllocator.h"
 #include "DXrenderer/RenderContext.h"
+#include "DXrenderer/RenderGraph/RenderGraphResources.h"
 #include "DXrenderer/Shader.h"
 #include "DXrenderer/Swapchain.h"
-#include "DXrenderer/Textures/TextureManager.h"
 #include "DXrenderer/PsoManager.h"
 #include "Model.h"
 
@@ -16,29 +17,55 @@ namespace DirectxPlayground
 Tonemapper::~Tonemapper()
 {
     SafeDelete(mModel);
-    SafeDelete(mHdrRtBuffer);
 }
 
 void Tonemapper::InitResources(RenderContext& ctx, ID3D12RootSignature* rootSig)
 {
-    CreateRenderTarget(ctx);
-    mHdrRtBuffer = new UploadBuffer(*ctx.Device, sizeof(TonemapperData), true, RenderContext::FramesCount);
     CreateGeometry(ctx);
     CreatePSO(ctx, rootSig);
 }
 
-void Tonemapper::Render(RenderContext& ctx)
+RgResource Tonemapper::CreateHdrTarget(RenderGraph& graph, const RenderContext& ctx) const
+{
+    D3D12_RESOURCE_DESC desc{};
+    desc.MipLevels = 1;
+    desc.Format = mRtFormat;
+    desc.Width = ctx.Width;
+    desc.Height = ctx.Height;
+    desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+    desc.DepthOrArraySize = 1;
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+
+    D3D12_CLEAR_VALUE clearValue{};
+    clearValue.Color[0] = mClearColor[0];
+    clearValue.Color[1] = mClearColor[1];
+    clearValue.Color[2] = mClearColor[2];
+    clearValue.Color[3] = mClearColor[3];
+    clearValue.Format = mRtFormat;
+
+    return graph.CreateTexture("HDRTexture", desc, &clearValue);
+}
+
+void Tonemapper::AddPass(RenderGraph& graph, RgResource hdrTarget, RgResource backBuffer)
+{
+    RgPass pass = graph.AddPass("Tonemapping", [this, hdrTarget](RenderContext& ctx, RenderGraphResources& resources)
+    {
+        Render(ctx, resources, hdrTarget);
+    });
+    graph.Read(pass, hdrTarget, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    graph.Write(pass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+}
+
+void Tonemapper::Render(RenderContext& ctx, RenderGraphResources& resources, RgResource hdrTarget)
 {
     ImGui::Begin("Tonemapping");
     ImGui::SliderFloat("Exposure", &mTonemapperData.Exposure, 0.0f, 10.0f);
     ImGui::End();
 
-    UINT frameIndex = ctx.SwapChain->GetCurrentBackBufferIndex();
-    mHdrRtBuffer->UploadData(frameIndex, mTonemapperData);
-
-    ID3D12Resource* hdrTex = ctx.TexManager->GetResource(mResourceIdx);
-    auto toPSResource = CD3DX12_RESOURCE_BARRIER::Transition(hdrTex, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-    ctx.CommandList->ResourceBarrier(1, &toPSResource);
+    mTonemapperData.HdrTexIndex = resources.GetSrv(hdrTarget);
+    D3D12_GPU_VIRTUAL_ADDRESS tonemapperCb = ctx.Constants->Upload(mTonemapperData);
 
     D3D12_RECT scissorRect = { 0, 0, LONG(ctx.Width), LONG(ctx.Height) };
     D3D12_VIEWPORT viewport = {};
@@ -56,42 +83,13 @@ void Tonemapper::Render(RenderContext& ctx)
     ctx.CommandList->OMSetRenderTargets(1, &lValue, false, nullptr);
 
     ctx.CommandList->SetPipelineState(ctx.PsoManager->GetPso(mPsoName));
-    ctx.CommandList->SetGraphicsRootConstantBufferView(0, mHdrRtBuffer->GetFrameDataGpuAddress(frameIndex));
+    ctx.CommandList->SetGraphicsRootConstantBufferView(0, tonemapperCb);
 
     ctx.CommandList->IASetVertexBuffers(0, 1, &mModel->GetVertexBufferView());
     ctx.CommandList->IASetIndexBuffer(&mModel->GetIndexBufferView());
 
     ctx.CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     ctx.CommandList->DrawIndexedInstanced(mModel->GetIndexCount(), 1, 0, 0, 0);
-
-    auto toRt = CD3DX12_RESOURCE_BARRIER::Transition(hdrTex, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
-    ctx.CommandList->ResourceBarrier(1, &toRt);
-}
-
-void Tonemapper::CreateRenderTarget(RenderContext& ctx)
-{
-    D3D12_RESOURCE_DESC desc{};
-    desc.MipLevels = 1;
-    desc.Format = mRtFormat;
-    desc.Width = ctx.Width;
-    desc.Height = ctx.Height;
-    desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-    desc.DepthOrArraySize = 1;
-    desc.SampleDesc.Count = 1;
-    desc.SampleDesc.Quality = 0;
-    desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-
-    D3D12_CLEAR_VALUE clearValue{};
-    clearValue.Color[0] = mClearColor[0];
-    clearValue.Color[1] = mClearColor[1];
-    clearValue.Color[2] = mClearColor[2];
-    clearValue.Color[3] = mClearColor[3];
-    clearValue.Format = mRtFormat;
-
-    TexResourceData p = ctx.TexManager->CreateRT(ctx, desc, L"HDRTexture", &clearValue);
-    mRtvOffset = p.RTVOffset;
-    mResourceIdx = p.ResourceIdx;
-    mTonemapperData.HdrTexIndex = p.SRVOffset;
 }
 
 void Tonemapper::CreateGeometry(RenderContext& context)
@@ -1,12 +1,12 @@
 #pragma once
 
 #include "External/Dx12Helpers/d3dx12.h"
+#include "DXrenderer/RenderGraph/RenderGraph.h"
 
 namespace DirectxPlayground
 {
 struct RenderContext;
 class Model;
-class UploadBuffer;
 
 class Tonemapper
 {
@@ -15,10 +15,12 @@ public:
     ~Tonemapper();
 
     void InitResources(RenderContext& ctx, ID3D12RootSignature* rootSig);
-    void Render(RenderContext& ctx);
+    // The HDR target of the frame, screen sized. Its content is undefined until the scene clears it.
+    RgResource CreateHdrTarget(RenderGraph& graph, const RenderContext& ctx) const;
+    // Tonemaps the HDR target to the back buffer.
+    void AddPass(RenderGraph& graph, RgResource hdrTarget, RgResource backBuffer);
 
     DXGI_FORMAT GetHDRTargetFormat() const;
-    UINT GetRtIndex() const;
 
     const float* GetClearColor() const;
 
@@ -29,17 +31,14 @@ private:
         float Exposure = 2.0f;
     };
 
-    void CreateRenderTarget(RenderContext& ctx);
+    void Render(RenderContext& ctx, RenderGraphResources& resources, RgResource hdrTarget);
     void CreateGeometry(RenderContext& context);
     void CreatePSO(RenderContext& ctx, ID3D12RootSignature* rootSig);
 
     std::string mPsoName = "Tonemapper";
     Model* mModel = nullptr;
     TonemapperData mTonemapperData{};
-    UINT mRtvOffset = 0;
-    UINT mResourceIdx = 0;
     DXGI_FORMAT mRtFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
-    UploadBuffer* mHdrRtBuffer = nullptr;
 
     const float mClearColor[4] = { 0.001f, 0.001f, 0.001f, 1.0f };
 };
@@ -49,11 +48,6 @@ inline DXGI_FORMAT Tonemapper::GetHDRTargetFormat() const
     return mRtFormat;
 }
 
-inline UINT Tonemapper::GetRtIndex() const
-{
-    return mRtvOffset;
-}
-
 inline const float* Tonemapper::GetClearColor() const
 {
     return mClearColor;
@@ -2,15 +2,18 @@
 
 #include <array>
 
+#include "DXrenderer/RenderPipeline.h"
 #include "DXrenderer/Swapchain.h"
 
 #include "DXrenderer/Model.h"
 #include "DXrenderer/Shader.h"
 #include "DXrenderer/PsoManager.h"
+#include "DXrenderer/RenderGraph/RenderGraphResources.h"
 #include "DXrenderer/Textures/TextureManager.h"
 #include "DXrenderer/Tonemapper.h"
 #include "DXrenderer/LightManager.h"
 
+#include "DXrenderer/Buffers/ConstantBufferAllocator.h"
 #include "DXrenderer/Buffers/UploadBuffer.h"
 #include "DXrenderer/Textures/EnvironmentMap.h"
 
@@ -19,13 +22,17 @@
 
 namespace DirectxPlayground
 {
+namespace
+{
+// Below that the draws are recorded faster than the workers start. The sample models have far fewer meshes, the parallel path is
+// exercised by the debug toggle in the stats window.
+constexpr UINT MinMeshesPerList = 128;
+}
 
 GltfViewer::~GltfViewer()
 {
-    SafeDelete(mCameraCb);
     SafeDelete(mCamera);
     SafeDelete(mCameraController);
-    SafeDelete(mObjectCb);
     SafeDelete(mGltfMesh);
     SafeDelete(mSkybox);
     SafeDelete(mTonemapper);
@@ -39,14 +46,13 @@ void GltfViewer::InitResources(RenderContext& context)
     using Microsoft::WRL::ComPtr;
 
     mCamera = new Camera(1.0472f, 1.77864583f, 0.001f, 1000.0f);
-    mCameraCb = new UploadBuffer(*context.Device, sizeof(CameraShaderData), true, context.FramesCount);
-    mObjectCb = new UploadBuffer(*context.Device, sizeof(XMFLOAT4X4), true, context.FramesCount);
     mEnvCb = new UploadBuffer(*context.Device, sizeof(EnvironmentData), true, 1);
     mCameraController = new CameraController(mCamera);
     mLightManager = new LightManager(context);
 
     auto path = ASSETS_DIR + std::string("Textures//colorful_studio_4k.hdr");
-    mEnvMap = new EnvironmentMap(context, path, 2048, 64);
+    // Only seen as the background and through the reflections, BC6H is good enough.
+    mEnvMap = new EnvironmentMap(context, path, 64, true);
     Light l = { { 300.0f, 300.0f, 300.0f, 1.0f}, { 0.0f, 0.0f, 0.0f } };
     mDirectionalLightInd = mLightManager->AddLight(l);
 
@@ -59,9 +65,9 @@ void GltfViewer::InitResources(RenderContext& context)
     CreatePSOs(context);
 
     context.TexManager->FlushMipsQueue(context);
-    mEnvMap->ConvertToCubemap(context);
+    mEnvMap->BakeIrradianceMap(context);
 
-    EnvironmentData envData{ mEnvMap->GetCubemapIndex(), mEnvMap->GetIrradianceMapIndex() };
+    EnvironmentData envData{ mEnvMap->GetCubemapIndex(), mEnvMap->GetIrradianceMapIndex(), mEnvMap->GetSpecularMapIndex(), mEnvMap->GetSpecularMipsCount(), mEnvMap->GetBrdfLutIndex() };
     mEnvCb->UploadData(0, envData);
 }
 
@@ -73,21 +79,72 @@ void GltfViewer::Render(RenderContext& context)
 
     UINT frameIndex = context.SwapChain->GetCurrentBackBufferIndex();
 
+    const XMFLOAT3 modelPosition = { 0.0f, 0.0f, 3.0f };
     XMFLOAT4X4 toWorld;
-    XMStoreFloat4x4(&toWorld, XMMatrixTranspose(XMMatrixTranslation(0.0f, 0.0f, 3.0f)));
+    XMStoreFloat4x4(&toWorld, XMMatrixTranspose(XMMatrixTranslation(modelPosition.x, modelPosition.y, modelPosition.z)));
     mCameraData.ViewProj = TransposeMatrix(mCamera->GetViewProjection());
     XMFLOAT4 camPos = mCamera->GetPosition();
     mCameraData.Position = { camPos.x, camPos.y, camPos.z };
     mCameraData.View = TransposeMatrix(mCamera->GetView());
     mCameraData.Proj = TransposeMatrix(mCamera->GetProjection());
-    mCameraCb->UploadData(frameIndex, mCameraData);
-    mObjectCb->UploadData(frameIndex, toWorld);
+    D3D12_GPU_VIRTUAL_ADDRESS cameraCb = context.Constants->Upload(mCameraData);
+    D3D12_GPU_VIRTUAL_ADDRESS objectCb = context.Constants->Upload(toWorld);
+    UpdateTextureStreaming(context, modelPosition);
     mGltfMesh->UpdateMeshes(frameIndex);
 
-    auto toRt = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-    context.CommandList->ResourceBarrier(1, &toRt);
+    RenderGraph graph;
+    RgResource backBuffer = graph.ImportResource("BackBuffer", &context.SwapChain->GetCurrentBackBufferResource());
+    RgResource depth = graph.ImportResource("Depth", &context.SwapChain->GetDepthStencilResource());
+    RgResource hdrTarget = mTonemapper->CreateHdrTarget(graph, context);
+
+    RgPass forward = graph.AddPass("Forward", [this, hdrTarget, cameraCb, objectCb](RenderContext& ctx, RenderGraphResources& resources)
+    {
+        RenderForward(ctx, resources.GetRtv(ctx, hdrTarget), cameraCb, objectCb);
+        DrawSkybox(ctx);
+    });
+    graph.Write(forward, hdrTarget, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    graph.Write(forward, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    mTonemapper->AddPass(graph, hdrTarget, backBuffer);
+
+    context.GraphResources->Execute(context, graph);
+}
+
+void GltfViewer::RenderForward(RenderContext& context, D3D12_CPU_DESCRIPTOR_HANDLE hdrTarget, D3D12_GPU_VIRTUAL_ADDRESS cameraCb, D3D12_GPU_VIRTUAL_ADDRESS objectCb)
+{
+    context.CommandList->ClearRenderTargetView(hdrTarget, mTonemapper->GetClearColor(), 0, nullptr);
+    context.CommandList->ClearDepthStencilView(context.SwapChain->GetDSCPUhandle(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+    const std::vector<Model::Mesh>& meshes = mGltfMesh->GetMeshes();
+    auto drawMeshes = [&](RenderContext& ctx, UINT first, UINT last)
+    {
+        SetForwardState(ctx, hdrTarget, cameraCb, objectCb);
+        UINT frameIndex = ctx.SwapChain->GetCurrentBackBufferIndex();
+        for (UINT i = first; i < last; ++i)
+        {
+            const Model::Mesh& mesh = meshes[i];
+            ctx.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(2), mesh.GetMaterialBufferGpuAddress(frameIndex));
+
+            ctx.CommandList->IASetVertexBuffers(0, 1, &mesh.GetVertexBufferView());
+            ctx.CommandList->IASetIndexBuffer(&mesh.GetIndexBufferView());
+
+            ctx.CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            ctx.CommandList->DrawIndexedInstanced(mesh.GetIndexCount(), 1, 0, 0, 0);
+        }
+    };
+    ImGui::Begin("Stats", NULL, ImGuiWindowFlags_NoFocusOnAppearing);
+    ImGui::Checkbox("Record meshes in parallel", &mForceParallelRecording);
+    ImGui::End();
 
-    auto rtCpuHandle = context.TexManager->GetRtHandle(context, mTonemapper->GetRtIndex());
+    // The frame continues in a new command list after the parallel recording, the skybox and the tonemapper need the state again.
+    UINT minMeshesPerList = mForceParallelRecording ? 1 : MinMeshesPerList;
+    if (context.Pipeline->RecordParallel(context, static_cast<UINT>(meshes.size()), minMeshesPerList, drawMeshes))
+        SetForwardState(context, hdrTarget, cameraCb, objectCb);
+}
+
+void GltfViewer::SetForwardState(RenderContext& context, D3D12_CPU_DESCRIPTOR_HANDLE hdrTarget, D3D12_GPU_VIRTUAL_ADDRESS cameraCb, D3D12_GPU_VIRTUAL_ADDRESS objectCb)
+{
+    UINT frameIndex = context.SwapChain->GetCurrentBackBufferIndex();
 
     D3D12_RECT scissorRect = { 0, 0, LONG(context.Width), LONG(context.Height) };
     D3D12_VIEWPORT viewport = {};
@@ -102,16 +159,14 @@ void GltfViewer::Render(RenderContext& context)
     context.CommandList->RSSetViewports(1, &viewport);
 
     auto lValue = context.SwapChain->GetDSCPUhandle();
-    context.CommandList->OMSetRenderTargets(1, &rtCpuHandle, false, &lValue);
-    context.CommandList->ClearRenderTargetView(rtCpuHandle, mTonemapper->GetClearColor(), 0, nullptr);
-    context.CommandList->ClearDepthStencilView(context.SwapChain->GetDSCPUhandle(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+    context.CommandList->OMSetRenderTargets(1, &hdrTarget, false, &lValue);
 
     context.CommandList->SetGraphicsRootSignature(mCommonRootSig.Get());
     context.CommandList->SetPipelineState(context.PsoManager->GetPso(mPsoName));
     ID3D12DescriptorHeap* descHeap[] = { context.TexManager->GetDescriptorHeap() };
     context.CommandList->SetDescriptorHeaps(1, descHeap);
-    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), mCameraCb->GetFrameDataGpuAddress(frameIndex));
-    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), mObjectCb->GetFrameDataGpuAddress(frameIndex));
+    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), cameraCb);
+    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), objectCb);
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(3), mLightManager->GetLightsBufferGpuAddress(frameIndex));
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(5), mEnvCb->GetFrameDataGpuAddress(0));
 
@@ -120,33 +175,21 @@ void GltfViewer::Render(RenderContext& context)
     CD3DX12_GPU_DESCRIPTOR_HANDLE cubeHeapBegin(context.TexManager->GetDescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
     cubeHeapBegin.Offset(context.CbvSrvUavDescriptorSize * RenderContext::MaxTextures);
     context.CommandList->SetGraphicsRootDescriptorTable(CubemapTableIndex, cubeHeapBegin);
+}
 
-    for (const auto& mesh : mGltfMesh->GetMeshes())
-    {
-        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(2), mesh.GetMaterialBufferGpuAddress(frameIndex));
-
-        context.CommandList->IASetVertexBuffers(0, 1, &mesh.GetVertexBufferView());
-        context.CommandList->IASetIndexBuffer(&mesh.GetIndexBufferView());
-
-        context.CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        context.CommandList->DrawIndexedInstanced(mesh.GetIndexCount(), 1, 0, 0, 0);
-    }
-
-    DrawSkybox(context);
-
-    mTonemapper->Render(context);
-
-    auto toPresent = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-    context.CommandList->ResourceBarrier(1, &toPresent);
+void GltfViewer::OnResourcesUploaded(RenderContext& context)
+{
+    mGltfMesh->LogMemoryStats();
+    mSkybox->LogMemoryStats();
 }
 
 void GltfViewer::LoadGeometry(RenderContext& context)
 {
     //auto path = ASSETS_DIR + std::string("Models//Avocado//glTF//Avocado.gltf");
     auto path = ASSETS_DIR + std::string("Models//FlightHelmet//glTF//FlightHelmet.gltf");
-    mGltfMesh = new Model(context, path);
+    mGltfMesh = new Model(context, path, CpuDataResidency::Release);
     path = ASSETS_DIR + std::string("Models//sphere//sphere.gltf");
-    mSkybox = new Model(context, path);
+    mSkybox = new Model(context, path, CpuDataResidency::Release);
 }
 
 void GltfViewer::CreateRootSignature(RenderContext& context)
@@ -184,6 +227,27 @@ void GltfViewer::UpdateLights(RenderContext& context)
     mLightManager->UpdateLights(context.SwapChain->GetCurrentBackBufferIndex());
 }
 
+void GltfViewer::UpdateTextureStreaming(RenderContext& context, const XMFLOAT3& modelPosition)
+{
+    // Projected diameter of the bounding sphere, 1 / Proj(1, 1) is tan(fovY / 2).
+    XMFLOAT4 camPos = mCamera->GetPosition();
+    XMFLOAT4 camForward = mCamera->GetForward();
+    XMVECTOR toModel = XMVectorSubtract(XMLoadFloat3(&modelPosition), XMLoadFloat4(&camPos));
+    float distance = XMVectorGetX(XMVector3Length(toModel));
+    float radius = mGltfMesh->GetBoundingRadius();
+    float depth = XMVectorGetX(XMVector3Dot(toModel, XMLoadFloat4(&camForward)));
+    bool visible = depth > -radius;
+    float screenSize = static_cast<float>(context.Height);
+    if (distance > radius)
+        screenSize *= radius * mCamera->GetProjection()(1, 1) / distance;
+    mGltfMesh->UpdateTextureStreaming(visible, screenSize);
+
+    const TextureStreamer& streamer = context.TexManager->GetStreamer();
+    ImGui::Begin("Stats", NULL, ImGuiWindowFlags_NoFocusOnAppearing);
+    ImGui::Text("Streamed textures %.1f / %.1f MB", streamer.GetResidentBytes() / (1024.0f * 1024.0f), streamer.GetBudget() / (1024.0f * 1024.0f));
+    ImGui::End();
+}
+
 void GltfViewer::DrawSkybox(RenderContext& context)
 {
     GPU_SCOPED_EVENT(context, "Skybox");
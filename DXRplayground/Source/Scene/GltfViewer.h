@@ -25,19 +25,23 @@ public:
 
     void InitResources(RenderContext& context) override;
     void Render(RenderContext& context) override;
+    void OnResourcesUploaded(RenderContext& context) override;
 
 private:
     void LoadGeometry(RenderContext& context);
     void CreateRootSignature(RenderContext& context);
     void CreatePSOs(RenderContext& context);
     void UpdateLights(RenderContext& context);
+    void UpdateTextureStreaming(RenderContext& context, const XMFLOAT3& modelPosition);
+    // Records the meshes in parallel if there are enough of them.
+    void RenderForward(RenderContext& context, D3D12_CPU_DESCRIPTOR_HANDLE hdrTarget, D3D12_GPU_VIRTUAL_ADDRESS cameraCb, D3D12_GPU_VIRTUAL_ADDRESS objectCb);
+    // Everything the draws of the meshes and the skybox need, a command list of a worker starts without state.
+    void SetForwardState(RenderContext& context, D3D12_CPU_DESCRIPTOR_HANDLE hdrTarget, D3D12_GPU_VIRTUAL_ADDRESS cameraCb, D3D12_GPU_VIRTUAL_ADDRESS objectCb);
     void DrawSkybox(RenderContext& context);
 
     Model* mGltfMesh = nullptr;
     Model* mSkybox = nullptr;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> mCommonRootSig; // Move to ctx. It's common after all
-    UploadBuffer* mCameraCb = nullptr;
-    UploadBuffer* mObjectCb = nullptr;
     UploadBuffer* mEnvCb = nullptr;
     const std::string mPsoName = "Opaque_PBR";
     const std::string mSkyboxPsoName = "Skybox";
@@ -49,5 +53,6 @@ private:
     EnvironmentMap* mEnvMap = nullptr;
     UINT mDirectionalLightInd = 0;
     CameraShaderData mCameraData{};
+    bool mForceParallelRecording = false; // Every mesh can get its own command list, see MinMeshesPerList.
 };
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "DXrenderer/Model.h"
 #include "DXrenderer/Shader.h"
 #include "DXrenderer/PsoManager.h"
+#include "DXrenderer/RenderGraph/RenderGraphResources.h"
 #include "DXrenderer/Textures/TextureManager.h"
 #include "DXrenderer/Tonemapper.h"
 #include "DXrenderer/LightManager.h"
@@ -20,11 +21,9 @@ namespace DirectxPlayground
 
 PbrTester::~PbrTester()
 {
-    SafeDelete(mCameraCb);
     SafeDelete(mCamera);
     SafeDelete(mCameraController);
     SafeDelete(mObjectCbs);
-    SafeDelete(mMaterials);
     SafeDelete(mGltfMesh);
     SafeDelete(mTonemapper);
     SafeDelete(mLightManager);
@@ -35,9 +34,8 @@ void PbrTester::InitResources(RenderContext& context)
     using Microsoft::WRL::ComPtr;
 
     mCamera = new Camera(1.0472f, 1.77864583f, 0.001f, 1000.0f);
-    mCameraCb = new UploadBuffer(*context.Device, sizeof(CameraShaderData), true, context.FramesCount);
     mObjectCbs = new UploadBuffer(*context.Device, sizeof(InstanceBuffers), true, context.FramesCount);
-    mMaterials = new UploadBuffer(*context.Device, sizeof(InstanceMaterials), true, context.FramesCount);
+    mMaterials = context.Constants->CreatePersistent(sizeof(InstanceMaterials));
     mCameraController = new CameraController(mCamera, 1.0f, 12.0f);
     mLightManager = new LightManager(context);
     Light l = { { 300.0f, 300.0f, 300.0f, 1.0f}, { 5.0f, 5.0f, 5.0f } };
@@ -70,7 +68,6 @@ void PbrTester::InitResources(RenderContext& context)
         }
     }
     mObjectCbs->UploadData(0, transforms.ToWorld);
-    mMaterials->UploadData(0, mInstanceMaterials.Materials);
 
     LoadGeometry(context);
     CreateRootSignature(context);
@@ -91,13 +88,9 @@ void PbrTester::Render(RenderContext& context)
     mCameraData.ViewProj = TransposeMatrix(mCamera->GetViewProjection());
     XMFLOAT4 camPos = mCamera->GetPosition();
     mCameraData.Position = { camPos.x, camPos.y, camPos.z };
-    mCameraCb->UploadData(frameIndex, mCameraData);
-    mMaterials->UploadData(frameIndex, mInstanceMaterials.Materials);
-
-    auto toRt = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-    context.CommandList->ResourceBarrier(1, &toRt);
-
-    auto rtCpuHandle = context.TexManager->GetRtHandle(context, mTonemapper->GetRtIndex());
+    D3D12_GPU_VIRTUAL_ADDRESS cameraCb = context.Constants->Upload(mCameraData);
+    // The materials are edited in the UI, they are written only when changed.
+    mMaterials.Update(frameIndex, mInstanceMaterials.Materials);
 
     D3D12_RECT scissorRect = { 0, 0, LONG(context.Width), LONG(context.Height) };
     D3D12_VIEWPORT viewport = {};
@@ -111,18 +104,39 @@ void PbrTester::Render(RenderContext& context)
     context.CommandList->RSSetScissorRects(1, &scissorRect);
     context.CommandList->RSSetViewports(1, &viewport);
 
+    RenderGraph graph;
+    RgResource backBuffer = graph.ImportResource("BackBuffer", &context.SwapChain->GetCurrentBackBufferResource());
+    RgResource depth = graph.ImportResource("Depth", &context.SwapChain->GetDepthStencilResource());
+    RgResource hdrTarget = mTonemapper->CreateHdrTarget(graph, context);
+
+    RgPass forward = graph.AddPass("Forward", [this, hdrTarget, cameraCb](RenderContext& ctx, RenderGraphResources& resources)
+    {
+        RenderForward(ctx, resources.GetRtv(ctx, hdrTarget), cameraCb);
+    });
+    graph.Write(forward, hdrTarget, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    graph.Write(forward, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    mTonemapper->AddPass(graph, hdrTarget, backBuffer);
+
+    context.GraphResources->Execute(context, graph);
+}
+
+void PbrTester::RenderForward(RenderContext& context, D3D12_CPU_DESCRIPTOR_HANDLE hdrTarget, D3D12_GPU_VIRTUAL_ADDRESS cameraCb)
+{
+    UINT frameIndex = context.SwapChain->GetCurrentBackBufferIndex();
+
     auto lValue = context.SwapChain->GetDSCPUhandle();
-    context.CommandList->OMSetRenderTargets(1, &rtCpuHandle, false, &lValue);
-    context.CommandList->ClearRenderTargetView(rtCpuHandle, mTonemapper->GetClearColor(), 0, nullptr);
+    context.CommandList->OMSetRenderTargets(1, &hdrTarget, false, &lValue);
+    context.CommandList->ClearRenderTargetView(hdrTarget, mTonemapper->GetClearColor(), 0, nullptr);
     context.CommandList->ClearDepthStencilView(context.SwapChain->GetDSCPUhandle(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
     context.CommandList->SetGraphicsRootSignature(mCommonRootSig.Get());
     context.CommandList->SetPipelineState(context.PsoManager->GetPso(mPsoName));
     ID3D12DescriptorHeap* descHeap[] = { context.TexManager->GetDescriptorHeap() };
     context.CommandList->SetDescriptorHeaps(1, descHeap);
-    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), mCameraCb->GetFrameDataGpuAddress(frameIndex));
+    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), cameraCb);
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), mObjectCbs->GetFrameDataGpuAddress(0));
-    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(2), mMaterials->GetFrameDataGpuAddress(frameIndex));
+    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(2), mMaterials.GetGpuAddress(frameIndex));
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(3), mLightManager->GetLightsBufferGpuAddress(frameIndex));
     context.CommandList->SetGraphicsRootDescriptorTable(TextureTableIndex, context.TexManager->GetDescriptorHeap()->GetGPUDescriptorHandleForHeapStart());
 
@@ -134,10 +148,6 @@ void PbrTester::Render(RenderContext& context)
         context.CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
         context.CommandList->DrawIndexedInstanced(mesh.GetIndexCount(), m_instanceCount, 0, 0, 0);
     }
-    mTonemapper->Render(context);
-
-    auto toPresent = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-    context.CommandList->ResourceBarrier(1, &toPresent);
 }
 
 void PbrTester::LoadGeometry(RenderContext& context)
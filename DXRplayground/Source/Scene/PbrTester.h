@@ -4,6 +4,7 @@
 #include <d3d12.h>
 #include "Scene/Scene.h"
 #include "External/Dx12Helpers/d3dx12.h"
+#include "DXrenderer/Buffers/ConstantBufferAllocator.h"
 
 #include "CameraController.h"
 #include "Camera.h"
@@ -49,12 +50,12 @@ private:
     void CreateRootSignature(RenderContext& context);
     void CreatePSOs(RenderContext& context);
     void UpdateLights(RenderContext& context);
+    void RenderForward(RenderContext& context, D3D12_CPU_DESCRIPTOR_HANDLE hdrTarget, D3D12_GPU_VIRTUAL_ADDRESS cameraCb);
 
     Model* mGltfMesh = nullptr;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> mCommonRootSig; // Move to ctx. It's common after all
-    UploadBuffer* mCameraCb = nullptr;
     UploadBuffer* mObjectCbs = nullptr;
-    UploadBuffer* mMaterials = nullptr;
+    PersistentConstants mMaterials;
 
     const std::string mPsoName = "Opaque_PBR";
 
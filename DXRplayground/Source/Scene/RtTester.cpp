@@ -7,6 +7,7 @@
 #include "DXrenderer/Model.h"
 #include "DXrenderer/Shader.h"
 #include "DXrenderer/PsoManager.h"
+#include "DXrenderer/RenderGraph/RenderGraphResources.h"
 #include "DXrenderer/Textures/TextureManager.h"
 #include "DXrenderer/Tonemapper.h"
 #include "DXrenderer/LightManager.h"
@@ -27,13 +28,28 @@ namespace
 static constexpr UINT AccelStructSlot = 0;
 static constexpr UINT DXROutputSlot = 1;
 static constexpr UINT SceneCBSlot = 2;
+static constexpr UINT EnvSamplingSlot = 3;
+
+D3D12_RESOURCE_DESC GetShadowsDesc(const RenderContext& context)
+{
+    D3D12_RESOURCE_DESC resDesc = {};
+    resDesc.MipLevels = 1;
+    resDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    resDesc.Width = context.Width;
+    resDesc.Height = context.Height;
+    resDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+    resDesc.DepthOrArraySize = 1;
+    resDesc.SampleDesc.Count = 1;
+    resDesc.SampleDesc.Quality = 0;
+    resDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    return resDesc;
+}
 }
 
 using Microsoft::WRL::ComPtr;
 
 RtTester::~RtTester()
 {
-    SafeDelete(mCameraCb);
     SafeDelete(mCamera);
     SafeDelete(mCameraController);
     SafeDelete(mObjectCb);
@@ -42,8 +58,6 @@ RtTester::~RtTester()
     SafeDelete(mTonemapper);
     SafeDelete(mLightManager);
     SafeDelete(mFloor);
-    SafeDelete(mFloorMaterialCb);
-    SafeDelete(mFloorTransformCb);
     SafeDelete(mEnvMap);
     SafeDelete(mEnvCb);
 
@@ -57,8 +71,6 @@ RtTester::~RtTester()
     SafeDelete(mRayGenShaderTable);
     SafeDelete(mInstanceDescs);
     SafeDelete(mScratchBuffer);
-    SafeDelete(mRtSceneDataCb);
-    SafeDelete(mShadowMapCb);
     SafeDelete(mRtShadowRaysBuffer);
 }
 
@@ -68,30 +80,29 @@ void RtTester::InitResources(RenderContext& context)
 
     mCamera = new Camera(1.0472f, 1.77864583f, 0.001f, 1000.0f);
     mCamera->SetWorldPosition({ 0.0f, 2.0f, -2.0f });
-    mCameraCb = new UploadBuffer(*context.Device, sizeof(CameraShaderData), true, context.FramesCount);
     mObjectCb = new UploadBuffer(*context.Device, sizeof(XMFLOAT4X4) * 2, true, 1);
     mEnvCb = new UploadBuffer(*context.Device, sizeof(EnvironmentData), true, 1);
 
     auto path = ASSETS_DIR + std::string("Textures//colorful_studio_4k.hdr");
-    mEnvMap = new EnvironmentMap(context, path, 2048, 64);
+    mEnvMap = new EnvironmentMap(context, path, 64);
 
     XMFLOAT4X4 toWorld[2];
     XMStoreFloat4x4(&toWorld[0], XMMatrixTranspose(XMMatrixTranslation(0.0f, 2.0f, 3.0f)));
     XMStoreFloat4x4(&toWorld[1], XMMatrixTranspose(XMMatrixTranslation(5.0f, 2.0f, 3.0f)));
     mObjectCb->UploadData(0, toWorld);
 
-    mFloorTransformCb = new UploadBuffer(*context.Device, sizeof(XMFLOAT4X4), true, context.FramesCount);
+    mFloorTransformCb = context.Constants->CreatePersistent(sizeof(XMFLOAT4X4));
     XMStoreFloat4x4(&toWorld[0], XMMatrixTranspose(XMMatrixTranslation(0.0f, 0.0f, 0.0f)));
     for (UINT i = 0; i < context.FramesCount; ++i)
-        mFloorTransformCb->UploadData(i, toWorld);
+        mFloorTransformCb.Update(i, toWorld[0]);
 
-    mFloorMaterialCb = new UploadBuffer(*context.Device, sizeof(NonTexturedMaterial), true, context.FramesCount);
+    mFloorMaterialCb = context.Constants->CreatePersistent(sizeof(NonTexturedMaterial));
     m_floorMaterial.Albedo = { 0.8f, 0.8f, 0.8f, 1.0f };
     m_floorMaterial.AO = 1.0f;
     m_floorMaterial.Metallic = 0.0f;
     m_floorMaterial.Roughness = 1.0f;
     for (UINT i = 0; i < context.FramesCount; ++i)
-        mFloorMaterialCb->UploadData(i, m_floorMaterial);
+        mFloorMaterialCb.Update(i, m_floorMaterial);
 
     mCameraController = new CameraController(mCamera);
     mLightManager = new LightManager(context);
@@ -110,9 +121,9 @@ void RtTester::InitResources(RenderContext& context)
     InitRaytracingPipeline(context);
 
     context.TexManager->FlushMipsQueue(context);
-    mEnvMap->ConvertToCubemap(context);
+    mEnvMap->BakeIrradianceMap(context);
 
-    EnvironmentData envData{ mEnvMap->GetCubemapIndex(), mEnvMap->GetIrradianceMapIndex() };
+    EnvironmentData envData{ mEnvMap->GetCubemapIndex(), mEnvMap->GetIrradianceMapIndex(), mEnvMap->GetSpecularMapIndex(), mEnvMap->GetSpecularMipsCount(), mEnvMap->GetBrdfLutIndex() };
     mEnvCb->UploadData(0, envData);
 }
 
@@ -129,12 +140,9 @@ void RtTester::Render(RenderContext& context)
     mCameraData.Position = { camPos.x, camPos.y, camPos.z };
     mCameraData.View = TransposeMatrix(mCamera->GetView());
     mCameraData.Proj = TransposeMatrix(mCamera->GetProjection());
-    mCameraCb->UploadData(frameIndex, mCameraData);
+    mCameraCb = context.Constants->Upload(mCameraData);
     mSuzanne->UpdateMeshes(frameIndex);
 
-    auto toRt = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-    context.CommandList->ResourceBarrier(1, &toRt);
-
     D3D12_RECT scissorRect = { 0, 0, LONG(context.Width), LONG(context.Height) };
     D3D12_VIEWPORT viewport = {};
     viewport.TopLeftX = 0.0f;
@@ -147,27 +155,51 @@ void RtTester::Render(RenderContext& context)
     context.CommandList->RSSetScissorRects(1, &scissorRect);
     context.CommandList->RSSetViewports(1, &viewport);
 
-    DepthPrepass(context);
-    RaytraceShadows(context);
-    RenderForwardObjects(context);
-    DrawSkybox(context);
+    RenderGraph graph;
+    RgResource backBuffer = graph.ImportResource("BackBuffer", &context.SwapChain->GetCurrentBackBufferResource());
+    RgResource depth = graph.ImportResource("Depth", &context.SwapChain->GetDepthStencilResource());
+    RgResource hdrTarget = mTonemapper->CreateHdrTarget(graph, context);
+    RgResource shadows = graph.CreateTexture("DXR Shadows", GetShadowsDesc(context));
 
-    ImGui::Begin("TexTest");
-    ImGui::Image(context.ImguiTexManager->GetTextureId(context.TexManager->GetDXRResource()), { 256, 256 });
-    ImGui::End();
+    RgPass depthPrepass = graph.AddPass("DepthPrepass", [this](RenderContext& ctx, RenderGraphResources&)
+    {
+        DepthPrepass(ctx);
+    });
+    graph.Write(depthPrepass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
-    mTonemapper->Render(context);
+    RgPass raytracing = graph.AddPass("RaytraceShadows", [this, shadows](RenderContext& ctx, RenderGraphResources& resources)
+    {
+        RaytraceShadows(ctx, resources.GetUav(ctx, shadows));
+    });
+    graph.Write(raytracing, shadows, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    // Only the floor receives the shadows, the rays aren't traced without it.
+    bool drawFloor = mDrawFloor;
+    RgPass forward = graph.AddPass("Forward", [this, drawFloor, shadows, hdrTarget](RenderContext& ctx, RenderGraphResources& resources)
+    {
+        RenderForwardObjects(ctx, resources.GetRtv(ctx, hdrTarget), drawFloor ? resources.GetSrv(shadows) : 0);
+        DrawSkybox(ctx);
+    });
+    if (drawFloor)
+        graph.Read(forward, shadows, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    graph.Write(forward, hdrTarget, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    graph.Write(forward, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
-    auto toPresent = CD3DX12_RESOURCE_BARRIER::Transition(context.SwapChain->GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-    context.CommandList->ResourceBarrier(1, &toPresent);
+    mTonemapper->AddPass(graph, hdrTarget, backBuffer);
+
+    context.GraphResources->Execute(context, graph);
 }
 
-void RtTester::DepthPrepass(RenderContext& context)
+void RtTester::OnResourcesUploaded(RenderContext& context)
 {
-    GPU_SCOPED_EVENT(context, "DepthPrepass");
+    mSuzanne->LogMemoryStats();
+    mSkybox->LogMemoryStats();
+    mFloor->LogMemoryStats();
+}
 
+void RtTester::DepthPrepass(RenderContext& context)
+{
     UINT frameIndex = context.SwapChain->GetCurrentBackBufferIndex();
-    auto rtCpuHandle = context.TexManager->GetRtHandle(context, mTonemapper->GetRtIndex());
 
     auto lValue = context.SwapChain->GetDSCPUhandle();
     context.CommandList->OMSetRenderTargets(0, nullptr, false, &lValue);
@@ -177,7 +209,7 @@ void RtTester::DepthPrepass(RenderContext& context)
     context.CommandList->SetPipelineState(context.PsoManager->GetPso(mDepthPrepassPsoName));
     ID3D12DescriptorHeap* descHeap[] = { context.TexManager->GetDescriptorHeap() };
     context.CommandList->SetDescriptorHeaps(1, descHeap);
-    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), mCameraCb->GetFrameDataGpuAddress(frameIndex));
+    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), mCameraCb);
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), mObjectCb->GetFrameDataGpuAddress(0));
 
     if (mDrawSuzanne)
@@ -194,29 +226,26 @@ void RtTester::DepthPrepass(RenderContext& context)
 
     if (mDrawFloor)
     {
-        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), mFloorTransformCb->GetFrameDataGpuAddress(frameIndex));
-        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(4), mShadowMapCb->GetFrameDataGpuAddress(0));
+        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), mFloorTransformCb.GetGpuAddress(frameIndex));
         context.CommandList->IASetVertexBuffers(0, 1, &mFloor->GetVertexBufferView());
         context.CommandList->IASetIndexBuffer(&mFloor->GetIndexBufferView());
         context.CommandList->DrawIndexedInstanced(mFloor->GetIndexCount(), 1, 0, 0, 0);
     }
 }
 
-void RtTester::RenderForwardObjects(RenderContext& context)
+void RtTester::RenderForwardObjects(RenderContext& context, D3D12_CPU_DESCRIPTOR_HANDLE hdrTarget, UINT shadowsSrv)
 {
-    GPU_SCOPED_EVENT(context, "RenderForwardObjects");
     UINT frameIndex = context.SwapChain->GetCurrentBackBufferIndex();
-    auto rtCpuHandle = context.TexManager->GetRtHandle(context, mTonemapper->GetRtIndex());
 
     auto lValue = context.SwapChain->GetDSCPUhandle();
-    context.CommandList->OMSetRenderTargets(1, &rtCpuHandle, false, &lValue);
-    context.CommandList->ClearRenderTargetView(rtCpuHandle, mTonemapper->GetClearColor(), 0, nullptr);
+    context.CommandList->OMSetRenderTargets(1, &hdrTarget, false, &lValue);
+    context.CommandList->ClearRenderTargetView(hdrTarget, mTonemapper->GetClearColor(), 0, nullptr);
 
     context.CommandList->SetGraphicsRootSignature(mCommonRootSig.Get());
     context.CommandList->SetPipelineState(context.PsoManager->GetPso(mPsoName));
     ID3D12DescriptorHeap* descHeap[] = { context.TexManager->GetDescriptorHeap() };
     context.CommandList->SetDescriptorHeaps(1, descHeap);
-    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), mCameraCb->GetFrameDataGpuAddress(frameIndex));
+    context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(0), mCameraCb);
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), mObjectCb->GetFrameDataGpuAddress(0));
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(3), mLightManager->GetLightsBufferGpuAddress(frameIndex));
     context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(5), mEnvCb->GetFrameDataGpuAddress(0));
@@ -243,8 +272,9 @@ void RtTester::RenderForwardObjects(RenderContext& context)
     if (mDrawFloor)
     {
         context.CommandList->SetPipelineState(context.PsoManager->GetPso(mFloorPsoName));
-        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), mFloorTransformCb->GetFrameDataGpuAddress(frameIndex));
-        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(2), mFloorMaterialCb->GetFrameDataGpuAddress(frameIndex));
+        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(1), mFloorTransformCb.GetGpuAddress(frameIndex));
+        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(2), mFloorMaterialCb.GetGpuAddress(frameIndex));
+        context.CommandList->SetGraphicsRootConstantBufferView(GetCBRootParamIndex(4), context.Constants->Upload(shadowsSrv));
         context.CommandList->IASetVertexBuffers(0, 1, &mFloor->GetVertexBufferView());
         context.CommandList->IASetIndexBuffer(&mFloor->GetIndexBufferView());
         context.CommandList->DrawIndexedInstanced(mFloor->GetIndexCount(), 1, 0, 0, 0);
@@ -256,9 +286,9 @@ void RtTester::LoadGeometry(RenderContext& context)
     //auto path = ASSETS_DIR + std::string("Models//Suzanne//glTF//Suzanne.gltf");
     auto path = ASSETS_DIR + std::string("Models//FlightHelmet//glTF//FlightHelmet.gltf");
 
-    mSuzanne = new Model(context, path);
+    mSuzanne = new Model(context, path, CpuDataResidency::PositionsOnly);
     path = ASSETS_DIR + std::string("Models//sphere//sphere.gltf");
-    mSkybox = new Model(context, path);
+    mSkybox = new Model(context, path, CpuDataResidency::Release);
 
     std::vector<Vertex> verts;
     verts.resize(4);
@@ -271,7 +301,7 @@ void RtTester::LoadGeometry(RenderContext& context)
     verts[2].Norm = { 0.0f, 1.0f, 0.0f };
     verts[3].Norm = { 0.0f, 1.0f, 0.0f };
     std::vector<UINT> ind = { 0, 1, 2, 0, 2, 3 };
-    mFloor = new Model(context, verts, ind);
+    mFloor = new Model(context, verts, ind, CpuDataResidency::Release);
 }
 
 void RtTester::CreateRootSignature(RenderContext& context)
@@ -348,26 +378,8 @@ void RtTester::DrawSkybox(RenderContext& context)
 
 void RtTester::InitRaytracingPipeline(RenderContext& context)
 {
-    mRtSceneDataCb = new UploadBuffer(*context.Device, sizeof(RtCb), true, context.FramesCount);
-    mShadowMapCb = new UploadBuffer(*context.Device, sizeof(UINT), true, 1);
     mRtShadowRaysBuffer = new UploadBuffer(*context.Device, sizeof(XMFLOAT4), true, 1);
 
-    D3D12_RESOURCE_DESC resDesc = {};
-    resDesc.MipLevels = 1;
-    resDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-    resDesc.Width = context.Width;
-    resDesc.Height = context.Height;
-    resDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-    resDesc.DepthOrArraySize = 1;
-    resDesc.SampleDesc.Count = 1;
-    resDesc.SampleDesc.Quality = 0;
-    resDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-
-    mShadowMapIndex = context.TexManager->CreateDxrOutput(context, resDesc);
-    mShadowMapCb->UploadData(0, mShadowMapIndex);
-
-    context.ImguiTexManager->AddTexture(context.TexManager->GetDXRResource());
-
     CreateRtRootSigs(context);
     BuildAccelerationStructures(context);
     CreateRtPSO(context);
@@ -389,6 +401,9 @@ void RtTester::CreateRtRootSigs(RenderContext& context)
     params.push_back({});
     params.back().InitAsConstantBufferView(0); // Scene cb (camera etc)
 
+    params.push_back({});
+    params.back().InitAsShaderResourceView(1); // Environment sampling tables
+
     CD3DX12_ROOT_SIGNATURE_DESC globalRootSigDesc{ UINT(params.size()), params.data() };
     ComPtr<ID3DBlob> blob;
     ComPtr<ID3DBlob> error;
@@ -570,9 +585,8 @@ void RtTester::BuildShaderTables(RenderContext& context)
 
 }
 
-void RtTester::RaytraceShadows(RenderContext& context)
+void RtTester::RaytraceShadows(RenderContext& context, D3D12_GPU_DESCRIPTOR_HANDLE output)
 {
-    GPU_SCOPED_EVENT(context, "RaytraceShadows");
     XMMATRIX viewProj = XMLoadFloat4x4(&mCamera->GetViewProjection());
     XMVECTOR det = XMMatrixDeterminant(viewProj);
     XMMATRIX invViewProjSimd = XMMatrixInverse(&det, viewProj);
@@ -581,22 +595,21 @@ void RtTester::RaytraceShadows(RenderContext& context)
     RtCb rtSceneData{};
     rtSceneData.InvViewProj = invViewProj;
     rtSceneData.CamPosition = mCamera->GetPosition();
-    mRtSceneDataCb->UploadData(context.SwapChain->GetCurrentBackBufferIndex(), rtSceneData);
+    rtSceneData.EnvSamplingSize = { mEnvMap->GetSamplingTablesWidth(), mEnvMap->GetSamplingTablesHeight() };
+    D3D12_GPU_VIRTUAL_ADDRESS rtSceneDataCb = context.Constants->Upload(rtSceneData);
 
     Light& dirLight = mLightManager->GetLightRef(mDirectionalLightInd);
     mRtShadowRaysBuffer->UploadData(0, XMFLOAT4{ dirLight.Direction.x, dirLight.Direction.y, dirLight.Direction.z, 1.0f });
 
     auto cmdList = context.CommandList;
 
-    auto transition = CD3DX12_RESOURCE_BARRIER::Transition(context.TexManager->GetDXRResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-    context.CommandList->ResourceBarrier(1, &transition);
-
-    ID3D12DescriptorHeap* descHeaps[] = { context.TexManager->GetDXRUavHeap() };
+    ID3D12DescriptorHeap* descHeaps[] = { context.TexManager->GetDescriptorHeap() };
     cmdList->SetComputeRootSignature(mRtGlobalRootSig.Get());
     cmdList->SetDescriptorHeaps(1, descHeaps);
-    cmdList->SetComputeRootConstantBufferView(SceneCBSlot, mRtSceneDataCb->GetFrameDataGpuAddress(context.SwapChain->GetCurrentBackBufferIndex()));
+    cmdList->SetComputeRootConstantBufferView(SceneCBSlot, rtSceneDataCb);
     cmdList->SetComputeRootShaderResourceView(AccelStructSlot, mTlas->GetGpuAddress());
-    cmdList->SetComputeRootDescriptorTable(DXROutputSlot, context.TexManager->GetDXRUavHeap()->GetGPUDescriptorHandleForHeapStart());
+    cmdList->SetComputeRootDescriptorTable(DXROutputSlot, output);
+    cmdList->SetComputeRootShaderResourceView(EnvSamplingSlot, mEnvMap->GetSamplingTablesAddress());
 
     D3D12_DISPATCH_RAYS_DESC desc = {};
     desc.Width = context.Width;
@@ -616,9 +629,6 @@ void RtTester::RaytraceShadows(RenderContext& context)
 
     cmdList->SetPipelineState1(mDxrStateObject.Get());
     cmdList->DispatchRays(&desc);
-
-    transition = CD3DX12_RESOURCE_BARRIER::Transition(context.TexManager->GetDXRResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-    context.CommandList->ResourceBarrier(1, &transition);
 }
 
 }
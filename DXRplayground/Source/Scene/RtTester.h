@@ -4,6 +4,7 @@
 #include "Scene/Scene.h"
 #include "External/Dx12Helpers/d3dx12.h"
 
+#include "DXrenderer/Buffers/ConstantBufferAllocator.h"
 #include "DXrenderer/Shader.h"
 #include "DXrenderer/ResourceDX.h"
 
@@ -35,6 +36,7 @@ public:
 
     void InitResources(RenderContext& context) override;
     void Render(RenderContext& context) override;
+    void OnResourcesUploaded(RenderContext& context) override;
 
 private:
     struct NonTexturedMaterial
@@ -47,7 +49,8 @@ private:
     } m_floorMaterial;
 
     void DepthPrepass(RenderContext& context);
-    void RenderForwardObjects(RenderContext& context);
+    // shadowsSrv - the traced shadows, only read by the floor.
+    void RenderForwardObjects(RenderContext& context, D3D12_CPU_DESCRIPTOR_HANDLE hdrTarget, UINT shadowsSrv);
     void LoadGeometry(RenderContext& context);
     void CreateRootSignature(RenderContext& context);
     void CreatePSOs(RenderContext& context);
@@ -62,17 +65,17 @@ private:
     void CreateRtPSO(RenderContext& context);
     void BuildAccelerationStructures(RenderContext& context);
     void BuildShaderTables(RenderContext& context);
-    void RaytraceShadows(RenderContext& context);
+    void RaytraceShadows(RenderContext& context, D3D12_GPU_DESCRIPTOR_HANDLE output);
     //
 
     Model* mSuzanne = nullptr;
     Model* mFloor = nullptr;
     Model* mSkybox = nullptr;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> mCommonRootSig; // Move to ctx. It's common after all
-    UploadBuffer* mCameraCb = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS mCameraCb = 0; // In the frame constants, uploaded by Render.
     UploadBuffer* mObjectCb = nullptr;
-    UploadBuffer* mFloorTransformCb = nullptr;
-    UploadBuffer* mFloorMaterialCb = nullptr;
+    PersistentConstants mFloorTransformCb;
+    PersistentConstants mFloorMaterialCb;
     UploadBuffer* mEnvCb = nullptr;
     const std::string mPsoName = "Opaque_PBR";
     const std::string mFloorPsoName = "Opaque_Non_Textured_PBR";
@@ -94,15 +97,15 @@ private:
     // rt
     static constexpr UINT RootDescriptorSize = 8;
     static constexpr UINT NumHitGroups = 3;
-    UploadBuffer* mShadowMapCb = nullptr;
     UploadBuffer* mRtShadowRaysBuffer = nullptr;
     struct RtCb
     {
         XMFLOAT4X4 InvViewProj;
         XMFLOAT4 CamPosition;
+        XMUINT2 EnvSamplingSize;
+        XMUINT2 Pad;
     };
 
-    UploadBuffer* mRtSceneDataCb = nullptr;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> mRtGlobalRootSig;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> mShadowLocalRootSig;
     Microsoft::WRL::ComPtr<ID3D12StateObject> mDxrStateObject;
@@ -113,7 +116,6 @@ private:
     UploadBuffer* mInstanceDescs = nullptr; // todo: after flush should be ok to delete, but it's not.
 
     UnorderedAccessBuffer* mScratchBuffer = nullptr; // todo: same shit as above
-    UINT mShadowMapIndex = 0;
     UINT mHitGroupStride = 0;
 
     Shader mRayGenShader;
@@ -9,6 +9,7 @@ class Scene
 public:
     virtual void InitResources(RenderContext& context) abstract;
     virtual void Render(RenderContext& context) abstract;
+    virtual void OnResourcesUploaded(RenderContext& context) {} // Called once the init command list was executed and flushed.
     virtual ~Scene() = default;
 };
 }
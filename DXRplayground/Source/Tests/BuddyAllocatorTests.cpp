@@ -0,0 +1,183 @@
+#include "DXrenderer/Memory/BuddyAllocator.h"
+
+#include <iterator>
+#include <map>
+#include <random>
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+namespace
+{
+constexpr UINT64 Capacity = 1024 * 1024;
+constexpr UINT64 MinBlockSize = 256;
+constexpr UINT64 UnitsCount = Capacity / MinBlockSize;
+
+// What the allocator should look like: the live blocks and which MinBlockSize units they cover.
+struct ShadowModel
+{
+    struct Block
+    {
+        UINT64 Size = 0;
+        UINT64 BlockSize = 0;
+    };
+
+    std::map<UINT64, Block> Blocks; // By offset.
+    std::vector<bool> UsedUnits = std::vector<bool>(UnitsCount, false);
+
+    bool IsFree(UINT64 offset, UINT64 size) const
+    {
+        for (UINT64 unit = offset / MinBlockSize; unit < (offset + size) / MinBlockSize; ++unit)
+        {
+            if (UsedUnits[unit])
+                return false;
+        }
+        return true;
+    }
+
+    void Mark(UINT64 offset, UINT64 size, bool used)
+    {
+        for (UINT64 unit = offset / MinBlockSize; unit < (offset + size) / MinBlockSize; ++unit)
+            UsedUnits[unit] = used;
+    }
+
+    // With the buddies merged right away a fully free aligned block is always available to the allocator.
+    bool HasFreeBlock(UINT64 blockSize) const
+    {
+        for (UINT64 offset = 0; offset < Capacity; offset += blockSize)
+        {
+            if (IsFree(offset, blockSize))
+                return true;
+        }
+        return false;
+    }
+
+    UINT64 GetLargestFreeBlock() const
+    {
+        for (UINT64 blockSize = Capacity; blockSize >= MinBlockSize; blockSize /= 2)
+        {
+            if (HasFreeBlock(blockSize))
+                return blockSize;
+        }
+        return 0;
+    }
+
+    // The free blocks which aren't part of a larger free block, merging leaves exactly these in the free lists.
+    UINT CountFreeBlocks(UINT64 offset, UINT64 blockSize) const
+    {
+        if (IsFree(offset, blockSize))
+            return 1;
+        auto it = Blocks.find(offset);
+        if (blockSize == MinBlockSize || (it != Blocks.end() && it->second.BlockSize == blockSize))
+            return 0;
+        return CountFreeBlocks(offset, blockSize / 2) + CountFreeBlocks(offset + blockSize / 2, blockSize / 2);
+    }
+};
+
+UINT64 GetBlockSize(UINT64 size, UINT64 alignment)
+{
+    UINT64 blockSize = MinBlockSize;
+    while (blockSize < size || blockSize < alignment)
+        blockSize *= 2;
+    return blockSize;
+}
+
+bool MatchesShadow(const BuddyAllocator& allocator, const ShadowModel& shadow)
+{
+    UINT64 allocatedSize = 0;
+    UINT64 requestedSize = 0;
+    for (const auto& [offset, block] : shadow.Blocks)
+    {
+        allocatedSize += block.BlockSize;
+        requestedSize += block.Size;
+    }
+    BuddyAllocatorStats stats = allocator.GetStats();
+    return stats.Capacity == Capacity && stats.AllocatedSize == allocatedSize && stats.RequestedSize == requestedSize
+        && stats.AllocationsCount == shadow.Blocks.size() && stats.LargestFreeBlock == shadow.GetLargestFreeBlock()
+        && stats.FreeBlocksCount == shadow.CountFreeBlocks(0, Capacity) && allocator.IsEmpty() == shadow.Blocks.empty();
+}
+}
+
+TEST(BuddyAllocator_Limits)
+{
+    BuddyAllocator allocator(Capacity, MinBlockSize);
+    CHECK(allocator.Allocate(Capacity + 1, 1) == BuddyAllocator::InvalidOffset);
+    CHECK(allocator.Allocate(1, Capacity * 2) == BuddyAllocator::InvalidOffset);
+
+    // The whole range, then nothing fits until it's freed.
+    UINT64 offset = allocator.Allocate(Capacity, 1);
+    CHECK(offset == 0);
+    CHECK(allocator.Allocate(1, 1) == BuddyAllocator::InvalidOffset);
+    allocator.Free(offset);
+    CHECK(allocator.IsEmpty());
+
+    // A small block with a large alignment takes a block of the alignment size.
+    offset = allocator.Allocate(100, 64 * 1024);
+    CHECK(offset == 0);
+    CHECK(allocator.GetStats().AllocatedSize == 64 * 1024 && allocator.GetStats().RequestedSize == 100);
+    allocator.Free(offset);
+    CHECK(allocator.GetStats().FreeBlocksCount == 1 && allocator.GetStats().LargestFreeBlock == Capacity);
+}
+
+// Random allocations and frees checked against a model of the range after every operation: the blocks are aligned, don't overlap,
+// an allocation fails only if no aligned block of its size is free, and the free lists hold exactly the merged free blocks.
+TEST(BuddyAllocator_FuzzAgainstShadow)
+{
+    BuddyAllocator allocator(Capacity, MinBlockSize);
+    ShadowModel shadow;
+    std::mt19937 rng(42);
+    const UINT64 alignments[] = { 1, 4, MinBlockSize, 4096, 64 * 1024 };
+
+    bool aligned = true;
+    bool disjoint = true;
+    bool failsOnlyWhenFull = true;
+    bool statsMatch = true;
+    UINT failedCount = 0;
+    for (UINT step = 0; step < 20000; ++step)
+    {
+        // Allocations outweigh frees at first, so the range gets full, and frees win later until it's empty again.
+        const bool allocate = shadow.Blocks.empty() || std::uniform_int_distribution<UINT>(0, 99)(rng) < (step < 10000 ? 60u : 35u);
+        if (allocate)
+        {
+            // Mostly small sizes with an occasional large one.
+            const UINT64 maxSize = std::uniform_int_distribution<UINT>(0, 9)(rng) == 0 ? Capacity / 4 : 8 * 1024;
+            const UINT64 size = std::uniform_int_distribution<UINT64>(1, maxSize)(rng);
+            const UINT64 alignment = alignments[std::uniform_int_distribution<size_t>(0, std::size(alignments) - 1)(rng)];
+            const UINT64 blockSize = GetBlockSize(size, alignment);
+            UINT64 offset = allocator.Allocate(size, alignment);
+            if (offset == BuddyAllocator::InvalidOffset)
+            {
+                failsOnlyWhenFull &= !shadow.HasFreeBlock(blockSize);
+                ++failedCount;
+            }
+            else
+            {
+                aligned &= offset % blockSize == 0 && offset + blockSize <= Capacity;
+                disjoint &= shadow.IsFree(offset, blockSize);
+                shadow.Mark(offset, blockSize, true);
+                shadow.Blocks[offset] = { size, blockSize };
+            }
+        }
+        else
+        {
+            auto it = shadow.Blocks.begin();
+            std::advance(it, std::uniform_int_distribution<size_t>(0, shadow.Blocks.size() - 1)(rng));
+            allocator.Free(it->first);
+            shadow.Mark(it->first, it->second.BlockSize, false);
+            shadow.Blocks.erase(it);
+        }
+        statsMatch &= MatchesShadow(allocator, shadow);
+    }
+    CHECK(aligned);
+    CHECK(disjoint);
+    CHECK(failsOnlyWhenFull);
+    CHECK(statsMatch);
+    // The range got full at some point, otherwise the failure path wasn't exercised.
+    CHECK(failedCount > 0);
+
+    for (const auto& [offset, block] : shadow.Blocks)
+        allocator.Free(offset);
+    CHECK(allocator.IsEmpty());
+    CHECK(allocator.GetStats().FreeBlocksCount == 1 && allocator.GetStats().LargestFreeBlock == Capacity);
+}
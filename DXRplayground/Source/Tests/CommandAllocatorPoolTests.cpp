@@ -0,0 +1,161 @@
+#include "DXrenderer/CommandAllocatorPool.h"
+
+#include <algorithm>
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+// Counts the resets, everything else a command list would need from an allocator is missing.
+class FakeAllocator : public ID3D12CommandAllocator
+{
+public:
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override
+    {
+        *object = nullptr;
+        return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return ++mRefsCount;
+    }
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        ULONG refsCount = --mRefsCount;
+        if (refsCount == 0)
+            delete this;
+        return refsCount;
+    }
+    HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override
+    {
+        return E_NOTIMPL;
+    }
+    HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override
+    {
+        return E_NOTIMPL;
+    }
+    HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override
+    {
+        return E_NOTIMPL;
+    }
+    HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override
+    {
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** device) override
+    {
+        *device = nullptr;
+        return E_NOINTERFACE;
+    }
+    HRESULT STDMETHODCALLTYPE Reset() override
+    {
+        ++ResetsCount;
+        return S_OK;
+    }
+
+    UINT ResetsCount = 0;
+
+private:
+    ULONG mRefsCount = 1;
+};
+
+// A fence the test advances by hand, the wait of the pool "executes" everything up to the value.
+struct FakeFence
+{
+    UINT64 Completed = 0;
+    std::vector<UINT64> Waits;
+};
+
+CommandAllocatorPool CreatePool(FakeFence& fence, UINT maxAllocatorsPerType)
+{
+    auto create = [](D3D12_COMMAND_LIST_TYPE, UINT)
+    {
+        ComPtr<ID3D12CommandAllocator> allocator;
+        allocator.Attach(new FakeAllocator());
+        return allocator;
+    };
+    auto wait = [&fence](UINT64 fenceValue)
+    {
+        fence.Waits.push_back(fenceValue);
+        fence.Completed = (std::max)(fence.Completed, fenceValue);
+    };
+    return CommandAllocatorPool(create, wait, maxAllocatorsPerType);
+}
+
+UINT GetResetsCount(const ComPtr<ID3D12CommandAllocator>& allocator)
+{
+    return static_cast<FakeAllocator*>(allocator.Get())->ResetsCount;
+}
+}
+
+TEST(CommandAllocatorPool_ReuseAfterFence)
+{
+    constexpr D3D12_COMMAND_LIST_TYPE Direct = D3D12_COMMAND_LIST_TYPE_DIRECT;
+    FakeFence fence;
+    CommandAllocatorPool pool = CreatePool(fence, 8);
+
+    ComPtr<ID3D12CommandAllocator> first = pool.Acquire(Direct, fence.Completed);
+    ID3D12CommandAllocator* firstPtr = first.Get();
+    pool.Release(Direct, std::move(first), 1);
+
+    // Still in flight, a new one is created instead of waiting.
+    ComPtr<ID3D12CommandAllocator> second = pool.Acquire(Direct, fence.Completed);
+    CHECK(second.Get() != firstPtr);
+    CHECK(pool.GetStats(Direct).Created == 2 && pool.GetStats(Direct).Reused == 0);
+    pool.Release(Direct, std::move(second), 2);
+
+    // The GPU passed the first value, the oldest allocator comes back reset.
+    fence.Completed = 1;
+    ComPtr<ID3D12CommandAllocator> reused = pool.Acquire(Direct, fence.Completed);
+    CHECK(reused.Get() == firstPtr);
+    CHECK(GetResetsCount(reused) == 1);
+    CHECK(pool.GetStats(Direct).Created == 2 && pool.GetStats(Direct).Reused == 1 && pool.GetStats(Direct).Waits == 0);
+    CHECK(pool.GetReleasedCount(Direct) == 1);
+    CHECK(fence.Waits.empty());
+
+    // Every type has its own allocators.
+    ComPtr<ID3D12CommandAllocator> copy = pool.Acquire(D3D12_COMMAND_LIST_TYPE_COPY, fence.Completed);
+    CHECK(pool.GetStats(D3D12_COMMAND_LIST_TYPE_COPY).Created == 1 && pool.GetStats(Direct).Created == 2);
+    pool.Release(D3D12_COMMAND_LIST_TYPE_COPY, std::move(copy), 3);
+    pool.Release(Direct, std::move(reused), 3);
+}
+
+// The pool grows while everything is in flight, at the limit it waits for the oldest allocator.
+TEST(CommandAllocatorPool_WaitsAtLimit)
+{
+    constexpr D3D12_COMMAND_LIST_TYPE Direct = D3D12_COMMAND_LIST_TYPE_DIRECT;
+    constexpr UINT MaxAllocators = 3;
+    FakeFence fence;
+    CommandAllocatorPool pool = CreatePool(fence, MaxAllocators);
+
+    std::vector<ID3D12CommandAllocator*> created;
+    for (UINT64 frame = 1; frame <= MaxAllocators; ++frame)
+    {
+        ComPtr<ID3D12CommandAllocator> allocator = pool.Acquire(Direct, fence.Completed);
+        created.push_back(allocator.Get());
+        pool.Release(Direct, std::move(allocator), frame);
+    }
+    CHECK(pool.GetStats(Direct).Created == MaxAllocators && fence.Waits.empty());
+
+    for (UINT64 frame = MaxAllocators + 1; frame <= 3 * MaxAllocators; ++frame)
+    {
+        ComPtr<ID3D12CommandAllocator> allocator = pool.Acquire(Direct, fence.Completed);
+        // Only the oldest submission is waited for, the allocators come back in the release order.
+        CHECK(fence.Waits.size() == frame - MaxAllocators && fence.Waits.back() == frame - MaxAllocators);
+        CHECK(allocator.Get() == created[(frame - 1) % MaxAllocators]);
+        pool.Release(Direct, std::move(allocator), frame);
+    }
+    const CommandAllocatorPool::Stats& stats = pool.GetStats(Direct);
+    CHECK(stats.Created == MaxAllocators);
+    CHECK(stats.Waits == 2 * MaxAllocators && stats.Reused == 2 * MaxAllocators);
+
+    // Nothing to wait for once the GPU catches up.
+    fence.Completed = 3 * MaxAllocators;
+    ComPtr<ID3D12CommandAllocator> allocator = pool.Acquire(Direct, fence.Completed);
+    CHECK(stats.Waits == 2 * MaxAllocators && stats.Reused == 2 * MaxAllocators + 1);
+    CHECK(GetResetsCount(allocator) == 3);
+    pool.Release(Direct, std::move(allocator), 3 * MaxAllocators + 1);
+}
@@ -0,0 +1,90 @@
+#include "DXrenderer/Memory/DeferredReleaseQueue.h"
+
+#include <memory>
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+// The deleters run in the enqueue order and only up to the completed fence value.
+TEST(DeferredReleaseQueue_DrainUpToCompleted)
+{
+    DeferredReleaseQueue queue;
+    std::vector<int> order;
+    queue.Enqueue(1, [&order]() { order.push_back(0); });
+    queue.Enqueue(1, [&order]() { order.push_back(1); });
+    queue.Enqueue(2, [&order]() { order.push_back(2); });
+    queue.Enqueue(4, [&order]() { order.push_back(3); });
+    CHECK(queue.GetPendingCount() == 4);
+
+    queue.Drain(0);
+    CHECK(order.empty());
+    queue.Drain(1);
+    CHECK(order == std::vector<int>({ 0, 1 }));
+    queue.Drain(3);
+    CHECK(order == std::vector<int>({ 0, 1, 2 }));
+    CHECK(queue.GetPendingCount() == 1);
+    queue.Drain(4);
+    CHECK(order == std::vector<int>({ 0, 1, 2, 3 }));
+    CHECK(queue.GetPendingCount() == 0);
+}
+
+// A deleter can release what its object owned, e.g. the heap of a placed resource. An already passed fence value runs in the same Drain.
+TEST(DeferredReleaseQueue_EnqueueFromDeleter)
+{
+    DeferredReleaseQueue queue;
+    std::vector<int> order;
+    queue.Enqueue(1, [&]()
+    {
+        order.push_back(0);
+        queue.Enqueue(1, [&order]() { order.push_back(2); });
+        queue.Enqueue(3, [&order]() { order.push_back(3); });
+    });
+    queue.Enqueue(1, [&order]() { order.push_back(1); });
+
+    queue.Drain(2);
+    CHECK(order == std::vector<int>({ 0, 1, 2 }));
+    CHECK(queue.GetPendingCount() == 1);
+    queue.Drain(3);
+    CHECK(order == std::vector<int>({ 0, 1, 2, 3 }));
+}
+
+// The owner flushes the GPU before destroying the queue, everything left is released.
+TEST(DeferredReleaseQueue_DestructorDrains)
+{
+    std::vector<int> order;
+    {
+        DeferredReleaseQueue queue;
+        queue.Enqueue(5, [&order]() { order.push_back(0); });
+        queue.Enqueue(~0ull, [&order]() { order.push_back(1); });
+        queue.Drain(1);
+        CHECK(order.empty());
+    }
+    CHECK(order == std::vector<int>({ 0, 1 }));
+}
+
+// Release keeps its copy of the owner alive until the fence value is passed, so the object outlives the caller's references.
+TEST(DeferredReleaseQueue_ReleaseKeepsObjectAlive)
+{
+    DeferredReleaseQueue queue;
+    std::shared_ptr<int> object = std::make_shared<int>(42);
+    std::weak_ptr<int> observer = object;
+    queue.Release(2, std::move(object));
+    CHECK(!observer.expired());
+
+    queue.Drain(1);
+    CHECK(!observer.expired());
+    queue.Drain(2);
+    CHECK(observer.expired());
+
+    std::weak_ptr<int> lastObserver;
+    {
+        DeferredReleaseQueue lastQueue;
+        std::shared_ptr<int> last = std::make_shared<int>(7);
+        lastObserver = last;
+        lastQueue.Release(10, last);
+        last.reset();
+        CHECK(!lastObserver.expired());
+    }
+    CHECK(lastObserver.expired());
+}
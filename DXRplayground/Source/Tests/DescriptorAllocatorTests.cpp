@@ -0,0 +1,101 @@
+#include "DXrenderer/Memory/DescriptorAllocator.h"
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+// A freed range isn't handed out again until the GPU passes the fence value it was freed with.
+TEST(DescriptorAllocator_ReuseAfterFence)
+{
+    DescriptorAllocator allocator(4);
+    CHECK(allocator.Allocate() == 0);
+    CHECK(allocator.Allocate() == 1);
+    CHECK(allocator.Allocate() == 2);
+    allocator.Free(1, 1, 5);
+    CHECK(allocator.Allocate() == 3);
+    CHECK(allocator.Allocate() == DescriptorAllocator::InvalidIndex);
+    CHECK(allocator.GetAllocatedCount() == 4);
+
+    allocator.Reclaim(4);
+    CHECK(allocator.Allocate() == DescriptorAllocator::InvalidIndex);
+    allocator.Reclaim(5);
+    CHECK(allocator.GetAllocatedCount() == 3);
+    CHECK(allocator.Allocate() == 1);
+    CHECK(allocator.GetAllocatedCount() == 4);
+}
+
+// Without the space at the end the smallest larger free range is split, the rest stays free.
+TEST(DescriptorAllocator_Split)
+{
+    DescriptorAllocator allocator(10);
+    CHECK(allocator.Allocate(4) == 0);
+    CHECK(allocator.Allocate(1) == 4);
+    CHECK(allocator.Allocate(3) == 5);
+    CHECK(allocator.Allocate(2) == 8);
+    allocator.Free(0, 4, 1);
+    allocator.Free(5, 3, 1);
+    allocator.Reclaim(1);
+
+    // A free range of the size first, then the smaller one of the larger ranges.
+    CHECK(allocator.Allocate(3) == 5);
+    CHECK(allocator.Allocate(1) == 0);
+    CHECK(allocator.Allocate(2) == 1);
+    CHECK(allocator.Allocate(2) == DescriptorAllocator::InvalidIndex);
+    CHECK(allocator.Allocate(1) == 3);
+    CHECK(allocator.Allocate(1) == DescriptorAllocator::InvalidIndex);
+    CHECK(allocator.GetAllocatedCount() == 10);
+}
+
+// Freed single descriptors merge into ranges a streamed texture can use, the ones at the end give the space back.
+TEST(DescriptorAllocator_Coalesce)
+{
+    DescriptorAllocator allocator(8);
+    for (UINT i = 0; i < 8; ++i)
+        CHECK(allocator.Allocate() == i);
+
+    allocator.Free(2, 1, 1);
+    allocator.Free(3, 1, 1);
+    allocator.Free(5, 1, 1);
+    allocator.Free(4, 1, 2);
+    allocator.Reclaim(1);
+    // 2 and 3 are free, 4 is still in flight.
+    CHECK(allocator.Allocate(3) == DescriptorAllocator::InvalidIndex);
+    CHECK(allocator.Allocate(2) == 2);
+    allocator.Free(2, 2, 2);
+    allocator.Reclaim(2);
+    CHECK(allocator.Allocate(4) == 2);
+
+    // The end is merged with the free range before it.
+    allocator.Free(6, 1, 3);
+    allocator.Free(1, 1, 3);
+    allocator.Free(7, 1, 3);
+    allocator.Free(2, 4, 3);
+    allocator.Reclaim(3);
+    CHECK(allocator.GetAllocatedCount() == 1);
+    CHECK(allocator.Allocate(7) == 1);
+    CHECK(allocator.Allocate() == DescriptorAllocator::InvalidIndex);
+}
+
+// Every frame has its own linear region after the persistent descriptors, reset as a whole by BeginFrame.
+TEST(DescriptorAllocator_TransientRegions)
+{
+    DescriptorAllocator allocator(4, 3, 2);
+    CHECK(allocator.GetCapacity() == 10);
+
+    allocator.BeginFrame(0);
+    CHECK(allocator.AllocateTransient(2) == 4);
+    CHECK(allocator.AllocateTransient(1) == 6);
+    CHECK(allocator.AllocateTransient(1) == DescriptorAllocator::InvalidIndex);
+
+    allocator.BeginFrame(1);
+    CHECK(allocator.AllocateTransient(3) == 7);
+    CHECK(allocator.AllocateTransient(1) == DescriptorAllocator::InvalidIndex);
+
+    allocator.BeginFrame(0);
+    CHECK(allocator.AllocateTransient(3) == 4);
+
+    // The persistent part doesn't grow into the regions.
+    CHECK(allocator.Allocate(4) == 0);
+    CHECK(allocator.Allocate() == DescriptorAllocator::InvalidIndex);
+    CHECK(allocator.GetAllocatedCount() == 4);
+}
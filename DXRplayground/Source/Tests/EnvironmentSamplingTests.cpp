@@ -0,0 +1,128 @@
+#include "DXrenderer/Textures/EnvironmentSampling.h"
+
+#include <cstring>
+
+#include "DXrenderer/Textures/MipChain.h"
+#include "DXrenderer/Textures/Texture.h"
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+namespace
+{
+constexpr UINT Width = 64;
+constexpr UINT Height = 32;
+
+// A dim sky gradient with a small bright sun, every texel has some luminance.
+std::vector<float> MakeEnvironment()
+{
+    std::vector<float> rgba(size_t(Width) * Height * 4);
+    for (UINT y = 0; y < Height; ++y)
+    {
+        for (UINT x = 0; x < Width; ++x)
+        {
+            float* texel = &rgba[(size_t(y) * Width + x) * 4];
+            bool sun = x >= 40 && x < 43 && y >= 8 && y < 10;
+            texel[0] = sun ? 50.0f : 0.2f + 0.01f * x;
+            texel[1] = sun ? 45.0f : 0.3f + 0.02f * y;
+            texel[2] = sun ? 40.0f : 0.8f;
+            texel[3] = 1.0f;
+        }
+    }
+    return rgba;
+}
+
+double IntegratePdf(const EnvironmentSampling& sampling)
+{
+    double sum = 0.0;
+    for (UINT y = 0; y < Height; ++y)
+    {
+        for (UINT x = 0; x < Width; ++x)
+            sum += sampling.GetPdf((x + 0.5f) / Width, (y + 0.5f) / Height);
+    }
+    return sum / (Width * Height);
+}
+}
+
+TEST(EnvironmentSampling_PdfIntegratesToOne)
+{
+    std::vector<float> rgba = MakeEnvironment();
+    EnvironmentSampling sampling;
+    sampling.Build(rgba.data(), Width, Height);
+    CHECK(sampling.GetWidth() == Width && sampling.GetHeight() == Height);
+    CHECK(sampling.GetTables().size() == Height + size_t(Width) * Height * 2);
+    CHECK_NEAR(IntegratePdf(sampling), 1.0, 1e-4);
+
+    // The sun is picked far more often than the sky around it.
+    CHECK(sampling.GetPdf(41.5f / Width, 8.5f / Height) > 10.0f * sampling.GetPdf(20.5f / Width, 8.5f / Height));
+
+    // A black map falls back to the uniform distribution.
+    std::vector<float> black(rgba.size(), 0.0f);
+    EnvironmentSampling uniform;
+    uniform.Build(black.data(), Width, Height);
+    CHECK_NEAR(IntegratePdf(uniform), 1.0, 1e-6);
+    CHECK_NEAR(uniform.GetPdf(0.3f, 0.7f), 1.0f, 1e-6f);
+}
+
+// Stratified xi over the unit square: the returned pdf is the one of the texel the point falls into, and the average of 1 / pdf
+// estimates the area of [0, 1]^2 only if the points are distributed with that pdf.
+TEST(EnvironmentSampling_SampleMatchesPdf)
+{
+    std::vector<float> rgba = MakeEnvironment();
+    EnvironmentSampling sampling;
+    sampling.Build(rgba.data(), Width, Height);
+
+    constexpr UINT Strata = 1024;
+    bool pdfsMatch = true;
+    bool inRange = true;
+    double inversePdfSum = 0.0;
+    for (UINT i = 0; i < Strata; ++i)
+    {
+        for (UINT j = 0; j < Strata; ++j)
+        {
+            float u = 0.0f;
+            float v = 0.0f;
+            float pdf = 0.0f;
+            sampling.Sample((i + 0.5f) / Strata, (j + 0.5f) / Strata, u, v, pdf);
+            inRange &= u >= 0.0f && u < 1.0f && v >= 0.0f && v < 1.0f;
+            pdfsMatch &= pdf == sampling.GetPdf(u, v);
+            inversePdfSum += 1.0 / pdf;
+        }
+    }
+    CHECK(inRange);
+    CHECK(pdfsMatch);
+    CHECK_NEAR(inversePdfSum / (Strata * Strata), 1.0, 0.01);
+}
+
+// EnvironmentMap cooks the tables from the HDR it has already decoded for the cubemap, wide images are built from a mip no wider
+// than MaxWidth.
+TEST(EnvironmentSampling_CookFromDecodedImage)
+{
+    auto makeSource = [](const std::vector<float>& rgba, UINT width, UINT height)
+    {
+        std::vector<byte> data(rgba.size() * sizeof(float));
+        memcpy(data.data(), rgba.data(), data.size());
+        return Texture(width, height, DXGI_FORMAT_R32G32B32A32_FLOAT, std::move(data));
+    };
+
+    std::vector<float> rgba = MakeEnvironment();
+    EnvironmentSampling built;
+    built.Build(rgba.data(), Width, Height);
+    EnvironmentSampling cooked;
+    cooked.CookFrom(makeSource(rgba, Width, Height));
+    CHECK(cooked.GetWidth() == Width && cooked.GetHeight() == Height);
+    CHECK(cooked.GetTables() == built.GetTables());
+
+    constexpr UINT WideWidth = EnvironmentSampling::MaxWidth * 2;
+    constexpr UINT WideHeight = 8;
+    std::vector<float> wide(size_t(WideWidth) * WideHeight * 4);
+    for (size_t i = 0; i < wide.size(); ++i)
+        wide[i] = 0.1f + float(i % 97) / 97.0f;
+    EnvironmentSampling reduced;
+    reduced.CookFrom(makeSource(wide, WideWidth, WideHeight));
+    CHECK(reduced.GetWidth() == EnvironmentSampling::MaxWidth && reduced.GetHeight() == WideHeight / 2);
+    std::vector<byte> chain = MipChain::Generate(wide.data(), WideWidth, WideHeight);
+    EnvironmentSampling secondMip;
+    secondMip.Build(reinterpret_cast<const float*>(chain.data()) + wide.size(), WideWidth / 2, WideHeight / 2);
+    CHECK(reduced.GetTables() == secondMip.GetTables());
+}
@@ -0,0 +1,107 @@
+#include "DXrenderer/Textures/MipChain.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+namespace
+{
+const float* GetFloatLevel(const std::vector<byte>& chain, UINT width, UINT height, UINT mip)
+{
+    size_t offset = 0;
+    for (UINT i = 0; i < mip; ++i)
+        offset += size_t(std::max(1U, width >> i)) * std::max(1U, height >> i) * 4;
+    return reinterpret_cast<const float*>(chain.data()) + offset;
+}
+}
+
+TEST(MipChain_LevelLayout)
+{
+    CHECK(MipChain::GetMipsCount(1, 1) == 1);
+    CHECK(MipChain::GetMipsCount(256, 256) == 9);
+    CHECK(MipChain::GetMipsCount(5, 3) == 3);
+    CHECK(MipChain::GetMipsCount(1, 7) == 3);
+
+    // 5x3, 2x1 and 1x1 tightly packed, level 0 is copied as is.
+    std::vector<byte> rgba(5 * 3 * 4);
+    for (size_t i = 0; i < rgba.size(); ++i)
+        rgba[i] = byte(i * 4);
+    std::vector<byte> chain = MipChain::Generate(rgba.data(), 5, 3, false);
+    CHECK(chain.size() == (15 + 2 + 1) * 4);
+    CHECK(memcmp(chain.data(), rgba.data(), rgba.size()) == 0);
+
+    std::vector<float> hdr(5 * 3 * 4, 1.0f);
+    std::vector<byte> hdrChain = MipChain::Generate(hdr.data(), 5, 3);
+    CHECK(hdrChain.size() == (15 + 2 + 1) * 4 * sizeof(float));
+}
+
+// For 5 texels the weights are (2, 2, 1) / 5 and (1, 2, 2) / 5, every source texel contributes 2/5 in total.
+TEST(MipChain_OddSizeWeights)
+{
+    for (UINT impulse = 0; impulse < 5; ++impulse)
+    {
+        std::vector<float> row(5 * 4, 0.0f);
+        row[impulse * 4] = 1.0f;
+        std::vector<byte> chain = MipChain::Generate(row.data(), 5, 1);
+        const float* mip1 = GetFloatLevel(chain, 5, 1, 1);
+        const float expected[5][2] = { { 0.4f, 0.0f }, { 0.4f, 0.0f }, { 0.2f, 0.2f }, { 0.0f, 0.4f }, { 0.0f, 0.4f } };
+        CHECK_NEAR(mip1[0], expected[impulse][0], 1e-6f);
+        CHECK_NEAR(mip1[4], expected[impulse][1], 1e-6f);
+        CHECK_NEAR(mip1[0] + mip1[4], 0.4f, 1e-6f);
+    }
+
+    // The weights sum to one, a constant image stays constant and the mean is preserved at every odd level.
+    const UINT width = 7;
+    const UINT height = 5;
+    std::vector<float> constant(size_t(width) * height * 4, 0.3f);
+    std::vector<byte> constantChain = MipChain::Generate(constant.data(), width, height);
+    const size_t chainFloats = constantChain.size() / sizeof(float);
+    for (size_t i = 0; i < chainFloats; ++i)
+        CHECK_NEAR(reinterpret_cast<const float*>(constantChain.data())[i], 0.3f, 1e-6f);
+
+    std::vector<float> gradient(size_t(width) * height * 4);
+    for (size_t i = 0; i < gradient.size(); ++i)
+        gradient[i] = float(i % 13) / 13.0f;
+    std::vector<byte> gradientChain = MipChain::Generate(gradient.data(), width, height);
+    for (UINT c = 0; c < 4; ++c)
+    {
+        double mean0 = 0.0;
+        for (UINT i = 0; i < width * height; ++i)
+            mean0 += gradient[i * 4 + c];
+        mean0 /= width * height;
+        // 7x5 -> 3x2, both axes use the three tap filter.
+        const float* mip1 = GetFloatLevel(gradientChain, width, height, 1);
+        double mean1 = 0.0;
+        for (UINT i = 0; i < 3 * 2; ++i)
+            mean1 += mip1[i * 4 + c];
+        mean1 /= 3 * 2;
+        CHECK_NEAR(mean0, mean1, 1e-5);
+    }
+}
+
+TEST(MipChain_SrgbRoundTrip)
+{
+    // A constant sRGB image comes back unchanged after the linear space filtering.
+    for (UINT value = 0; value < 256; ++value)
+    {
+        std::vector<byte> rgba(4 * 4 * 4, byte(value));
+        std::vector<byte> chain = MipChain::Generate(rgba.data(), 4, 4, true);
+        bool unchanged = true;
+        for (byte texel : chain)
+            unchanged &= texel == value;
+        CHECK(unchanged);
+    }
+
+    // Black and white average to the linear mid grey, 188 in sRGB. Alpha is filtered linearly.
+    const byte blackWhite[] = { 0, 0, 0, 0, 255, 255, 255, 255 };
+    std::vector<byte> srgbChain = MipChain::Generate(blackWhite, 2, 1, true);
+    CHECK(srgbChain.size() == 3 * 4);
+    CHECK(srgbChain[8] == 188 && srgbChain[9] == 188 && srgbChain[10] == 188);
+    CHECK(srgbChain[11] == 128);
+
+    std::vector<byte> linearChain = MipChain::Generate(blackWhite, 2, 1, false);
+    CHECK(linearChain[8] == 128 && linearChain[11] == 128);
+}
@@ -0,0 +1,70 @@
+#include "Utils/ParallelFor.h"
+
+#include <chrono>
+#include <mutex>
+#include <set>
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+// Every item is processed once by at most maxThreads threads.
+TEST(ParallelFor_AllItems)
+{
+    constexpr size_t Count = 1000;
+    std::vector<std::atomic<int>> processed(Count);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    ParallelFor(Count, [&](size_t i)
+    {
+        ++processed[i];
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    }, 4);
+
+    bool once = true;
+    for (const auto& p : processed)
+        once &= p == 1;
+    CHECK(once);
+    CHECK(threads.size() <= 4);
+}
+
+// A loop started from a worker runs on that worker, nested loops don't multiply the threads.
+TEST(ParallelFor_NestedRunsOnWorker)
+{
+    constexpr size_t OuterCount = 4;
+    constexpr size_t InnerCount = 64;
+    std::vector<std::atomic<int>> processed(OuterCount * InnerCount);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    bool sameThread = true;
+    ParallelFor(OuterCount, [&](size_t outer)
+    {
+        const std::thread::id outerThread = std::this_thread::get_id();
+        ParallelFor(InnerCount, [&](size_t inner)
+        {
+            ++processed[outer * InnerCount + inner];
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.insert(std::this_thread::get_id());
+            sameThread &= std::this_thread::get_id() == outerThread;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }, 4);
+    }, 4);
+
+    bool once = true;
+    for (const auto& p : processed)
+        once &= p == 1;
+    CHECK(once);
+    CHECK(sameThread);
+    CHECK(threads.size() <= OuterCount);
+
+    // The calling thread isn't a worker anymore, its next loop is parallel again.
+    std::set<std::thread::id> afterThreads;
+    ParallelFor(64, [&](size_t)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        afterThreads.insert(std::this_thread::get_id());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }, 4);
+    CHECK(afterThreads.size() > 1);
+}
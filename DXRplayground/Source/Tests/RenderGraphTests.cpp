@@ -0,0 +1,210 @@
+#include "DXrenderer/RenderGraph/RenderGraph.h"
+
+#include "DXrenderer/ResourceDX.h"
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+namespace
+{
+constexpr UINT64 PageSize = 64 * 1024;
+constexpr D3D12_RESOURCE_STATES RenderTarget = D3D12_RESOURCE_STATE_RENDER_TARGET;
+constexpr D3D12_RESOURCE_STATES PixelShader = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+constexpr D3D12_RESOURCE_STATES UnorderedAccess = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+
+// A texture of pagesCount pages, render targets go to their own heap group as on resource heap tier 1.
+D3D12_RESOURCE_DESC MakeDesc(UINT64 pagesCount, bool renderTarget = false)
+{
+    D3D12_RESOURCE_DESC desc{};
+    desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    desc.Width = pagesCount;
+    desc.Height = 1;
+    desc.Flags = renderTarget ? D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET : D3D12_RESOURCE_FLAG_NONE;
+    return desc;
+}
+
+RgAllocationInfo GetAllocationInfo(const D3D12_RESOURCE_DESC& desc)
+{
+    return { desc.Width * PageSize, PageSize, (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) ? 1u : 0u };
+}
+
+const RgTransition* FindTransition(const std::vector<RgTransition>& transitions, RgResource resource)
+{
+    for (const RgTransition& transition : transitions)
+    {
+        if (transition.Resource == resource)
+            return &transition;
+    }
+    return nullptr;
+}
+}
+
+TEST(RenderGraph_PassCulling)
+{
+    ResourceDX backBuffer;
+    RenderGraph graph;
+    RgResource back = graph.ImportResource("Back", &backBuffer);
+    RgResource shadows = graph.CreateTexture("Shadows", MakeDesc(1));
+    RgResource debug = graph.CreateTexture("Debug", MakeDesc(1));
+    RgResource history = graph.CreateTexture("History", MakeDesc(1));
+
+    RgPass shadowPass = graph.AddPass("Shadows", nullptr);
+    graph.Write(shadowPass, shadows, UnorderedAccess);
+    // Nobody reads what it writes.
+    RgPass debugPass = graph.AddPass("Debug", nullptr);
+    graph.Read(debugPass, shadows, PixelShader);
+    graph.Write(debugPass, debug, RenderTarget);
+    // Written only for a culled pass, the whole chain goes.
+    RgPass historyPass = graph.AddPass("History", nullptr);
+    graph.Write(historyPass, history, RenderTarget);
+    RgPass historyReadPass = graph.AddPass("HistoryRead", nullptr);
+    graph.Read(historyReadPass, history, PixelShader);
+    graph.Write(historyReadPass, debug, RenderTarget);
+    RgPass lightingPass = graph.AddPass("Lighting", nullptr);
+    graph.Read(lightingPass, shadows, PixelShader);
+    graph.Write(lightingPass, back, RenderTarget);
+    // Writes outside of the graph.
+    RgPass readbackPass = graph.AddPass("Readback", nullptr);
+    graph.Read(readbackPass, shadows, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    graph.SetSideEffects(readbackPass);
+    graph.Compile(GetAllocationInfo);
+
+    CHECK(!graph.IsCulled(shadowPass));
+    CHECK(graph.IsCulled(debugPass));
+    CHECK(graph.IsCulled(historyPass) && graph.IsCulled(historyReadPass));
+    CHECK(!graph.IsCulled(lightingPass));
+    CHECK(!graph.IsCulled(readbackPass));
+
+    const std::vector<RgCompiledPass>& passes = graph.GetCompiledPasses();
+    CHECK(passes.size() == 3);
+    CHECK(passes[0].Pass == shadowPass && passes[1].Pass == lightingPass && passes[2].Pass == readbackPass);
+    // The resources of the culled passes are neither placed nor given memory.
+    CHECK(graph.GetPlacement(debug).FirstPass == InvalidRgIndex && graph.GetPlacement(history).FirstPass == InvalidRgIndex);
+    CHECK(graph.GetHeapGroupsCount() == 1 && graph.GetHeapSize(0) == PageSize);
+    CHECK(graph.GetUsedStates(shadows) == (UnorderedAccess | PixelShader | D3D12_RESOURCE_STATE_COPY_SOURCE));
+}
+
+// Resources alive at different times share memory and get an aliasing barrier with their first use, the ones alive at the same time or
+// in another heap group never do.
+TEST(RenderGraph_DisjointLifetimesAlias)
+{
+    ResourceDX backBuffer;
+    RenderGraph graph;
+    RgResource back = graph.ImportResource("Back", &backBuffer);
+    RgResource a = graph.CreateTexture("A", MakeDesc(4));
+    RgResource b = graph.CreateTexture("B", MakeDesc(2));
+    RgResource c = graph.CreateTexture("C", MakeDesc(2));
+    RgResource target = graph.CreateTexture("Target", MakeDesc(4, true));
+
+    RgPass p0 = graph.AddPass("P0", nullptr);
+    graph.Write(p0, a, UnorderedAccess);
+    RgPass p1 = graph.AddPass("P1", nullptr);
+    graph.Read(p1, a, PixelShader);
+    graph.Write(p1, b, UnorderedAccess);
+    RgPass p2 = graph.AddPass("P2", nullptr);
+    graph.Write(p2, b, UnorderedAccess);
+    RgPass p3 = graph.AddPass("P3", nullptr);
+    graph.Write(p3, c, UnorderedAccess);
+    graph.Write(p3, target, RenderTarget);
+    RgPass p4 = graph.AddPass("P4", nullptr);
+    graph.Read(p4, b, PixelShader);
+    graph.Read(p4, c, PixelShader);
+    graph.Read(p4, target, PixelShader);
+    graph.Write(p4, back, RenderTarget);
+    graph.Compile(GetAllocationInfo);
+
+    const std::vector<RgCompiledPass>& passes = graph.GetCompiledPasses();
+    CHECK(passes.size() == 5);
+
+    // A lives in [0, 1], B in [1, 4] and C in [3, 4]. C takes the memory of A, B overlaps both in time.
+    const RgPlacement& placementA = graph.GetPlacement(a);
+    const RgPlacement& placementB = graph.GetPlacement(b);
+    const RgPlacement& placementC = graph.GetPlacement(c);
+    CHECK(placementA.FirstPass == 0 && placementA.LastPass == 1);
+    CHECK(placementB.FirstPass == 1 && placementB.LastPass == 4);
+    CHECK(placementC.FirstPass == 3 && placementC.LastPass == 4);
+    CHECK(placementA.Offset == 0 && placementC.Offset == 0 && placementB.Offset == 4 * PageSize);
+    CHECK(placementA.Aliases.size() == 1 && placementA.Aliases[0] == c);
+    CHECK(placementC.Aliases.size() == 1 && placementC.Aliases[0] == a);
+    CHECK(placementB.Aliases.empty());
+    CHECK(graph.GetHeapSize(0) == 6 * PageSize);
+
+    // The render target has its own heap even though A is free by then.
+    const RgPlacement& targetPlacement = graph.GetPlacement(target);
+    CHECK(graph.GetHeapGroupsCount() == 2);
+    CHECK(targetPlacement.HeapGroup == 1 && targetPlacement.Offset == 0 && targetPlacement.Aliases.empty());
+    CHECK(graph.GetHeapSize(1) == 4 * PageSize);
+
+    CHECK(passes[0].Acquired.size() == 1 && passes[0].Acquired[0] == a);
+    CHECK(passes[1].Acquired.size() == 1 && passes[1].Acquired[0] == b);
+    CHECK(passes[3].Acquired.size() == 2);
+
+    // B stays in the UAV state between two writes, the second one waits for the first.
+    CHECK(passes[2].UavBarriers.size() == 1 && passes[2].UavBarriers[0] == b);
+    CHECK(FindTransition(passes[2].Transitions, b) == nullptr);
+}
+
+// The first access of an imported resource transitions from its tracked state and begins with the frame, the later ones know the state
+// and begin right after the previous access.
+TEST(RenderGraph_ImportedResourceTransitions)
+{
+    ResourceDX backBuffer;
+    ResourceDX depthBuffer;
+    RenderGraph graph;
+    RgResource back = graph.ImportResource("Back", &backBuffer);
+    RgResource depth = graph.ImportResource("Depth", &depthBuffer);
+    RgResource hdr = graph.CreateTexture("Hdr", MakeDesc(1));
+
+    RgPass prepass = graph.AddPass("Prepass", nullptr);
+    graph.Write(prepass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    RgPass aoPass = graph.AddPass("Ao", nullptr);
+    graph.Read(aoPass, depth, PixelShader);
+    graph.Read(aoPass, depth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    RgPass forwardPass = graph.AddPass("Forward", nullptr);
+    graph.Write(forwardPass, hdr, RenderTarget);
+    graph.Write(forwardPass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    graph.SetSideEffects(aoPass);
+    RgPass postPass = graph.AddPass("Post", nullptr);
+    graph.Write(postPass, hdr, UnorderedAccess);
+    RgPass tonemapPass = graph.AddPass("Tonemap", nullptr);
+    graph.Read(tonemapPass, hdr, PixelShader);
+    graph.Write(tonemapPass, back, RenderTarget);
+    graph.Compile(GetAllocationInfo);
+
+    CHECK(graph.IsImported(back) && graph.GetImportedResource(back) == &backBuffer);
+    CHECK(!graph.IsImported(hdr));
+    const std::vector<RgCompiledPass>& passes = graph.GetCompiledPasses();
+    CHECK(passes.size() == 5);
+
+    // Imported resources aren't acquired or placed.
+    for (const RgCompiledPass& pass : passes)
+    {
+        for (RgResource acquired : pass.Acquired)
+            CHECK(acquired == hdr);
+    }
+    CHECK(graph.GetHeapSize(0) == PageSize);
+
+    const RgTransition* depthFirst = FindTransition(passes[0].Transitions, depth);
+    CHECK(depthFirst != nullptr && !depthFirst->BeforeKnown && depthFirst->After == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    CHECK(graph.GetFirstState(depth) == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    // The read states of one pass are combined into one transition.
+    const D3D12_RESOURCE_STATES depthRead = static_cast<D3D12_RESOURCE_STATES>(PixelShader | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    const RgTransition* depthRead1 = FindTransition(passes[1].Transitions, depth);
+    CHECK(depthRead1 != nullptr && depthRead1->BeforeKnown && depthRead1->Before == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    CHECK(depthRead1 != nullptr && depthRead1->After == depthRead);
+    const RgTransition* depthWrite2 = FindTransition(passes[2].Transitions, depth);
+    CHECK(depthWrite2 != nullptr && depthWrite2->Before == depthRead && depthWrite2->After == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    CHECK(graph.GetUsedStates(depth) == (D3D12_RESOURCE_STATE_DEPTH_WRITE | depthRead));
+
+    // The back buffer is first used by the last pass, its transition begins with the frame. The first transition of a transient
+    // resource follows its aliasing barrier and can't be split.
+    const RgTransition* backFirst = FindTransition(passes[4].Transitions, back);
+    CHECK(backFirst != nullptr && !backFirst->BeforeKnown && backFirst->After == RenderTarget);
+    CHECK(passes[0].SplitBegins.size() == 1 && passes[0].SplitBegins[0].Resource == back);
+
+    // Hdr goes from the UAV writes of Post to Tonemap right away, the depth transitions follow adjacent passes. Nothing else is split.
+    for (UINT i = 1; i < passes.size(); ++i)
+        CHECK(passes[i].SplitBegins.empty());
+}
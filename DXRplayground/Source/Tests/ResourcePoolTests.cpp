@@ -0,0 +1,85 @@
+#include "DXrenderer/Memory/ResourcePool.h"
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+namespace
+{
+constexpr UINT PageSize = 4;
+using Pool = ResourcePool<int, PageSize>;
+
+UINT GetIndex(ResourceHandle handle)
+{
+    return handle & ((1u << Pool::IndexBits) - 1);
+}
+}
+
+// Destroying bumps the generation of the slot, the old handle is rejected once the slot holds another object.
+TEST(ResourcePool_StaleHandles)
+{
+    Pool pool;
+    ResourceHandle first = pool.Create(1);
+    ResourceHandle second = pool.Create(2);
+    CHECK(pool.GetCount() == 2);
+    CHECK(pool.Get(first) != nullptr && *pool.Get(first) == 1);
+    CHECK(!pool.IsValid(InvalidResourceHandle) && pool.Get(InvalidResourceHandle) == nullptr);
+
+    pool.Destroy(first);
+    CHECK(pool.GetCount() == 1);
+    CHECK(!pool.IsValid(first) && pool.Get(first) == nullptr);
+    CHECK(*pool.Get(second) == 2);
+
+    // The freed slot is reused first with the next generation.
+    ResourceHandle third = pool.Create(3);
+    CHECK(GetIndex(third) == GetIndex(first) && third != first);
+    CHECK(third >> Pool::IndexBits == (first >> Pool::IndexBits) + 1);
+    CHECK(pool.Get(first) == nullptr && *pool.Get(third) == 3);
+
+    // A handle of a slot which was never created.
+    CHECK(!pool.IsValid(GetIndex(second) + 1));
+}
+
+// New pages are added without moving the old ones, the pointers of the live objects stay valid.
+TEST(ResourcePool_PointersSurviveGrowth)
+{
+    Pool pool;
+    std::vector<ResourceHandle> handles;
+    std::vector<const int*> pointers;
+    for (int i = 0; i < 10 * static_cast<int>(PageSize); ++i)
+    {
+        handles.push_back(pool.Create(i));
+        pointers.push_back(pool.Get(handles.back()));
+    }
+
+    bool stable = true;
+    for (int i = 0; i < static_cast<int>(handles.size()); ++i)
+        stable &= pool.Get(handles[i]) == pointers[i] && *pointers[i] == i;
+    CHECK(stable);
+    // Objects of a page are next to each other.
+    CHECK(pointers[1] == pointers[0] + 1 && pointers[PageSize - 1] == pointers[0] + PageSize - 1);
+}
+
+// The live objects are visited in the slot order with their current handles, the destroyed ones are skipped.
+TEST(ResourcePool_ForEach)
+{
+    Pool pool;
+    std::vector<ResourceHandle> handles;
+    for (int i = 0; i < 6; ++i)
+        handles.push_back(pool.Create(i));
+    pool.Destroy(handles[1]);
+    pool.Destroy(handles[4]);
+    handles[4] = pool.Create(40);
+
+    std::vector<int> visited;
+    bool handlesMatch = true;
+    pool.ForEach([&](ResourceHandle handle, int& value)
+    {
+        handlesMatch &= pool.Get(handle) == &value;
+        visited.push_back(value);
+        value *= 10;
+    });
+    CHECK(handlesMatch);
+    CHECK(visited == std::vector<int>({ 0, 2, 3, 40, 5 }));
+    CHECK(*pool.Get(handles[4]) == 400);
+}
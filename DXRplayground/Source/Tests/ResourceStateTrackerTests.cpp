@@ -0,0 +1,197 @@
+#include "DXrenderer/ResourceStateTracker.h"
+
+#include <cstdint>
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+namespace
+{
+constexpr UINT All = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+constexpr D3D12_RESOURCE_STATES Common = D3D12_RESOURCE_STATE_COMMON;
+constexpr D3D12_RESOURCE_STATES CopyDest = D3D12_RESOURCE_STATE_COPY_DEST;
+constexpr D3D12_RESOURCE_STATES PixelShader = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+constexpr D3D12_RESOURCE_STATES UnorderedAccess = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+
+// The tracker never dereferences the resources, any distinct pointers do.
+ID3D12Resource* FakeResource(uintptr_t id)
+{
+    return reinterpret_cast<ID3D12Resource*>(id * 0x100);
+}
+
+bool IsTransition(const D3D12_RESOURCE_BARRIER& barrier, ID3D12Resource* resource, UINT subresource, D3D12_RESOURCE_STATES before,
+    D3D12_RESOURCE_STATES after, D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE)
+{
+    return barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && barrier.Flags == flags && barrier.Transition.pResource == resource
+        && barrier.Transition.Subresource == subresource && barrier.Transition.StateBefore == before && barrier.Transition.StateAfter == after;
+}
+
+bool IsUav(const D3D12_RESOURCE_BARRIER& barrier, ID3D12Resource* resource)
+{
+    return barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV && barrier.UAV.pResource == resource;
+}
+}
+
+// Transitions to the current state are dropped, consecutive ones are merged and a pair returning to the state cancels out.
+TEST(ResourceStateTracker_MergesTransitions)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* a = FakeResource(1);
+    ID3D12Resource* b = FakeResource(2);
+    SubresourceStates statesA(Common);
+    SubresourceStates statesB(Common);
+
+    tracker.Transition(a, statesA, Common);
+    CHECK(tracker.GetPendingBarriers().empty());
+
+    tracker.Transition(a, statesA, CopyDest);
+    tracker.Transition(b, statesB, CopyDest);
+    tracker.Transition(a, statesA, PixelShader);
+    const std::vector<D3D12_RESOURCE_BARRIER>& pending = tracker.GetPendingBarriers();
+    CHECK(pending.size() == 2);
+    CHECK(pending.size() == 2 && IsTransition(pending[0], a, All, Common, PixelShader));
+    CHECK(statesA.Get() == PixelShader);
+
+    // B goes back to where it was in this batch.
+    tracker.Transition(b, statesB, Common);
+    CHECK(pending.size() == 1 && IsTransition(pending[0], a, All, Common, PixelShader));
+    CHECK(statesB.Get() == Common);
+
+    std::vector<D3D12_RESOURCE_BARRIER> flushed;
+    tracker.Flush(flushed);
+    CHECK(flushed.size() == 1 && tracker.GetPendingBarriers().empty());
+    // Nothing merges across a Flush.
+    tracker.Transition(a, statesA, Common);
+    CHECK(pending.size() == 1 && IsTransition(pending[0], a, All, PixelShader, Common));
+}
+
+// A UAV or an aliasing barrier of the resource has to stay between its transitions, the ones of other resources don't matter.
+TEST(ResourceStateTracker_BarriersStopMerging)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* a = FakeResource(1);
+    ID3D12Resource* b = FakeResource(2);
+    SubresourceStates statesA(Common);
+    const std::vector<D3D12_RESOURCE_BARRIER>& pending = tracker.GetPendingBarriers();
+
+    tracker.Transition(a, statesA, UnorderedAccess);
+    tracker.UavBarrier(b);
+    tracker.Transition(a, statesA, PixelShader);
+    CHECK(pending.size() == 2 && IsTransition(pending[0], a, All, Common, PixelShader) && IsUav(pending[1], b));
+
+    std::vector<D3D12_RESOURCE_BARRIER> flushed;
+    tracker.Flush(flushed);
+    tracker.Transition(a, statesA, UnorderedAccess);
+    tracker.UavBarrier(a);
+    // Nothing runs in between, the second one has nothing to wait for.
+    tracker.UavBarrier(a);
+    tracker.Transition(a, statesA, PixelShader);
+    CHECK(pending.size() == 3);
+    CHECK(pending.size() == 3 && IsTransition(pending[0], a, All, PixelShader, UnorderedAccess) && IsUav(pending[1], a)
+        && IsTransition(pending[2], a, All, UnorderedAccess, PixelShader));
+
+    // A UAV barrier of all resources covers A as well.
+    tracker.Flush(flushed);
+    tracker.Transition(a, statesA, UnorderedAccess);
+    tracker.UavBarrier(nullptr);
+    tracker.UavBarrier(b);
+    tracker.Transition(a, statesA, PixelShader);
+    CHECK(pending.size() == 3 && IsUav(pending[1], nullptr) && IsTransition(pending[2], a, All, UnorderedAccess, PixelShader));
+
+    tracker.Flush(flushed);
+    tracker.Transition(a, statesA, CopyDest);
+    tracker.AliasingBarrier(nullptr, b);
+    tracker.Transition(a, statesA, PixelShader);
+    CHECK(pending.size() == 3 && pending[1].Type == D3D12_RESOURCE_BARRIER_TYPE_ALIASING);
+    CHECK(pending.size() == 3 && IsTransition(pending[2], a, All, CopyDest, PixelShader));
+}
+
+// Subresources diverge with their own transitions and become uniform again once they are all in one state, a transition of the whole
+// resource covers every diverged subresource.
+TEST(ResourceStateTracker_Subresources)
+{
+    SubresourceStates states(Common);
+    states.SetSubresourceCount(3);
+    states.Set(1, Common);
+    CHECK(states.IsUniform());
+    states.Set(1, CopyDest);
+    CHECK(!states.IsUniform() && states.Get(0) == Common && states.Get(1) == CopyDest && states.Get(2) == Common);
+    states.Set(0, CopyDest);
+    CHECK(!states.IsUniform());
+    states.Set(2, CopyDest);
+    CHECK(states.IsUniform() && states.Get() == CopyDest);
+
+    ResourceStateTracker tracker;
+    ID3D12Resource* a = FakeResource(1);
+    std::vector<D3D12_RESOURCE_BARRIER> flushed;
+    tracker.Transition(a, states, PixelShader, 1);
+    tracker.Flush(flushed);
+    CHECK(flushed.size() == 1 && IsTransition(flushed[0], a, 1, CopyDest, PixelShader));
+
+    tracker.Transition(a, states, PixelShader);
+    const std::vector<D3D12_RESOURCE_BARRIER>& pending = tracker.GetPendingBarriers();
+    CHECK(pending.size() == 2);
+    CHECK(pending.size() == 2 && IsTransition(pending[0], a, 0, CopyDest, PixelShader) && IsTransition(pending[1], a, 2, CopyDest, PixelShader));
+    CHECK(states.IsUniform() && states.Get() == PixelShader);
+}
+
+// A split begun and ended in one batch is a regular barrier, across a Flush the end follows as its own barrier.
+TEST(ResourceStateTracker_SplitTransitions)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* a = FakeResource(1);
+    ID3D12Resource* b = FakeResource(2);
+    SubresourceStates statesA(Common);
+    SubresourceStates statesB(Common);
+    const std::vector<D3D12_RESOURCE_BARRIER>& pending = tracker.GetPendingBarriers();
+
+    tracker.BeginTransition(a, statesA, PixelShader);
+    CHECK(tracker.GetOpenSplitCount() == 1);
+    CHECK(pending.size() == 1 && IsTransition(pending[0], a, All, Common, PixelShader, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+    tracker.Transition(a, statesA, PixelShader);
+    CHECK(tracker.GetOpenSplitCount() == 0);
+    CHECK(pending.size() == 1 && IsTransition(pending[0], a, All, Common, PixelShader));
+
+    std::vector<D3D12_RESOURCE_BARRIER> flushed;
+    tracker.Flush(flushed);
+    tracker.BeginTransition(a, statesA, CopyDest);
+    tracker.Flush(flushed);
+    CHECK(tracker.GetOpenSplitCount() == 1);
+    // The next transition ends the split and can't be merged into its end.
+    tracker.Transition(a, statesA, Common);
+    CHECK(pending.size() == 2);
+    CHECK(pending.size() == 2 && IsTransition(pending[0], a, All, PixelShader, CopyDest, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY)
+        && IsTransition(pending[1], a, All, CopyDest, Common));
+
+    // The splits still open when a command list is closed.
+    tracker.Flush(flushed);
+    tracker.BeginTransition(a, statesA, PixelShader);
+    tracker.BeginTransition(b, statesB, CopyDest);
+    tracker.Flush(flushed);
+    CHECK(tracker.GetOpenSplitCount() == 2 && pending.empty());
+    tracker.EndOpenSplits();
+    CHECK(tracker.GetOpenSplitCount() == 0);
+    CHECK(pending.size() == 2 && IsTransition(pending[0], a, All, Common, PixelShader, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY)
+        && IsTransition(pending[1], b, All, Common, CopyDest, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+}
+
+// A cancelled pair before an unflushed begin shifts it in the batch, ending the split must still find it.
+TEST(ResourceStateTracker_CancelBeforeSplit)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* a = FakeResource(1);
+    ID3D12Resource* b = FakeResource(2);
+    SubresourceStates statesA(Common);
+    SubresourceStates statesB(Common);
+    const std::vector<D3D12_RESOURCE_BARRIER>& pending = tracker.GetPendingBarriers();
+
+    tracker.Transition(a, statesA, CopyDest);
+    tracker.BeginTransition(b, statesB, PixelShader);
+    tracker.Transition(a, statesA, Common);
+    CHECK(pending.size() == 1 && IsTransition(pending[0], b, All, Common, PixelShader, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+
+    tracker.Transition(b, statesB, PixelShader);
+    CHECK(tracker.GetOpenSplitCount() == 0);
+    CHECK(pending.size() == 1 && IsTransition(pending[0], b, All, Common, PixelShader));
+}
@@ -0,0 +1,160 @@
+#include "DXrenderer/Buffers/RingAllocator.h"
+
+#include <iterator>
+#include <map>
+#include <random>
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+namespace
+{
+constexpr UINT64 Capacity = 1024;
+}
+
+// A range that doesn't fit before the end starts over at 0, the skipped bytes stay used until the range before them is reclaimed.
+TEST(RingAllocator_WrapSkipsEnd)
+{
+    RingAllocator ring(Capacity);
+    CHECK(ring.Allocate(512, 1, 1) == 0);
+    CHECK(ring.Allocate(384, 1, 2) == 512);
+    ring.Reclaim(1);
+    CHECK(ring.GetUsedSize() == 384);
+
+    // 128 bytes at the end are skipped.
+    CHECK(ring.Allocate(256, 1, 3) == 0);
+    CHECK(ring.GetUsedSize() == 384 + 128 + 256);
+    // Doesn't fit before the range of fence 2.
+    CHECK(ring.Allocate(300, 1, 3) == RingAllocator::InvalidOffset);
+    CHECK(ring.Allocate(256, 1, 3) == 256);
+    CHECK(ring.GetUsedSize() == Capacity);
+
+    // The skipped bytes go with the range of fence 3, only the range of fence 2 is free again.
+    ring.Reclaim(2);
+    CHECK(ring.GetUsedSize() == 128 + 512);
+    CHECK(ring.Allocate(385, 1, 4) == RingAllocator::InvalidOffset);
+    CHECK(ring.Allocate(384, 1, 4) == 512);
+    CHECK(ring.Allocate(1, 1, 4) == RingAllocator::InvalidOffset);
+}
+
+// Consecutive allocations of one fence value are reclaimed together, the next fence value keeps its range.
+TEST(RingAllocator_MergesSameFence)
+{
+    RingAllocator ring(Capacity);
+    CHECK(ring.Allocate(100, 1, 1) == 0);
+    CHECK(ring.Allocate(100, 1, 1) == 100);
+    CHECK(ring.Allocate(100, 1, 1) == 200);
+    CHECK(ring.Allocate(100, 1, 2) == 300);
+    CHECK(ring.GetUsedSize() == 400);
+
+    ring.Reclaim(0);
+    CHECK(ring.GetUsedSize() == 400);
+    ring.Reclaim(1);
+    CHECK(ring.GetUsedSize() == 100);
+    // Everything up to the range of fence 2 is free: the end of the ring and then its start.
+    CHECK(ring.Allocate(624, 1, 3) == 400);
+    CHECK(ring.Allocate(300, 1, 3) == 0);
+    CHECK(ring.Allocate(1, 1, 3) == RingAllocator::InvalidOffset);
+}
+
+// With nothing in flight the ring starts over, so an allocation of the whole capacity fits wherever the previous ones ended.
+TEST(RingAllocator_ReclaimResetsHeadAndTail)
+{
+    RingAllocator ring(Capacity);
+    CHECK(ring.Allocate(600, 1, 1) == 0);
+    ring.Reclaim(1);
+    CHECK(ring.GetUsedSize() == 0);
+    CHECK(ring.Allocate(Capacity, 1, 2) == 0);
+    CHECK(ring.Allocate(1, 1, 2) == RingAllocator::InvalidOffset);
+    ring.Reclaim(2);
+    CHECK(ring.Allocate(Capacity, 1, 3) == 0);
+}
+
+TEST(RingAllocator_Full)
+{
+    RingAllocator ring(Capacity);
+    CHECK(ring.Allocate(Capacity + 1, 1, 1) == RingAllocator::InvalidOffset);
+    CHECK(ring.GetUsedSize() == 0);
+
+    // The alignment bytes count as used.
+    CHECK(ring.Allocate(1, 1, 1) == 0);
+    CHECK(ring.Allocate(1, 256, 1) == 256);
+    CHECK(ring.GetUsedSize() == 257);
+    CHECK(ring.Allocate(Capacity - 257, 1, 1) == 257);
+    CHECK(ring.GetUsedSize() == Capacity);
+    CHECK(ring.Allocate(1, 1, 1) == RingAllocator::InvalidOffset);
+
+    // Nothing is freed until the fence is passed.
+    ring.Reclaim(0);
+    CHECK(ring.Allocate(1, 1, 2) == RingAllocator::InvalidOffset);
+}
+
+// Random allocations with increasing fence values and a GPU lagging behind by a few of them: the live ranges never overlap, stay inside
+// the ring and aligned, and the used size covers at least all of them.
+TEST(RingAllocator_RandomNeverOverlaps)
+{
+    RingAllocator ring(Capacity);
+    std::map<UINT64, UINT64> live; // The end by the offset.
+    std::map<UINT64, std::vector<UINT64>> liveByFence; // The offsets by the fence value.
+    std::mt19937 rng(7);
+    const UINT64 alignments[] = { 1, 4, 16, 256 };
+
+    bool valid = true;
+    bool disjoint = true;
+    bool usedCovers = true;
+    UINT failedCount = 0;
+    UINT64 fenceValue = 1;
+    UINT64 completedFenceValue = 0;
+    for (UINT step = 0; step < 20000; ++step)
+    {
+        const UINT action = std::uniform_int_distribution<UINT>(0, 9)(rng);
+        if (action == 0)
+        {
+            ++fenceValue;
+        }
+        else if (action == 1 && completedFenceValue + 1 < fenceValue)
+        {
+            completedFenceValue = std::uniform_int_distribution<UINT64>(completedFenceValue + 1, fenceValue - 1)(rng);
+            ring.Reclaim(completedFenceValue);
+            while (!liveByFence.empty() && liveByFence.begin()->first <= completedFenceValue)
+            {
+                for (UINT64 offset : liveByFence.begin()->second)
+                    live.erase(offset);
+                liveByFence.erase(liveByFence.begin());
+            }
+        }
+        else
+        {
+            const UINT64 size = std::uniform_int_distribution<UINT64>(1, 200)(rng);
+            const UINT64 alignment = alignments[std::uniform_int_distribution<size_t>(0, 3)(rng)];
+            UINT64 offset = ring.Allocate(size, alignment, fenceValue);
+            if (offset == RingAllocator::InvalidOffset)
+            {
+                ++failedCount;
+            }
+            else
+            {
+                valid &= offset % alignment == 0 && offset + size <= Capacity;
+                auto next = live.lower_bound(offset);
+                disjoint &= next == live.end() || next->first >= offset + size;
+                disjoint &= next == live.begin() || std::prev(next)->second <= offset;
+                live[offset] = offset + size;
+                liveByFence[fenceValue].push_back(offset);
+            }
+        }
+
+        UINT64 liveSize = 0;
+        for (const auto& [offset, end] : live)
+            liveSize += end - offset;
+        usedCovers &= ring.GetUsedSize() >= liveSize && ring.GetUsedSize() <= Capacity;
+    }
+    CHECK(valid);
+    CHECK(disjoint);
+    CHECK(usedCovers);
+    CHECK(failedCount > 0);
+
+    ring.Reclaim(fenceValue);
+    CHECK(ring.GetUsedSize() == 0);
+    CHECK(ring.Allocate(Capacity, 1, fenceValue + 1) == 0);
+}
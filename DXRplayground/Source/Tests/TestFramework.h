@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <windows.h>
+
+namespace DirectxPlayground::Tests
+{
+// A minimal registry for the CPU tests of the renderer, no GPU or window is created. TEST defines a function which registers itself
+// before main, CHECK reports a failure and lets the test continue. TestsMain runs everything and returns the failures count.
+struct TestCase
+{
+    const char* Name = nullptr;
+    void (*Func)() = nullptr;
+};
+
+inline std::vector<TestCase>& GetTests()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+inline UINT& GetFailuresCount()
+{
+    static UINT failures = 0;
+    return failures;
+}
+
+struct TestRegistrar
+{
+    TestRegistrar(const char* name, void (*func)())
+    {
+        GetTests().push_back({ name, func });
+    }
+};
+
+inline void ReportFailure(const char* expression, const char* file, int line)
+{
+    printf("    %s(%d): CHECK(%s) failed\n", file, line, expression);
+    ++GetFailuresCount();
+}
+}
+
+#define TEST(name) \
+    static void name(); \
+    static const DirectxPlayground::Tests::TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(expression) \
+    ((expression) ? (void)0 : DirectxPlayground::Tests::ReportFailure(#expression, __FILE__, __LINE__))
+
+#define CHECK_NEAR(a, b, epsilon) \
+    CHECK(std::abs(double(a) - double(b)) <= double(epsilon))
@@ -0,0 +1,20 @@
+#include <windows.h>
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground::Tests;
+
+int main()
+{
+    UINT failedTests = 0;
+    for (const TestCase& test : GetTests())
+    {
+        printf("%s\n", test.Name);
+        UINT failures = GetFailuresCount();
+        test.Func();
+        if (GetFailuresCount() != failures)
+            ++failedTests;
+    }
+    printf("%zu tests, %u failed\n", GetTests().size(), failedTests);
+    return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include "DXrenderer/Textures/TextureCache.h"
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+namespace
+{
+TexResourceData MakeTexture(UINT srv, ResourceHandle resource)
+{
+    TexResourceData data;
+    data.SRVOffset = srv;
+    data.Resource = resource;
+    return data;
+}
+}
+
+// Every request of a path takes a reference, the texture and its keys are forgotten with the last one.
+TEST(TextureCache_RefCountDrop)
+{
+    TextureCache cache;
+    CHECK(cache.FindPath("a.png") == nullptr && cache.GetRefCount(3) == 0);
+
+    cache.Add(3, MakeTexture(3, 7), { 100 }, false);
+    TexResourceData first = cache.AddRef({ 3, InvalidOffset }, "a.png");
+    CHECK(first.SRVOffset == 3 && first.Resource == 7 && first.ArraySlice == InvalidOffset);
+    CHECK(cache.GetRefCount(3) == 1);
+
+    // Another path with the same cooked content and the same path again.
+    const TextureCache::Location* byContent = cache.FindContent(100);
+    CHECK(byContent != nullptr && byContent->Slot == 3);
+    cache.AddRef(*byContent, "copy_of_a.png");
+    const TextureCache::Location* byPath = cache.FindPath("a.png");
+    CHECK(byPath != nullptr && byPath->Slot == 3);
+    cache.AddRef(*byPath, "a.png");
+    CHECK(cache.GetRefCount(3) == 3);
+    CHECK(cache.FindPath("copy_of_a.png") != nullptr);
+
+    TexResourceData released;
+    CHECK(!cache.Release(3, released));
+    CHECK(!cache.Release(3, released));
+    CHECK(cache.GetRefCount(3) == 1 && cache.FindPath("a.png") != nullptr);
+    CHECK(cache.Release(3, released));
+    CHECK(released.SRVOffset == 3 && released.Resource == 7);
+    CHECK(cache.GetRefCount(3) == 0);
+    CHECK(cache.FindPath("a.png") == nullptr && cache.FindPath("copy_of_a.png") == nullptr && cache.FindContent(100) == nullptr);
+
+    // The slot can be taken again.
+    cache.Add(3, MakeTexture(3, 8), { 101 }, false);
+    CHECK(cache.AddRef({ 3, InvalidOffset }, "b.png").Resource == 8);
+}
+
+// The slices of a texture array are one entry, it's released once none of them is referenced.
+TEST(TextureCache_ArraySlices)
+{
+    TextureCache cache;
+    cache.Add(5, MakeTexture(5, 1), { 200, 201, 202 }, true);
+    const TextureCache::Location* second = cache.FindContent(201);
+    CHECK(second != nullptr && second->Slot == 5 && second->ArraySlice == 1);
+
+    TexResourceData slice0 = cache.AddRef(*cache.FindContent(200), "0.png");
+    TexResourceData slice2 = cache.AddRef(*cache.FindContent(202), "2.png");
+    CHECK(slice0.ArraySlice == 0 && slice2.ArraySlice == 2 && slice0.SRVOffset == slice2.SRVOffset);
+    CHECK(cache.GetRefCount(5) == 2);
+
+    TexResourceData released;
+    CHECK(!cache.Release(5, released));
+    CHECK(cache.FindContent(201) != nullptr);
+    CHECK(cache.Release(5, released));
+    CHECK(cache.FindContent(200) == nullptr && cache.FindContent(201) == nullptr && cache.FindPath("2.png") == nullptr);
+}
+
+// Textures the caller loaded itself aren't found by a path or a content, they are still released by the reference count.
+TEST(TextureCache_NotShared)
+{
+    TextureCache cache;
+    cache.Add(9, MakeTexture(9, 4), {}, false);
+    TexResourceData texture = cache.AddRef({ 9, InvalidOffset }, {});
+    CHECK(texture.Resource == 4 && cache.GetRefCount(9) == 1);
+    CHECK(cache.FindPath("") == nullptr);
+
+    TexResourceData released;
+    CHECK(cache.Release(9, released));
+    CHECK(released.Resource == 4 && cache.GetRefCount(9) == 0);
+}
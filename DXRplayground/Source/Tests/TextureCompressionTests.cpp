@@ -0,0 +1,108 @@
+#include "DXrenderer/Textures/TextureCompression.h"
+
+#include <cmath>
+#include <immintrin.h>
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+namespace
+{
+// Not a multiple of the block size, so the partial blocks at the edges are encoded too.
+constexpr UINT Width = 130;
+constexpr UINT Height = 66;
+
+// Smooth gradients with a sharp edge and a noisy alpha, close enough to real albedo and mask textures.
+std::vector<byte> MakeImage()
+{
+    std::vector<byte> rgba(size_t(Width) * Height * 4);
+    UINT seed = 1;
+    for (UINT y = 0; y < Height; ++y)
+    {
+        for (UINT x = 0; x < Width; ++x)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            byte* texel = &rgba[(size_t(y) * Width + x) * 4];
+            texel[0] = byte(128.0 + 100.0 * std::sin(x * 0.05));
+            texel[1] = byte(x * 255 / Width);
+            texel[2] = x < Width / 2 ? byte(y * 255 / Height) : byte(255 - y * 255 / Height);
+            texel[3] = byte(200 + (seed >> 16) % 50);
+        }
+    }
+    return rgba;
+}
+
+float CompressAndMeasure(const std::vector<byte>& rgba, DXGI_FORMAT format, UINT channelsMask)
+{
+    std::vector<byte> blocks = TextureCompression::Compress(rgba.data(), Width, Height, format);
+    CHECK(blocks.size() == size_t((Width + 3) / 4) * ((Height + 3) / 4) * (format == DXGI_FORMAT_BC1_UNORM || format == DXGI_FORMAT_BC4_UNORM ? 8 : 16));
+    std::vector<byte> decompressed = TextureCompression::Decompress(blocks.data(), Width, Height, format);
+    CHECK(decompressed.size() == rgba.size());
+    return TextureCompression::ComputePSNR(rgba.data(), decompressed.data(), Width, Height, channelsMask);
+}
+}
+
+TEST(TextureCompression_BC1)
+{
+    CHECK(CompressAndMeasure(MakeImage(), DXGI_FORMAT_BC1_UNORM, 0x7) > 37.0f);
+}
+
+TEST(TextureCompression_BC3)
+{
+    CHECK(CompressAndMeasure(MakeImage(), DXGI_FORMAT_BC3_UNORM, 0xF) > 35.0f);
+}
+
+TEST(TextureCompression_BC4)
+{
+    CHECK(CompressAndMeasure(MakeImage(), DXGI_FORMAT_BC4_UNORM, 0x1) > 50.0f);
+}
+
+TEST(TextureCompression_BC5)
+{
+    CHECK(CompressAndMeasure(MakeImage(), DXGI_FORMAT_BC5_UNORM, 0x3) > 50.0f);
+}
+
+TEST(TextureCompression_BC7)
+{
+    CHECK(CompressAndMeasure(MakeImage(), DXGI_FORMAT_BC7_UNORM, 0xF) > 35.0f);
+}
+
+// The HDR values are tonemapped to RGBA8 so the error is weighted the way it is seen on screen.
+TEST(TextureCompression_BC6H)
+{
+    std::vector<float> hdr(size_t(Width) * Height * 4);
+    for (UINT y = 0; y < Height; ++y)
+    {
+        for (UINT x = 0; x < Width; ++x)
+        {
+            float* texel = &hdr[(size_t(y) * Width + x) * 4];
+            texel[0] = 16.0f * float(x) / Width;
+            texel[1] = 0.5f + 0.5f * std::sin(y * 0.1f);
+            texel[2] = x < Width / 2 ? 0.01f * float(y) : 4.0f;
+            texel[3] = 1.0f;
+        }
+    }
+
+    std::vector<UINT16> half(hdr.size());
+    for (size_t i = 0; i < hdr.size(); i += 4)
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(half.data() + i), _mm_cvtps_ph(_mm_loadu_ps(hdr.data() + i), _MM_FROUND_TO_NEAREST_INT));
+    std::vector<byte> blocks = TextureCompression::CompressHdr(half.data(), Width, Height);
+    CHECK(blocks.size() == size_t((Width + 3) / 4) * ((Height + 3) / 4) * 16);
+    std::vector<UINT16> decompressed = TextureCompression::DecompressHdr(blocks.data(), Width, Height);
+    CHECK(decompressed.size() == half.size());
+
+    std::vector<byte> expected(hdr.size());
+    std::vector<byte> actual(hdr.size());
+    for (size_t i = 0; i < hdr.size(); i += 4)
+    {
+        float texel[4];
+        _mm_storeu_ps(texel, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(decompressed.data() + i))));
+        for (size_t c = 0; c < 3; ++c)
+        {
+            expected[i + c] = byte(255.0f * hdr[i + c] / (1.0f + hdr[i + c]) + 0.5f);
+            actual[i + c] = byte(255.0f * texel[c] / (1.0f + texel[c]) + 0.5f);
+        }
+    }
+    CHECK(TextureCompression::ComputePSNR(expected.data(), actual.data(), Width, Height, 0x7) > 37.0f);
+}
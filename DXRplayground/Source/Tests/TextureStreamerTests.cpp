@@ -0,0 +1,149 @@
+#include "DXrenderer/Textures/TextureStreamer.h"
+
+#include "Tests/TestFramework.h"
+
+using namespace DirectxPlayground;
+
+namespace
+{
+constexpr UINT MipTailSize = 128;
+
+// A square texture with one byte per texel, the levels up to MipTailSize are the mip tail.
+StreamedTextureDesc MakeDesc(UINT size)
+{
+    StreamedTextureDesc desc;
+    desc.Width = size;
+    desc.Height = size;
+    for (UINT s = size; ; s /= 2)
+    {
+        desc.MipSizes.push_back(UINT64(s) * s);
+        if (s > MipTailSize)
+            ++desc.MipTailStart;
+        if (s == 1)
+            break;
+    }
+    return desc;
+}
+
+UINT64 GetTailBytes(const StreamedTextureDesc& desc)
+{
+    UINT64 res = 0;
+    for (UINT mip = desc.MipTailStart; mip < desc.MipSizes.size(); ++mip)
+        res += desc.MipSizes[mip];
+    return res;
+}
+
+void LoadEverything(TextureStreamer& streamer)
+{
+    while (!streamer.Update(16).empty())
+        ;
+}
+}
+
+TEST(TextureStreamer_MaxLoadsCap)
+{
+    TextureStreamer streamer(~0ULL);
+    for (UINT i = 0; i < 4; ++i)
+        streamer.Register(MakeDesc(1024));
+
+    CHECK(streamer.Update(0).empty());
+
+    // 4 textures with 3 streamed levels each, one level per request and 2 requests per update.
+    UINT updates = 0;
+    UINT loads = 0;
+    for (std::vector<StreamingRequest> requests = streamer.Update(2); !requests.empty(); requests = streamer.Update(2))
+    {
+        CHECK(requests.size() <= 2);
+        loads += static_cast<UINT>(requests.size());
+        ++updates;
+    }
+    CHECK(loads == 12);
+    CHECK(updates == 6);
+    for (UINT id = 0; id < 4; ++id)
+        CHECK(streamer.GetResidentMip(id) == 0);
+}
+
+// Invisible textures go first, the least recently visible of them before the others. Visible ones keep the levels they need.
+TEST(TextureStreamer_EvictionOrder)
+{
+    TextureStreamer streamer(~0ULL);
+    const StreamedTextureDesc desc = MakeDesc(256);
+    const UINT64 topMipSize = desc.MipSizes[0];
+    UINT a = streamer.Register(desc);
+    UINT b = streamer.Register(desc);
+    UINT c = streamer.Register(desc);
+    LoadEverything(streamer);
+    CHECK(streamer.GetResidentMip(a) == 0 && streamer.GetResidentMip(b) == 0 && streamer.GetResidentMip(c) == 0);
+
+    streamer.SetFeedback(a, false, 0.0f);
+    streamer.Update(1);
+    streamer.SetFeedback(b, true, 256.0f);
+    streamer.Update(1);
+    streamer.SetFeedback(b, false, 0.0f);
+    streamer.SetFeedback(c, true, 256.0f);
+
+    // Becoming invisible doesn't evict anything while the budget holds.
+    CHECK(streamer.Update(1).empty());
+
+    streamer.SetBudget(streamer.GetResidentBytes() - topMipSize);
+    std::vector<StreamingRequest> requests = streamer.Update(1);
+    CHECK(requests.size() == 1 && requests[0].TextureId == a && requests[0].MostDetailedMip == 1);
+
+    streamer.SetBudget(streamer.GetResidentBytes() - topMipSize);
+    requests = streamer.Update(1);
+    CHECK(requests.size() == 1 && requests[0].TextureId == b && requests[0].MostDetailedMip == 1);
+
+    // Only the visible texture has its top level, and it needs it.
+    streamer.SetBudget(streamer.GetResidentBytes() - topMipSize);
+    CHECK(streamer.Update(1).empty());
+    CHECK(streamer.GetResidentMip(c) == 0);
+    CHECK(streamer.GetResidentBytes() > streamer.GetBudget());
+}
+
+TEST(TextureStreamer_MipTailIsNeverEvicted)
+{
+    TextureStreamer streamer(~0ULL);
+    const StreamedTextureDesc desc = MakeDesc(1024);
+    UINT a = streamer.Register(desc);
+    UINT b = streamer.Register(desc);
+    CHECK(streamer.GetResidentMip(a) == desc.MipTailStart);
+    CHECK(streamer.GetResidentBytes() == 2 * GetTailBytes(desc));
+    LoadEverything(streamer);
+
+    streamer.SetFeedback(a, false, 0.0f);
+    streamer.SetFeedback(b, false, 0.0f);
+    streamer.SetBudget(0);
+    streamer.Update(4);
+    CHECK(streamer.GetResidentMip(a) == desc.MipTailStart);
+    CHECK(streamer.GetResidentMip(b) == desc.MipTailStart);
+    CHECK(streamer.GetResidentBytes() == 2 * GetTailBytes(desc));
+
+    // A visible texture doesn't load above the tail when the budget has no room.
+    streamer.SetFeedback(a, true, 1024.0f);
+    CHECK(streamer.Update(4).empty());
+    CHECK(streamer.GetResidentMip(a) == desc.MipTailStart);
+}
+
+TEST(TextureStreamer_Unregister)
+{
+    TextureStreamer streamer(~0ULL);
+    const StreamedTextureDesc desc = MakeDesc(512);
+    UINT a = streamer.Register(desc);
+    UINT b = streamer.Register(desc);
+    LoadEverything(streamer);
+    const UINT64 textureBytes = streamer.GetResidentBytes() / 2;
+
+    // The released texture gives its bytes back and isn't evicted or loaded again.
+    streamer.Unregister(a);
+    CHECK(streamer.GetResidentBytes() == textureBytes);
+    streamer.SetFeedback(b, false, 0.0f);
+    streamer.SetBudget(0);
+    std::vector<StreamingRequest> requests = streamer.Update(4);
+    CHECK(requests.size() == 1 && requests[0].TextureId == b);
+
+    // Its id is reused and starts from the mip tail.
+    streamer.SetBudget(~0ULL);
+    CHECK(streamer.Register(desc) == a);
+    CHECK(streamer.GetResidentMip(a) == desc.MipTailStart);
+    CHECK(streamer.GetResidentBytes() == 2 * GetTailBytes(desc));
+}
@@ -12,6 +12,11 @@ public:
     virtual void Serialize(BinaryContainer& container) = 0;
     virtual void Deserialize(BinaryContainer& container) = 0;
     virtual size_t GetVersion() const = 0;
+    // Distinguishes cooked variants of the same source file, e.g. the same image compressed for different usages.
+    virtual std::string GetCookedNameSuffix() const
+    {
+        return {};
+    }
 
     virtual ~Asset() = default;
 };
@@ -18,13 +18,16 @@ size_t GetLastModificationTime(const std::string& assetPath)
     return static_cast<size_t>(lmtSinceEpoch.count());
 }
 
-void ParseAsset(const std::string& assetPath, Asset& asset, const std::filesystem::path& binAssetPath, size_t lastAssetModificationTime)
+void ParseAsset(const std::string& assetPath, Asset& asset, const std::filesystem::path& binAssetPath, size_t lastAssetModificationTime, const std::function<void()>& cook)
 {
     BinaryContainer container{};
     container << lastAssetModificationTime;
     container << asset.GetVersion();
 
-    asset.Parse(assetPath);
+    if (cook)
+        cook();
+    else
+        asset.Parse(assetPath);
     asset.Serialize(container);
     container.Close();
 
@@ -33,18 +36,48 @@ void ParseAsset(const std::string& assetPath, Asset& asset, const std::filesyste
     outFile.close();
 }
 
-void ParseAsset(const std::string& assetPath, Asset& asset, const std::filesystem::path& binAssetPath)
+void ParseAsset(const std::string& assetPath, Asset& asset, const std::filesystem::path& binAssetPath, const std::function<void()>& cook)
 {
     size_t lastModificationTime = GetLastModificationTime(assetPath);
-    ParseAsset(assetPath, asset, binAssetPath, lastModificationTime);
+    ParseAsset(assetPath, asset, binAssetPath, lastModificationTime, cook);
+}
+
+// Returns false if the cooked file is older than the source or was written by another version of the asset.
+bool DeserializeAsset(Asset& asset, const std::filesystem::path& binAssetPath, size_t lastAssetModificationTime)
+{
+    std::ifstream inFile(binAssetPath.string(), std::ios::in | std::ios::binary);
+    size_t byteSize = 0;
+    inFile.read((char*)&byteSize, sizeof(std::size_t));
+    char* buf = new char[byteSize];
+    inFile.read(buf, byteSize);
+    inFile.close();
+
+    BinaryContainer inContainer{ buf, byteSize };
+    size_t lastSavedModificationTime = 0;
+    inContainer >> lastSavedModificationTime;
+    size_t version = 0;
+    inContainer >> version;
+    assert(version <= asset.GetVersion());
+    if (lastAssetModificationTime > lastSavedModificationTime || asset.GetVersion() != version)
+        return false;
+    asset.Deserialize(inContainer);
+    return true;
 }
 }
 
 //#define FORCE_PARSE_ASSET
 void Load(const std::string& assetPath, Asset& asset)
+{
+    Load(assetPath, asset, {});
+}
+
+void Load(const std::string& assetPath, Asset& asset, const std::function<void()>& cook)
 {
 #ifdef FORCE_PARSE_ASSET
-    asset.Parse(assetPath);
+    if (cook)
+        cook();
+    else
+        asset.Parse(assetPath);
     return;
 #endif
 
@@ -59,7 +92,7 @@ void Load(const std::string& assetPath, Asset& asset)
     filesystem::path relative = std::filesystem::relative(assetPath, projectAssetsPath); // Models\FlightHelmet\glTF\FlightHelmet.gltf
     filesystem::path parentPath = projectAssetsPath.parent_path().parent_path(); // <-- due to // in assets assetPath. \Repos\DXRplayground\DXRplayground (to create tmp there)
     //auto assetPath = ASSETS_DIR + std::string("Models//FlightHelmet//glTF//FlightHelmet.gltf");
-    filesystem::path binAssetPath{ parentPath.string() + std::string("//tmp//") + relative.string() + std::string(".bast") }; // bast - binary asset extension
+    filesystem::path binAssetPath{ parentPath.string() + std::string("//tmp//") + relative.string() + asset.GetCookedNameSuffix() + std::string(".bast") }; // bast - binary asset extension
     if (!filesystem::exists(binAssetPath))
     {
         filesystem::path parentDir = binAssetPath.parent_path();
@@ -67,33 +100,27 @@ void Load(const std::string& assetPath, Asset& asset)
         {
             filesystem::create_directories(parentDir);
         }
-        ParseAsset(assetPath, asset, binAssetPath);
+        ParseAsset(assetPath, asset, binAssetPath, cook);
     }
     else
     {
         size_t lastModificationTimeCount = GetLastModificationTime(assetPath);
-
-        std::ifstream inFile(binAssetPath.string(), std::ios::in | std::ios::binary);
-        size_t byteSize = 0;
-        inFile.read((char*)&byteSize, sizeof(std::size_t));
-        char* buf = new char[byteSize];
-        inFile.read(buf, byteSize);
-        inFile.close();
-
-        BinaryContainer inContainer{ buf, byteSize };
-        size_t lastSavedModificationTime = 0;
-        inContainer >> lastSavedModificationTime;
-        size_t version = 0;
-        inContainer >> version;
-        assert(version <= asset.GetVersion());
-        if (lastModificationTimeCount <= lastSavedModificationTime && asset.GetVersion() == version)
-        {
-            asset.Deserialize(inContainer);
-        }
-        else
-        {
-            ParseAsset(assetPath, asset, binAssetPath, lastModificationTimeCount);
-        }
+        if (!DeserializeAsset(asset, binAssetPath, lastModificationTimeCount))
+            ParseAsset(assetPath, asset, binAssetPath, lastModificationTimeCount, cook);
     }
 }
+
+void LoadGenerated(const std::string& name, Asset& asset)
+{
+    using namespace std;
+
+    filesystem::path projectAssetsPath{ ASSETS_DIR };
+    filesystem::path parentPath = projectAssetsPath.parent_path().parent_path();
+    filesystem::path binAssetPath{ parentPath.string() + std::string("//tmp//Generated//") + name + asset.GetCookedNameSuffix() + std::string(".bast") };
+    // There is no source file, the modification time is always 0.
+    if (filesystem::exists(binAssetPath) && DeserializeAsset(asset, binAssetPath, 0))
+        return;
+    filesystem::create_directories(binAssetPath.parent_path());
+    ParseAsset(name, asset, binAssetPath, 0, {});
+}
 }
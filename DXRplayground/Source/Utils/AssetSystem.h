@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 
 namespace DirectxPlayground
@@ -9,5 +10,10 @@ class Asset;
 namespace AssetSystem
 {
 void Load(const std::string& assetPath, Asset& asset);
+// cook is called instead of Asset::Parse when the cooked file is missing or outdated, e.g. to cook several assets from one decoded source.
+void Load(const std::string& assetPath, Asset& asset, const std::function<void()>& cook);
+// For assets computed from their parameters alone, e.g. lookup tables. Asset::Parse gets the name, the cooked file is valid
+// while the asset version matches, so the parameters have to be a part of the cooked name suffix.
+void LoadGenerated(const std::string& name, Asset& asset);
 }
 }
@@ -3,6 +3,7 @@
 #include <string>
 #include <windows.h>
 #include <codecvt>
+#include <cstring>
 
 namespace DirectxPlayground
 {
@@ -36,4 +37,22 @@ inline UINT NextPOT(UINT v)
 {
     return static_cast<UINT>(pow(2, Log2(v)));
 }
+
+// FNV-1a over 8 byte words, the tail is hashed byte by byte. Fast enough for texture sized buffers, not meant to be cryptographic.
+inline UINT64 HashBytes(const void* data, size_t size, UINT64 seed = 14695981039346656037ull)
+{
+    constexpr UINT64 Prime = 1099511628211ull;
+    const byte* bytes = static_cast<const byte*>(data);
+    UINT64 hash = seed;
+    size_t i = 0;
+    for (; i + sizeof(UINT64) <= size; i += sizeof(UINT64))
+    {
+        UINT64 word;
+        memcpy(&word, bytes + i, sizeof(UINT64));
+        hash = (hash ^ word) * Prime;
+    }
+    for (; i < size; ++i)
+        hash = (hash ^ bytes[i]) * Prime;
+    return hash;
+}
 }
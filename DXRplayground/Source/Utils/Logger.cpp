@@ -6,11 +6,12 @@ ImguiLogger ImguiLogger::Logger{};
 
 ImguiLogger::ImguiLogger()
 {
-    Clear();
+    ClearInternal();
 }
 
 void ImguiLogger::Draw(const char* title, bool* p_open /*= NULL*/)
 {
+    std::lock_guard<std::mutex> lock(mMutex);
     if (!ImGui::Begin(title, p_open))
     {
         ImGui::End();
@@ -29,7 +30,7 @@ void ImguiLogger::Draw(const char* title, bool* p_open /*= NULL*/)
     ImGui::BeginChild("scrolling", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
 
     if (clear)
-        Clear();
+        ClearInternal();
     if (copy)
         ImGui::LogToClipboard();
 
@@ -3,6 +3,7 @@
 #include "External/IMGUI/imgui.h"
 #include "Utils/Helpers.h"
 
+#include <mutex>
 #include <string>
 #include <sstream>
 #include <locale>
@@ -11,6 +12,7 @@
 namespace DirectxPlayground
 {
 
+// LOG may be called from worker threads, e.g. while the textures are loaded in parallel, the buffer is guarded by a mutex.
 class ImguiLogger
 {
 public:
@@ -23,8 +25,10 @@ public:
     void Draw(const char* title, bool* p_open = NULL);
 
 private:
+    void ClearInternal();
     void AddLogInternal(const char* fmt, ...);
 
+    std::mutex mMutex;
     ImGuiTextBuffer mTextBuffer;
     ImVector<int> mLineOffsets; // Index to lines offset. We maintain this with AddLog() calls, allowing us to have a random access on lines
     bool mAutoScroll = true;
@@ -33,16 +37,23 @@ private:
 
 inline void ImguiLogger::Clear()
 {
-    mTextBuffer.clear();
-    mLineOffsets.clear();
-    mLineOffsets.push_back(0);
+    std::lock_guard<std::mutex> lock(mMutex);
+    ClearInternal();
 }
 
 inline void ImguiLogger::AddLog(const std::string& msg)
 {
+    std::lock_guard<std::mutex> lock(mMutex);
     AddLogInternal("%s \n", msg.c_str());
 }
 
+inline void ImguiLogger::ClearInternal()
+{
+    mTextBuffer.clear();
+    mLineOffsets.clear();
+    mLineOffsets.push_back(0);
+}
+
 
 namespace Internal
 {
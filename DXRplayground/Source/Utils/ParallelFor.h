@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace DirectxPlayground
+{
+namespace Internal
+{
+inline thread_local bool IsParallelForWorker = false;
+}
+
+// Calls func(i) for every i in [0, count) on a set of worker threads (the calling thread works too). Blocks until everything is processed.
+// A ParallelFor called from func runs on the calling worker, e.g. the mips of the textures loaded in parallel, so nested loops don't
+// multiply the threads.
+inline void ParallelFor(size_t count, const std::function<void(size_t)>& func, size_t maxThreads = 0)
+{
+    if (count == 0)
+        return;
+
+    size_t threadsCount = maxThreads == 0 ? static_cast<size_t>(std::thread::hardware_concurrency()) : maxThreads;
+    threadsCount = Internal::IsParallelForWorker ? 1 : std::clamp<size_t>(threadsCount, 1, count);
+    if (threadsCount == 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+            func(i);
+        return;
+    }
+
+    std::atomic<size_t> nextItem = 0;
+    auto worker = [&]()
+    {
+        Internal::IsParallelForWorker = true;
+        for (size_t i = nextItem++; i < count; i = nextItem++)
+            func(i);
+        Internal::IsParallelForWorker = false;
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadsCount - 1);
+    for (size_t i = 1; i < threadsCount; ++i)
+        workers.emplace_back(worker);
+    worker();
+    for (auto& w : workers)
+        w.join();
+}
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cassert>
 #include <string>
+#include <vector>
 #include <d3d12.h>
 #include <chrono>
 #include <ctime>
@@ -31,19 +33,51 @@ public:
     ~ScopedGpuEvent();
 
 private:
+    friend void EndOpenEvents(ID3D12GraphicsCommandList* commandList);
+    friend void ReopenEvents(ID3D12GraphicsCommandList* previousList, ID3D12GraphicsCommandList* commandList);
+
     ID3D12GraphicsCommandList* mCmdList = nullptr;
+    std::string mName;
 };
 
-inline ScopedGpuEvent::ScopedGpuEvent(ID3D12GraphicsCommandList* commandList, const std::string& name) : mCmdList(commandList)
+// The events of the thread, innermost last. A command list is recorded by one thread, so this never needs a lock.
+inline thread_local std::vector<ScopedGpuEvent*> OpenEvents;
+
+inline ScopedGpuEvent::ScopedGpuEvent(ID3D12GraphicsCommandList* commandList, const std::string& name) : mCmdList(commandList), mName(name)
 {
-    PIXBeginEvent(mCmdList, PIX_COLOR(0, 0, 254), name.c_str());
+    PIXBeginEvent(mCmdList, PIX_COLOR(0, 0, 254), mName.c_str());
+    OpenEvents.push_back(this);
 }
 
 inline ScopedGpuEvent::~ScopedGpuEvent()
 {
+    assert(OpenEvents.back() == this && "Scoped events end in the reverse order");
+    OpenEvents.pop_back();
     PIXEndEvent(mCmdList);
 }
 
+// An event can't span command lists. When the recording of a list continues in another one, the events open in it end before it's
+// closed and ReopenEvents begins them again in the next list, see IRenderPipeline::RecordParallel.
+inline void EndOpenEvents(ID3D12GraphicsCommandList* commandList)
+{
+    for (auto it = OpenEvents.rbegin(); it != OpenEvents.rend(); ++it)
+    {
+        if ((*it)->mCmdList == commandList)
+            PIXEndEvent(commandList);
+    }
+}
+
+inline void ReopenEvents(ID3D12GraphicsCommandList* previousList, ID3D12GraphicsCommandList* commandList)
+{
+    for (ScopedGpuEvent* event : OpenEvents)
+    {
+        if (event->mCmdList != previousList)
+            continue;
+        event->mCmdList = commandList;
+        PIXBeginEvent(commandList, PIX_COLOR(0, 0, 254), event->mName.c_str());
+    }
+}
+
 inline void BeginCaptureGpuFrame()
 {
     std::wstring filename = PIX_CAPTURES_DIR_W + GetCurrentCaptureName();